@@ -26,7 +26,10 @@ struct GGPOSession {
     virtual GGPOErrorCode SetFrameDelay(GGPOPlayerHandle player, int delay) { return GGPO_ERRORCODE_UNSUPPORTED; }
 	virtual GGPOErrorCode SetDisconnectTimeout(int timeout) { return GGPO_ERRORCODE_UNSUPPORTED; }
 	virtual GGPOErrorCode SetDisconnectNotifyStart(int timeout) { return GGPO_ERRORCODE_UNSUPPORTED; }
+	virtual GGPOErrorCode SetCompactInput(bool enabled) { return GGPO_ERRORCODE_UNSUPPORTED; }
 	virtual GGPOErrorCode TrySynchronizeLocal() { return GGPO_ERRORCODE_UNSUPPORTED; } 
+	virtual GGPOErrorCode SetSyncTestRandomRollbacks(int max_frames, unsigned int seed) { return GGPO_ERRORCODE_UNSUPPORTED; }
+	virtual GGPOErrorCode GetSyncTestStats(GGPOSyncTestStats *stats) { return GGPO_ERRORCODE_UNSUPPORTED; }
 };
 
 typedef struct GGPOSession Quark, IQuarkBackend; /* XXX: nuke this */
@@ -17,14 +17,18 @@ Peer2PeerBackend::Peer2PeerBackend(GGPOSessionCallbacks *cb,
                                    const char *gamename,
                                    ConnectionManager* connection_manager,
                                    int num_players,
-                                   int input_size) :
+                                   int input_size,
+                                   const GGPOSessionLimits &limits) :
     _sync(_local_connect_status),
     _num_spectators(0),
     _input_size(input_size),
+    _limits(limits),
     _num_players(num_players),
     _next_spectator_frame(0),
+    _spectator_first_frame(0),
     _disconnect_timeout(DEFAULT_DISCONNECT_TIMEOUT),
-    _disconnect_notify_start(DEFAULT_DISCONNECT_NOTIFY_START)
+    _disconnect_notify_start(DEFAULT_DISCONNECT_NOTIFY_START),
+    _compact_input(true)
 {
    _callbacks = *cb;
    _synchronizing = true;
@@ -37,7 +41,9 @@ Peer2PeerBackend::Peer2PeerBackend(GGPOSessionCallbacks *cb,
    config.num_players = num_players;
    config.input_size = input_size;
    config.callbacks = _callbacks;
-   config.num_prediction_frames = MAX_PREDICTION_FRAMES;
+   config.num_prediction_frames = limits.prediction_frames;
+   config.input_queue_length = limits.input_queue_length;
+   config.save_interval = limits.save_interval;
    _sync.Init(config);
 
    /*
@@ -75,6 +81,7 @@ Peer2PeerBackend::AddRemotePlayer(int connection_id,
    _endpoints[queue].Init(&_udp, _poll, queue, connection_id, _local_connect_status);
    _endpoints[queue].SetDisconnectTimeout(_disconnect_timeout);
    _endpoints[queue].SetDisconnectNotifyStart(_disconnect_notify_start);
+   _endpoints[queue].SetCompactInput(_compact_input);
    _endpoints[queue].Synchronize();
 }
 
@@ -84,9 +91,9 @@ GGPOErrorCode Peer2PeerBackend::AddSpectator(int connection_id)
       return GGPO_ERRORCODE_TOO_MANY_SPECTATORS;
    }
    /*
-    * Currently, we can only add spectators before the game starts.
+    * Once the game has started, spectators need a snapshot to start from.
     */
-   if (!_synchronizing) {
+   if (!_synchronizing && !_callbacks.make_snapshot) {
       return GGPO_ERRORCODE_INVALID_REQUEST;
    }
    int queue = _num_spectators++;
@@ -94,7 +101,10 @@ GGPOErrorCode Peer2PeerBackend::AddSpectator(int connection_id)
    _spectators[queue].Init(&_udp, _poll, queue + 1000, connection_id, _local_connect_status);
    _spectators[queue].SetDisconnectTimeout(_disconnect_timeout);
    _spectators[queue].SetDisconnectNotifyStart(_disconnect_notify_start);
+   _spectators[queue].SetCompactInput(_compact_input);
    _spectators[queue].Synchronize();
+   _spectator_next_frame[queue] = _synchronizing ? 0 : -1;
+   _spectator_disconnected[queue] = false;
 
    return GGPO_OK;
 }
@@ -127,7 +137,11 @@ Peer2PeerBackend::DoPoll(int timeout)
          Log("last confirmed frame in p2p backend is %d.\n", total_min_confirmed);
          if (total_min_confirmed >= 0) {
             ASSERT(total_min_confirmed != INT_MAX);
-            if (_num_spectators > 0) {
+            /*
+             * Confirmed inputs are kept for spectators even before there are any,
+             * if one could join later.
+             */
+            if (_num_spectators > 0 || _callbacks.make_snapshot) {
                while (_next_spectator_frame <= total_min_confirmed) {
                   Log("pushing frame %d to spectators.\n", _next_spectator_frame);
    
@@ -135,11 +149,10 @@ Peer2PeerBackend::DoPoll(int timeout)
                   input.frame = _next_spectator_frame;
                   input.size = _input_size * _num_players;
                   _sync.GetConfirmedInputs(input.bits, _input_size * _num_players, _next_spectator_frame);
-                  for (int i = 0; i < _num_spectators; i++) {
-                     _spectators[i].SendInput(input);
-                  }
+                  _spectator_inputs.push_back(input);
                   _next_spectator_frame++;
                }
+               SendSpectatorInputs();
             }
             Log("setting confirmed frame in sync to %d.\n", total_min_confirmed);
             _sync.SetLastConfirmedFrame(total_min_confirmed);
@@ -160,11 +173,18 @@ Peer2PeerBackend::DoPoll(int timeout)
                _next_recommended_sleep = current_frame + RECOMMENDATION_INTERVAL;
             }
          }
-         // XXX: this is obviously a farce...
+         // Sleep until a packet arrives, and handle it before returning.
+         // Anything queued above goes out first so the remote side isn't
+         // kept waiting on us for the length of the sleep.
          if (timeout) {
-            Platform::SleepMS(1);
+            _udp.Flush();
+         }
+         if (timeout && _poll.Wait(timeout)) {
+            _poll.Pump(0);
+            PollUdpProtocolEvents();
          }
       }
+      _udp.Flush();
    }
    return GGPO_OK;
 }
@@ -303,6 +323,7 @@ Peer2PeerBackend::AddLocalInput(GGPOPlayerHandle player,
             _endpoints[i].SendInput(input);
          }
       }
+      _udp.Flush();
    }
 
    return GGPO_OK;
@@ -396,20 +417,107 @@ Peer2PeerBackend::OnUdpProtocolSpectatorEvent(UdpProtocol::Event &evt, int queue
    GGPOPlayerHandle handle = QueueToSpectatorHandle(queue);
    OnUdpProtocolEvent(evt, handle);
 
-   GGPOEvent info;
-
    switch (evt.type) {
    case UdpProtocol::Event::Disconnected:
-      _spectators[queue].Disconnect();
+      DisconnectSpectator(queue);
+      break;
+   }
+}
 
-      info.code = GGPO_EVENTCODE_DISCONNECTED_FROM_PEER;
-      info.u.disconnected.player = handle;
-      _callbacks.on_event(&info);
+void
+Peer2PeerBackend::DisconnectSpectator(int queue)
+{
+   GGPOEvent info;
 
-      break;
+   _spectators[queue].Disconnect();
+   _spectator_disconnected[queue] = true;
+
+   info.code = GGPO_EVENTCODE_DISCONNECTED_FROM_PEER;
+   info.u.disconnected.player = QueueToSpectatorHandle(queue);
+   _callbacks.on_event(&info);
+}
+
+void
+Peer2PeerBackend::SendSpectatorInputs(void)
+{
+   int end_frame = _spectator_first_frame + (int)_spectator_inputs.size();
+   /*
+    * A spectator joining now starts from the last save no later than the current
+    * frame, so the inputs from there on are kept too.
+    */
+   int oldest_needed = _sync.GetLastSaveFrame(MIN(end_frame, _sync.GetFrameCount()));
+
+   for (int i = 0; i < _num_spectators; i++) {
+      if (_spectator_disconnected[i]) {
+         continue;
+      }
+      if (_spectator_next_frame[i] < 0) {
+         if (!_spectators[i].IsRunning()) {
+            continue;
+         }
+         SendSpectatorSnapshot(i);
+         if (_spectator_next_frame[i] < 0) {
+            continue;
+         }
+      }
+      int &next_frame = _spectator_next_frame[i];
+      oldest_needed = MIN(oldest_needed, next_frame);
+      if (!_spectators[i].IsRunning() || _spectators[i].IsSendingSnapshot()) {
+         continue;
+      }
+
+      /*
+       * Spectators get several frames per packet.  It costs them a few frames of
+       * latency, but saves the players' uplink most of the packets.  Anything left
+       * over goes out with the endpoint's resend timer.  Ones catching up get what
+       * fits in one packet at a time.
+       */
+      bool send = false;
+      while (next_frame < end_frame && _spectators[i].GetPendingOutputSize() < UdpProtocol::MAX_SPECTATOR_PENDING_OUTPUT) {
+         _spectators[i].QueueInput(_spectator_inputs[next_frame - _spectator_first_frame]);
+         next_frame++;
+         send = send || next_frame % GGPO_SPECTATOR_INPUT_INTERVAL == 0;
+      }
+      if (send) {
+         _spectators[i].SendPendingOutput();
+      }
+   }
+
+   while (_spectator_first_frame < oldest_needed) {
+      _spectator_inputs.pop_front();
+      _spectator_first_frame++;
    }
 }
 
+/*
+ * Starts a spectator that joined a game in progress from the state at the start
+ * of the first frame it hasn't been sent the inputs for.  Every input before that
+ * frame is confirmed and the rollback for it is done, so the saved state is final.
+ */
+void
+Peer2PeerBackend::SendSpectatorSnapshot(int queue)
+{
+   int frame = _sync.GetLastSaveFrame(MIN(_next_spectator_frame, _sync.GetFrameCount()));
+   byte *buf;
+   int len;
+   if (!_sync.GetSavedFrame(frame, &buf, &len)) {
+      Log("No saved state of frame %d for spectator %d yet.\n", frame, queue);
+      return;
+   }
+
+   unsigned char *snapshot = NULL;
+   int snapshot_len = 0;
+   if (!_callbacks.make_snapshot(buf, len, &snapshot, &snapshot_len) || !snapshot || snapshot_len <= 0) {
+      Log("Could not make a snapshot of frame %d for spectator %d.\n", frame, queue);
+      delete [] snapshot;
+      DisconnectSpectator(queue);
+      return;
+   }
+   _spectators[queue].SendSnapshot(frame, snapshot, snapshot_len);
+   delete [] snapshot;
+   _spectator_next_frame[queue] = frame;
+}
+
 void
 Peer2PeerBackend::OnUdpProtocolEvent(UdpProtocol::Event &evt, GGPOPlayerHandle handle)
 {
@@ -501,6 +609,7 @@ Peer2PeerBackend::DisconnectPlayerQueue(int queue, int syncto)
 
    _local_connect_status[queue].disconnected = 1;
    _local_connect_status[queue].last_frame = syncto;
+   Trace(TRACE_DISCONNECT, queue, syncto);
 
    if (syncto < framecount) {
       Log("adjusting simulation to account for the fact that %d disconnected @ %d.\n", queue, syncto);
@@ -529,6 +638,7 @@ Peer2PeerBackend::GetNetworkStats(FGGPONetworkStats *stats, GGPOPlayerHandle pla
 
    memset(stats, 0, sizeof *stats);
    _endpoints[queue].GetNetworkStats(stats);
+   stats->timesync.confirmed_frame = _sync.GetLastConfirmedFrame();
 
    return GGPO_OK;
 }
@@ -543,6 +653,14 @@ Peer2PeerBackend::SetFrameDelay(GGPOPlayerHandle player, int delay)
    if (!GGPO_SUCCEEDED(result)) {
       return result;
    }
+   /*
+    * Delayed inputs wait in the queue on top of both players' prediction
+    * windows and the frames since the last save, so the queue has to hold
+    * them all.
+    */
+   if (delay < 0 || 2 * _limits.prediction_frames + _limits.save_interval - 1 + delay >= _limits.input_queue_length) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
    _sync.SetFrameDelay(queue, delay);
    return GGPO_OK; 
 }
@@ -571,6 +689,13 @@ Peer2PeerBackend::SetDisconnectNotifyStart(int timeout)
    return GGPO_OK;
 }
 
+GGPOErrorCode
+Peer2PeerBackend::SetCompactInput(bool enabled)
+{
+   _compact_input = enabled;
+   return GGPO_OK;
+}
+
 GGPOErrorCode
 Peer2PeerBackend::TrySynchronizeLocal()
 {
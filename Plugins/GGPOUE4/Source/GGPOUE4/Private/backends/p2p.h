@@ -8,6 +8,7 @@
 #ifndef _P2P_H
 #define _P2P_H
 
+#include <deque>
 #include "types.h"
 #include "poll.h"
 #include "sync.h"
@@ -17,7 +18,7 @@
 
 class Peer2PeerBackend : public IQuarkBackend, IPollSink, Udp::Callbacks {
 public:
-   Peer2PeerBackend(GGPOSessionCallbacks *cb, const char *gamename, ConnectionManager* connection_manager, int num_players, int input_size);
+   Peer2PeerBackend(GGPOSessionCallbacks *cb, const char *gamename, ConnectionManager* connection_manager, int num_players, int input_size, const GGPOSessionLimits &limits);
    virtual ~Peer2PeerBackend();
 
 
@@ -34,6 +35,7 @@ public:
    virtual GGPOErrorCode SetFrameDelay(GGPOPlayerHandle player, int delay);
    virtual GGPOErrorCode SetDisconnectTimeout(int timeout);
    virtual GGPOErrorCode SetDisconnectNotifyStart(int timeout);
+   virtual GGPOErrorCode SetCompactInput(bool enabled) override;
    virtual GGPOErrorCode TrySynchronizeLocal() override;
 
 public:
@@ -51,6 +53,9 @@ protected:
    int PollNPlayers(int current_frame);
    void AddRemotePlayer(int connection_id, int queue);
    GGPOErrorCode AddSpectator(int connection_id);
+   void SendSpectatorInputs(void);
+   void SendSpectatorSnapshot(int queue);
+   void DisconnectSpectator(int queue);
    virtual void OnSyncEvent(Sync::Event &e) { }
    virtual void OnUdpProtocolEvent(UdpProtocol::Event &e, GGPOPlayerHandle handle);
    virtual void OnUdpProtocolPeerEvent(UdpProtocol::Event &e, int queue);
@@ -65,14 +70,20 @@ protected:
    UdpProtocol           _spectators[GGPO_MAX_SPECTATORS];
    int                   _num_spectators;
    int                   _input_size;
+   GGPOSessionLimits     _limits;
 
    bool                  _synchronizing;
    int                   _num_players;
    int                   _next_recommended_sleep;
 
    int                   _next_spectator_frame;
+   std::deque<GameInput> _spectator_inputs;        // confirmed, but not yet queued for every spectator
+   int                   _spectator_first_frame;   // frame of _spectator_inputs.front()
+   int                   _spectator_next_frame[GGPO_MAX_SPECTATORS]; // -1 until one added late has a snapshot
+   bool                  _spectator_disconnected[GGPO_MAX_SPECTATORS];
    int                   _disconnect_timeout;
    int                   _disconnect_notify_start;
+   bool                  _compact_input;
 
    UdpMsg::connect_status _local_connect_status[UDP_MSG_MAX_PLAYERS];
 };
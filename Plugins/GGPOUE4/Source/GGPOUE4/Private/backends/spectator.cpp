@@ -7,23 +7,31 @@
 
 #include "spectator.h"
 
+/*
+ * How long relayed inputs wait for a full batch once the host goes quiet,
+ * so the last frames of a match still go out.
+ */
+static const int RELAY_FLUSH_INTERVAL = 100;
+
 SpectatorBackend::SpectatorBackend(GGPOSessionCallbacks *cb,
                                    const char* gamename,
                                    ConnectionManager* connection_manager,
                                    int num_players,
                                    int input_size,
-                                   int connection_id) :
+                                   int connection_id,
+                                   const GGPOSessionLimits &limits) :
    _input_size(input_size),
    _num_players(num_players),
-   _next_input_to_send(0)
+   _next_input_to_send(0),
+   _max_inputs(limits.spectator_frames),
+   _compact_input(true),
+   _num_spectators(0),
+   _relay_first_frame(0),
+   _relay_last_input_time(0)
 {
    _callbacks = *cb;
    _synchronizing = true;
 
-   for (int i = 0; i < ARRAY_SIZE(_inputs); i++) {
-      _inputs[i].frame = -1;
-   }
-
    /*
     * Initialize the UDP port
     */
@@ -49,8 +57,60 @@ GGPOErrorCode
 SpectatorBackend::DoPoll(int timeout)
 {
    _poll.Pump(0);
-
    PollUdpProtocolEvents();
+   if (timeout) {
+      /* Don't hold acks and relayed inputs back while we sleep. */
+      RelayInputs();
+      _udp.Flush();
+   }
+   if (timeout && _poll.Wait(timeout)) {
+      _poll.Pump(0);
+      PollUdpProtocolEvents();
+   }
+
+   RelayInputs();
+   _udp.Flush();
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+SpectatorBackend::AddPlayer(GGPOPlayer *player,
+                            GGPOPlayerHandle *handle)
+{
+   if (player->type != GGPO_PLAYERTYPE_SPECTATOR) {
+      return GGPO_ERRORCODE_UNSUPPORTED;
+   }
+   if (_num_spectators == GGPO_MAX_SPECTATORS) {
+      return GGPO_ERRORCODE_TOO_MANY_SPECTATORS;
+   }
+   /*
+    * Inputs are only kept for relaying once there is someone to relay them
+    * to, so spectators have to be added before the first one arrives.
+    */
+   if (_next_input_to_send > 0 || !_inputs.empty()) {
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
+   int queue = _num_spectators++;
+
+   _spectators[queue].Init(&_udp, _poll, queue + 1000, player->connection_id, NULL);
+   _spectators[queue].SetCompactInput(_compact_input);
+   _spectators[queue].Synchronize();
+   _spectator_next_frame[queue] = 0;
+   _spectator_disconnected[queue] = false;
+   if (handle) {
+      *handle = QueueToSpectatorHandle(queue);
+   }
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+SpectatorBackend::SetCompactInput(bool enabled)
+{
+   _compact_input = enabled;
+   _host.SetCompactInput(enabled);
+   for (int i = 0; i < _num_spectators; i++) {
+      _spectators[i].SetCompactInput(enabled);
+   }
    return GGPO_OK;
 }
 
@@ -64,14 +124,18 @@ SpectatorBackend::SyncInput(void *values,
       return GGPO_ERRORCODE_NOT_SYNCHRONIZED;
    }
 
-   GameInput &input = _inputs[_next_input_to_send % SPECTATOR_FRAME_BUFFER_SIZE];
-   if (input.frame < _next_input_to_send) {
+   // Inputs from before a snapshot was loaded are of no use.
+   while (!_inputs.empty() && _inputs.front().frame < _next_input_to_send) {
+      _inputs.pop_front();
+   }
+   if (_inputs.empty()) {
       // Haven't received the input from the host yet.  Wait
       return GGPO_ERRORCODE_PREDICTION_THRESHOLD;
    }
+   GameInput &input = _inputs.front();
    if (input.frame > _next_input_to_send) {
-      // The host is way way way far ahead of the spectator.  How'd this
-      // happen?  Anyway, the input we need is gone forever.
+      // The host started sending after the frame we need, and there was
+      // no snapshot to start from instead.  The input is gone forever.
       return GGPO_ERRORCODE_GENERAL_FAILURE;
    }
 
@@ -80,6 +144,7 @@ SpectatorBackend::SyncInput(void *values,
    if (disconnect_flags) {
       *disconnect_flags = 0; // xxx: should get them from the host!
    }
+   _inputs.pop_front();
    _next_input_to_send++;
 
    return GGPO_OK;
@@ -102,6 +167,61 @@ SpectatorBackend::PollUdpProtocolEvents(void)
    while (_host.GetEvent(evt)) {
       OnUdpProtocolEvent(evt);
    }
+   for (int i = 0; i < _num_spectators; i++) {
+      while (_spectators[i].GetEvent(evt)) {
+         OnUdpProtocolSpectatorEvent(evt, i);
+      }
+   }
+}
+
+void
+SpectatorBackend::RelayInputs(void)
+{
+   if (_num_spectators == 0) {
+      return;
+   }
+
+   int end_frame = _relay_first_frame + (int)_relay_inputs.size();
+   int oldest_needed = end_frame;
+   /*
+    * Keep no more than this spectator does for itself.  A downstream
+    * spectator that never synchronizes, or falls that far behind, is
+    * dropped rather than holding every input since it was added.
+    */
+   int oldest_kept = end_frame - _max_inputs;
+   int batch_frames = GGPO_SPECTATOR_INPUT_INTERVAL;
+   if (Platform::GetCurrentTimeMS() - _relay_last_input_time >= RELAY_FLUSH_INTERVAL) {
+      batch_frames = 1;
+   }
+   for (int i = 0; i < _num_spectators; i++) {
+      if (_spectator_disconnected[i]) {
+         continue;
+      }
+      /*
+       * Send once a batch of frames is ready, and keep the pending output
+       * small enough for one input message.  Spectators that are still
+       * synchronizing catch up from the first frame.
+       */
+      int &next_frame = _spectator_next_frame[i];
+      if (next_frame < oldest_kept) {
+         Log("Spectator %d fell %d frames behind, disconnecting.\n", i, end_frame - next_frame);
+         DisconnectSpectator(i);
+         continue;
+      }
+      if (_spectators[i].IsRunning() && !_spectators[i].IsSendingSnapshot() && end_frame - next_frame >= batch_frames) {
+         while (next_frame < end_frame && _spectators[i].GetPendingOutputSize() < UdpProtocol::MAX_SPECTATOR_PENDING_OUTPUT) {
+            _spectators[i].QueueInput(_relay_inputs[next_frame - _relay_first_frame]);
+            next_frame++;
+         }
+         _spectators[i].SendPendingOutput();
+      }
+      oldest_needed = MIN(oldest_needed, next_frame);
+   }
+
+   while (_relay_first_frame < oldest_needed) {
+      _relay_inputs.pop_front();
+      _relay_first_frame++;
+   }
 }
 
 void
@@ -153,21 +273,80 @@ SpectatorBackend::OnUdpProtocolEvent(UdpProtocol::Event &evt)
       _callbacks.on_event(&info);
       break;
 
+   case UdpProtocol::Event::Snapshot: {
+      std::vector<uint8> snapshot;
+      int frame = evt.u.snapshot.frame;
+      _host.TakeSnapshot(snapshot);
+      Log("Starting from the snapshot of frame %d (%d bytes).\n", frame, (int)snapshot.size());
+      if (_callbacks.load_snapshot && !_callbacks.load_snapshot(snapshot.data(), (int)snapshot.size(), frame)) {
+         Log("Could not load the snapshot of frame %d.\n", frame);
+         break;
+      }
+      _next_input_to_send = frame;
+
+      // Our own spectators start from the same snapshot.
+      _relay_inputs.clear();
+      _relay_first_frame = frame;
+      for (int i = 0; i < _num_spectators; i++) {
+         _spectators[i].SendSnapshot(frame, snapshot.data(), (int)snapshot.size());
+         _spectator_next_frame[i] = frame;
+      }
+      break;
+   }
+
    case UdpProtocol::Event::Input:
       GameInput& input = evt.u.input.input;
 
       _host.SetLocalFrameNumber(input.frame);
       _host.SendInputAck();
-      _inputs[input.frame % SPECTATOR_FRAME_BUFFER_SIZE] = input;
+      _inputs.push_back(input);
+      if ((int)_inputs.size() > _max_inputs) {
+         _inputs.pop_front();
+      }
+      if (_num_spectators > 0) {
+         ASSERT(input.frame == _relay_first_frame + (int)_relay_inputs.size());
+         _relay_inputs.push_back(input);
+         _relay_last_input_time = Platform::GetCurrentTimeMS();
+      }
       break;
    }
 }
+
+void
+SpectatorBackend::OnUdpProtocolSpectatorEvent(UdpProtocol::Event &evt, int queue)
+{
+   switch (evt.type) {
+   case UdpProtocol::Event::Disconnected:
+      DisconnectSpectator(queue);
+      break;
+   }
+}
+
+void
+SpectatorBackend::DisconnectSpectator(int queue)
+{
+   GGPOEvent info;
+
+   _spectators[queue].Disconnect();
+   _spectator_disconnected[queue] = true;
+
+   info.code = GGPO_EVENTCODE_DISCONNECTED_FROM_PEER;
+   info.u.disconnected.player = QueueToSpectatorHandle(queue);
+   _callbacks.on_event(&info);
+}
  
 void
 SpectatorBackend::OnMsg(int connection_id, UdpMsg *msg, int len)
 {
    if (_host.HandlesMsg(connection_id, msg)) {
       _host.OnMsg(msg, len);
+      return;
+   }
+   for (int i = 0; i < _num_spectators; i++) {
+      if (_spectators[i].HandlesMsg(connection_id, msg)) {
+         _spectators[i].OnMsg(msg, len);
+         return;
+      }
    }
 }
 
@@ -8,6 +8,7 @@
 #ifndef _SPECTATOR_H
 #define _SPECTATOR_H
 
+#include <deque>
 #include "types.h"
 #include "poll.h"
 #include "sync.h"
@@ -15,17 +16,26 @@
 #include "timesync.h"
 #include "network/udp_proto.h"
 
-#define SPECTATOR_FRAME_BUFFER_SIZE    64
+/*
+ * A spectator can relay the inputs it receives to spectators of its own,
+ * added with ggpo_add_player as GGPO_PLAYERTYPE_SPECTATOR.  The players
+ * then send to the relay only, however large its audience.  Relays can be
+ * chained, and a relay that never calls ggpo_synchronize_input works as a
+ * headless relay.
+ *
+ * A spectator that joined a game in progress starts from the snapshot the
+ * host sends, and passes it on to the spectators it relays to.
+ */
 
 class SpectatorBackend : public IQuarkBackend, IPollSink, Udp::Callbacks {
 public:
-   SpectatorBackend(GGPOSessionCallbacks *cb, const char *gamename, ConnectionManager* connection_manager, int num_players, int input_size, int connection_id);
+   SpectatorBackend(GGPOSessionCallbacks *cb, const char *gamename, ConnectionManager* connection_manager, int num_players, int input_size, int connection_id, const GGPOSessionLimits &limits);
    virtual ~SpectatorBackend();
 
 
 public:
    virtual GGPOErrorCode DoPoll(int timeout);
-   virtual GGPOErrorCode AddPlayer(GGPOPlayer *player, GGPOPlayerHandle *handle) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode AddPlayer(GGPOPlayer *player, GGPOPlayerHandle *handle);
    virtual GGPOErrorCode AddLocalInput(GGPOPlayerHandle player, void *values, int size) { return GGPO_OK; }
    virtual GGPOErrorCode SyncInput(void *values, int size, int *disconnect_flags);
    virtual GGPOErrorCode IncrementFrame(void);
@@ -34,15 +44,20 @@ public:
    virtual GGPOErrorCode SetFrameDelay(GGPOPlayerHandle player, int delay) { return GGPO_ERRORCODE_UNSUPPORTED; }
    virtual GGPOErrorCode SetDisconnectTimeout(int timeout) { return GGPO_ERRORCODE_UNSUPPORTED; }
    virtual GGPOErrorCode SetDisconnectNotifyStart(int timeout) { return GGPO_ERRORCODE_UNSUPPORTED; }
+   virtual GGPOErrorCode SetCompactInput(bool enabled);
 
 public:
    virtual void OnMsg(int connection_id, UdpMsg *msg, int len);
 
 protected:
+   GGPOPlayerHandle QueueToSpectatorHandle(int queue) { return (GGPOPlayerHandle)(queue + 1000); }
    void PollUdpProtocolEvents(void);
    void CheckInitialSync(void);
+   void RelayInputs(void);
+   void DisconnectSpectator(int queue);
 
    void OnUdpProtocolEvent(UdpProtocol::Event &e);
+   void OnUdpProtocolSpectatorEvent(UdpProtocol::Event &e, int queue);
 
 protected:
    GGPOSessionCallbacks  _callbacks;
@@ -53,7 +68,17 @@ protected:
    int                   _input_size;
    int                   _num_players;
    int                   _next_input_to_send;
-   GameInput             _inputs[SPECTATOR_FRAME_BUFFER_SIZE];
+   std::deque<GameInput> _inputs;            // received, but not yet returned by SyncInput
+   int                   _max_inputs;        // how far behind the host this spectator may fall, older inputs are dropped
+   bool                  _compact_input;
+
+   UdpProtocol           _spectators[GGPO_MAX_SPECTATORS];
+   int                   _num_spectators;
+   int                   _spectator_next_frame[GGPO_MAX_SPECTATORS];
+   bool                  _spectator_disconnected[GGPO_MAX_SPECTATORS];
+   std::deque<GameInput> _relay_inputs;      // received, but not yet queued for every spectator, at most _max_inputs
+   int                   _relay_first_frame; // frame of _relay_inputs.front()
+   unsigned int          _relay_last_input_time;
 };
 
 #endif
@@ -16,6 +16,10 @@ SyncTestBackend::SyncTestBackend(GGPOSessionCallbacks *cb,
    _callbacks = *cb;
    _num_players = num_players;
    _check_distance = frames;
+   _fixed_distance = frames;
+   _random_max_distance = 0;
+   _random_state = 0;
+   memset(&_stats, 0, sizeof(_stats));
    _last_verified = 0;
    _rollingback = false;
    _running = false;
@@ -28,7 +32,9 @@ SyncTestBackend::SyncTestBackend(GGPOSessionCallbacks *cb,
     */
    Sync::Config config = Sync::Config();
    config.callbacks = _callbacks;
-   config.num_prediction_frames = MAX_PREDICTION_FRAMES;
+   config.num_prediction_frames = GGPO_DEFAULT_PREDICTION_FRAMES;
+   config.input_queue_length = GGPO_DEFAULT_INPUT_QUEUE_LENGTH;
+   config.save_interval = 1;
    _sync.Init(config);
 
    /*
@@ -125,9 +131,10 @@ SyncTestBackend::IncrementFrame(void)
    info.checksum = _sync.GetLastSavedFrame().checksum;
    _saved_frames.push(info);
 
-   if (frame - _last_verified == _check_distance) {
+   if (frame - _last_verified >= _check_distance) {
       // We've gone far enough ahead and should now start replaying frames.
       // Load the last verified frame and set the rollback flag to true.
+      uint64_t start = Platform::GetCurrentTimeUS();
       _sync.LoadFrame(_last_verified);
 
       _rollingback = true;
@@ -140,23 +147,71 @@ SyncTestBackend::IncrementFrame(void)
          _saved_frames.pop();
 
          if (info.frame != _sync.GetFrameCount()) {
+            _stats.failures++;
             RaiseSyncError("Frame number %d does not match saved frame number %d", info.frame, frame);
          }
          int checksum = _sync.GetLastSavedFrame().checksum;
          if (info.checksum != checksum) {
+            _stats.failures++;
             LogSaveStates(info);
             RaiseSyncError("Checksum for frame %d does not match saved (%d != %d)", frame, checksum, info.checksum);
          }
-         printf("Checksum %08d for frame %d matches.\n", checksum, info.frame);
+         Log("Checksum %08d for frame %d matches.\n", checksum, info.frame);
          free(info.buf);
       }
+      RecordRollback(frame - _last_verified, Platform::GetCurrentTimeUS() - start);
       _last_verified = frame;
       _rollingback = false;
+      _check_distance = NextCheckDistance();
    }
 
    return GGPO_OK;
 }
 
+GGPOErrorCode
+SyncTestBackend::SetSyncTestRandomRollbacks(int max_frames, unsigned int seed)
+{
+   _random_max_distance = MIN(MAX(max_frames, 0), GGPO_DEFAULT_PREDICTION_FRAMES);
+   _random_state = seed;
+   _check_distance = NextCheckDistance();
+   return GGPO_OK;
+}
+
+GGPOErrorCode
+SyncTestBackend::GetSyncTestStats(GGPOSyncTestStats *stats)
+{
+   *stats = _stats;
+   return GGPO_OK;
+}
+
+int
+SyncTestBackend::NextCheckDistance()
+{
+   if (_random_max_distance == 0) {
+      return _fixed_distance;
+   }
+   // Our own LCG rather than rand(), so the depths only depend on the seed.
+   _random_state = _random_state * 1103515245 + 12345;
+   return 1 + (int)((_random_state >> 16) % _random_max_distance);
+}
+
+void
+SyncTestBackend::RecordRollback(int depth, uint64_t elapsed_us)
+{
+   if (depth < 1 || depth > GGPO_MAX_PREDICTION_FRAMES) {
+      return;
+   }
+   int bucket = 0;
+   while (bucket < GGPO_SYNCTEST_HISTOGRAM_BUCKETS - 1 && elapsed_us >> (bucket + 1) != 0) {
+      bucket++;
+   }
+   _stats.checks++;
+   _stats.depth[depth].rollbacks++;
+   _stats.depth[depth].total_us += elapsed_us;
+   _stats.depth[depth].max_us = MAX(_stats.depth[depth].max_us, (int)elapsed_us);
+   _stats.depth[depth].buckets[bucket]++;
+}
+
 void
 SyncTestBackend::RaiseSyncError(const char *fmt, ...)
 {
@@ -168,6 +223,15 @@ SyncTestBackend::RaiseSyncError(const char *fmt, ...)
 
    puts(buf);
    EndLog();
+
+#if GGPO_TRACE
+   char filename[MAX_PATH];
+   Platform::CreateDirectory("synclogs", NULL);
+   sprintf(filename, "synclogs/trace-%04d.ggpotrace", _sync.GetFrameCount());
+   if (TraceDump(filename)) {
+      printf("Wrote GGPO trace to %s\n", filename);
+   }
+#endif
    //DebugBreak();
 }
 
@@ -185,6 +249,14 @@ SyncTestBackend::BeginLog(int saving)
 {
    EndLog();
 
+   /*
+    * A log file per frame is only opened when logging is compiled in and
+    * turned on.
+    */
+#if GGPO_LOGGING
+   if (!LogEnabled()) {
+      return;
+   }
    char filename[MAX_PATH];
    Platform::CreateDirectory("synclogs", NULL);
    sprintf(filename, "synclogs\\%s-%04d-%s.log",
@@ -192,7 +264,8 @@ SyncTestBackend::BeginLog(int saving)
            _sync.GetFrameCount(),
            _rollingback ? "replay" : "original");
 
-    fopen(filename, "w");
+   _logfp = fopen(filename, "w");
+#endif
 }
 
 void
@@ -24,6 +24,8 @@ public:
    virtual GGPOErrorCode SyncInput(void *values, int size, int *disconnect_flags);
    virtual GGPOErrorCode IncrementFrame(void);
    virtual GGPOErrorCode Logv(const char *fmt, va_list list) override;
+   virtual GGPOErrorCode SetSyncTestRandomRollbacks(int max_frames, unsigned int seed) override;
+   virtual GGPOErrorCode GetSyncTestStats(GGPOSyncTestStats *stats) override;
 
 protected:
    struct SavedInfo {
@@ -38,12 +40,17 @@ protected:
    void BeginLog(int saving);
    void EndLog();
    void LogSaveStates(SavedInfo &info);
+   int NextCheckDistance();
+   void RecordRollback(int depth, uint64_t elapsed_us);
 
 protected:
    GGPOSessionCallbacks   _callbacks;
    Sync                   _sync;
    int                    _num_players;
    int                    _check_distance;
+   int                    _fixed_distance;
+   int                    _random_max_distance;
+   unsigned int           _random_state;
    int                    _last_verified;
    bool                   _rollingback;
    bool                   _running;
@@ -53,6 +60,7 @@ protected:
    GameInput                  _current_input;
    GameInput                  _last_input;
    RingBuffer<SavedInfo, 32>  _saved_frames;
+   GGPOSyncTestStats          _stats;
 };
 
 #endif
@@ -151,3 +151,245 @@ std::string UPDInfo::ToString() {
 
 }
 #endif
+
+#if defined(__linux__)
+struct UDPPacketBatch {
+	mmsghdr recv_msgs[UDPConnectionManager::BATCH_SIZE];
+	iovec recv_iov[UDPConnectionManager::BATCH_SIZE];
+	sockaddr_in recv_addrs[UDPConnectionManager::BATCH_SIZE];
+	char recv_bufs[UDPConnectionManager::BATCH_SIZE][UDPConnectionManager::MAX_PACKET_SIZE];
+	int recv_count;
+	int recv_next;
+
+	mmsghdr send_msgs[UDPConnectionManager::BATCH_SIZE];
+	iovec send_iov[UDPConnectionManager::BATCH_SIZE];
+	// Copies of each destination, since the connection map can be reset before Flush.
+	sockaddr_in send_addrs[UDPConnectionManager::BATCH_SIZE];
+	char send_bufs[UDPConnectionManager::BATCH_SIZE][UDPConnectionManager::MAX_PACKET_SIZE];
+	int send_count;
+};
+
+SOCKET
+CreateSocket(uint16 bind_port, int retries)
+{
+	SOCKET s;
+	sockaddr_in sin;
+	uint16 port;
+	int optval = 1;
+
+	s = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (s == INVALID_SOCKET) {
+		UE_LOG(GGPOLOG, Error, TEXT("socket failed (errno %d)."), errno);
+		return INVALID_SOCKET;
+	}
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof optval);
+#ifdef SO_BUSY_POLL
+	// Spin briefly in the kernel for packets instead of waiting on an interrupt.
+	// Raising this above net.core.busy_read needs CAP_NET_ADMIN, so failure is fine.
+	int busy_poll_us = 50;
+	setsockopt(s, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof busy_poll_us);
+#endif
+
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_ANY);
+	for (port = bind_port; port <= bind_port + retries; port++) {
+		sin.sin_port = htons(port);
+		if (bind(s, (sockaddr*)&sin, sizeof sin) != SOCKET_ERROR) {
+			UE_LOG(GGPOLOG, Verbose, TEXT("Udp bound to port: %d."), port);
+			return s;
+		}
+	}
+	closesocket(s);
+	return INVALID_SOCKET;
+}
+
+UDPConnectionManager::UDPConnectionManager() : _socket(INVALID_SOCKET), _batch(nullptr), _num_connections(0) {}
+
+int UDPConnectionManager::SendTo(const char* buffer, int len, int flags, int connection_id) {
+	if (_socket == INVALID_SOCKET) {
+		return -1;
+	}
+	if (len > MAX_PACKET_SIZE) {
+		UE_LOG(GGPOLOG, Error, TEXT("Packet of %d bytes is too large to send, Connection ID: %d."), len, connection_id);
+		return -1;
+	}
+	const sockaddr_in* dest_addr = nullptr;
+	for (int i = 0; i < _num_connections; i++) {
+		if (_connection_ids[i] == connection_id) {
+			dest_addr = &_connection_addrs[i];
+			break;
+		}
+	}
+	if (!dest_addr) {
+		UE_LOG(GGPOLOG, Warning, TEXT("Connection not in map Connection ID: %d)."), connection_id);
+		return -1;
+	}
+
+	if (_batch->send_count == BATCH_SIZE) {
+		Flush();
+	}
+	int index = _batch->send_count++;
+	memcpy(_batch->send_bufs[index], buffer, len);
+	_batch->send_iov[index].iov_len = len;
+	_batch->send_addrs[index] = *dest_addr;
+	return 0;
+}
+
+void UDPConnectionManager::Flush() {
+	if (!_batch) {
+		return;
+	}
+	int sent = 0;
+	while (sent < _batch->send_count) {
+		int res = sendmmsg(_socket, &_batch->send_msgs[sent], _batch->send_count - sent, MSG_DONTWAIT);
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			// The socket buffer is full or the send failed. GGPO resends anything it
+			// still needs, so the rest of the batch is dropped like any lost packet.
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				UE_LOG(GGPOLOG, Error, TEXT("sendmmsg failed (errno %d), dropping %d packets."), errno, _batch->send_count - sent);
+			}
+			break;
+		}
+		sent += res;
+	}
+	_batch->send_count = 0;
+}
+
+int UDPConnectionManager::RecvFrom(char* buffer, int len, int flags, int* connection_id) {
+	*connection_id = -1;
+	if (!_batch) {
+		return -1;
+	}
+
+	// >0 indicates data length.
+	// 0 indicates a disconnect.
+	// -1 indicates no data or some other error.
+	for (;;) {
+		if (_batch->recv_next == _batch->recv_count) {
+			_batch->recv_next = 0;
+			_batch->recv_count = 0;
+			for (int i = 0; i < BATCH_SIZE; i++) {
+				_batch->recv_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			}
+			int res = recvmmsg(_socket, _batch->recv_msgs, BATCH_SIZE, MSG_DONTWAIT | flags, nullptr);
+			if (res <= 0) {
+				if (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+					UE_LOG(GGPOLOG, Error, TEXT("recvmmsg failed (errno %d)."), errno);
+				}
+				return -1;
+			}
+			_batch->recv_count = res;
+		}
+
+		int index = _batch->recv_next++;
+		int id = FindIDFromIP(&_batch->recv_addrs[index]);
+		if (id == -1) {
+			continue;
+		}
+		int inlen = MIN((int)_batch->recv_msgs[index].msg_len, len);
+		memcpy(buffer, _batch->recv_bufs[index], inlen);
+		*connection_id = id;
+		return inlen;
+	}
+}
+
+int UDPConnectionManager::GetWaitHandle() {
+	return _socket == INVALID_SOCKET ? -1 : (int)_socket;
+}
+
+int UDPConnectionManager::FindIDFromIP(sockaddr_in* addr) {
+	for (int i = 0; i < _num_connections; i++) {
+		if (_connection_addrs[i].sin_addr.s_addr == addr->sin_addr.s_addr
+			&& _connection_addrs[i].sin_port == addr->sin_port) {
+			return _connection_ids[i];
+		}
+	}
+	return -1;
+}
+
+void UDPConnectionManager::Init(uint16 port) {
+	UE_LOG(GGPOLOG, Verbose, TEXT("Binding udp socket to port %d."), port);
+	_socket = CreateSocket(port, 0);
+	if (_socket == INVALID_SOCKET || _batch) {
+		return;
+	}
+
+	_batch = new UDPPacketBatch();
+	memset(_batch, 0, sizeof(UDPPacketBatch));
+	for (int i = 0; i < BATCH_SIZE; i++) {
+		_batch->recv_iov[i].iov_base = _batch->recv_bufs[i];
+		_batch->recv_iov[i].iov_len = MAX_PACKET_SIZE;
+		_batch->recv_msgs[i].msg_hdr.msg_iov = &_batch->recv_iov[i];
+		_batch->recv_msgs[i].msg_hdr.msg_iovlen = 1;
+		_batch->recv_msgs[i].msg_hdr.msg_name = &_batch->recv_addrs[i];
+		_batch->recv_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+
+		_batch->send_iov[i].iov_base = _batch->send_bufs[i];
+		_batch->send_msgs[i].msg_hdr.msg_iov = &_batch->send_iov[i];
+		_batch->send_msgs[i].msg_hdr.msg_iovlen = 1;
+		_batch->send_msgs[i].msg_hdr.msg_name = &_batch->send_addrs[i];
+		_batch->send_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+	}
+}
+
+uint16 UDPConnectionManager::GetPort() const {
+	sockaddr_in addr;
+	socklen_t addr_len = sizeof(addr);
+	if (_socket == INVALID_SOCKET || getsockname(_socket, (sockaddr*)&addr, &addr_len) != 0) {
+		return 0;
+	}
+	return ntohs(addr.sin_port);
+}
+
+int UDPConnectionManager::AddConnection(const char* ip_address, uint16 port) {
+	if (_num_connections >= MAX_CONNECTIONS) {
+		return -1;
+	}
+	std::shared_ptr<ConnectionInfo> info = BuildConnectionInfo(ip_address, port);
+	int id = ConnectionManager::AddConnection(info);
+	_connection_addrs[_num_connections] = static_cast<UPDInfo&>(*info).addr;
+	_connection_ids[_num_connections] = id;
+	_num_connections++;
+	return id;
+}
+
+int UDPConnectionManager::ResetManager() {
+	memset(_connection_addrs, 0, sizeof(_connection_addrs));
+	memset(_connection_ids, 0, sizeof(_connection_ids));
+	_num_connections = 0;
+	return ConnectionManager::ResetManager();
+}
+
+UDPConnectionManager::~UDPConnectionManager() {
+	if (_socket != INVALID_SOCKET) {
+		Flush();
+		closesocket(_socket);
+		_socket = INVALID_SOCKET;
+	}
+	delete _batch;
+	_batch = nullptr;
+}
+
+std::shared_ptr<ConnectionInfo> UDPConnectionManager::BuildConnectionInfo(const char* ip_address, uint16 port) {
+	return std::static_pointer_cast<ConnectionInfo>(std::make_shared<UPDInfo>(ip_address, port));
+}
+
+UPDInfo::UPDInfo(const char* ip_address, uint16 port) {
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	inet_pton(AF_INET, ip_address, &addr.sin_addr.s_addr);
+	addr.sin_port = htons(port);
+}
+
+std::string UPDInfo::ToString() {
+	char dst_ip[INET_ADDRSTRLEN];
+	char buffer[100];
+	snprintf(buffer, sizeof(buffer), "Connection: IP: %s, Port: %d",
+		inet_ntop(AF_INET, (void*)(&addr.sin_addr), dst_ip, ARRAY_SIZE(dst_ip)),
+		ntohs(addr.sin_port));
+	return std::string(buffer);
+}
+#endif
@@ -0,0 +1,247 @@
+
+#include "include/simulated_connection_manager.h"
+#include "types.h"
+#include "GGPOUE4.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static bool
+IsBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static std::string
+Trim(const std::string& text)
+{
+	size_t start = 0, end = text.size();
+	while (start < end && IsBlank(text[start])) {
+		start++;
+	}
+	while (end > start && IsBlank(text[end - 1])) {
+		end--;
+	}
+	return text.substr(start, end - start);
+}
+
+bool NetworkConditions::Load(const char* text, const char* profile) {
+	bool in_profile = false, found = false;
+	const char* line = text;
+	while (*line) {
+		const char* end = strchr(line, '\n');
+		std::string current = Trim(end ? std::string(line, end - line) : std::string(line));
+		line = end ? end + 1 : line + strlen(line);
+
+		if (current.empty() || current[0] == ';' || current[0] == '#') {
+			continue;
+		}
+		if (current[0] == '[') {
+			in_profile = current == std::string("[") + profile + "]";
+			found |= in_profile;
+			continue;
+		}
+		size_t equals = current.find('=');
+		if (!in_profile || equals == std::string::npos) {
+			continue;
+		}
+		std::string key = Trim(current.substr(0, equals));
+		const char* value = current.c_str() + equals + 1;
+		if (key == "latency_ms") {
+			latency_ms = atoi(value);
+		} else if (key == "jitter_ms") {
+			jitter_ms = atoi(value);
+		} else if (key == "loss_percent") {
+			loss_percent = (float)atof(value);
+		} else if (key == "burst_loss_percent") {
+			burst_loss_percent = (float)atof(value);
+		} else if (key == "burst_length") {
+			burst_length = atoi(value);
+		} else if (key == "duplicate_percent") {
+			duplicate_percent = (float)atof(value);
+		} else if (key == "reorder_percent") {
+			reorder_percent = (float)atof(value);
+		} else if (key == "reorder_ms") {
+			reorder_ms = atoi(value);
+		} else if (key == "bandwidth_kbps") {
+			bandwidth_kbps = atoi(value);
+		} else if (key == "seed") {
+			seed = (uint32)strtoul(value, NULL, 10);
+		} else {
+			UE_LOG(GGPOLOG, Warning, TEXT("Unknown network condition %s in profile %s."), UTF8_TO_TCHAR(key.c_str()), UTF8_TO_TCHAR(profile));
+		}
+	}
+	return found;
+}
+
+bool NetworkConditions::IsPerfect() const {
+	return latency_ms <= 0 && jitter_ms <= 0 && loss_percent <= 0 && burst_loss_percent <= 0
+		&& duplicate_percent <= 0 && reorder_percent <= 0 && bandwidth_kbps <= 0;
+}
+
+SimulatedConnectionManager::SimulatedConnectionManager(ConnectionManager* inner, const NetworkConditions& conditions) :
+	_inner(inner),
+	_conditions(conditions),
+	// xorshift gets stuck at 0.
+	_random_state(conditions.seed ? conditions.seed : 1),
+	_next_sequence(0),
+	_burst_remaining(0),
+	_link_free_us(0) {
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+SimulatedConnectionManager::~SimulatedConnectionManager() {
+}
+
+int SimulatedConnectionManager::SendTo(const char* buffer, int len, int flags, int connection_id) {
+	_stats.sent++;
+
+	// Losses are decided first so a profile loses the same packets whatever its delays are.
+	bool lost = false;
+	if (_burst_remaining > 0) {
+		_burst_remaining--;
+		lost = true;
+	} else if (Chance(_conditions.burst_loss_percent)) {
+		_burst_remaining = _conditions.burst_length - 1;
+		lost = true;
+	}
+	if (Chance(_conditions.loss_percent)) {
+		lost = true;
+	}
+	if (lost) {
+		_stats.lost++;
+		return len;
+	}
+
+	uint64 now = Platform::GetCurrentTimeUS();
+	if (_conditions.bandwidth_kbps > 0) {
+		// Bits over kilobits per second is milliseconds, so bytes * 8000 / kbps is microseconds.
+		_link_free_us = MAX(_link_free_us, now) + (uint64)len * 8000 / _conditions.bandwidth_kbps;
+		now = _link_free_us;
+	}
+
+	double delay_ms = MAX(_conditions.latency_ms, 0);
+	if (_conditions.jitter_ms > 0) {
+		// Box-Muller, dropping delays below the base latency so jitter only ever adds.
+		double u1 = MAX(RandomUnit(), 1e-9), u2 = RandomUnit();
+		double normal = sqrt(-2 * log(u1)) * cos(6.283185307179586 * u2);
+		delay_ms += fabs(normal) * _conditions.jitter_ms;
+	}
+	if (Chance(_conditions.reorder_percent)) {
+		delay_ms += _conditions.reorder_ms;
+		_stats.reordered++;
+	}
+	uint64 deliver_us = now + (uint64)(delay_ms * 1000);
+	Hold(buffer, len, connection_id, deliver_us);
+
+	if (Chance(_conditions.duplicate_percent)) {
+		Hold(buffer, len, connection_id, deliver_us + 1000);
+		_stats.duplicated++;
+	}
+	Deliver();
+	return len;
+}
+
+int SimulatedConnectionManager::RecvFrom(char* buffer, int len, int flags, int* connection_id) {
+	Deliver();
+	return _inner->RecvFrom(buffer, len, flags, connection_id);
+}
+
+void SimulatedConnectionManager::Flush() {
+	Deliver();
+	_inner->Flush();
+}
+
+int SimulatedConnectionManager::ResetManager() {
+	while (!_held.empty()) {
+		_held.pop();
+	}
+	return _inner->ResetManager();
+}
+
+std::string SimulatedConnectionManager::ToString(int connection_id) {
+	return _inner->ToString(connection_id) + " (simulated)";
+}
+
+void SimulatedConnectionManager::GetStats(Stats* stats) const {
+	*stats = _stats;
+	stats->queued = (int)_held.size();
+}
+
+void SimulatedConnectionManager::Deliver() {
+	uint64 now = Platform::GetCurrentTimeUS();
+	while (!_held.empty() && _held.top().deliver_us <= now) {
+		const HeldPacket& packet = _held.top();
+		_inner->SendTo(packet.data.data(), (int)packet.data.size(), 0, packet.connection_id);
+		_held.pop();
+	}
+}
+
+void SimulatedConnectionManager::Hold(const char* buffer, int len, int connection_id, uint64 deliver_us) {
+	HeldPacket packet;
+	packet.deliver_us = deliver_us;
+	packet.sequence = _next_sequence++;
+	packet.connection_id = connection_id;
+	packet.data.assign(buffer, len);
+	_held.push(std::move(packet));
+}
+
+uint32 SimulatedConnectionManager::Random() {
+	// xorshift32
+	_random_state ^= _random_state << 13;
+	_random_state ^= _random_state >> 17;
+	_random_state ^= _random_state << 5;
+	return _random_state;
+}
+
+double SimulatedConnectionManager::RandomUnit() {
+	return Random() / 4294967296.0;
+}
+
+bool SimulatedConnectionManager::Chance(float percent) {
+	// Always draws, so a packet's fate only depends on the profile and the packets sent before it.
+	return RandomUnit() * 100 < percent;
+}
+
+
+LoopbackConnectionManager::LoopbackConnectionManager() : _bytes_sent(0), _packets_sent(0) {}
+
+LoopbackConnectionManager::~LoopbackConnectionManager() {
+	for (const Peer& peer : _peers) {
+		if (peer.manager) {
+			peer.manager->_peers[peer.remote_id].manager = NULL;
+		}
+	}
+}
+
+void LoopbackConnectionManager::Connect(LoopbackConnectionManager* a, LoopbackConnectionManager* b) {
+	int a_id = (int)a->_peers.size(), b_id = (int)b->_peers.size();
+	a->_peers.push_back({ b, b_id });
+	b->_peers.push_back({ a, a_id });
+}
+
+int LoopbackConnectionManager::SendTo(const char* buffer, int len, int flags, int connection_id) {
+	_bytes_sent += len;
+	_packets_sent++;
+	if (connection_id >= 0 && connection_id < (int)_peers.size() && _peers[connection_id].manager) {
+		const Peer& peer = _peers[connection_id];
+		peer.manager->_incoming.push_back({ peer.remote_id, std::string(buffer, len) });
+	}
+	return len;
+}
+
+int LoopbackConnectionManager::RecvFrom(char* buffer, int len, int flags, int* connection_id) {
+	if (_incoming.empty()) {
+		return -1;
+	}
+	const Packet& packet = _incoming.front();
+	int size = MIN((int)packet.data.size(), len);
+	memcpy(buffer, packet.data.data(), size);
+	*connection_id = packet.connection_id;
+	_incoming.pop_front();
+	return size;
+}
+
+std::string LoopbackConnectionManager::ToString(int connection_id) {
+	return "loopback " + std::to_string(connection_id);
+}
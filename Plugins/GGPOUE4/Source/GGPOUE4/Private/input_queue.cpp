@@ -8,19 +8,21 @@
 #include "input_queue.h"
 #include "types.h"
 
-#define PREVIOUS_FRAME(offset)   (((offset) == 0) ? (INPUT_QUEUE_LENGTH - 1) : ((offset) - 1))
+#define PREVIOUS_FRAME(offset)   (((offset) == 0) ? (_capacity - 1) : ((offset) - 1))
 
-InputQueue::InputQueue(int input_size)
+InputQueue::InputQueue() :
+   _inputs(NULL),
+   _capacity(0)
 {
-   Init(-1, input_size);
 }
 
 InputQueue::~InputQueue()
 {
+   delete [] _inputs;
 }
 
 void
-InputQueue::Init(int id, int input_size)
+InputQueue::Init(int id, int input_size, int length)
 {
    _id = id;
    _head = 0;
@@ -39,8 +41,13 @@ InputQueue::Init(int id, int input_size)
     * This is safe because we know the GameInput is a proper structure (as in,
     * no virtual methods, no contained classes, etc.).
     */
-   memset(_inputs, 0, sizeof _inputs);
-   for (int i = 0; i < ARRAY_SIZE(_inputs); i++) {
+   if (_capacity != length) {
+      delete [] _inputs;
+      _inputs = new GameInput[length];
+      _capacity = length;
+   }
+   memset(_inputs, 0, sizeof(GameInput) * _capacity);
+   for (int i = 0; i < _capacity; i++) {
       _inputs[i].size = input_size;
    }
 }
@@ -77,7 +84,7 @@ InputQueue::DiscardConfirmedFrames(int frame)
       Log("difference of %d frames.\n", offset);
       ASSERT(offset >= 0);
 
-      _tail = (_tail + offset) % INPUT_QUEUE_LENGTH;
+      _tail = (_tail + offset) % _capacity;
       _length -= offset;
    }
 
@@ -105,7 +112,7 @@ bool
 InputQueue::GetConfirmedInput(int requested_frame, GameInput *input)
 {
    ASSERT(_first_incorrect_frame == GameInput::NullFrame || requested_frame < _first_incorrect_frame);
-   int offset = requested_frame % INPUT_QUEUE_LENGTH; 
+   int offset = requested_frame % _capacity; 
    if (_inputs[offset].frame != requested_frame) {
       return false;
    }
@@ -141,7 +148,7 @@ InputQueue::GetInput(int requested_frame, GameInput *input)
       int offset = requested_frame - _inputs[_tail].frame;
 
       if (offset < _length) {
-         offset = (offset + _tail) % INPUT_QUEUE_LENGTH;
+         offset = (offset + _tail) % _capacity;
          ASSERT(_inputs[offset].frame == requested_frame);
          *input = _inputs[offset];
          Log("returning confirmed frame number %d.\n", input->frame);
@@ -177,6 +184,7 @@ InputQueue::GetInput(int requested_frame, GameInput *input)
    *input = _prediction;
    input->frame = requested_frame;
    Log("returning prediction frame number %d (%d).\n", input->frame, _prediction.frame);
+   Trace(TRACE_PREDICTION, _id, requested_frame, TraceInputBits(input->bits), _last_added_frame);
 
    return false;
 }
@@ -229,7 +237,7 @@ InputQueue::AddDelayedInputToQueue(GameInput &input, int frame_number)
     */ 
    _inputs[_head] = input;
    _inputs[_head].frame = frame_number;
-   _head = (_head + 1) % INPUT_QUEUE_LENGTH;
+   _head = (_head + 1) % _capacity;
    _length++;
    _first_frame = false;
 
@@ -246,6 +254,7 @@ InputQueue::AddDelayedInputToQueue(GameInput &input, int frame_number)
        */
       if (_first_incorrect_frame == GameInput::NullFrame && !_prediction.equal(input, true)) {
          Log("frame %d does not match prediction.  marking error.\n", frame_number);
+         Trace(TRACE_MISPREDICTION, _id, frame_number);
          _first_incorrect_frame = frame_number;
       }
 
@@ -262,7 +271,7 @@ InputQueue::AddDelayedInputToQueue(GameInput &input, int frame_number)
          _prediction.frame++;
       }
    }
-   ASSERT(_length <= INPUT_QUEUE_LENGTH);
+   ASSERT(_length <= _capacity);
 }
 
 int
@@ -304,6 +313,7 @@ InputQueue::AdvanceQueueHead(int frame)
 }
 
 
+#if GGPO_LOGGING
 void
 InputQueue::Log(const char *fmt, ...)
 {
@@ -318,3 +328,4 @@ InputQueue::Log(const char *fmt, ...)
    ::Log(buf);
    va_end(args);
 }
+#endif
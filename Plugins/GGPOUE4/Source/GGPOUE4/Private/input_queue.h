@@ -8,18 +8,20 @@
 #ifndef _INPUT_QUEUE_H
 #define _INPUT_QUEUE_H
 
+#include "types.h"
 #include "game_input.h"
 
-#define INPUT_QUEUE_LENGTH    128
-#define DEFAULT_INPUT_SIZE      4
-
 class InputQueue {
 public:
-   InputQueue(int input_size = DEFAULT_INPUT_SIZE);
+   InputQueue();
    ~InputQueue();
 
 public:
-   void Init(int id, int input_size);
+   /*
+    * Keeps the last length inputs.  The queue is allocated here, so call
+    * it once, when the session starts.
+    */
+   void Init(int id, int input_size, int length);
    int GetLastConfirmedFrame();
    int GetFirstIncorrectFrame();
    int GetLength() { return _length; }
@@ -34,7 +36,11 @@ public:
 protected:
    int AdvanceQueueHead(int frame);
    void AddDelayedInputToQueue(GameInput &input, int i);
+#if GGPO_LOGGING
    void Log(const char *fmt, ...);
+#else
+   template <typename... Args> void Log(const char *, Args...) { }
+#endif
 
 protected:
    int                  _id;
@@ -50,7 +56,8 @@ protected:
 
    int                  _frame_delay;
 
-   GameInput            _inputs[INPUT_QUEUE_LENGTH];
+   GameInput            *_inputs;
+   int                  _capacity;
    GameInput            _prediction;
 };
 
@@ -9,6 +9,7 @@
 #include "types.h"
 
 static FILE *logfile = NULL;
+static bool flush_on_log = false;
 
 void LogFlush()
 {
@@ -17,8 +18,12 @@ void LogFlush()
    }
 }
 
-static char logbuf[4 * 1024 * 1024];
+void LogFlushOnLog(bool flush)
+{
+   flush_on_log = flush;
+}
 
+#if GGPO_LOGGING
 void Log(const char *fmt, ...)
 {
    va_list args;
@@ -26,15 +31,34 @@ void Log(const char *fmt, ...)
    Logv(fmt, args);
    va_end(args);
 }
+#endif
+
+/*
+ * The environment is only read on the first call.
+ */
+static int log_enabled = -1;
+
+bool LogEnabled()
+{
+   if (log_enabled < 0) {
+      log_enabled = getenv("GGPO_LOG") && !getenv("GGPO_LOG_IGNORE");
+   }
+   return log_enabled != 0;
+}
 
 void Logv(const char *fmt, va_list args)
 {
-   if (!getenv("GGPO_LOG") || getenv("GGPO_LOG_IGNORE")) {
+   if (!LogEnabled()) {
       return;
    }
    if (!logfile) {
-      sprintf(logbuf, "log-%d.log", static_cast<int>(Platform::GetProcessID()));
-      fopen(logbuf, "w");
+      char filename[64];
+      sprintf(filename, "log-%d.log", static_cast<int>(Platform::GetProcessID()));
+      logfile = fopen(filename, "w");
+      if (!logfile) {
+         log_enabled = 0;
+         return;
+      }
    }
    Logv(logfile, fmt, args);
 }
@@ -51,8 +75,7 @@ void Logv(FILE *fp, const char *fmt, va_list args)
    fprintf(fp, "%d.%03d : ", t / 1000, t % 1000);
 
    vfprintf(fp, fmt, args);
-   fflush(fp);
-   
-   vsprintf(logbuf, fmt, args);
+   if (flush_on_log) {
+      fflush(fp);
+   }
 }
-
@@ -8,7 +8,23 @@
 #ifndef _LOG_H
 #define _LOG_H
 
+/*
+ * Build with GGPO_LOGGING=1 to compile the Log calls in.  They are then
+ * written to log-<pid>.log when the GGPO_LOG environment variable is set.
+ * Otherwise every Log call, including the per-object ones in InputQueue,
+ * Udp and UdpProtocol, inlines to nothing, so the rollback paths don't pay
+ * for formatting.  See trace.h for a cheaper record of what happened.
+ */
+#ifndef GGPO_LOGGING
+#define GGPO_LOGGING    0
+#endif
+
+#if GGPO_LOGGING
 extern void Log(const char *fmt, ...);
+#else
+template <typename... Args> inline void Log(const char *, Args...) { }
+#endif
+extern bool LogEnabled();
 extern void Logv(const char *fmt, va_list list);
 extern void Logv(FILE *fp, const char *fmt, va_list args);
 extern void LogFlush();
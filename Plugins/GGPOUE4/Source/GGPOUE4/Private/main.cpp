@@ -28,19 +28,54 @@ ggpo_logv(GGPOSession *ggpo, const char *fmt, va_list args)
    }
 }
 
+/*
+ * Fills in the defaults for the limits left 0, and checks the others.
+ */
+static bool
+ResolveLimits(const GGPOSessionLimits *limits, GGPOSessionLimits *resolved)
+{
+   memset(resolved, 0, sizeof(*resolved));
+   if (limits) {
+      *resolved = *limits;
+   }
+   if (resolved->prediction_frames == 0) {
+      resolved->prediction_frames = GGPO_DEFAULT_PREDICTION_FRAMES;
+   }
+   if (resolved->input_queue_length == 0) {
+      resolved->input_queue_length = GGPO_DEFAULT_INPUT_QUEUE_LENGTH;
+   }
+   if (resolved->spectator_frames == 0) {
+      resolved->spectator_frames = GGPO_DEFAULT_SPECTATOR_FRAMES;
+   }
+   if (resolved->save_interval == 0) {
+      resolved->save_interval = 1;
+   }
+   return resolved->prediction_frames >= 1 && resolved->prediction_frames <= GGPO_MAX_PREDICTION_FRAMES &&
+          resolved->save_interval >= 1 && resolved->save_interval <= GGPO_MAX_PREDICTION_FRAMES &&
+          resolved->input_queue_length > 2 * resolved->prediction_frames + resolved->save_interval - 1 &&
+          resolved->spectator_frames > 0;
+}
+
 GGPOErrorCode
 GGPONet::ggpo_start_session(GGPOSession **session,
                    GGPOSessionCallbacks *cb,
                    ConnectionManager* connection_manager,
                    const char *game,
                    int num_players,
-                   int input_size)
+                   int input_size,
+                   const GGPOSessionLimits *limits)
 {
+   GGPOSessionLimits resolved;
+   if (!ResolveLimits(limits, &resolved)) {
+      *session = NULL;
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
    *session= (GGPOSession *)new Peer2PeerBackend(cb,
                                                  game,
                                                  connection_manager,
                                                  num_players,
-                                                 input_size);
+                                                 input_size,
+                                                 resolved);
    return GGPO_OK;
 }
 
@@ -69,6 +104,26 @@ GGPONet::ggpo_start_synctest(GGPOSession **ggpo,
    return GGPO_OK;
 }
 
+GGPOErrorCode
+GGPONet::ggpo_set_synctest_random_rollbacks(GGPOSession *ggpo,
+                                   int max_frames,
+                                   unsigned int seed)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   return ggpo->SetSyncTestRandomRollbacks(max_frames, seed);
+}
+
+GGPOErrorCode
+GGPONet::ggpo_get_synctest_stats(GGPOSession *ggpo, GGPOSyncTestStats *stats)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   return ggpo->GetSyncTestStats(stats);
+}
+
 GGPOErrorCode
 GGPONet::ggpo_set_frame_delay(GGPOSession *ggpo,
                      GGPOPlayerHandle player,
@@ -159,6 +214,7 @@ GGPONet::ggpo_close_session(GGPOSession *ggpo)
       return GGPO_ERRORCODE_INVALID_SESSION;
    }
    delete ggpo;
+   LogFlush();
    return GGPO_OK;
 }
 
@@ -180,6 +236,31 @@ GGPONet::ggpo_set_disconnect_notify_start(GGPOSession *ggpo, int timeout)
    return ggpo->SetDisconnectNotifyStart(timeout);
 }
 
+GGPOErrorCode
+GGPONet::ggpo_set_compact_input(GGPOSession *ggpo, bool enabled)
+{
+   if (!ggpo) {
+      return GGPO_ERRORCODE_INVALID_SESSION;
+   }
+   return ggpo->SetCompactInput(enabled);
+}
+
+GGPOErrorCode
+GGPONet::ggpo_dump_trace(const char *filename)
+{
+#if GGPO_TRACE
+   return TraceDump(filename) ? GGPO_OK : GGPO_ERRORCODE_GENERAL_FAILURE;
+#else
+   return GGPO_ERRORCODE_UNSUPPORTED;
+#endif
+}
+
+GGPOErrorCode
+GGPONet::ggpo_render_trace(const char *trace_file, const char *text_file)
+{
+   return TraceRender(trace_file, text_file) ? GGPO_OK : GGPO_ERRORCODE_INVALID_REQUEST;
+}
+
 GGPOErrorCode GGPONet::ggpo_try_synchronize_local(GGPOSession* ggpo)
 {
    if (!ggpo)
@@ -193,14 +274,21 @@ GGPOErrorCode GGPONet::ggpo_start_spectating(GGPOSession **session,
                                     const char *game,
                                     int num_players,
                                     int input_size,
-                                    int connection_id)
+                                    int connection_id,
+                                    const GGPOSessionLimits *limits)
 {
+   GGPOSessionLimits resolved;
+   if (!ResolveLimits(limits, &resolved)) {
+      *session = NULL;
+      return GGPO_ERRORCODE_INVALID_REQUEST;
+   }
    *session= (GGPOSession *)new SpectatorBackend(cb,
                                                  game,
                                                  connection_manager,
                                                  num_players,
                                                  input_size,
-                                                 connection_id);
+                                                 connection_id,
+                                                 resolved);
    return GGPO_OK;
 }
 
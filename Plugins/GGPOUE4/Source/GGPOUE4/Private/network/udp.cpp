@@ -27,6 +27,7 @@ Udp::Init(Poll *poll, Callbacks *callbacks, ConnectionManager* connection_manage
    _poll = poll;
    _connection_manager = connection_manager;
    _poll->RegisterLoop(this);
+   _poll->RegisterWaitHandle(_connection_manager->GetWaitHandle());
 }
 
 void
@@ -35,11 +36,19 @@ Udp::SendTo(char *buffer, int len, int flags, int connection_id)
    _connection_manager->SendTo(buffer, len, flags, connection_id);
 }
 
+void
+Udp::Flush()
+{
+   _connection_manager->Flush();
+}
+
 bool
 Udp::OnLoopPoll(void *cookie)
 {
    uint8          recv_buf[MAX_UDP_PACKET_SIZE];
 
+   // Send anything queued since the last poll before reading replies to it.
+   Flush();
    for (;;) {
       int connection_id = -1;
       int len = _connection_manager->RecvFrom((char*)recv_buf, MAX_UDP_PACKET_SIZE, 0, &connection_id);
@@ -50,7 +59,7 @@ Udp::OnLoopPoll(void *cookie)
 #ifdef _WIN32
          int error = WSAGetLastError();
 #else
-         int error = 1;
+         int error = errno;
 #endif
          if (error != WSAEWOULDBLOCK) {
             Log("recvfrom WSAGetLastError returned %d (%x).\n", error, error);
@@ -66,6 +75,7 @@ Udp::OnLoopPoll(void *cookie)
 }
 
 
+#if GGPO_LOGGING
 void
 Udp::Log(const char *fmt, ...)
 {
@@ -81,3 +91,4 @@ Udp::Log(const char *fmt, ...)
    ::Log(buf);
    va_end(args);
 }
+#endif
@@ -8,6 +8,7 @@
 #ifndef _UDP_H
 #define _UDP_H
 
+#include "types.h"
 #include "poll.h"
 #include "udp_msg.h"
 #include "include/ggponet.h"
@@ -33,7 +34,11 @@ public:
 
 
 protected:
+#if GGPO_LOGGING
    void Log(const char *fmt, ...);
+#else
+   template <typename... Args> void Log(const char *, Args...) { }
+#endif
 
 public:
    Udp();
@@ -41,6 +46,7 @@ public:
    void Init(Poll *p, Callbacks *callbacks, ConnectionManager* connection_manager);
    
    void SendTo(char *buffer, int len, int flags, int connection_id);
+   void Flush();
 
    virtual bool OnLoopPoll(void *cookie);
 
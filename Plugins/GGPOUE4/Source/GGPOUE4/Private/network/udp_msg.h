@@ -9,8 +9,16 @@
 #define _UDP_MSG_H
 
 #define MAX_COMPRESSED_BITS       4096
+#define MAX_COMPACT_INPUT_BYTES   2048
+#define MAX_COMPACT_INPUT_SIZE      32   /* one bit per input byte in a uint32 mask */
+#define MAX_SNAPSHOT_CHUNK_BYTES  1024
 #define UDP_MSG_MAX_PLAYERS          4
 
+/*
+ * Capabilities exchanged in the sync handshake.
+ */
+#define UDP_MSG_CAP_COMPACT_INPUT    0x1
+
 #pragma pack(push, 1)
 
 struct UdpMsg
@@ -24,6 +32,9 @@ struct UdpMsg
       QualityReply  = 5,
       KeepAlive     = 6,
       InputAck      = 7,
+      CompactInput  = 8,
+      SnapshotChunk = 9,
+      SnapshotAck   = 10,
    };
 
    struct connect_status {
@@ -41,10 +52,12 @@ struct UdpMsg
          uint32      random_request;  /* please reply back with this random data */
          uint16      remote_magic;
          uint8       remote_endpoint;
+         uint8       capabilities;    /* UDP_MSG_CAP_* the sender can use */
       } sync_request;
       
       struct {
          uint32      random_reply;    /* OK, here's your random data back */
+         uint8       capabilities;
       } sync_reply;
       
       struct {
@@ -73,6 +86,34 @@ struct UdpMsg
          int               ack_frame:31;
       } input_ack;
 
+      /*
+       * The same information as input, as a byte stream: varint frame deltas,
+       * then runs of identical inputs with only their non-zero bytes.  See
+       * UdpProtocol::EncodeCompactInput.
+       */
+      struct {
+         uint16            num_bytes;
+         uint8             data[MAX_COMPACT_INPUT_BYTES]; /* must be last */
+      } compact_input;
+
+      /*
+       * A piece of the game state snapshot a spectator joining a game in
+       * progress starts from.  Chunks are sent in order and acked with the
+       * number of bytes received in order so far.
+       */
+      struct {
+         int               frame;
+         uint32            total_size;
+         uint32            offset;
+         uint16            num_bytes;
+         uint8             data[MAX_SNAPSHOT_CHUNK_BYTES]; /* must be last */
+      } snapshot_chunk;
+
+      struct {
+         int               frame;
+         uint32            received;
+      } snapshot_ack;
+
    } u;
 
 public:
@@ -89,7 +130,12 @@ public:
       case QualityReport: return sizeof(u.quality_report);
       case QualityReply:  return sizeof(u.quality_reply);
       case InputAck:      return sizeof(u.input_ack);
+      case SnapshotAck:   return sizeof(u.snapshot_ack);
       case KeepAlive:     return 0;
+      case CompactInput:
+         return (int)((char *)&u.compact_input.data - (char *)&u.compact_input) + u.compact_input.num_bytes;
+      case SnapshotChunk:
+         return (int)((char *)&u.snapshot_chunk.data - (char *)&u.snapshot_chunk) + u.snapshot_chunk.num_bytes;
       case Input:
          size = (int)((char *)&u.input.bits - (char *)&u.input);
          size += (u.input.num_bits + 7) / 8;
@@ -0,0 +1,88 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "udp_msg_pool.h"
+#include "types.h"
+#include <new>
+
+UdpMsgPool::UdpMsgPool() :
+   _msgs(NULL),
+   _free_list(NULL),
+   _capacity(0),
+   _free_count(0),
+   _in_use(0),
+   _high_water(0),
+   _overflows(0)
+{
+}
+
+UdpMsgPool::~UdpMsgPool()
+{
+   ::operator delete(_msgs);
+   delete [] _free_list;
+}
+
+void
+UdpMsgPool::Init(int capacity)
+{
+   ASSERT(_in_use == 0);
+   ::operator delete(_msgs);
+   delete [] _free_list;
+   _msgs = NULL;
+   _free_list = NULL;
+   _capacity = _free_count = 0;
+
+#if GGPO_UDP_MSG_POOL
+   /*
+    * The slab is raw memory; each message is constructed as it's handed out.
+    */
+   _msgs = (UdpMsg *)::operator new(capacity * sizeof(UdpMsg));
+   _free_list = new int[capacity];
+   _capacity = capacity;
+   for (int i = 0; i < capacity; i++) {
+      _free_list[_free_count++] = capacity - 1 - i;
+   }
+#endif
+}
+
+UdpMsg *
+UdpMsgPool::Alloc(UdpMsg::MsgType type)
+{
+   UdpMsg *msg;
+   if (_free_count) {
+      msg = new (&_msgs[_free_list[--_free_count]]) UdpMsg(type);
+   } else {
+      msg = new UdpMsg(type);
+      _overflows++;
+   }
+   _in_use++;
+   _high_water = MAX(_high_water, _in_use);
+   return msg;
+}
+
+void
+UdpMsgPool::Free(UdpMsg *msg)
+{
+   if (!msg) {
+      return;
+   }
+   _in_use--;
+   if (msg >= _msgs && msg < _msgs + _capacity) {
+      _free_list[_free_count++] = (int)(msg - _msgs);
+   } else {
+      delete msg;
+   }
+}
+
+void
+UdpMsgPool::GetStats(Stats *stats)
+{
+   stats->capacity = _capacity;
+   stats->in_use = _in_use;
+   stats->high_water = _high_water;
+   stats->overflows = _overflows;
+}
@@ -0,0 +1,57 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _UDP_MSG_POOL_H
+#define _UDP_MSG_POOL_H
+
+#include "udp_msg.h"
+
+/*
+ * Set to 0 to allocate every message on the heap, to compare against the pool.
+ */
+#ifndef GGPO_UDP_MSG_POOL
+#define GGPO_UDP_MSG_POOL     1
+#endif
+
+/*
+ * Fixed-capacity free list of UdpMsgs, owned by one UdpProtocol.  Messages
+ * are handed out most-recently-freed first so the same few stay in cache.
+ * If the pool runs dry, messages fall back to the heap and are counted as
+ * overflows.
+ */
+class UdpMsgPool
+{
+public:
+   struct Stats {
+      int      capacity;
+      int      in_use;
+      int      high_water;
+      int      overflows;
+   };
+
+public:
+   UdpMsgPool();
+   ~UdpMsgPool();
+   UdpMsgPool(const UdpMsgPool &) = delete;
+   UdpMsgPool &operator=(const UdpMsgPool &) = delete;
+
+   void Init(int capacity);
+   UdpMsg *Alloc(UdpMsg::MsgType type);
+   void Free(UdpMsg *msg);
+   void GetStats(Stats *stats);
+
+protected:
+   UdpMsg         *_msgs;
+   int            *_free_list;
+   int            _capacity;
+   int            _free_count;
+   int            _in_use;
+   int            _high_water;
+   int            _overflows;
+};
+
+#endif
@@ -19,6 +19,57 @@ static const int QUALITY_REPORT_INTERVAL = 1000;
 static const int NETWORK_STATS_INTERVAL  = 1000;
 static const int UDP_SHUTDOWN_TIMER = 5000;
 static const int MAX_SEQ_DISTANCE = (1 << 15);
+static const int SNAPSHOT_WINDOW_CHUNKS = 16;
+static const int SNAPSHOT_RETRY_INTERVAL = 200;
+static const uint32 MAX_SNAPSHOT_SIZE = 64 * 1024 * 1024;
+
+/*
+ * Varints store 7 bits per byte, low bits first, with the high bit set on
+ * every byte but the last.  Signed values are zigzag encoded first so small
+ * negative deltas stay small.
+ */
+static bool
+WriteVarint(uint8 **p, uint8 *end, uint32 value)
+{
+   do {
+      if (*p >= end) {
+         return false;
+      }
+      uint8 byte = value & 0x7F;
+      value >>= 7;
+      *(*p)++ = byte | (value ? 0x80 : 0);
+   } while (value);
+   return true;
+}
+
+static bool
+ReadVarint(const uint8 **p, const uint8 *end, uint32 *value)
+{
+   *value = 0;
+   for (int shift = 0; shift < 35; shift += 7) {
+      if (*p >= end) {
+         return false;
+      }
+      uint8 byte = *(*p)++;
+      *value |= (uint32)(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+static uint32
+ZigZag(int value)
+{
+   return ((uint32)value << 1) ^ (uint32)(value >> 31);
+}
+
+static int
+UnZigZag(uint32 value)
+{
+   return (int)(value >> 1) ^ -(int)(value & 1);
+}
 
 UdpProtocol::UdpProtocol() :
    _udp(NULL),
@@ -26,9 +77,13 @@ UdpProtocol::UdpProtocol() :
    _queue(-1),
    _remote_magic_number(0),
    _connected(false),
+   _round_trip_time(0),
+   _round_trip_jitter(-1),
    _packets_sent(0),
    _bytes_sent(0),
    _stats_start_time(0),
+   _input_packets_sent(0),
+   _input_bytes_sent(0),
    _local_frame_advantage(0),
    _remote_frame_advantage(0),
    _last_send_time(0),
@@ -38,7 +93,16 @@ UdpProtocol::UdpProtocol() :
    _disconnect_notify_start(0),
    _disconnect_notify_sent(false),
    _next_send_seq(0),
-   _next_recv_seq(0)
+   _next_recv_seq(0),
+   _local_capabilities(UDP_MSG_CAP_COMPACT_INPUT),
+   _remote_capabilities(0),
+   _snapshot_send_frame(-1),
+   _snapshot_send_acked(0),
+   _snapshot_send_offset(0),
+   _snapshot_send_progress_time(0),
+   _snapshot_recv_frame(-1),
+   _snapshot_recv_size(0),
+   _snapshot_recv_received(0)
 {
    _last_sent_input.init(-1, NULL, 1);
    _last_received_input.init(-1, NULL, 1);
@@ -49,10 +113,6 @@ UdpProtocol::UdpProtocol() :
    for (int i = 0; i < ARRAY_SIZE(_peer_connect_status); i++) {
       _peer_connect_status[i].last_frame = -1;
    }
-   _oo_packet.msg = NULL;
-
-   _send_latency = 2;
-   _oop_percent = 0;
 }
 
 UdpProtocol::~UdpProtocol()
@@ -72,6 +132,7 @@ UdpProtocol::Init(Udp *udp,
    _local_connect_status = status;
    
    _connection_id = connection_id;
+   _msg_pool.Init(MSG_POOL_SIZE);
 
    do {
       _magic_number = (uint16)rand();
@@ -81,6 +142,15 @@ UdpProtocol::Init(Udp *udp,
 
 void
 UdpProtocol::SendInput(GameInput &input)
+{
+   if (_udp) {
+      QueueInput(input);
+      SendPendingOutput();
+   }  
+}
+
+void
+UdpProtocol::QueueInput(GameInput &input)
 {
    if (_udp) {
       if (_current_state == Running) {
@@ -99,14 +169,24 @@ UdpProtocol::SendInput(GameInput &input)
           */
          _pending_output.push(input);
       }
-      SendPendingOutput();
-   }  
+   }
 }
 
 void
 UdpProtocol::SendPendingOutput()
 {
-   UdpMsg *msg = new UdpMsg(UdpMsg::Input);
+   if (_pending_output.size() && (_local_capabilities & _remote_capabilities & UDP_MSG_CAP_COMPACT_INPUT)) {
+      UdpMsg *compact = _msg_pool.Alloc(UdpMsg::CompactInput);
+      if (EncodeCompactInput(compact)) {
+         _input_packets_sent++;
+         _input_bytes_sent += compact->PacketSize();
+         SendMsg(compact);
+         return;
+      }
+      _msg_pool.Free(compact);
+   }
+
+   UdpMsg *msg = _msg_pool.Alloc(UdpMsg::Input);
    int i, j, offset = 0;
    uint8 *bits;
    GameInput last;
@@ -151,17 +231,157 @@ UdpProtocol::SendPendingOutput()
 
    ASSERT(offset < MAX_COMPRESSED_BITS);
 
+   _input_packets_sent++;
+   _input_bytes_sent += msg->PacketSize();
    SendMsg(msg);
 }
 
+/*
+ * Compact input layout, all varints unless noted:
+ *
+ *   start frame
+ *   zigzag(start frame - ack frame)
+ *   input size                          (1 byte)
+ *   flags: disconnect requested in bit 0, then one disconnected bit per
+ *          peer connect status          (1 byte)
+ *   zigzag(start frame - last frame) for each peer connect status
+ *   mask of input bytes that are non-zero in any frame of the packet
+ *   runs until the end: frame count, then the masked bytes of the input
+ *
+ * Game inputs rarely use more than their low 16 bits and are held for many
+ * frames, so a run is usually 3 bytes.  Returns false if the pending output
+ * doesn't fit, in which case the regular Input message is sent.
+ */
+bool
+UdpProtocol::EncodeCompactInput(UdpMsg *msg)
+{
+   uint8 *p = msg->u.compact_input.data;
+   uint8 *end = p + MAX_COMPACT_INPUT_BYTES;
+   GameInput &first = _pending_output.front();
+   int start_frame = first.frame;
+   int size = first.size;
+   int i, j;
+
+   if (size > MAX_COMPACT_INPUT_SIZE) {
+      return false;
+   }
+   uint32 mask = 0;
+   for (j = 0; j < _pending_output.size(); j++) {
+      GameInput &current = _pending_output.item(j);
+      ASSERT(current.size == size);
+      for (i = 0; i < size; i++) {
+         if (current.bits[i]) {
+            mask |= 1u << i;
+         }
+      }
+   }
+
+   uint8 flags = _current_state == Disconnected ? 1 : 0;
+   if (_local_connect_status) {
+      for (i = 0; i < UDP_MSG_MAX_PLAYERS; i++) {
+         flags |= _local_connect_status[i].disconnected << (i + 1);
+      }
+   }
+   if (!WriteVarint(&p, end, start_frame) ||
+       !WriteVarint(&p, end, ZigZag(start_frame - _last_received_input.frame)) ||
+       end - p < 2) {
+      return false;
+   }
+   *p++ = (uint8)size;
+   *p++ = flags;
+   for (i = 0; i < UDP_MSG_MAX_PLAYERS; i++) {
+      int last_frame = _local_connect_status ? _local_connect_status[i].last_frame : 0;
+      if (!WriteVarint(&p, end, ZigZag(start_frame - last_frame))) {
+         return false;
+      }
+   }
+   if (!WriteVarint(&p, end, mask)) {
+      return false;
+   }
+
+   for (j = 0; j < _pending_output.size(); ) {
+      GameInput &current = _pending_output.item(j);
+      int run = 1;
+      while (j + run < _pending_output.size() && memcmp(_pending_output.item(j + run).bits, current.bits, size) == 0) {
+         run++;
+      }
+      if (!WriteVarint(&p, end, run)) {
+         return false;
+      }
+      for (i = 0; i < size; i++) {
+         if (mask & (1u << i)) {
+            if (p >= end) {
+               return false;
+            }
+            *p++ = (uint8)current.bits[i];
+         }
+      }
+      j += run;
+   }
+
+   msg->u.compact_input.num_bytes = (uint16)(p - msg->u.compact_input.data);
+   _last_sent_input = _pending_output.item(_pending_output.size() - 1);
+   return true;
+}
+
 void
 UdpProtocol::SendInputAck()
 {
-   UdpMsg *msg = new UdpMsg(UdpMsg::InputAck);
+   UdpMsg *msg = _msg_pool.Alloc(UdpMsg::InputAck);
    msg->u.input_ack.ack_frame = _last_received_input.frame;
    SendMsg(msg);
 }
 
+void
+UdpProtocol::SendSnapshot(int frame, const uint8 *data, int len)
+{
+   ASSERT(len > 0 && (uint32)len <= MAX_SNAPSHOT_SIZE);
+   Log("Sending snapshot of frame %d (%d bytes).\n", frame, len);
+   _snapshot_send.assign(data, data + len);
+   _snapshot_send_frame = frame;
+   _snapshot_send_acked = 0;
+   _snapshot_send_offset = 0;
+   _snapshot_send_progress_time = Platform::GetCurrentTimeMS();
+   PumpSnapshot();
+}
+
+void
+UdpProtocol::TakeSnapshot(std::vector<uint8> &snapshot)
+{
+   snapshot.swap(_snapshot_recv);
+   _snapshot_recv.clear();
+}
+
+void
+UdpProtocol::PumpSnapshot()
+{
+   if (!_udp || _snapshot_send_frame < 0 || _current_state != Running) {
+      return;
+   }
+
+   unsigned int now = Platform::GetCurrentTimeMS();
+   if (_snapshot_send_progress_time + SNAPSHOT_RETRY_INTERVAL < now) {
+      if (_snapshot_send_offset > _snapshot_send_acked) {
+         Log("Snapshot stalled at %d of %d bytes.  Resending.\n", _snapshot_send_acked, (int)_snapshot_send.size());
+      }
+      _snapshot_send_offset = _snapshot_send_acked;
+      _snapshot_send_progress_time = now;
+   }
+
+   uint32 window_end = MIN((uint32)_snapshot_send.size(), _snapshot_send_acked + SNAPSHOT_WINDOW_CHUNKS * MAX_SNAPSHOT_CHUNK_BYTES);
+   while (_snapshot_send_offset < window_end) {
+      UdpMsg *msg = _msg_pool.Alloc(UdpMsg::SnapshotChunk);
+      uint16 num_bytes = (uint16)MIN(window_end - _snapshot_send_offset, (uint32)MAX_SNAPSHOT_CHUNK_BYTES);
+      msg->u.snapshot_chunk.frame = _snapshot_send_frame;
+      msg->u.snapshot_chunk.total_size = (uint32)_snapshot_send.size();
+      msg->u.snapshot_chunk.offset = _snapshot_send_offset;
+      msg->u.snapshot_chunk.num_bytes = num_bytes;
+      memcpy(msg->u.snapshot_chunk.data, &_snapshot_send[_snapshot_send_offset], num_bytes);
+      SendMsg(msg);
+      _snapshot_send_offset += num_bytes;
+   }
+}
+
 bool
 UdpProtocol::GetEvent(UdpProtocol::Event &e)
 {
@@ -201,9 +421,10 @@ UdpProtocol::OnLoopPoll(void *cookie)
          SendPendingOutput();
          _state.running.last_input_packet_recv_time = now;
       }
+      PumpSnapshot();
 
       if (!_state.running.last_quality_report_time || _state.running.last_quality_report_time + QUALITY_REPORT_INTERVAL < now) {
-         UdpMsg *msg = new UdpMsg(UdpMsg::QualityReport);
+         UdpMsg *msg = _msg_pool.Alloc(UdpMsg::QualityReport);
          msg->u.quality_report.ping = Platform::GetCurrentTimeMS();
          msg->u.quality_report.frame_advantage = (uint8)_local_frame_advantage;
          SendMsg(msg);
@@ -217,7 +438,7 @@ UdpProtocol::OnLoopPoll(void *cookie)
 
       if (_last_send_time && _last_send_time + KEEP_ALIVE_INTERVAL < now) {
          Log("Sending keep alive packet\n");
-         SendMsg(new UdpMsg(UdpMsg::KeepAlive));
+         SendMsg(_msg_pool.Alloc(UdpMsg::KeepAlive));
       }
 
       if (_disconnect_timeout && _disconnect_notify_start && 
@@ -262,8 +483,9 @@ void
 UdpProtocol::SendSyncRequest()
 {
    _state.sync.random = rand() & 0xFFFF;
-   UdpMsg *msg = new UdpMsg(UdpMsg::SyncRequest);
+   UdpMsg *msg = _msg_pool.Alloc(UdpMsg::SyncRequest);
    msg->u.sync_request.random_request = _state.sync.random;
+   msg->u.sync_request.capabilities = _local_capabilities;
    SendMsg(msg);
 }
 
@@ -307,6 +529,9 @@ UdpProtocol::OnMsg(UdpMsg *msg, int len)
       &UdpProtocol::OnQualityReply,        /* QualityReply */
       &UdpProtocol::OnKeepAlive,           /* KeepAlive */
       &UdpProtocol::OnInputAck,            /* InputAck */
+      &UdpProtocol::OnCompactInput,        /* CompactInput */
+      &UdpProtocol::OnSnapshotChunk,       /* SnapshotChunk */
+      &UdpProtocol::OnSnapshotAck,         /* SnapshotAck */
    };
 
    // filter out messages that don't match what we expect
@@ -393,6 +618,7 @@ UdpProtocol::GetPeerConnectStatus(int id, int *frame)
    return !_peer_connect_status[id].disconnected;
 }
 
+#if GGPO_LOGGING
 void
 UdpProtocol::Log(const char *fmt, ...)
 {
@@ -408,6 +634,7 @@ UdpProtocol::Log(const char *fmt, ...)
    ::Log(buf);
    va_end(args);
 }
+#endif
 
 void
 UdpProtocol::LogMsg(const char *prefix, UdpMsg *msg)
@@ -436,6 +663,16 @@ UdpProtocol::LogMsg(const char *prefix, UdpMsg *msg)
    case UdpMsg::InputAck:
       Log("%s input ack.\n", prefix);
       break;
+   case UdpMsg::CompactInput:
+      Log("%s compact-input (%d bytes).\n", prefix, msg->u.compact_input.num_bytes);
+      break;
+   case UdpMsg::SnapshotChunk:
+      Log("%s snapshot-chunk %d (%d + %d of %d bytes).\n", prefix, msg->u.snapshot_chunk.frame,
+          msg->u.snapshot_chunk.offset, msg->u.snapshot_chunk.num_bytes, msg->u.snapshot_chunk.total_size);
+      break;
+   case UdpMsg::SnapshotAck:
+      Log("%s snapshot-ack %d (%d bytes).\n", prefix, msg->u.snapshot_ack.frame, msg->u.snapshot_ack.received);
+      break;
    default:
       ASSERT(false && "Unknown UdpMsg type.");
    }
@@ -466,8 +703,10 @@ UdpProtocol::OnSyncRequest(UdpMsg *msg, int len)
            msg->hdr.magic, _remote_magic_number);
       return false;
    }
-   UdpMsg *reply = new UdpMsg(UdpMsg::SyncReply);
+   _remote_capabilities = msg->u.sync_request.capabilities;
+   UdpMsg *reply = _msg_pool.Alloc(UdpMsg::SyncReply);
    reply->u.sync_reply.random_reply = msg->u.sync_request.random_request;
+   reply->u.sync_reply.capabilities = _local_capabilities;
    SendMsg(reply);
    return true;
 }
@@ -486,6 +725,7 @@ UdpProtocol::OnSyncReply(UdpMsg *msg, int len)
       return false;
    }
 
+   _remote_capabilities = msg->u.sync_reply.capabilities;
    if (!_connected) {
       QueueEvent(Event(Event::Connected));
       _connected = true;
@@ -511,28 +751,7 @@ UdpProtocol::OnSyncReply(UdpMsg *msg, int len)
 bool
 UdpProtocol::OnInput(UdpMsg *msg, int len)
 {
-   /*
-    * If a disconnect is requested, go ahead and disconnect now.
-    */
-   bool disconnect_requested = msg->u.input.disconnect_requested;
-   if (disconnect_requested) {
-      if (_current_state != Disconnected && !_disconnect_event_sent) {
-         Log("Disconnecting endpoint on remote request.\n");
-         QueueEvent(Event(Event::Disconnected));
-         _disconnect_event_sent = true;
-      }
-   } else {
-      /*
-       * Update the peer connection status if this peer is still considered to be part
-       * of the network.
-       */
-      UdpMsg::connect_status* remote_status = msg->u.input.peer_connect_status;
-      for (int i = 0; i < ARRAY_SIZE(_peer_connect_status); i++) {
-         ASSERT(remote_status[i].last_frame >= _peer_connect_status[i].last_frame);
-         _peer_connect_status[i].disconnected = _peer_connect_status[i].disconnected || remote_status[i].disconnected;
-         _peer_connect_status[i].last_frame = MAX(_peer_connect_status[i].last_frame, remote_status[i].last_frame);
-      }
-   }
+   OnRemoteConnectStatus(msg->u.input.disconnect_requested, msg->u.input.peer_connect_status);
 
    /*
     * Decompress the input.
@@ -574,26 +793,7 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
           * the emulator.
           */
          if (useInputs) {
-            /*
-             * Move forward 1 frame in the stream.
-             */
-            char desc[1024];
-            ASSERT(currentFrame == _last_received_input.frame + 1);
-            _last_received_input.frame = currentFrame;
-
-            /*
-             * Send the event to the emualtor
-             */
-            UdpProtocol::Event evt(UdpProtocol::Event::Input);
-            evt.u.input.input = _last_received_input;
-
-            _last_received_input.desc(desc, ARRAY_SIZE(desc));
-
-            _state.running.last_input_packet_recv_time = Platform::GetCurrentTimeMS();
-
-            Log("Sending frame %d to emu queue %d (%s).\n", _last_received_input.frame, _queue, desc);
-            QueueEvent(evt);
-
+            QueueReceivedInput(currentFrame);
          } else {
             Log("Skipping past frame:(%d) current is %d.\n", currentFrame, _last_received_input.frame);
          }
@@ -606,29 +806,160 @@ UdpProtocol::OnInput(UdpMsg *msg, int len)
    }
    ASSERT(_last_received_input.frame >= last_received_frame_number);
 
+   AckPendingOutput(msg->u.input.ack_frame);
+   return true;
+}
+
+bool
+UdpProtocol::OnCompactInput(UdpMsg *msg, int len)
+{
+   const uint8 *p = msg->u.compact_input.data;
+   const uint8 *end = p + msg->u.compact_input.num_bytes;
+   uint32 start_frame, ack_delta, mask, value;
+   UdpMsg::connect_status remote_status[UDP_MSG_MAX_PLAYERS];
+   int i, size, flags;
+
    /*
-    * Get rid of our buffered input
+    * num_bytes comes off the wire.  Only trust it as far as the datagram
+    * we actually received.
     */
-   while (_pending_output.size() && _pending_output.front().frame < msg->u.input.ack_frame) {
-      Log("Throwing away pending output frame %d\n", _pending_output.front().frame);
-      _last_acked_input = _pending_output.front();
-      _pending_output.pop();
+   if (msg->u.compact_input.num_bytes > MAX_COMPACT_INPUT_BYTES || msg->PacketSize() > len) {
+      Log("Ignoring compact input of %d bytes in a %d byte packet.\n", msg->u.compact_input.num_bytes, len);
+      return false;
+   }
+   if (!ReadVarint(&p, end, &start_frame) || !ReadVarint(&p, end, &ack_delta) || end - p < 2) {
+      Log("Ignoring truncated compact input.\n");
+      return false;
+   }
+   size = *p++;
+   flags = *p++;
+   for (i = 0; i < UDP_MSG_MAX_PLAYERS; i++) {
+      if (!ReadVarint(&p, end, &value)) {
+         Log("Ignoring truncated compact input.\n");
+         return false;
+      }
+      remote_status[i].disconnected = (flags >> (i + 1)) & 1;
+      remote_status[i].last_frame = (int)start_frame - UnZigZag(value);
+   }
+   if (size > GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS || size > MAX_COMPACT_INPUT_SIZE || !ReadVarint(&p, end, &mask)) {
+      Log("Ignoring compact input with bad size %d.\n", size);
+      return false;
+   }
+
+   OnRemoteConnectStatus((flags & 1) != 0, remote_status);
+
+   int last_received_frame_number = _last_received_input.frame;
+   int currentFrame = start_frame;
+   if (p < end) {
+      _last_received_input.size = size;
+      if (_last_received_input.frame < 0) {
+         _last_received_input.frame = start_frame - 1;
+      }
    }
+   while (p < end) {
+      uint32 run;
+      char bits[GAMEINPUT_MAX_BYTES * GAMEINPUT_MAX_PLAYERS] = { 0 };
+      if (!ReadVarint(&p, end, &run)) {
+         break;
+      }
+      /*
+       * run comes off the wire too.  The sender can't have more frames
+       * pending than its ring holds, and every new frame becomes an event,
+       * so refuse runs past either.  Dropping the rest is safe: the sender
+       * keeps resending until we ack.
+       */
+      if (run == 0 || run > (uint32)(PENDING_OUTPUT_SIZE - 1 - (currentFrame - (int)start_frame)) ||
+          currentFrame + (int)run - 1 - _last_received_input.frame > EVENT_QUEUE_SIZE - 1 - _event_queue.size()) {
+         Log("Ignoring compact input run of %u frames from frame %d.\n", run, currentFrame);
+         return false;
+      }
+      for (i = 0; i < size; i++) {
+         if ((mask & (1u << i)) && p < end) {
+            bits[i] = *p++;
+         }
+      }
+      for (; run > 0; run--, currentFrame++) {
+         ASSERT(currentFrame <= (_last_received_input.frame + 1));
+         if (currentFrame == _last_received_input.frame + 1) {
+            memcpy(_last_received_input.bits, bits, size);
+            QueueReceivedInput(currentFrame);
+         } else {
+            Log("Skipping past frame:(%d) current is %d.\n", currentFrame, _last_received_input.frame);
+         }
+      }
+   }
+   ASSERT(_last_received_input.frame >= last_received_frame_number);
+
+   AckPendingOutput((int)start_frame - UnZigZag(ack_delta));
    return true;
 }
 
+void
+UdpProtocol::OnRemoteConnectStatus(bool disconnect_requested, UdpMsg::connect_status *remote_status)
+{
+   /*
+    * If a disconnect is requested, go ahead and disconnect now.
+    */
+   if (disconnect_requested) {
+      if (_current_state != Disconnected && !_disconnect_event_sent) {
+         Log("Disconnecting endpoint on remote request.\n");
+         QueueEvent(Event(Event::Disconnected));
+         _disconnect_event_sent = true;
+      }
+   } else {
+      /*
+       * Update the peer connection status if this peer is still considered to be part
+       * of the network.
+       */
+      for (int i = 0; i < ARRAY_SIZE(_peer_connect_status); i++) {
+         ASSERT(remote_status[i].last_frame >= _peer_connect_status[i].last_frame);
+         _peer_connect_status[i].disconnected = _peer_connect_status[i].disconnected || remote_status[i].disconnected;
+         _peer_connect_status[i].last_frame = MAX(_peer_connect_status[i].last_frame, remote_status[i].last_frame);
+      }
+   }
+}
+
+void
+UdpProtocol::QueueReceivedInput(int frame)
+{
+   /*
+    * Move forward 1 frame in the stream.
+    */
+   char desc[1024];
+   ASSERT(frame == _last_received_input.frame + 1);
+   _last_received_input.frame = frame;
 
-bool
-UdpProtocol::OnInputAck(UdpMsg *msg, int len)
+   /*
+    * Send the event to the emualtor
+    */
+   UdpProtocol::Event evt(UdpProtocol::Event::Input);
+   evt.u.input.input = _last_received_input;
+
+   _last_received_input.desc(desc, ARRAY_SIZE(desc));
+
+   _state.running.last_input_packet_recv_time = Platform::GetCurrentTimeMS();
+
+   Log("Sending frame %d to emu queue %d (%s).\n", _last_received_input.frame, _queue, desc);
+   QueueEvent(evt);
+}
+
+void
+UdpProtocol::AckPendingOutput(int ack_frame)
 {
    /*
     * Get rid of our buffered input
     */
-   while (_pending_output.size() && _pending_output.front().frame < msg->u.input_ack.ack_frame) {
+   while (_pending_output.size() && _pending_output.front().frame < ack_frame) {
       Log("Throwing away pending output frame %d\n", _pending_output.front().frame);
       _last_acked_input = _pending_output.front();
       _pending_output.pop();
    }
+}
+
+bool
+UdpProtocol::OnInputAck(UdpMsg *msg, int len)
+{
+   AckPendingOutput(msg->u.input_ack.ack_frame);
    return true;
 }
 
@@ -636,7 +967,7 @@ bool
 UdpProtocol::OnQualityReport(UdpMsg *msg, int len)
 {
    // send a reply so the other side can compute the round trip transmit time.
-   UdpMsg *reply = new UdpMsg(UdpMsg::QualityReply);
+   UdpMsg *reply = _msg_pool.Alloc(UdpMsg::QualityReply);
    reply->u.quality_reply.pong = msg->u.quality_report.ping;
    SendMsg(reply);
 
@@ -647,7 +978,20 @@ UdpProtocol::OnQualityReport(UdpMsg *msg, int len)
 bool
 UdpProtocol::OnQualityReply(UdpMsg *msg, int len)
 {
-   _round_trip_time = Platform::GetCurrentTimeMS() - msg->u.quality_reply.pong;
+   int rtt = Platform::GetCurrentTimeMS() - msg->u.quality_reply.pong;
+
+   /*
+    * Smoothed mean deviation of the round trip time, as in RFC 3550.  Kept
+    * in 1/16ths of a ms so the integer update doesn't round small changes
+    * away.  -1 until the first reply arrives.
+    */
+   if (_round_trip_jitter < 0) {
+      _round_trip_jitter = 0;
+   } else {
+      int delta = abs(rtt - _round_trip_time) * 16;
+      _round_trip_jitter += (delta - _round_trip_jitter) / 16;
+   }
+   _round_trip_time = rtt;
    return true;
 }
 
@@ -657,14 +1001,93 @@ UdpProtocol::OnKeepAlive(UdpMsg *msg, int len)
    return true;
 }
 
+bool
+UdpProtocol::OnSnapshotChunk(UdpMsg *msg, int len)
+{
+   int frame = msg->u.snapshot_chunk.frame;
+   uint32 num_bytes = msg->u.snapshot_chunk.num_bytes;
+
+   /*
+    * As with compact input, num_bytes comes off the wire and the chunk is
+    * only as long as the datagram we actually received.
+    */
+   if (num_bytes > MAX_SNAPSHOT_CHUNK_BYTES || msg->PacketSize() > len) {
+      Log("Ignoring snapshot chunk of %d bytes in a %d byte packet.\n", num_bytes, len);
+      return false;
+   }
+
+   if (frame != _snapshot_recv_frame) {
+      if (msg->u.snapshot_chunk.total_size == 0 || msg->u.snapshot_chunk.total_size > MAX_SNAPSHOT_SIZE) {
+         Log("Ignoring snapshot of %d bytes.\n", msg->u.snapshot_chunk.total_size);
+         return false;
+      }
+      Log("Receiving snapshot of frame %d (%d bytes).\n", frame, msg->u.snapshot_chunk.total_size);
+      _snapshot_recv.clear();
+      _snapshot_recv.reserve(msg->u.snapshot_chunk.total_size);
+      _snapshot_recv_frame = frame;
+      _snapshot_recv_size = msg->u.snapshot_chunk.total_size;
+      _snapshot_recv_received = 0;
+   }
+
+   /*
+    * Anything but the next chunk is a resend or got ahead of a lost one.
+    * Either way, the ack tells the sender where to carry on from.
+    */
+   if (msg->u.snapshot_chunk.offset == _snapshot_recv_received && _snapshot_recv_received < _snapshot_recv_size) {
+      num_bytes = MIN(num_bytes, _snapshot_recv_size - _snapshot_recv_received);
+      _snapshot_recv.insert(_snapshot_recv.end(), msg->u.snapshot_chunk.data, msg->u.snapshot_chunk.data + num_bytes);
+      _snapshot_recv_received += num_bytes;
+      if (_snapshot_recv_received == _snapshot_recv_size) {
+         Event evt(Event::Snapshot);
+         evt.u.snapshot.frame = frame;
+         QueueEvent(evt);
+      }
+   }
+
+   UdpMsg *ack = _msg_pool.Alloc(UdpMsg::SnapshotAck);
+   ack->u.snapshot_ack.frame = frame;
+   ack->u.snapshot_ack.received = _snapshot_recv_received;
+   SendMsg(ack);
+   return true;
+}
+
+bool
+UdpProtocol::OnSnapshotAck(UdpMsg *msg, int len)
+{
+   if (msg->u.snapshot_ack.frame != _snapshot_send_frame || msg->u.snapshot_ack.received <= _snapshot_send_acked) {
+      return true;
+   }
+   _snapshot_send_acked = MIN(msg->u.snapshot_ack.received, (uint32)_snapshot_send.size());
+   _snapshot_send_offset = MAX(_snapshot_send_offset, _snapshot_send_acked);
+   _snapshot_send_progress_time = Platform::GetCurrentTimeMS();
+   if (_snapshot_send_acked == _snapshot_send.size()) {
+      Log("Snapshot of frame %d delivered.\n", _snapshot_send_frame);
+      _snapshot_send_frame = -1;
+      std::vector<uint8>().swap(_snapshot_send);
+   } else {
+      PumpSnapshot();
+   }
+   return true;
+}
+
 void
 UdpProtocol::GetNetworkStats(struct FGGPONetworkStats *s)
 {
    s->network.ping = _round_trip_time;
+   s->network.ping_jitter = _round_trip_jitter < 0 ? -1 : _round_trip_jitter / 16;
    s->network.send_queue_len = _pending_output.size();
    s->network.kbps_sent = _kbps_sent;
+
+   UdpMsgPool::Stats pool;
+   _msg_pool.GetStats(&pool);
+   s->network.msg_pool_high_water = pool.high_water;
+   s->network.msg_pool_overflows = pool.overflows;
+   s->network.input_packets_sent = _input_packets_sent;
+   s->network.input_bytes_sent = _input_bytes_sent;
+   s->network.compact_input = (_local_capabilities & _remote_capabilities & UDP_MSG_CAP_COMPACT_INPUT) != 0;
    s->timesync.remote_frames_behind = _remote_frame_advantage;
    s->timesync.local_frames_behind = _local_frame_advantage;
+   s->timesync.frames_ahead = _timesync.frames_ahead();
 }
 
 void
@@ -706,47 +1129,37 @@ UdpProtocol::SetDisconnectNotifyStart(int timeout)
    _disconnect_notify_start = timeout;
 }
 
+void
+UdpProtocol::SetCompactInput(bool enabled)
+{
+   if (enabled) {
+      _local_capabilities |= UDP_MSG_CAP_COMPACT_INPUT;
+   } else {
+      _local_capabilities &= ~UDP_MSG_CAP_COMPACT_INPUT;
+   }
+}
+
 void
 UdpProtocol::PumpSendQueue()
 {
+   /*
+    * Latency, loss and reordering are simulated by wrapping the connection
+    * manager in a SimulatedConnectionManager.
+    */
    while (!_send_queue.empty()) {
       QueueEntry &entry = _send_queue.front();
+      _udp->SendTo((char *)entry.msg, entry.msg->PacketSize(), 0, entry.connection_id);
 
-      if (_send_latency) {
-         // should really come up with a gaussian distributation based on the configured
-         // value, but this will do for now.
-         int jitter = (_send_latency * 2 / 3) + ((rand() % _send_latency) / 3);
-         if (Platform::GetCurrentTimeMS() < _send_queue.front().queue_time + jitter) {
-            break;
-         }
-      }
-      if (_oop_percent && !_oo_packet.msg && ((rand() % 100) < _oop_percent)) {
-         int delay = rand() % (_send_latency * 10 + 1000);
-         Log("creating rogue oop (seq: %d  delay: %d)\n", entry.msg->hdr.sequence_number, delay);
-         _oo_packet.send_time = Platform::GetCurrentTimeMS() + delay;
-         _oo_packet.msg = entry.msg;
-         _oo_packet.connection_id = entry.connection_id;
-      } else {
-         _udp->SendTo((char *)entry.msg, entry.msg->PacketSize(), 0, entry.connection_id);
-
-         delete entry.msg;
-      }
+      _msg_pool.Free(entry.msg);
       _send_queue.pop();
    }
-   if (_oo_packet.msg && _oo_packet.send_time < Platform::GetCurrentTimeMS()) {
-      Log("sending rogue oop!");
-      _udp->SendTo((char *)_oo_packet.msg, _oo_packet.msg->PacketSize(), 0, _oo_packet.connection_id);
-
-      delete _oo_packet.msg;
-      _oo_packet.msg = NULL;
-   }
 }
 
 void
 UdpProtocol::ClearSendQueue()
 {
    while (!_send_queue.empty()) {
-      delete _send_queue.front().msg;
+      _msg_pool.Free(_send_queue.front().msg);
       _send_queue.pop();
    }
 }
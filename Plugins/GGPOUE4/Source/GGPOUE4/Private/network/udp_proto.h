@@ -8,9 +8,11 @@
 #ifndef _UDP_PROTO_H_
 #define _UDP_PROTO_H_
 
+#include <vector>
 #include "poll.h"
 #include "udp.h"
 #include "udp_msg.h"
+#include "udp_msg_pool.h"
 #include "game_input.h"
 #include "timesync.h"
 #include "include/ggponet.h"
@@ -25,6 +27,7 @@ public:
       int                 local_frame_advantage;
       int                 send_queue_len;
       Udp::Stats          udp;
+      UdpMsgPool::Stats   msg_pool;
    };
 
    struct Event {
@@ -37,6 +40,7 @@ public:
          Disconnected,
          NetworkInterrupted,
          NetworkResumed,
+         Snapshot,
       };
 
       Type      type;
@@ -51,6 +55,9 @@ public:
          struct {
             int         disconnect_timeout;
          } network_interrupted;
+         struct {
+            int         frame;
+         } snapshot;
       } u;
 
       Event(Type t = Unknown) : type(t) { }
@@ -71,7 +78,30 @@ public:
    bool IsSynchronized() { return _current_state == Running; }
    bool IsRunning() { return _current_state == Running; }
    void SendInput(GameInput &input);
+   /*
+    * QueueInput adds an input to the pending output without sending it, so
+    * several frames can go out in one packet with SendPendingOutput.
+    */
+   void QueueInput(GameInput &input);
+   void SendPendingOutput();
+   int GetPendingOutputSize() { return _pending_output.size(); }
    void SendInputAck();
+
+   /*
+    * Spectators are sent at most this many inputs at once, so what they
+    * haven't acked always fits one input message.
+    */
+   static const int MAX_SPECTATOR_PENDING_OUTPUT = 32;
+
+   /*
+    * SendSnapshot sends a copy of a game state snapshot to a spectator
+    * joining a game in progress, once the endpoint is running.  No input
+    * should be queued until IsSendingSnapshot is false.  The other side
+    * gets a Snapshot event and takes the data with TakeSnapshot.
+    */
+   void SendSnapshot(int frame, const uint8 *data, int len);
+   bool IsSendingSnapshot() { return _snapshot_send_frame >= 0; }
+   void TakeSnapshot(std::vector<uint8> &snapshot);
    bool HandlesMsg(int connection_id, UdpMsg *msg);
    void OnMsg(UdpMsg *msg, int len);
    void Disconnect();
@@ -84,8 +114,17 @@ public:
 
    void SetDisconnectTimeout(int timeout);
    void SetDisconnectNotifyStart(int timeout);
+   void SetCompactInput(bool enabled);
 
 protected:
+   /*
+    * Every queued message, plus one being filled in, comes from the pool.
+    */
+   static const int SEND_QUEUE_SIZE = 64;
+   static const int MSG_POOL_SIZE = SEND_QUEUE_SIZE + 1;
+   static const int PENDING_OUTPUT_SIZE = 64;
+   static const int EVENT_QUEUE_SIZE = 64;
+
    enum State {
       Syncing,
       Synchronzied,
@@ -105,22 +144,33 @@ protected:
    void UpdateNetworkStats(void);
    void QueueEvent(const UdpProtocol::Event &evt);
    void ClearSendQueue(void);
+#if GGPO_LOGGING
    void Log(const char *fmt, ...);
+#else
+   template <typename... Args> void Log(const char *, Args...) { }
+#endif
    void LogMsg(const char *prefix, UdpMsg *msg);
    void LogEvent(const char *prefix, const UdpProtocol::Event &evt);
    void SendSyncRequest();
    void SendMsg(UdpMsg *msg);
    void PumpSendQueue();
+   void PumpSnapshot();
    void DispatchMsg(uint8 *buffer, int len);
-   void SendPendingOutput();
+   bool EncodeCompactInput(UdpMsg *msg);
+   void OnRemoteConnectStatus(bool disconnect_requested, UdpMsg::connect_status *remote_status);
+   void QueueReceivedInput(int frame);
+   void AckPendingOutput(int ack_frame);
    bool OnInvalid(UdpMsg *msg, int len);
    bool OnSyncRequest(UdpMsg *msg, int len);
    bool OnSyncReply(UdpMsg *msg, int len);
    bool OnInput(UdpMsg *msg, int len);
+   bool OnCompactInput(UdpMsg *msg, int len);
    bool OnInputAck(UdpMsg *msg, int len);
    bool OnQualityReport(UdpMsg *msg, int len);
    bool OnQualityReply(UdpMsg *msg, int len);
    bool OnKeepAlive(UdpMsg *msg, int len);
+   bool OnSnapshotChunk(UdpMsg *msg, int len);
+   bool OnSnapshotAck(UdpMsg *msg, int len);
 
 protected:
    /*
@@ -133,23 +183,20 @@ protected:
    int            _queue;
    uint16         _remote_magic_number;
    bool           _connected;
-   int            _send_latency;
-   int            _oop_percent;
-   struct {
-      int         send_time;
-      int         connection_id;
-      UdpMsg*     msg;
-   }              _oo_packet;
-   RingBuffer<QueueEntry, 64> _send_queue;
+   RingBuffer<QueueEntry, SEND_QUEUE_SIZE> _send_queue;
+   UdpMsgPool     _msg_pool;
 
    /*
     * Stats
     */
    int            _round_trip_time;
+   int            _round_trip_jitter;
    int            _packets_sent;
    int            _bytes_sent;
    int            _kbps_sent;
    int            _stats_start_time;
+   int            _input_packets_sent;
+   int            _input_bytes_sent;
 
    /*
     * The state machine
@@ -179,7 +226,7 @@ protected:
    /*
     * Packet loss...
     */
-   RingBuffer<GameInput, 64>  _pending_output;
+   RingBuffer<GameInput, PENDING_OUTPUT_SIZE>  _pending_output;
    GameInput                  _last_received_input;
    GameInput                  _last_sent_input;
    GameInput                  _last_acked_input;
@@ -194,6 +241,28 @@ protected:
    uint16                     _next_send_seq;
    uint16                     _next_recv_seq;
 
+   /*
+    * UDP_MSG_CAP_* flags.  Compact input is only sent once both sides have
+    * offered it during sync, but is always accepted.
+    */
+   uint8                      _local_capabilities;
+   uint8                      _remote_capabilities;
+
+   /*
+    * Snapshot transfer.  The sender keeps a window of chunks in flight past
+    * the last acked byte, and goes back to it if no ack moves it on for a
+    * while.  The receiver only takes chunks in order.
+    */
+   std::vector<uint8>         _snapshot_send;
+   int                        _snapshot_send_frame;
+   uint32                     _snapshot_send_acked;
+   uint32                     _snapshot_send_offset;
+   unsigned int               _snapshot_send_progress_time;
+   std::vector<uint8>         _snapshot_recv;
+   int                        _snapshot_recv_frame;
+   uint32                     _snapshot_recv_size;
+   uint32                     _snapshot_recv_received;
+
    /*
     * Rift synchronization.
     */
@@ -202,7 +271,7 @@ protected:
    /*
     * Event queue
     */
-   RingBuffer<UdpProtocol::Event, 64>  _event_queue;
+   RingBuffer<UdpProtocol::Event, EVENT_QUEUE_SIZE>  _event_queue;
 };
 
 #endif
@@ -14,6 +14,12 @@ uint32_t Platform::GetCurrentTimeMS() {
   return (ts.tv_sec * 1000) + (ts.tv_nsec / (1000*1000));
 }
 
+uint64_t Platform::GetCurrentTimeUS() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
 void Platform::SleepMS(int milliseconds) {
   usleep(milliseconds * 1000);
 }
@@ -52,6 +52,7 @@ public:  // functions
    static ProcessID GetProcessID() { return getpid(); }
    static void AssertFailed(char *msg) { }
    static uint32_t GetCurrentTimeMS();
+   static uint64_t GetCurrentTimeUS();
    static void SleepMS(int milliseconds);
    static void CreateDirectory(const char* pathname, const void* junk);
 };
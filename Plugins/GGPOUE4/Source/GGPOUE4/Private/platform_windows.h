@@ -28,6 +28,12 @@ public:  // functions
    static ProcessID GetProcessID() { return GetCurrentProcessId(); }
    static void AssertFailed(char *msg) { MessageBoxA(NULL, msg, "GGPO Assertion Failed", MB_OK | MB_ICONEXCLAMATION); }
    static uint32_t GetCurrentTimeMS() { return timeGetTime(); }
+   static uint64_t GetCurrentTimeUS() {
+      LARGE_INTEGER freq, now;
+      QueryPerformanceFrequency(&freq);
+      QueryPerformanceCounter(&now);
+      return (now.QuadPart / freq.QuadPart) * 1000000 + (now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+   }
    static void SleepMS(int ms) { Sleep(ms); }
    static void CreateDirectory(const char* pathname, const void* junk) { CreateDirectoryA(pathname, (LPSECURITY_ATTRIBUTES)junk); }
 };
@@ -7,6 +7,11 @@
 
 #include "poll.h"
 #include "types.h"
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
 
 #ifndef _WIN32
 using namespace neosmart;
@@ -14,7 +19,10 @@ using namespace neosmart;
 
 Poll::Poll(void) :
    _start_time(0),
-   _handle_count(0)
+   _handle_count(0),
+   _epoll_fd(-1),
+   _timer_fd(-1),
+   _wait_handle_count(0)
 {
    /*
     * Create a dummy handle to simplify things.
@@ -24,6 +32,29 @@ Poll::Poll(void) :
 #else
    _handles[_handle_count++] = CreateEvent(true, false);
 #endif
+
+#if defined(__linux__)
+   _epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   _timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   if (_epoll_fd != -1 && _timer_fd != -1) {
+      epoll_event ev = { 0 };
+      ev.events = EPOLLIN;
+      ev.data.fd = _timer_fd;
+      epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _timer_fd, &ev);
+   }
+#endif
+}
+
+Poll::~Poll(void)
+{
+#if defined(__linux__)
+   if (_timer_fd != -1) {
+      close(_timer_fd);
+   }
+   if (_epoll_fd != -1) {
+      close(_epoll_fd);
+   }
+#endif
 }
 
 void
@@ -53,6 +84,22 @@ Poll::RegisterPeriodic(IPollSink *sink, int interval, void *cookie)
    _periodic_sinks.push_back(PollPeriodicSinkCb(sink, cookie, interval));
 }
 
+void
+Poll::RegisterWaitHandle(int fd)
+{
+#if defined(__linux__)
+   if (fd < 0 || _epoll_fd == -1 || _timer_fd == -1 || _wait_handle_count >= MAX_WAIT_HANDLES) {
+      return;
+   }
+   epoll_event ev = { 0 };
+   ev.events = EPOLLIN;
+   ev.data.fd = fd;
+   if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0) {
+      _wait_handle_count++;
+   }
+#endif
+}
+
 void
 Poll::Run()
 {
@@ -105,6 +152,48 @@ Poll::Pump(int timeout)
    return finished;
 }
 
+bool
+Poll::Wait(int timeout)
+{
+#if defined(__linux__)
+   if (_wait_handle_count > 0) {
+      if (_start_time == 0) {
+         _start_time = Platform::GetCurrentTimeMS();
+      }
+      int maxwait = ComputeWaitTime(Platform::GetCurrentTimeMS() - _start_time);
+      if (maxwait != INFINITE) {
+         timeout = MIN(timeout, maxwait);
+      }
+      if (timeout <= 0) {
+         return false;
+      }
+
+      // The timer is armed for every wait and disarmed after it, so a stale expiry never cuts the next one short.
+      itimerspec deadline = { 0 };
+      deadline.it_value.tv_sec = timeout / 1000;
+      deadline.it_value.tv_nsec = (long)(timeout % 1000) * 1000000;
+      timerfd_settime(_timer_fd, 0, &deadline, NULL);
+
+      epoll_event events[MAX_WAIT_HANDLES + 1];
+      int count = epoll_wait(_epoll_fd, events, MAX_WAIT_HANDLES + 1, -1);
+      bool woken = false;
+      for (int i = 0; i < count; i++) {
+         woken |= events[i].data.fd != _timer_fd;
+      }
+
+      itimerspec disarm = { 0 };
+      timerfd_settime(_timer_fd, 0, &disarm, NULL);
+      uint64 expirations;
+      while (read(_timer_fd, &expirations, sizeof(expirations)) > 0) {
+         continue;
+      }
+      return woken;
+   }
+#endif
+   Platform::SleepMS(1);
+   return false;
+}
+
 int
 Poll::ComputeWaitTime(int elapsed)
 {
@@ -11,6 +11,16 @@
 #include "static_buffer.h"
 
 #define MAX_POLLABLE_HANDLES     64
+/*
+ * Every UdpProtocol registers a loop sink, so this must hold one per player
+ * and spectator a session can have, GGPO_MAX_PLAYERS + GGPO_MAX_SPECTATORS.
+ * StaticBuffer holds one less than its size.
+ */
+#define MAX_LOOP_SINKS           64
+/*
+ * Descriptors Wait can sleep on, one per connection manager with a socket.
+ */
+#define MAX_WAIT_HANDLES         4
 
 
 class IPollSink {
@@ -25,13 +35,26 @@ public:
 class Poll {
 public:
    Poll(void);
+   ~Poll(void);
    void RegisterHandle(IPollSink *sink, HANDLE h, void *cookie = NULL);
    void RegisterMsgLoop(IPollSink *sink, void *cookie = NULL);
    void RegisterPeriodic(IPollSink *sink, int interval, void *cookie = NULL);
    void RegisterLoop(IPollSink *sink, void *cookie = NULL);
+   /*
+    * Lets Wait wake as soon as fd becomes readable.  Only Linux waits on
+    * descriptors, other platforms ignore them.
+    */
+   void RegisterWaitHandle(int fd);
 
    void Run();
    bool Pump(int timeout);
+   /*
+    * Sleeps until a wait handle is readable, a periodic sink is due or
+    * timeout milliseconds pass, whichever comes first, and returns whether
+    * a wait handle woke it.  Without wait handles to sleep on, this sleeps
+    * for a millisecond and returns false.
+    */
+   bool Wait(int timeout);
 
 protected:
    int ComputeWaitTime(int elapsed);
@@ -57,8 +80,16 @@ protected:
    PollSinkCb        _handle_sinks[MAX_POLLABLE_HANDLES];
 
    StaticBuffer<PollSinkCb, 16>          _msg_sinks;
-   StaticBuffer<PollSinkCb, 16>          _loop_sinks;
+   StaticBuffer<PollSinkCb, MAX_LOOP_SINKS> _loop_sinks;
    StaticBuffer<PollPeriodicSinkCb, 16>  _periodic_sinks;
+
+   /*
+    * On Linux, Wait sleeps in epoll_wait on the wait handles and a timerfd
+    * armed for its deadline.
+    */
+   int               _epoll_fd;
+   int               _timer_fd;
+   int               _wait_handle_count;
 };
 
 #endif
@@ -23,9 +23,10 @@ Sync::~Sync()
     * Delete frames manually here rather than in a destructor of the SavedFrame
     * structure so we can efficently copy frames via weak references.
     */
-   for (int i = 0; i < ARRAY_SIZE(_savedstate.frames); i++) {
+   for (int i = 0; i < _savedstate.count; i++) {
       _callbacks.free_buffer(_savedstate.frames[i].buf);
    }
+   delete [] _savedstate.frames;
    delete [] _input_queues;
    _input_queues = NULL;
 }
@@ -40,16 +41,32 @@ Sync::Init(Sync::Config &config)
 
    _max_prediction_frames = config.num_prediction_frames;
 
+   /*
+    * Every frame in the prediction window can be rolled back to, plus the
+    * frame being saved and the last confirmed one.
+    */
+   _savedstate.count = _max_prediction_frames + 2;
+   _savedstate.frames = new SavedFrame[_savedstate.count];
+   _savedstate.head = 0;
+
    CreateQueues(config);
 }
 
 void
 Sync::SetLastConfirmedFrame(int frame) 
 {   
+   if (frame != _last_confirmed_frame) {
+      Trace(TRACE_CONFIRMED_FRAME, 0, frame);
+   }
    _last_confirmed_frame = frame;
-   if (_last_confirmed_frame > 0) {
+   /*
+    * Rollbacks resimulate from the last save before the frame they need,
+    * so the inputs since the last save before this frame are kept.
+    */
+   int discard_to = GetLastSaveFrame(frame) - 1;
+   if (discard_to >= 0) {
       for (int i = 0; i < _config.num_players; i++) {
-         _input_queues[i].DiscardConfirmedFrames(frame - 1);
+         _input_queues[i].DiscardConfirmedFrames(discard_to);
       }
    }
 }
@@ -60,6 +77,7 @@ Sync::AddLocalInput(int queue, GameInput &input)
    int frames_behind = _framecount - _last_confirmed_frame; 
    if (_framecount >= _max_prediction_frames && frames_behind >= _max_prediction_frames) {
       Log("Rejecting input from emulator: reached prediction barrier.\n");
+      Trace(TRACE_PREDICTION_BARRIER, queue, _framecount, _last_confirmed_frame);
       return false;
    }
 
@@ -69,6 +87,7 @@ Sync::AddLocalInput(int queue, GameInput &input)
 
    Log("Sending undelayed local frame %d to queue %d.\n", _framecount, queue);
    input.frame = _framecount;
+   Trace(TRACE_LOCAL_INPUT, queue, input.frame, TraceInputBits(input.bits));
    _input_queues[queue].AddInput(input);
 
    return true;
@@ -77,6 +96,7 @@ Sync::AddLocalInput(int queue, GameInput &input)
 void
 Sync::AddRemoteInput(int queue, GameInput &input)
 {
+   Trace(TRACE_REMOTE_INPUT, queue, input.frame, TraceInputBits(input.bits));
    _input_queues[queue].AddInput(input);
 }
 
@@ -137,23 +157,28 @@ void
 Sync::IncrementFrame(void)
 {
    _framecount++;
-   SaveCurrentFrame();
+   if (_framecount % _config.save_interval == 0) {
+      SaveCurrentFrame();
+   }
 }
 
 void
 Sync::AdjustSimulation(int seek_to)
 {
    int framecount = _framecount;
-   int count = _framecount - seek_to;
 
    Log("Catching up\n");
    _rollingback = true;
 
    /*
-    * Flush our input queue and load the last frame.
+    * Flush our input queue and load the last frame saved at or before
+    * seek_to.  With a save interval, the frames in between are simulated
+    * again too.
     */
-   LoadFrame(seek_to);
-   ASSERT(_framecount == seek_to);
+   LoadFrame(GetLastSaveFrame(seek_to));
+   ASSERT(_framecount <= seek_to);
+   int count = framecount - _framecount;
+   Trace(TRACE_ROLLBACK, 0, seek_to, count);
 
    /*
     * Advance frame by frame (stuffing notifications back to 
@@ -187,12 +212,13 @@ Sync::LoadFrame(int frame)
        state->frame, state->cbuf, state->checksum);
 
    ASSERT(state->buf && state->cbuf);
+   Trace(TRACE_LOAD_STATE, 0, state->frame, _framecount);
    _callbacks.load_game_state(state->buf, state->cbuf);
 
    // Reset framecount and the head of the state ring-buffer to point in
    // advance of the current frame (as if we had just finished executing it).
    _framecount = state->frame;
-   _savedstate.head = (_savedstate.head + 1) % ARRAY_SIZE(_savedstate.frames);
+   _savedstate.head = (_savedstate.head + 1) % _savedstate.count;
 }
 
 void
@@ -211,7 +237,8 @@ Sync::SaveCurrentFrame()
    _callbacks.save_game_state(&state->buf, &state->cbuf, &state->checksum, state->frame);
 
    Log("=== Saved frame info %d (size: %d  checksum: %08x).\n", state->frame, state->cbuf, state->checksum);
-   _savedstate.head = (_savedstate.head + 1) % ARRAY_SIZE(_savedstate.frames);
+   Trace(TRACE_SAVE_STATE, 0, state->frame, state->checksum, state->cbuf);
+   _savedstate.head = (_savedstate.head + 1) % _savedstate.count;
 }
 
 Sync::SavedFrame&
@@ -219,16 +246,30 @@ Sync::GetLastSavedFrame()
 {
    int i = _savedstate.head - 1;
    if (i < 0) {
-      i = ARRAY_SIZE(_savedstate.frames) - 1;
+      i = _savedstate.count - 1;
    }
    return _savedstate.frames[i];
 }
 
+bool
+Sync::GetSavedFrame(int frame, byte **buf, int *len)
+{
+   for (int i = 0; i < _savedstate.count; i++) {
+      SavedFrame &state = _savedstate.frames[i];
+      if (state.frame == frame && state.buf) {
+         *buf = state.buf;
+         *len = state.cbuf;
+         return true;
+      }
+   }
+   return false;
+}
+
 
 int
 Sync::FindSavedFrameIndex(int frame)
 {
-   int i, count = ARRAY_SIZE(_savedstate.frames);
+   int i, count = _savedstate.count;
    for (i = 0; i < count; i++) {
       if (_savedstate.frames[i].frame == frame) {
          break;
@@ -248,7 +289,7 @@ Sync::CreateQueues(Config &config)
    _input_queues = new InputQueue[_config.num_players];
 
    for (int i = 0; i < _config.num_players; i++) {
-      _input_queues[i].Init(i, _config.input_size);
+      _input_queues[i].Init(i, _config.input_size, _config.input_queue_length);
    }
    return true;
 }
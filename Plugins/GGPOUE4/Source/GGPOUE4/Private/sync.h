@@ -15,8 +15,6 @@
 #include "ring_buffer.h"
 #include "network/udp_msg.h"
 
-#define MAX_PREDICTION_FRAMES    8
-
 class SyncTestBackend;
 
 class Sync {
@@ -24,6 +22,8 @@ public:
    struct Config {
       GGPOSessionCallbacks    callbacks;
       int                     num_prediction_frames;
+      int                     input_queue_length;
+      int                     save_interval;
       int                     num_players;
       int                     input_size;
    };
@@ -56,6 +56,16 @@ public:
    void IncrementFrame(void);
 
    int GetFrameCount() { return _framecount; }
+   int GetLastConfirmedFrame() { return _last_confirmed_frame; }
+   /*
+    * Only every save_interval'th frame is saved.  This is the last saved
+    * frame at or before frame, which a rollback to frame starts from.
+    */
+   int GetLastSaveFrame(int frame) { return frame - frame % _config.save_interval; }
+   /*
+    * The state saved at the start of frame, if it is still kept.
+    */
+   bool GetSavedFrame(int frame, byte **buf, int *len);
    bool InRollback() { return _rollingback; }
 
    bool GetEvent(Event &e);
@@ -71,7 +81,8 @@ protected:
       SavedFrame() : buf(NULL), cbuf(0), frame(-1), checksum(0) { }
    };
    struct SavedState {
-      SavedFrame frames[MAX_PREDICTION_FRAMES + 2];
+      SavedFrame *frames;  // num_prediction_frames + 2 of them
+      int count;
       int head;
    };
 
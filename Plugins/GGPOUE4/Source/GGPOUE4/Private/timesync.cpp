@@ -27,8 +27,8 @@ TimeSync::advance_frame(GameInput &input, int advantage, int radvantage)
    _remote[input.frame % ARRAY_SIZE(_remote)] = radvantage;
 }
 
-int
-TimeSync::recommend_frame_wait_duration(bool require_idle_input)
+float
+TimeSync::frames_ahead()
 {
    // Average our local and remote frame advantages
    int i, sum = 0;
@@ -44,20 +44,31 @@ TimeSync::recommend_frame_wait_duration(bool require_idle_input)
    }
    radvantage = sum / (float)ARRAY_SIZE(_remote);
 
+   // Half the gap, since the other side sees the same gap from its end.
+   // Positive when we're the one ahead.
+   return (radvantage - advantage) / 2;
+}
+
+int
+TimeSync::recommend_frame_wait_duration(bool require_idle_input)
+{
+   int i;
+   float ahead = frames_ahead();
+
    static int count = 0;
    count++;
 
    // See if someone should take action.  The person furthest ahead
    // needs to slow down so the other user can catch up.
    // Only do this if both clients agree on who's ahead!!
-   if (advantage >= radvantage) {
+   if (ahead <= 0) {
       return 0;
    }
 
    // Both clients agree that we're the one ahead.  Split
    // the difference between the two to figure out how long to
    // sleep for.
-   int sleep_frames = (int)(((radvantage - advantage) / 2) + 0.5);
+   int sleep_frames = (int)(ahead + 0.5);
 
    Log("iteration %d:  sleep frames is %d\n", count, sleep_frames);
 
@@ -23,6 +23,7 @@ public:
 
    void advance_frame(GameInput &input, int advantage, int radvantage);
    int recommend_frame_wait_duration(bool require_idle_input);
+   float frames_ahead();
 
 protected:
    int         _local[FRAME_WINDOW_SIZE];
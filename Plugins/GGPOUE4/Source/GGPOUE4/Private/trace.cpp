@@ -0,0 +1,114 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#include "types.h"
+#include "trace.h"
+
+#define TRACE_MAGIC     "GGPOTRC"
+#define TRACE_VERSION   1
+
+/*
+ * A trace file is this header followed by its records, oldest first.
+ */
+struct TraceFileHeader {
+   char           magic[8];
+   int            version;
+   int            record_size;
+   int            count;
+   unsigned int   first;      /* sequence number of the first record */
+};
+
+static const struct {
+   const char *name;
+   bool        queue;      /* whether the record is about one player's queue */
+   const char *args;
+} trace_events[TRACE_EVENT_COUNT] = {
+   { "local-input",        true,  "bits %08x" },
+   { "remote-input",       true,  "bits %08x" },
+   { "prediction",         true,  "bits %08x from frame %d" },
+   { "misprediction",      true,  "" },
+   { "prediction-barrier", false, "last confirmed %d" },
+   { "save-state",         false, "checksum %08x size %d" },
+   { "load-state",         false, "rolling back from %d" },
+   { "rollback",           false, "resimulating %d frames" },
+   { "confirmed-frame",    false, "" },
+   { "disconnect",         true,  "" },
+};
+
+#if GGPO_TRACE
+TraceRecord trace_records[GGPO_TRACE_RECORDS];
+unsigned int trace_count = 0;
+#endif
+
+bool
+TraceDump(const char *filename)
+{
+#if GGPO_TRACE
+   FILE *fp = fopen(filename, "wb");
+   if (!fp) {
+      return false;
+   }
+   TraceFileHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+   header.version = TRACE_VERSION;
+   header.record_size = sizeof(TraceRecord);
+   header.count = (int)MIN(trace_count, (unsigned int)GGPO_TRACE_RECORDS);
+   header.first = trace_count - header.count;
+
+   bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+   for (int i = 0; ok && i < header.count; i++) {
+      ok = fwrite(&trace_records[(header.first + i) % GGPO_TRACE_RECORDS], sizeof(TraceRecord), 1, fp) == 1;
+   }
+   fclose(fp);
+   return ok;
+#else
+   return false;
+#endif
+}
+
+bool
+TraceRender(const char *trace_file, const char *text_file)
+{
+   FILE *in = fopen(trace_file, "rb");
+   if (!in) {
+      return false;
+   }
+   TraceFileHeader header;
+   if (fread(&header, sizeof(header), 1, in) != 1 ||
+       memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+       header.version != TRACE_VERSION ||
+       header.record_size != sizeof(TraceRecord)) {
+      fclose(in);
+      return false;
+   }
+   FILE *out = fopen(text_file, "w");
+   if (!out) {
+      fclose(in);
+      return false;
+   }
+
+   TraceRecord record;
+   for (int i = 0; i < header.count && fread(&record, sizeof(record), 1, in) == 1; i++) {
+      fprintf(out, "%10u  frame %6d  ", header.first + i, record.frame);
+      if (record.event < TRACE_EVENT_COUNT) {
+         if (trace_events[record.event].queue) {
+            fprintf(out, "q%d ", record.queue);
+         } else {
+            fprintf(out, "   ");
+         }
+         fprintf(out, "%-20s", trace_events[record.event].name);
+         fprintf(out, trace_events[record.event].args, record.args[0], record.args[1]);
+      } else {
+         fprintf(out, "q%d event %-14d%d %d", record.queue, record.event, record.args[0], record.args[1]);
+      }
+      fputc('\n', out);
+   }
+   fclose(out);
+   fclose(in);
+   return true;
+}
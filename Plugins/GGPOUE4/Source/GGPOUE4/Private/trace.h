@@ -0,0 +1,84 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/*
+ * Build with GGPO_TRACE=1 to record what the rollback paths do into a fixed
+ * ring of binary records, with no formatting, so it can run in a real match.
+ * After a desync, ggpo_dump_trace writes the ring to a file and
+ * ggpo_render_trace turns it into text.  Sessions on different threads share
+ * the ring, so their records may interleave.
+ */
+#ifndef GGPO_TRACE
+#define GGPO_TRACE            0
+#endif
+
+/*
+ * Records kept in the ring, 16 bytes each.  A power of two.
+ */
+#ifndef GGPO_TRACE_RECORDS
+#define GGPO_TRACE_RECORDS    (64 * 1024)
+#endif
+
+enum TraceEvent {
+   TRACE_LOCAL_INPUT,         /* frame, input bits */
+   TRACE_REMOTE_INPUT,        /* frame, input bits */
+   TRACE_PREDICTION,          /* frame, predicted bits, frame predicted from */
+   TRACE_MISPREDICTION,       /* first incorrect frame */
+   TRACE_PREDICTION_BARRIER,  /* frame, last confirmed frame */
+   TRACE_SAVE_STATE,          /* frame, checksum, size */
+   TRACE_LOAD_STATE,          /* frame, frame rolled back from */
+   TRACE_ROLLBACK,            /* first incorrect frame, frames resimulated */
+   TRACE_CONFIRMED_FRAME,     /* frame */
+   TRACE_DISCONNECT,          /* last frame of the disconnected player */
+   TRACE_EVENT_COUNT
+};
+
+struct TraceRecord {
+   unsigned char  event;
+   unsigned char  queue;
+   unsigned short reserved;
+   int            frame;
+   int            args[2];
+};
+
+#if GGPO_TRACE
+extern TraceRecord trace_records[GGPO_TRACE_RECORDS];
+extern unsigned int trace_count;
+
+inline void
+Trace(TraceEvent event, int queue, int frame, int arg0 = 0, int arg1 = 0)
+{
+   TraceRecord &record = trace_records[trace_count++ % GGPO_TRACE_RECORDS];
+   record.event = (unsigned char)event;
+   record.queue = (unsigned char)queue;
+   record.reserved = 0;
+   record.frame = frame;
+   record.args[0] = arg0;
+   record.args[1] = arg1;
+}
+#else
+inline void Trace(TraceEvent, int, int, int = 0, int = 0) { }
+#endif
+
+/*
+ * The first 4 bytes of an input, which hold a whole input in most games.
+ */
+inline int
+TraceInputBits(const char *bits)
+{
+   int value;
+   memcpy(&value, bits, sizeof(value));
+   return value;
+}
+
+extern bool TraceDump(const char *filename);
+extern bool TraceRender(const char *trace_file, const char *text_file);
+
+#endif
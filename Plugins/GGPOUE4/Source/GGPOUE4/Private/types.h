@@ -39,6 +39,7 @@ typedef unsigned char byte;
 #endif
 
 #include "log.h"
+#include "trace.h"
 
 
 
@@ -6,6 +6,7 @@
 #include <memory>
 #include <string>
 #include "../../Private/types.h"
+#include "ggpolimits.h"
 
 /**
 * ConnectionInfo is an abstract base class for defining connections.
@@ -57,6 +58,25 @@ public:
 	*/
 	virtual int RecvFrom(char* buffer, int len, int flags, int* connection_id) = 0;
 
+	/**
+	* Flush sends any packets queued by SendTo
+	*
+	* A connection manager may batch packets passed to SendTo instead of
+	* sending each one right away. GGPO calls Flush after sending local
+	* inputs and at the end of every poll, so anything batched must be
+	* sent here. The default implementation does nothing.
+	*/
+	virtual void Flush() {}
+
+	/**
+	* GetWaitHandle returns a descriptor that is readable while packets wait
+	*
+	* When ggpo_idle is given a timeout, GGPO sleeps on this descriptor on
+	* Linux, so it wakes as soon as a packet arrives instead of after a
+	* fixed sleep. Return -1, the default, if there is nothing to wait on.
+	*/
+	virtual int GetWaitHandle() { return -1; }
+
 	/**
 	* ResetManager is a reset function to clear the connection_map
 	*
@@ -146,6 +166,88 @@ protected:
 	SOCKET _socket;
 
 };
+#elif defined(__linux__)
+/// UDPConnectionManager on Linux batches packets through recvmmsg and sendmmsg.
+class UPDInfo : public ConnectionInfo   {
+public:
+	UPDInfo(const char* ip_address, uint16 port);
+
+	sockaddr_in addr;
+
+	~UPDInfo() {
+	}
+
+	virtual std::string ToString();
+};
+
+struct UDPPacketBatch;
+
+class GGPOUE4_API UDPConnectionManager : public ConnectionManager {
+
+public:
+	UDPConnectionManager();
+	virtual ~UDPConnectionManager();
+
+	/**
+	* Queues the packet, and sends the whole queue once it's full.
+	* Call Flush to send a partial queue.
+	*/
+	virtual int SendTo(const char* buffer, int len, int flags, int connection_id);
+
+	/**
+	* Returns the next packet from a batch read with a single recvmmsg call.
+	* Packets from unknown addresses are dropped.
+	*/
+	virtual int RecvFrom(char* buffer, int len, int flags, int* connection_id);
+
+	virtual void Flush();
+
+	/**
+	* The socket. GGPO reads every buffered packet each time it polls,
+	* so nothing is left in the batch when it waits. Call Init first.
+	*/
+	virtual int GetWaitHandle();
+
+	/**
+	* Returns -1 once MAX_CONNECTIONS connections have been added.
+	*/
+	int AddConnection(const char* ip_address, uint16 port);
+
+	/**
+	* Forgets the receive-side address table along with the connection map.
+	*/
+	virtual int ResetManager();
+
+	/**
+	* Binds a non-blocking socket to the port. Pass 0 to bind any free port,
+	* then read it back with GetPort.
+	*/
+	void Init(uint16 port);
+
+	uint16 GetPort() const;
+
+	int FindIDFromIP(sockaddr_in* sockaddr);
+
+	/// Packets read or sent per syscall.
+	static const int BATCH_SIZE = 32;
+	/// Largest packet the batch buffers hold. Matches MAX_UDP_PACKET_SIZE in udp.h.
+	static const int MAX_PACKET_SIZE = 4096;
+	/// Every remote player and spectator a session can have.
+	static const int MAX_CONNECTIONS = GGPO_MAX_PLAYERS + GGPO_MAX_SPECTATORS;
+
+protected:
+	std::shared_ptr<ConnectionInfo> BuildConnectionInfo(const char* ip_address, uint16 port);
+
+	SOCKET _socket;
+
+	/// Buffers for both directions, allocated once in Init so no packet allocates.
+	UDPPacketBatch* _batch;
+
+	/// Addresses of added connections, so receiving doesn't walk _connection_map.
+	sockaddr_in _connection_addrs[MAX_CONNECTIONS];
+	int _connection_ids[MAX_CONNECTIONS];
+	int _num_connections;
+};
 #endif
 
 
@@ -0,0 +1,22 @@
+/* -----------------------------------------------------------------------
+ * GGPO.net (http://ggpo.net)  -  Copyright 2009 GroundStorm Studios, LLC.
+ *
+ * Use of this software is governed by the MIT license that can be found
+ * in the LICENSE file.
+ */
+
+#ifndef _GGPOLIMITS_H
+#define _GGPOLIMITS_H
+
+/*
+ * Session limits, kept apart from ggponet.h so the connection managers
+ * can size their tables without pulling in the whole API.
+ */
+#define GGPO_MAX_PLAYERS                  4
+#define GGPO_MAX_PREDICTION_FRAMES       30
+#define GGPO_MAX_SPECTATORS              32
+
+#define GGPO_DEFAULT_PREDICTION_FRAMES    8
+#define GGPO_DEFAULT_INPUT_QUEUE_LENGTH 128
+
+#endif
@@ -65,8 +65,25 @@ struct FGGPONetworkInfo
 	int32 recv_queue_len;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	int32 ping;
+	// Smoothed variation of ping in ms, or -1 before the first ping was measured.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 ping_jitter;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	int32 kbps_sent;
+	// Most UdpMsgs this endpoint had allocated at once.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 msg_pool_high_water;
+	// UdpMsgs allocated on the heap because the endpoint's pool was empty.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 msg_pool_overflows;
+	// Input packets sent to this endpoint, and their size in bytes without UDP/IP headers.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 input_packets_sent;
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 input_bytes_sent;
+	// Whether both sides agreed to compact input encoding during sync.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool compact_input;
 };
 
 USTRUCT(BlueprintType)
@@ -78,6 +95,13 @@ struct FGGPOSyncInfo
 	int32 local_frames_behind;
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	int32 remote_frames_behind;
+	// Frames the local client is ahead of the remote, averaged over recent frames and split between the two
+	// clients. Negative when behind. The same measurement GGPO_EVENTCODE_TIMESYNC is based on.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	float frames_ahead;
+	// Last frame every player's input has arrived for. States up to it are final and won't be rolled back.
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 confirmed_frame;
 };
 
 USTRUCT(BlueprintType)
@@ -203,9 +227,9 @@ extern "C" {
 #  define GGPO_API
 #endif
 
-#define GGPO_MAX_PLAYERS                  4
-#define GGPO_MAX_PREDICTION_FRAMES        8
-#define GGPO_MAX_SPECTATORS              32
+#include "ggpolimits.h"
+
+#define GGPO_DEFAULT_SPECTATOR_FRAMES  3600
 
 #define GGPO_SPECTATOR_INPUT_INTERVAL     4
 
@@ -250,6 +274,71 @@ typedef struct GGPOLocalEndpoint
 	int player_num;
 } GGPOLocalEndpoint;
 
+/*
+ * The GGPOSessionLimits structure sizes the buffers of a session, and sets
+ * how often it saves, passed to ggpo_start_session and ggpo_start_spectating.
+ * The buffers are allocated once when the session starts.  Leave a field 0
+ * for its default.
+ *
+ * prediction_frames: How many frames a player may run ahead of the last
+ *       confirmed frame before ggpo_add_local_input returns
+ *       GGPO_ERRORCODE_PREDICTION_THRESHOLD, and so the deepest rollback.
+ *       One game state is kept per frame, plus two.  Between 1 and
+ *       GGPO_MAX_PREDICTION_FRAMES, GGPO_DEFAULT_PREDICTION_FRAMES by default.
+ *
+ * input_queue_length: Inputs kept per player.  Must hold more than twice
+ *       prediction_frames, plus save_interval - 1 and the largest frame
+ *       delay.  GGPO_DEFAULT_INPUT_QUEUE_LENGTH by default.
+ *
+ * spectator_frames: How many received inputs a spectator keeps before
+ *       dropping the oldest, so one that fell behind or joined a game in
+ *       progress has room to catch up.  GGPO_DEFAULT_SPECTATOR_FRAMES, a
+ *       minute at 60 frames per second, by default.
+ *
+ * save_interval: save_game_state is only called for every save_interval'th
+ *       frame.  A rollback loads the last save at or before the frame it
+ *       needs and simulates forward from there, so it runs up to
+ *       save_interval - 1 frames more in exchange for fewer saves.  Between
+ *       1 and GGPO_MAX_PREDICTION_FRAMES, 1 by default.
+ */
+typedef struct GGPOSessionLimits
+{
+	int prediction_frames;
+	int input_queue_length;
+	int spectator_frames;
+	int save_interval;
+} GGPOSessionLimits;
+
+#define GGPO_SYNCTEST_HISTOGRAM_BUCKETS  16
+
+/*
+ * The GGPOSyncTestStats structure contains the rollbacks verified by a sync
+ * test session, as returned by ggpo_get_synctest_stats.
+ *
+ * checks: The number of rollbacks which have been resimulated and verified.
+ *
+ * failures: The number of resimulated frames whose checksum did not match
+ *       the checksum saved when the frame was first run.
+ *
+ * depth[n]: Rollbacks which went back n frames.  rollbacks counts them,
+ *       total_us and max_us are the time spent loading the state and
+ *       resimulating, in microseconds.  buckets is a histogram of that time:
+ *       bucket 0 counts rollbacks which took under 2us, and bucket i counts
+ *       rollbacks which took 2^i to 2^(i+1) us.  The last bucket also counts
+ *       anything slower.
+ */
+typedef struct GGPOSyncTestStats
+{
+	int checks;
+	int failures;
+	struct {
+		int rollbacks;
+		long long total_us;
+		int max_us;
+		int buckets[GGPO_SYNCTEST_HISTOGRAM_BUCKETS];
+	} depth[GGPO_MAX_PREDICTION_FRAMES + 1];
+} GGPOSyncTestStats;
+
 
 #define GGPO_ERRORLIST                                               \
    GGPO_ERRORLIST_ENTRY(GGPO_OK,                               0)    \
@@ -381,7 +470,8 @@ typedef struct
 /*
  * The GGPOSessionCallbacks structure contains the callback functions that
  * your application must implement.  GGPO.net will periodically call these
- * functions during the game.  All callback functions must be implemented.
+ * functions during the game.  All callback functions must be implemented,
+ * except the ones marked optional.
  */
 struct GGPOSessionCallbacks
 {
@@ -437,6 +527,26 @@ struct GGPOSessionCallbacks
 	 * structure above for more information.
 	 */
 	std::function<bool(GGPOEvent* info)> on_event;
+
+	/*
+	 * make_snapshot - Optional.  Lets spectators join a game in progress.
+	 * Called with a state returned from save_game_state.  The client should
+	 * allocate a buffer with new[] and write a copy of that state into it
+	 * that another machine can load: no pointers or other values that only
+	 * mean something in this process, and compressed if it is large.
+	 * GGPO.net frees it with delete[].  Without it, spectators can only be
+	 * added before the game starts.
+	 */
+	std::function<bool(unsigned char* buffer, int len, unsigned char** snapshot, int* snapshot_len)> make_snapshot;
+
+	/*
+	 * load_snapshot - Called on a spectator that joined a game in progress,
+	 * with the snapshot the host made of the given frame.  The client should
+	 * make the current game state match it.  ggpo_synchronize_input returns
+	 * the inputs from that frame on, and the client should run the frames
+	 * it missed as quickly as it can, without presenting them.
+	 */
+	std::function<bool(unsigned char* snapshot, int len, int frame)> load_snapshot;
 };
 
 extern "C" {
@@ -500,6 +610,26 @@ extern "C" {
       * structure above for more information.
       */
      bool(__cdecl* on_event)(GGPOEvent* info);
+
+     /*
+      * make_snapshot - Optional.  Lets spectators join a game in progress.
+      * Called with a state returned from save_game_state.  The client should
+      * allocate a buffer with new[] and write a copy of that state into it
+      * that another machine can load: no pointers or other values that only
+      * mean something in this process, and compressed if it is large.
+      * GGPO.net frees it with delete[].  Without it, spectators can only be
+      * added before the game starts.
+      */
+     bool(__cdecl* make_snapshot)(unsigned char* buffer, int len, unsigned char** snapshot, int* snapshot_len);
+
+     /*
+      * load_snapshot - Called on a spectator that joined a game in progress,
+      * with the snapshot the host made of the given frame.  The client should
+      * make the current game state match it.  ggpo_synchronize_input returns
+      * the inputs from that frame on, and the client should run the frames
+      * it missed as quickly as it can, without presenting them.
+      */
+     bool(__cdecl* load_snapshot)(unsigned char* snapshot, int len, int frame);
  } GGPOSessionCallbacks;
 
 #endif
@@ -530,13 +660,17 @@ public:
 	 * input_size - The size of the game inputs which will be passsed to ggpo_add_local_input.
 	 *
 	 * local_port - The port GGPO should bind to for UDP traffic.
+	 *
+	 * limits - The prediction window and buffer sizes of the session, or NULL for the
+	 * defaults.  Returns GGPO_ERRORCODE_INVALID_REQUEST if they are out of range.
 	 */
 	static GGPO_API GGPOErrorCode __cdecl ggpo_start_session(GGPOSession** session,
 	                                                         GGPOSessionCallbacks* cb,
 	                                                         ConnectionManager* connection_manager,
 	                                                         const char* game,
 	                                                         int num_players,
-	                                                         int input_size);
+	                                                         int input_size,
+	                                                         const GGPOSessionLimits* limits = NULL);
 
 
 	/*
@@ -586,6 +720,36 @@ public:
 	                                                          int input_size,
 	                                                          int frames);
 
+	/*
+	 * ggpo_set_synctest_random_rollbacks --
+	 *
+	 * Makes a sync test session roll back a random number of frames at each
+	 * check, instead of the fixed distance passed to ggpo_start_synctest.
+	 * Depths are drawn uniformly from 1 to max_frames by a generator seeded
+	 * with seed, so a run can be repeated exactly.
+	 *
+	 * max_frames - The deepest rollback to inject.  Clamped to
+	 * GGPO_DEFAULT_PREDICTION_FRAMES, the prediction window of a sync test
+	 * session.  Pass 0 to go back to the fixed distance.
+	 *
+	 * seed - Seed for the rollback depth sequence.
+	 */
+	static GGPO_API GGPOErrorCode __cdecl ggpo_set_synctest_random_rollbacks(GGPOSession* session,
+	                                                                         int max_frames,
+	                                                                         unsigned int seed);
+
+	/*
+	 * ggpo_get_synctest_stats --
+	 *
+	 * Used to fetch the rollbacks verified so far by a sync test session, with
+	 * the time each rollback took by depth.  Returns GGPO_ERRORCODE_UNSUPPORTED
+	 * for other sessions.
+	 *
+	 * stats - Out parameter to the sync test statistics.
+	 */
+	static GGPO_API GGPOErrorCode __cdecl ggpo_get_synctest_stats(GGPOSession* session,
+	                                                              GGPOSyncTestStats* stats);
+
 
 	/*
 	 * ggpo_start_spectating --
@@ -610,6 +774,20 @@ public:
 	 * player partcipating in the session can serve as a host.
 	 *
 	 * host_port - The port of the session on the host
+	 *
+	 * A spectator session can relay the inputs to up to GGPO_MAX_SPECTATORS
+	 * spectators of its own, added with ggpo_add_player as GGPO_PLAYERTYPE_SPECTATOR
+	 * before the first input arrives.  It sends them several frames per packet,
+	 * and the players only pay for the relay.  A relay that never calls
+	 * ggpo_synchronize_input only has to call ggpo_idle.
+	 *
+	 * If the host implements make_snapshot, spectators can also be added
+	 * after the game has started.  They are sent a snapshot of a recent
+	 * confirmed frame, passed to load_snapshot, and then the inputs from
+	 * that frame on.  A relay passes the snapshot on to its own spectators.
+	 *
+	 * limits - As for ggpo_start_session.  Only spectator_frames applies to a
+	 * spectator, or NULL for the defaults.
 	 */
 	static GGPO_API GGPOErrorCode __cdecl ggpo_start_spectating(GGPOSession** session,
 	                                                            GGPOSessionCallbacks* cb,
@@ -617,7 +795,8 @@ public:
 	                                                            const char* game,
 	                                                            int num_players,
 	                                                            int input_size,
-	                                                            int connection_id);
+	                                                            int connection_id,
+	                                                            const GGPOSessionLimits* limits = NULL);
 
 	/*
 	 * ggpo_close_session --
@@ -752,6 +931,46 @@ public:
 	static GGPO_API GGPOErrorCode __cdecl ggpo_set_disconnect_notify_start(GGPOSession*,
 	                                                                       int timeout);
 
+	/*
+	 * ggpo_set_compact_input --
+	 *
+	 * Offers compact input packets to peers added after this call.  Both
+	 * sides must offer it during synchronization before it is used, and
+	 * inputs whose changes don't fit fall back to the regular encoding.
+	 * Compact input sends only the non-zero bytes of each input, once per run
+	 * of identical frames, which suits button bitfields.  On by default.
+	 *
+	 * enabled - Whether to offer compact input.
+	 */
+	static GGPO_API GGPOErrorCode __cdecl ggpo_set_compact_input(GGPOSession*,
+	                                                             bool enabled);
+
+	/*
+	 * ggpo_dump_trace --
+	 *
+	 * Writes the trace ring to a file, oldest record first.  The ring holds
+	 * the last few thousand inputs, predictions, saves and rollbacks of
+	 * every session in the process, in binary, and is meant to be dumped
+	 * after a desync.  Returns GGPO_ERRORCODE_UNSUPPORTED unless GGPOUE4 is
+	 * built with GGPO_TRACE=1.
+	 *
+	 * filename - The file to write.
+	 */
+	static GGPO_API GGPOErrorCode __cdecl ggpo_dump_trace(const char *filename);
+
+	/*
+	 * ggpo_render_trace --
+	 *
+	 * Turns a file written by ggpo_dump_trace into text, one line per
+	 * record.  Works in any build.
+	 *
+	 * trace_file - The file written by ggpo_dump_trace.
+	 *
+	 * text_file - The text file to write.
+	 */
+	static GGPO_API GGPOErrorCode __cdecl ggpo_render_trace(const char *trace_file,
+	                                                        const char *text_file);
+
 	/*
 	 * ggpo_try_synchronize_local --
 	 *
@@ -0,0 +1,157 @@
+
+#ifndef _SIMULATED_CONNECTION_MANAGER_H
+#define _SIMULATED_CONNECTION_MANAGER_H
+
+#include <deque>
+#include <queue>
+#include <string>
+#include <vector>
+#include "connection_manager.h"
+
+/**
+* NetworkConditions describes the impairments a SimulatedConnectionManager
+* applies to the packets it sends.
+*
+* Percentages are 0 to 100. Every random decision comes from seed, so
+* the same profile drops, duplicates and delays the same packets in
+* every run.
+*/
+struct GGPOUE4_API NetworkConditions {
+	/// Delay added to every packet.
+	int latency_ms = 0;
+	/// Standard deviation of extra, normally distributed delay.
+	int jitter_ms = 0;
+	/// Chance each packet is lost on its own.
+	float loss_percent = 0;
+	/// Chance each packet starts a burst of losses.
+	float burst_loss_percent = 0;
+	/// Packets lost in a row once a burst starts.
+	int burst_length = 0;
+	/// Chance each packet is delivered twice.
+	float duplicate_percent = 0;
+	/// Chance each packet is held back by reorder_ms, so later packets overtake it.
+	float reorder_percent = 0;
+	int reorder_ms = 0;
+	/// Outgoing bandwidth cap. Packets queue behind each other once it's exceeded. 0 is unlimited.
+	int bandwidth_kbps = 0;
+	uint32 seed = 1;
+
+	/**
+	* Reads the [profile] section of an ini style text, one key=value
+	* per line, with keys named after the fields above. Lines starting
+	* with ; or # are comments. Returns false if there is no such section.
+	*/
+	bool Load(const char* text, const char* profile);
+
+	/// Whether these conditions change anything at all.
+	bool IsPerfect() const;
+};
+
+/**
+* SimulatedConnectionManager wraps another connection manager and
+* impairs every packet sent through it, as described by NetworkConditions.
+*
+* Packets are held until they are due and passed to the wrapped manager
+* from RecvFrom and Flush, which GGPO calls on every poll. Wrap both ends
+* of a connection to impair both directions. Connection IDs are those of
+* the wrapped manager, which must outlive this one.
+*/
+class GGPOUE4_API SimulatedConnectionManager : public ConnectionManager {
+
+public:
+	SimulatedConnectionManager(ConnectionManager* inner, const NetworkConditions& conditions);
+	virtual ~SimulatedConnectionManager();
+
+	virtual int SendTo(const char* buffer, int len, int flags, int connection_id);
+
+	virtual int RecvFrom(char* buffer, int len, int flags, int* connection_id);
+
+	virtual void Flush();
+
+	virtual int ResetManager();
+
+	virtual std::string ToString(int connection_id);
+
+	struct Stats {
+		int sent;
+		int lost;
+		int duplicated;
+		int reordered;
+		/// Packets waiting to be delivered.
+		int queued;
+	};
+	void GetStats(Stats* stats) const;
+
+protected:
+	struct HeldPacket {
+		uint64 deliver_us;
+		uint32 sequence;
+		int connection_id;
+		std::string data;
+
+		bool operator>(const HeldPacket& other) const {
+			return deliver_us != other.deliver_us ? deliver_us > other.deliver_us : sequence > other.sequence;
+		}
+	};
+
+	/// Passes every packet that is due to the wrapped manager.
+	void Deliver();
+	void Hold(const char* buffer, int len, int connection_id, uint64 deliver_us);
+
+	uint32 Random();
+	/// A uniformly distributed number in [0, 1).
+	double RandomUnit();
+	bool Chance(float percent);
+
+	ConnectionManager* _inner;
+	NetworkConditions _conditions;
+	uint32 _random_state;
+	uint32 _next_sequence;
+	int _burst_remaining;
+	/// When the simulated link finishes sending what's queued, for the bandwidth cap.
+	uint64 _link_free_us;
+	std::priority_queue<HeldPacket, std::vector<HeldPacket>, std::greater<HeldPacket>> _held;
+	Stats _stats;
+};
+
+/**
+* LoopbackConnectionManager connects to other instances in the same
+* process, without sockets. Each Connect call gives both ends the next
+* connection ID of their own for the other, starting at 0.
+*/
+class GGPOUE4_API LoopbackConnectionManager : public ConnectionManager {
+
+public:
+	LoopbackConnectionManager();
+	virtual ~LoopbackConnectionManager();
+
+	static void Connect(LoopbackConnectionManager* a, LoopbackConnectionManager* b);
+
+	/// Bytes and packets passed to SendTo so far.
+	uint64 GetBytesSent() const { return _bytes_sent; }
+	uint64 GetPacketsSent() const { return _packets_sent; }
+
+	virtual int SendTo(const char* buffer, int len, int flags, int connection_id);
+
+	virtual int RecvFrom(char* buffer, int len, int flags, int* connection_id);
+
+	virtual std::string ToString(int connection_id);
+
+protected:
+	struct Peer {
+		LoopbackConnectionManager* manager;
+		/// The connection ID the peer has for this manager.
+		int remote_id;
+	};
+	struct Packet {
+		int connection_id;
+		std::string data;
+	};
+
+	std::vector<Peer> _peers;
+	std::deque<Packet> _incoming;
+	uint64 _bytes_sent;
+	uint64 _packets_sent;
+};
+
+#endif
@@ -449,244 +449,263 @@ void ABattleObject::HandlePushCollision(ABattleObject* OtherObj)
 
 void ABattleObject::HandleHitCollision(APlayerObject* OtherChar)
 {
-	if (AttackFlags & ATK_IsAttacking && AttackFlags & ATK_HitActive &&
+	if (!CanHitPlayer(OtherChar))
+		return;
+	FCollisionBox Hitbox;
+	if (FindHitOverlap(OtherChar, Hitbox))
+		ResolveHit(OtherChar, Hitbox);
+}
+
+bool ABattleObject::CanHitPlayer(const APlayerObject* OtherChar) const
+{
+	return AttackFlags & ATK_IsAttacking && AttackFlags & ATK_HitActive &&
 		!(OtherChar->InvulnFlags & INV_StrikeInvulnerable) && !OtherChar->StrikeInvulnerableTimer && OtherChar != Player
-		&& OtherChar->ObjectsToIgnoreHitsFrom.Find(this) == INDEX_NONE && (!(AttackFlags & ATK_AttackHeadAttribute &&
+		&& OtherChar->ObjectsToIgnoreHitsFrom.Find(const_cast<ABattleObject*>(this)) == INDEX_NONE && (!(AttackFlags & ATK_AttackHeadAttribute &&
 		OtherChar->InvulnFlags & INV_HeadInvulnerable) && !(AttackFlags & ATK_AttackProjectileAttribute && OtherChar->
-		InvulnFlags & INV_ProjectileInvulnerable)))
+		InvulnFlags & INV_ProjectileInvulnerable));
+}
+
+bool ABattleObject::FindHitOverlap(const APlayerObject* OtherChar, FCollisionBox& OutHitbox) const
+{
+	for (int i = 0; i < CollisionArraySize; i++)
 	{
-		for (int i = 0; i < CollisionArraySize; i++)
+		if (Boxes[i].Type == BOX_Hit)
 		{
-			if (Boxes[i].Type == BOX_Hit)
+			for (int j = 0; j < CollisionArraySize; j++)
 			{
-				for (int j = 0; j < CollisionArraySize; j++)
+				if (OtherChar->Boxes[j].Type == BOX_Hurt)
 				{
-					if (OtherChar->Boxes[j].Type == BOX_Hurt)
-					{
-						FCollisionBox Hitbox = Boxes[i];
+					FCollisionBox Hitbox = Boxes[i];
 
-						FCollisionBox Hurtbox = OtherChar->Boxes[j];
+					FCollisionBox Hurtbox = OtherChar->Boxes[j];
 
-						if (Direction == DIR_Right)
-						{
-							Hitbox.PosX += PosX;
-						}
-						else
-						{
-							Hitbox.PosX = -Hitbox.PosX + PosX;  
-						}
-						Hitbox.PosY += PosY;
-						if (OtherChar->Direction == DIR_Right)
-						{
-							Hurtbox.PosX += OtherChar->PosX;
-						}
-						else
-						{
-							Hurtbox.PosX = -Hurtbox.PosX + OtherChar->PosX;  
-						}
-						Hurtbox.PosY += OtherChar->PosY;
-							
-						if (Hitbox.PosY + Hitbox.SizeY / 2 >= Hurtbox.PosY - Hurtbox.SizeY / 2
-							&& Hitbox.PosY - Hitbox.SizeY / 2 <= Hurtbox.PosY + Hurtbox.SizeY / 2
-							&& Hitbox.PosX + Hitbox.SizeX / 2 >= Hurtbox.PosX - Hurtbox.SizeX / 2
-							&& Hitbox.PosX - Hitbox.SizeX / 2 <= Hurtbox.PosX + Hurtbox.SizeX / 2)
-						{
-							OtherChar->AttackOwner = this;
-							OtherChar->ObjectsToIgnoreHitsFrom.AddUnique(this);
-							OtherChar->StunTime = 2147483647;
-							OtherChar->FaceOpponent();
-							OtherChar->HaltMomentum();
-							OtherChar->PlayerFlags |= PLF_IsStunned;
-							AttackFlags |= ATK_HasHit;
-							AttackTarget = OtherChar;
-								
-							int CollisionDepthX;
-							if (Hitbox.PosX < OtherChar->PosX)
-							{
-								CollisionDepthX = OtherChar->PosX - (Hitbox.PosX + Hitbox.SizeX / 2);
-								HitPosX = Hitbox.PosX + CollisionDepthX / 2;
-							}
-							else
-							{
-								CollisionDepthX = Hitbox.PosX - Hitbox.SizeX / 2 - OtherChar->PosX;
-								HitPosX = Hitbox.PosX - CollisionDepthX / 2;
-							}
-							int CollisionDepthY;
-							int32 CenterPosY = OtherChar->GetPosYCenter();
-							if (Hitbox.PosY < CenterPosY)
-							{
-								CollisionDepthY = CenterPosY - (Hitbox.PosY + Hitbox.SizeY / 2);
-								HitPosY = Hitbox.PosY + CollisionDepthY / 2;
-							}
-							else
-							{
-								CollisionDepthY = Hitbox.PosY - Hitbox.SizeY / 2 - CenterPosY;
-								HitPosY = Hitbox.PosY - CollisionDepthY / 2;
-							}
-								
-							TriggerEvent(EVT_HitOrBlock);
-								
-							if (OtherChar->IsCorrectBlock(HitCommon.BlockType)) //check blocking
-							{
-								CreateCommonParticle("cmn_guard", POS_Enemy,
-								                     FVector(0, 100, 0),
-								                     FRotator(HitCommon.HitAngle, 0, 0));
-								TriggerEvent(EVT_Block);
-									
-								const int32 ChipDamage = NormalHit.Damage * HitCommon.ChipDamagePercent / 100;
-								OtherChar->CurrentHealth -= ChipDamage;
-									
-								const FHitData Data = InitHitDataByAttackLevel(false);
-								OtherChar->ReceivedHitCommon = HitCommon;
-								OtherChar->ReceivedHit = Data;
-									
-								if (OtherChar->CurrentHealth <= 0)
-								{
-									EHitAction HACT;
-										
-									if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
-										HACT = NormalHit.GroundHitAction;
-									else
-										HACT = NormalHit.AirHitAction;
-										
-									OtherChar->HandleHitAction(HACT);
-								}
-								else
-								{
-									OtherChar->HandleBlockAction();
-									OtherChar->AirDashTimer = 0;
-									if (OtherChar->PlayerFlags & PLF_TouchingWall)
-									{
-										Pushback = OtherChar->Pushback;
-										OtherChar->Pushback = 0;
-									}
-								}
-								OtherChar->AddMeter(NormalHit.Damage * OtherChar->MeterPercentOnReceiveHitGuard / 100);
-								Player->AddMeter(NormalHit.Damage * Player->MeterPercentOnHitGuard / 100);
-							}
-							else if (OtherChar->SuperArmorSuccess(this))
-							{
-								if (OtherChar->SuperArmorData.ArmorHits > 0) OtherChar->SuperArmorData.ArmorHits--;
-								switch (OtherChar->SuperArmorData.Type)
-								{
-								case ARM_Guard:
-									{
-										if (OtherChar->SuperArmorData.bArmorTakeChipDamage)
-										{
-											const int32 ChipDamage = NormalHit.Damage * HitCommon.ChipDamagePercent / 100;
-											OtherChar->CurrentHealth -= ChipDamage;
-											OtherChar->AddMeter(NormalHit.Damage * OtherChar->MeterPercentOnReceiveHitGuard / 100);
-											Player->AddMeter(NormalHit.Damage * Player->MeterPercentOnHitGuard / 100);
-										}
-										if (OtherChar->SuperArmorData.ArmorDamagePercent)
-										{
-											const int32 ArmorDamage = NormalHit.Damage * OtherChar->SuperArmorData.ArmorDamagePercent / 100;
-											OtherChar->CurrentHealth -= ArmorDamage;
-											OtherChar->AddMeter(
-												NormalHit.Damage * OtherChar->MeterPercentOnReceiveHit * OtherChar->
-												SuperArmorData.ArmorDamagePercent / 10000);
-											Player->AddMeter(
-												NormalHit.Damage * Player->MeterPercentOnHit * OtherChar->
-												SuperArmorData.ArmorDamagePercent / 10000);
-										}
-									
-										const FHitData Data = InitHitDataByAttackLevel(false);
-										OtherChar->ReceivedHitCommon = HitCommon;
-										OtherChar->ReceivedHit = Data;
-											
-										if (OtherChar->CurrentHealth <= 0)
-										{
-											EHitAction HACT;
-										
-											if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
-												HACT = NormalHit.GroundHitAction;
-											else
-												HACT = NormalHit.AirHitAction;
-										
-											OtherChar->HandleHitAction(HACT);
-										}
-										else
-										{
-											Hitstop = ReceivedHit.Hitstop;
-											OtherChar->Hitstop = ReceivedHit.Hitstop;
-										}
-									}
-									break;
-								case ARM_Dodge:
-								default:
-									break;
-								}
-							}
-							else if ((OtherChar->AttackFlags & ATK_IsAttacking) == 0)
-							{
-								TriggerEvent(EVT_Hit);
-									
-								if (IsPlayer && Player->PlayerFlags & PLF_HitgrabActive)
-								{
-									OtherChar->JumpToState(OtherChar->CharaStateData->DefaultThrowLock);
-									OtherChar->PlayerFlags |= PLF_IsThrowLock;
-									OtherChar->AttackOwner = Player;
-									Player->ThrowExe();
-									return;
-								}
-									
-								const FHitData Data = InitHitDataByAttackLevel(false);
-								CreateCommonParticle(HitCommon.HitVFXOverride.ToString(), POS_Hit,
-								                     FVector(0, 100, 0),
-								                     FRotator(HitCommon.HitAngle, 0, 0));
-								PlayCommonSound(HitCommon.HitSFXOverride.ToString());
-								OtherChar->ReceivedHitCommon = HitCommon;
-								OtherChar->ReceivedHit = Data;
-								EHitAction HACT;
-										
-								if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
-									HACT = NormalHit.GroundHitAction;
-								else
-									HACT = NormalHit.AirHitAction;
-
-								OtherChar->HandleHitAction(HACT);
-							}
-							else
-							{
-								TriggerEvent(EVT_Hit);
-								TriggerEvent(EVT_CounterHit);
-
-								OtherChar->AddColor = FLinearColor(5,0.2,0.2,1);
-								OtherChar->MulColor = FLinearColor(1,0.1,0.1,1);
-								OtherChar->AddFadeSpeed = 0.1;
-								OtherChar->MulFadeSpeed = 0.1;
-									
-								if (IsPlayer && Player->PlayerFlags & PLF_HitgrabActive)
-								{
-									OtherChar->JumpToState(OtherChar->CharaStateData->DefaultThrowLock);
-									OtherChar->PlayerFlags |= PLF_IsThrowLock;
-									OtherChar->AttackOwner = Player;
-									Player->ThrowExe();
-									return;
-								}
-
-								const FHitData CounterData = InitHitDataByAttackLevel(true);
-								CreateCommonParticle(HitCommon.HitVFXOverride.ToString(), POS_Hit, FVector(0, 100, 0), FRotator(HitCommon.HitAngle, 0, 0));
-								PlayCommonSound(HitCommon.HitSFXOverride.ToString());
-								OtherChar->ReceivedHitCommon = HitCommon;
-								OtherChar->ReceivedHit = CounterData;
-								OtherChar->ReceivedHit = CounterData;
-								EHitAction HACT;
-										
-								if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
-									HACT = CounterHit.GroundHitAction;
-								else
-									HACT = CounterHit.AirHitAction;
-									
-								OtherChar->HandleHitAction(HACT);
-							}
-							return;
-						}
+					if (Direction == DIR_Right)
+					{
+						Hitbox.PosX += PosX;
+					}
+					else
+					{
+						Hitbox.PosX = -Hitbox.PosX + PosX;  
+					}
+					Hitbox.PosY += PosY;
+					if (OtherChar->Direction == DIR_Right)
+					{
+						Hurtbox.PosX += OtherChar->PosX;
+					}
+					else
+					{
+						Hurtbox.PosX = -Hurtbox.PosX + OtherChar->PosX;  
+					}
+					Hurtbox.PosY += OtherChar->PosY;
+						
+					if (Hitbox.PosY + Hitbox.SizeY / 2 >= Hurtbox.PosY - Hurtbox.SizeY / 2
+						&& Hitbox.PosY - Hitbox.SizeY / 2 <= Hurtbox.PosY + Hurtbox.SizeY / 2
+						&& Hitbox.PosX + Hitbox.SizeX / 2 >= Hurtbox.PosX - Hurtbox.SizeX / 2
+						&& Hitbox.PosX - Hitbox.SizeX / 2 <= Hurtbox.PosX + Hurtbox.SizeX / 2)
+					{
+						OutHitbox = Hitbox;
+						return true;
 					}
 				}
 			}
 		}
 	}
+	return false;
+}
+
+void ABattleObject::ResolveHit(APlayerObject* OtherChar, const FCollisionBox& Hitbox)
+{
+	if (GameState->bRecordCollisions)
+		GameState->ResolvedCollisions.Add(FIntVector(ObjNumber, OtherChar->ObjNumber, 0));
+	OtherChar->AttackOwner = this;
+	OtherChar->ObjectsToIgnoreHitsFrom.AddUnique(this);
+	OtherChar->StunTime = 2147483647;
+	OtherChar->FaceOpponent();
+	OtherChar->HaltMomentum();
+	OtherChar->PlayerFlags |= PLF_IsStunned;
+	AttackFlags |= ATK_HasHit;
+	AttackTarget = OtherChar;
+		
+	int CollisionDepthX;
+	if (Hitbox.PosX < OtherChar->PosX)
+	{
+		CollisionDepthX = OtherChar->PosX - (Hitbox.PosX + Hitbox.SizeX / 2);
+		HitPosX = Hitbox.PosX + CollisionDepthX / 2;
+	}
+	else
+	{
+		CollisionDepthX = Hitbox.PosX - Hitbox.SizeX / 2 - OtherChar->PosX;
+		HitPosX = Hitbox.PosX - CollisionDepthX / 2;
+	}
+	int CollisionDepthY;
+	int32 CenterPosY = OtherChar->GetPosYCenter();
+	if (Hitbox.PosY < CenterPosY)
+	{
+		CollisionDepthY = CenterPosY - (Hitbox.PosY + Hitbox.SizeY / 2);
+		HitPosY = Hitbox.PosY + CollisionDepthY / 2;
+	}
+	else
+	{
+		CollisionDepthY = Hitbox.PosY - Hitbox.SizeY / 2 - CenterPosY;
+		HitPosY = Hitbox.PosY - CollisionDepthY / 2;
+	}
+		
+	TriggerEvent(EVT_HitOrBlock);
+		
+	if (OtherChar->IsCorrectBlock(HitCommon.BlockType)) //check blocking
+	{
+		CreateCommonParticle("cmn_guard", POS_Enemy,
+		                     FVector(0, 100, 0),
+		                     FRotator(HitCommon.HitAngle, 0, 0));
+		TriggerEvent(EVT_Block);
+			
+		const int32 ChipDamage = NormalHit.Damage * HitCommon.ChipDamagePercent / 100;
+		OtherChar->CurrentHealth -= ChipDamage;
+			
+		const FHitData Data = InitHitDataByAttackLevel(false);
+		OtherChar->ReceivedHitCommon = HitCommon;
+		OtherChar->ReceivedHit = Data;
+			
+		if (OtherChar->CurrentHealth <= 0)
+		{
+			EHitAction HACT;
+				
+			if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
+				HACT = NormalHit.GroundHitAction;
+			else
+				HACT = NormalHit.AirHitAction;
+				
+			OtherChar->HandleHitAction(HACT);
+		}
+		else
+		{
+			OtherChar->HandleBlockAction();
+			OtherChar->AirDashTimer = 0;
+			if (OtherChar->PlayerFlags & PLF_TouchingWall)
+			{
+				Pushback = OtherChar->Pushback;
+				OtherChar->Pushback = 0;
+			}
+		}
+		OtherChar->AddMeter(NormalHit.Damage * OtherChar->MeterPercentOnReceiveHitGuard / 100);
+		Player->AddMeter(NormalHit.Damage * Player->MeterPercentOnHitGuard / 100);
+	}
+	else if (OtherChar->SuperArmorSuccess(this))
+	{
+		if (OtherChar->SuperArmorData.ArmorHits > 0) OtherChar->SuperArmorData.ArmorHits--;
+		switch (OtherChar->SuperArmorData.Type)
+		{
+		case ARM_Guard:
+			{
+				if (OtherChar->SuperArmorData.bArmorTakeChipDamage)
+				{
+					const int32 ChipDamage = NormalHit.Damage * HitCommon.ChipDamagePercent / 100;
+					OtherChar->CurrentHealth -= ChipDamage;
+					OtherChar->AddMeter(NormalHit.Damage * OtherChar->MeterPercentOnReceiveHitGuard / 100);
+					Player->AddMeter(NormalHit.Damage * Player->MeterPercentOnHitGuard / 100);
+				}
+				if (OtherChar->SuperArmorData.ArmorDamagePercent)
+				{
+					const int32 ArmorDamage = NormalHit.Damage * OtherChar->SuperArmorData.ArmorDamagePercent / 100;
+					OtherChar->CurrentHealth -= ArmorDamage;
+					OtherChar->AddMeter(
+						NormalHit.Damage * OtherChar->MeterPercentOnReceiveHit * OtherChar->
+						SuperArmorData.ArmorDamagePercent / 10000);
+					Player->AddMeter(
+						NormalHit.Damage * Player->MeterPercentOnHit * OtherChar->
+						SuperArmorData.ArmorDamagePercent / 10000);
+				}
+			
+				const FHitData Data = InitHitDataByAttackLevel(false);
+				OtherChar->ReceivedHitCommon = HitCommon;
+				OtherChar->ReceivedHit = Data;
+					
+				if (OtherChar->CurrentHealth <= 0)
+				{
+					EHitAction HACT;
+				
+					if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
+						HACT = NormalHit.GroundHitAction;
+					else
+						HACT = NormalHit.AirHitAction;
+				
+					OtherChar->HandleHitAction(HACT);
+				}
+				else
+				{
+					Hitstop = ReceivedHit.Hitstop;
+					OtherChar->Hitstop = ReceivedHit.Hitstop;
+				}
+			}
+			break;
+		case ARM_Dodge:
+		default:
+			break;
+		}
+	}
+	else if ((OtherChar->AttackFlags & ATK_IsAttacking) == 0)
+	{
+		TriggerEvent(EVT_Hit);
+			
+		if (IsPlayer && Player->PlayerFlags & PLF_HitgrabActive)
+		{
+			OtherChar->JumpToState(OtherChar->CharaStateData->DefaultThrowLock);
+			OtherChar->PlayerFlags |= PLF_IsThrowLock;
+			OtherChar->AttackOwner = Player;
+			Player->ThrowExe();
+			return;
+		}
+			
+		const FHitData Data = InitHitDataByAttackLevel(false);
+		CreateCommonParticle(HitCommon.HitVFXOverride.ToString(), POS_Hit,
+		                     FVector(0, 100, 0),
+		                     FRotator(HitCommon.HitAngle, 0, 0));
+		PlayCommonSound(HitCommon.HitSFXOverride.ToString());
+		OtherChar->ReceivedHitCommon = HitCommon;
+		OtherChar->ReceivedHit = Data;
+		EHitAction HACT;
+				
+		if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
+			HACT = NormalHit.GroundHitAction;
+		else
+			HACT = NormalHit.AirHitAction;
+
+		OtherChar->HandleHitAction(HACT);
+	}
+	else
+	{
+		TriggerEvent(EVT_Hit);
+		TriggerEvent(EVT_CounterHit);
+
+		OtherChar->AddColor = FLinearColor(5,0.2,0.2,1);
+		OtherChar->MulColor = FLinearColor(1,0.1,0.1,1);
+		OtherChar->AddFadeSpeed = 0.1;
+		OtherChar->MulFadeSpeed = 0.1;
+			
+		if (IsPlayer && Player->PlayerFlags & PLF_HitgrabActive)
+		{
+			OtherChar->JumpToState(OtherChar->CharaStateData->DefaultThrowLock);
+			OtherChar->PlayerFlags |= PLF_IsThrowLock;
+			OtherChar->AttackOwner = Player;
+			Player->ThrowExe();
+			return;
+		}
+
+		const FHitData CounterData = InitHitDataByAttackLevel(true);
+		CreateCommonParticle(HitCommon.HitVFXOverride.ToString(), POS_Hit, FVector(0, 100, 0), FRotator(HitCommon.HitAngle, 0, 0));
+		PlayCommonSound(HitCommon.HitSFXOverride.ToString());
+		OtherChar->ReceivedHitCommon = HitCommon;
+		OtherChar->ReceivedHit = CounterData;
+		OtherChar->ReceivedHit = CounterData;
+		EHitAction HACT;
+				
+		if (OtherChar->PosY == OtherChar->GroundHeight && !(OtherChar->PlayerFlags & PLF_IsKnockedDown))
+			HACT = CounterHit.GroundHitAction;
+		else
+			HACT = CounterHit.AirHitAction;
+			
+		OtherChar->HandleHitAction(HACT);
+	}
 }
 
 FHitData ABattleObject::InitHitDataByAttackLevel(bool IsCounter)
@@ -1169,109 +1188,131 @@ FHitData ABattleObject::InitHitDataByAttackLevel(bool IsCounter)
 
 void ABattleObject::HandleClashCollision(ABattleObject* OtherObj)
 {
-	if (AttackFlags & ATK_IsAttacking && AttackFlags & ATK_HitActive && OtherObj->Player != Player
-		&& OtherObj->AttackFlags & ATK_IsAttacking && OtherObj->AttackFlags & ATK_HitActive)
+	if (!CanClash(OtherObj))
+		return;
+	FCollisionBox Hitbox;
+	FCollisionBox OtherHitbox;
+	if (FindClashOverlap(OtherObj, Hitbox, OtherHitbox))
+		ResolveClash(OtherObj, Hitbox, OtherHitbox);
+}
+
+bool ABattleObject::CanClash(const ABattleObject* OtherObj) const
+{
+	return AttackFlags & ATK_IsAttacking && AttackFlags & ATK_HitActive && OtherObj->Player != Player
+		&& OtherObj->AttackFlags & ATK_IsAttacking && OtherObj->AttackFlags & ATK_HitActive;
+}
+
+bool ABattleObject::FindClashOverlap(const ABattleObject* OtherObj, FCollisionBox& OutHitbox,
+                                     FCollisionBox& OutOtherHitbox) const
+{
+	for (int i = 0; i < CollisionArraySize; i++)
 	{
-		for (int i = 0; i < CollisionArraySize; i++)
+		if (Boxes[i].Type == BOX_Hit)
 		{
-			if (Boxes[i].Type == BOX_Hit)
+			for (int j = 0; j < CollisionArraySize; j++)
 			{
-				for (int j = 0; j < CollisionArraySize; j++)
+				if (OtherObj->Boxes[j].Type == BOX_Hit)
 				{
-					if (OtherObj->Boxes[j].Type == BOX_Hit)
-					{
-						FCollisionBox Hitbox = Boxes[i];
+					FCollisionBox Hitbox = Boxes[i];
 
-						FCollisionBox OtherHitbox = OtherObj->Boxes[j];
+					FCollisionBox OtherHitbox = OtherObj->Boxes[j];
 
-						if (Direction == DIR_Right)
-						{
-							Hitbox.PosX += PosX;
-						}
-						else
-						{
-							Hitbox.PosX = -Hitbox.PosX + PosX;  
-						}
-						Hitbox.PosY += PosY;
-						if (OtherObj->Direction == DIR_Right)
-						{
-							OtherHitbox.PosX += OtherObj->PosX;
-						}
-						else
-						{
-							OtherHitbox.PosX = -OtherHitbox.PosX + OtherObj->PosX;  
-						}
-						OtherHitbox.PosY += OtherObj->PosY;
-							
-						if (Hitbox.PosY + Hitbox.SizeY / 2 >= OtherHitbox.PosY - OtherHitbox.SizeY / 2
-							&& Hitbox.PosY - Hitbox.SizeY / 2 <= OtherHitbox.PosY + OtherHitbox.SizeY / 2
-							&& Hitbox.PosX + Hitbox.SizeX / 2 >= OtherHitbox.PosX - OtherHitbox.SizeX / 2
-							&& Hitbox.PosX - Hitbox.SizeX / 2 <= OtherHitbox.PosX + OtherHitbox.SizeX / 2)
-						{
-							int CollisionDepthX;
-							if (Hitbox.PosX < OtherHitbox.PosX)
-							{
-								CollisionDepthX = OtherHitbox.PosX - OtherHitbox.SizeX / 2 - (Hitbox.PosX + Hitbox.SizeX / 2);
-								HitPosX = Hitbox.PosX - CollisionDepthX;
-							}
-							else
-							{
-								CollisionDepthX = Hitbox.PosX - Hitbox.SizeX / 2 - (OtherHitbox.PosX + OtherHitbox.SizeX / 2);
-								HitPosX = Hitbox.PosX + CollisionDepthX;
-							}
-							int CollisionDepthY;
-							if (Hitbox.PosY < OtherHitbox.PosY)
-							{
-								CollisionDepthY = OtherHitbox.PosY - OtherHitbox.SizeY / 2 - (Hitbox.PosY + Hitbox.SizeY / 2);
-								HitPosY = Hitbox.PosY - CollisionDepthY;
-							}
-							else
-							{
-								CollisionDepthY = Hitbox.PosY - Hitbox.SizeY / 2 - (OtherHitbox.PosY + OtherHitbox.SizeY / 2);
-								HitPosY = Hitbox.PosY + CollisionDepthY;
-							}
-							
-							if (IsPlayer && OtherObj->IsPlayer)
-							{
-								Hitstop = 16;
-								OtherObj->Hitstop = 16;
-								AttackFlags &= ~ATK_HitActive;
-								OtherObj->AttackFlags &= ~ATK_HitActive;
-								OtherObj->HitPosX = HitPosX;
-								OtherObj->HitPosY = HitPosY;
-								Player->EnableAttacks();
-								Player->EnableCancelIntoSelf(true);
-								Player->EnableState(ENB_ForwardDash);
-								OtherObj->Player->EnableAttacks();
-								OtherObj->Player->EnableCancelIntoSelf(true);
-								OtherObj->Player->EnableState(ENB_ForwardDash);
-								TriggerEvent(EVT_HitOrBlock);
-								OtherObj->TriggerEvent(EVT_HitOrBlock);
-								CreateCommonParticle("cmn_hit_clash", POS_Hit, FVector(0, 100, 0));
-                                PlayCommonSound("HitClash");
-								return;
-							}
-							if (!IsPlayer && !OtherObj->IsPlayer)
-							{
-								OtherObj->Hitstop = 16;
-								Hitstop = 16;
-								AttackFlags &= ~ATK_HitActive;
-								OtherObj->AttackFlags &= ~ATK_HitActive;
-								OtherObj->HitPosX = HitPosX;
-								OtherObj->HitPosY = HitPosY;
-								TriggerEvent(EVT_HitOrBlock);
-								OtherObj->TriggerEvent(EVT_HitOrBlock);
-								CreateCommonParticle("cmn_hit_clash", POS_Hit, FVector(0, 100, 0));
-                                PlayCommonSound("HitClash");
-								return;
-							}
-							return;
-						}
+					if (Direction == DIR_Right)
+					{
+						Hitbox.PosX += PosX;
+					}
+					else
+					{
+						Hitbox.PosX = -Hitbox.PosX + PosX;  
+					}
+					Hitbox.PosY += PosY;
+					if (OtherObj->Direction == DIR_Right)
+					{
+						OtherHitbox.PosX += OtherObj->PosX;
+					}
+					else
+					{
+						OtherHitbox.PosX = -OtherHitbox.PosX + OtherObj->PosX;  
+					}
+					OtherHitbox.PosY += OtherObj->PosY;
+						
+					if (Hitbox.PosY + Hitbox.SizeY / 2 >= OtherHitbox.PosY - OtherHitbox.SizeY / 2
+						&& Hitbox.PosY - Hitbox.SizeY / 2 <= OtherHitbox.PosY + OtherHitbox.SizeY / 2
+						&& Hitbox.PosX + Hitbox.SizeX / 2 >= OtherHitbox.PosX - OtherHitbox.SizeX / 2
+						&& Hitbox.PosX - Hitbox.SizeX / 2 <= OtherHitbox.PosX + OtherHitbox.SizeX / 2)
+					{
+						OutHitbox = Hitbox;
+						OutOtherHitbox = OtherHitbox;
+						return true;
 					}
 				}
 			}
 		}
 	}
+	return false;
+}
+
+void ABattleObject::ResolveClash(ABattleObject* OtherObj, const FCollisionBox& Hitbox, const FCollisionBox& OtherHitbox)
+{
+	if (GameState->bRecordCollisions)
+		GameState->ResolvedCollisions.Add(FIntVector(ObjNumber, OtherObj->ObjNumber, 1));
+	int CollisionDepthX;
+	if (Hitbox.PosX < OtherHitbox.PosX)
+	{
+		CollisionDepthX = OtherHitbox.PosX - OtherHitbox.SizeX / 2 - (Hitbox.PosX + Hitbox.SizeX / 2);
+		HitPosX = Hitbox.PosX - CollisionDepthX;
+	}
+	else
+	{
+		CollisionDepthX = Hitbox.PosX - Hitbox.SizeX / 2 - (OtherHitbox.PosX + OtherHitbox.SizeX / 2);
+		HitPosX = Hitbox.PosX + CollisionDepthX;
+	}
+	int CollisionDepthY;
+	if (Hitbox.PosY < OtherHitbox.PosY)
+	{
+		CollisionDepthY = OtherHitbox.PosY - OtherHitbox.SizeY / 2 - (Hitbox.PosY + Hitbox.SizeY / 2);
+		HitPosY = Hitbox.PosY - CollisionDepthY;
+	}
+	else
+	{
+		CollisionDepthY = Hitbox.PosY - Hitbox.SizeY / 2 - (OtherHitbox.PosY + OtherHitbox.SizeY / 2);
+		HitPosY = Hitbox.PosY + CollisionDepthY;
+	}
+	
+	if (IsPlayer && OtherObj->IsPlayer)
+	{
+		Hitstop = 16;
+		OtherObj->Hitstop = 16;
+		AttackFlags &= ~ATK_HitActive;
+		OtherObj->AttackFlags &= ~ATK_HitActive;
+		OtherObj->HitPosX = HitPosX;
+		OtherObj->HitPosY = HitPosY;
+		Player->EnableAttacks();
+		Player->EnableCancelIntoSelf(true);
+		Player->EnableState(ENB_ForwardDash);
+		OtherObj->Player->EnableAttacks();
+		OtherObj->Player->EnableCancelIntoSelf(true);
+		OtherObj->Player->EnableState(ENB_ForwardDash);
+		TriggerEvent(EVT_HitOrBlock);
+		OtherObj->TriggerEvent(EVT_HitOrBlock);
+		CreateCommonParticle("cmn_hit_clash", POS_Hit, FVector(0, 100, 0));
+		PlayCommonSound("HitClash");
+		return;
+	}
+	if (!IsPlayer && !OtherObj->IsPlayer)
+	{
+		OtherObj->Hitstop = 16;
+		Hitstop = 16;
+		AttackFlags &= ~ATK_HitActive;
+		OtherObj->AttackFlags &= ~ATK_HitActive;
+		OtherObj->HitPosX = HitPosX;
+		OtherObj->HitPosY = HitPosY;
+		TriggerEvent(EVT_HitOrBlock);
+		OtherObj->TriggerEvent(EVT_HitOrBlock);
+		CreateCommonParticle("cmn_hit_clash", POS_Hit, FVector(0, 100, 0));
+		PlayCommonSound("HitClash");
+		return;
+	}
 }
 
 void ABattleObject::HandleFlip()
@@ -1538,14 +1579,31 @@ void ABattleObject::CollisionView()
 	}
 }
 
-void ABattleObject::SaveForRollback(unsigned char* Buffer) const
+FBattleObjectHandle ABattleObject::GetObjectHandle(const ABattleObject* InObject)
 {
-	FMemory::Memcpy(Buffer, &ObjSync, SizeOfBattleObject);
+	if (!IsValid(InObject))
+		return NullObjectHandle;
+	return static_cast<FBattleObjectHandle>(InObject->ObjNumber);
+}
+
+void ABattleObject::SaveForRollback(unsigned char* Buffer)
+{
+	PlayerHandle = GetObjectHandle(Player);
+	AttackTargetHandle = GetObjectHandle(AttackTarget);
+	PositionLinkHandle = GetObjectHandle(PositionLinkObj);
+	StopLinkHandle = GetObjectHandle(StopLinkObj);
+	MaterialLinkHandle = GetObjectHandle(MaterialLinkObj);
+	FMemory::Memcpy(Buffer, &ObjSync, SizeOfBattleObjectHot);
 }
 
 void ABattleObject::LoadForRollback(const unsigned char* Buffer)
 {
-	FMemory::Memcpy(&ObjSync, Buffer, SizeOfBattleObject);
+	FMemory::Memcpy(&ObjSync, Buffer, SizeOfBattleObjectHot);
+	Player = Cast<APlayerObject>(GameState->GetObjectFromHandle(PlayerHandle));
+	AttackTarget = GameState->GetObjectFromHandle(AttackTargetHandle);
+	PositionLinkObj = GameState->GetObjectFromHandle(PositionLinkHandle);
+	StopLinkObj = GameState->GetObjectFromHandle(StopLinkHandle);
+	MaterialLinkObj = GameState->GetObjectFromHandle(MaterialLinkHandle);
 	if (!IsPlayer)
 	{
 		const int StateIndex = Player->ObjectStateNames.Find(ObjectStateName);
@@ -1557,6 +1615,74 @@ void ABattleObject::LoadForRollback(const unsigned char* Buffer)
 	}
 }
 
+bool ABattleObject::SaveColdForRollback(unsigned char* Buffer, uint32& SavedVersion)
+{
+	if (ColdVersion != 0 && ColdVersion == SavedVersion)
+	{
+		checkSlow(FMemory::Memcmp(Buffer, &ObjColdSync, SizeOfBattleObjectCold) == 0);
+		return false;
+	}
+	if (ColdVersion == 0)
+		MarkColdDirty();
+	FMemory::Memcpy(Buffer, &ObjColdSync, SizeOfBattleObjectCold);
+	SavedVersion = ColdVersion;
+	return true;
+}
+
+void ABattleObject::LoadColdForRollback(const unsigned char* Buffer, uint32& SavedVersion)
+{
+	if (SavedVersion != 0 && SavedVersion == ColdVersion)
+		return;
+	FMemory::Memcpy(&ObjColdSync, Buffer, SizeOfBattleObjectCold);
+	// Saved data of unknown version, such as another machine's snapshot, gets a version now that it matches this object.
+	if (SavedVersion == 0)
+	{
+		MarkColdDirty();
+		SavedVersion = ColdVersion;
+	}
+	else
+	{
+		ColdVersion = SavedVersion;
+	}
+}
+
+const TArray<FSnapshotField>& ABattleObject::GetSnapshotFields()
+{
+	static const TArray<FSnapshotField> Fields = []
+	{
+		TArray<FSnapshotField> Result;
+		const auto Add = [&Result](ESnapshotField Kind, size_t Offset, size_t Size)
+		{
+			Result.Add({ Kind, static_cast<uint32>(Offset - offsetof(ABattleObject, ObjSync)), static_cast<uint32>(Size) });
+		};
+		Add(ESnapshotField::Name, offsetof(ABattleObject, CelName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(ABattleObject, BlendCelName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(ABattleObject, LabelName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(ABattleObject, AnimName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(ABattleObject, BlendAnimName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(ABattleObject, ObjectStateName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(ABattleObject, SocketName), sizeof(FName));
+		Add(ESnapshotField::Object, offsetof(ABattleObject, AnimSequence), sizeof(TObjectPtr<UObject>));
+		Add(ESnapshotField::Object, offsetof(ABattleObject, BlendAnimSequence), sizeof(TObjectPtr<UObject>));
+		for (const size_t HitCommon : { offsetof(ABattleObject, HitCommon), offsetof(ABattleObject, ReceivedHitCommon) })
+		{
+			Add(ESnapshotField::Name, HitCommon + offsetof(FHitDataCommon, GuardSFXOverride), sizeof(FName));
+			Add(ESnapshotField::Name, HitCommon + offsetof(FHitDataCommon, GuardVFXOverride), sizeof(FName));
+			Add(ESnapshotField::Name, HitCommon + offsetof(FHitDataCommon, HitSFXOverride), sizeof(FName));
+			Add(ESnapshotField::Name, HitCommon + offsetof(FHitDataCommon, HitVFXOverride), sizeof(FName));
+		}
+		for (int i = 0; i < EVT_NUM; i++)
+		{
+			const size_t Handler = offsetof(ABattleObject, EventHandlers) + i * sizeof(FEventHandler);
+			Add(ESnapshotField::Name, Handler + offsetof(FEventHandler, FunctionName), sizeof(FName));
+			Add(ESnapshotField::Name, Handler + offsetof(FEventHandler, SubroutineName), sizeof(FName));
+		}
+		Add(ESnapshotField::Name, offsetof(ABattleObject, BoxesCelName), sizeof(FName));
+		return Result;
+	}();
+	return Fields;
+}
+
 void ABattleObject::LogForSyncTestFile(std::ofstream& file)
 {
 	if(file)
@@ -1592,6 +1718,8 @@ void ABattleObject::LogForSyncTestFile(std::ofstream& file)
 
 void ABattleObject::UpdateVisuals()
 {
+	if (IsValid(GameState) && !GameState->Presentation->IsVisible())
+		return;
 	if (IsPlayer)
 	{
 		if (Player->PlayerFlags & PLF_IsOnScreen) SetActorHiddenInGame(false);
@@ -1712,6 +1840,13 @@ void ABattleObject::FuncCall(const FName& FuncName) const
 
 void ABattleObject::GetBoxes()
 {
+	BoxesGeneration++;
+	// Boxes are rebuilt from the same cel every frame, which leaves the cold rollback data as it was.
+	if (BoxesCelName != CelName || CelName.IsNone())
+	{
+		BoxesCelName = CelName;
+		MarkColdDirty();
+	}
 	for (int j = 0; j < CollisionArraySize; j++)
 	{
 		Boxes[j].Type = BOX_Hurt;
@@ -2016,6 +2151,9 @@ void ABattleObject::ResetObject()
 	{
 		Box = FCollisionBox();
 	}
+	BoxesCelName = FName();
+	BoxesGeneration++;
+	MarkColdDirty();
 	ObjectStateName = FName();
 	ObjectID = 0;
 	Player = nullptr;
@@ -2094,14 +2232,24 @@ void ABattleObject::InitEventHandler(EEventType EventType, FName FuncName, int32
 		UpdateTime = 0;
 	default: break;
 	}
-	EventHandlers[EventType].FunctionName = FName(FuncName.ToString());
-	EventHandlers[EventType].SubroutineName = FName(SubroutineName);
+	const FName NewFunctionName = FName(FuncName.ToString());
+	const FName NewSubroutineName = FName(SubroutineName);
+	if (EventHandlers[EventType].FunctionName != NewFunctionName || EventHandlers[EventType].SubroutineName != NewSubroutineName)
+	{
+		EventHandlers[EventType].FunctionName = NewFunctionName;
+		EventHandlers[EventType].SubroutineName = NewSubroutineName;
+		MarkColdDirty();
+	}
 }
 
 void ABattleObject::RemoveEventHandler(EEventType EventType)
 {
-	EventHandlers[EventType].FunctionName = FName();
-	EventHandlers[EventType].SubroutineName = FName();
+	if (!EventHandlers[EventType].FunctionName.IsNone() || !EventHandlers[EventType].SubroutineName.IsNone())
+	{
+		EventHandlers[EventType].FunctionName = FName();
+		EventHandlers[EventType].SubroutineName = FName();
+		MarkColdDirty();
+	}
 	if (EventType == EVT_Update)
 		UpdateTime = 0;
 }
@@ -2492,7 +2640,7 @@ void ABattleObject::SetPushWidthExtend(int32 Extend)
 
 void ABattleObject::CreateCommonParticle(FString Name, EPosType PosType, FVector Offset, FRotator Rotation)
 {
-	if (!GameState) return;
+	if (!GameState || !GameState->Presentation->IsVisible()) return;
 	if (Player->CommonParticleData != nullptr)
 	{
 		for (FParticleStruct ParticleStruct : Player->CommonParticleData->ParticleStructs)
@@ -2528,7 +2676,7 @@ void ABattleObject::CreateCommonParticle(FString Name, EPosType PosType, FVector
 
 void ABattleObject::CreateCharaParticle(FString Name, EPosType PosType, FVector Offset, FRotator Rotation)
 {
-	if (!GameState) return;
+	if (!GameState || !GameState->Presentation->IsVisible()) return;
 	if (Player->CharaParticleData != nullptr)
 	{
 		for (FParticleStruct ParticleStruct : Player->CharaParticleData->ParticleStructs)
@@ -2561,7 +2709,7 @@ void ABattleObject::CreateCharaParticle(FString Name, EPosType PosType, FVector
 
 void ABattleObject::LinkCommonParticle(FString Name)
 {
-	if (!GameState) return;
+	if (!GameState || !GameState->Presentation->IsVisible()) return;
 	if (IsPlayer)
 		return;
 	if (Player->CommonParticleData != nullptr)
@@ -2588,7 +2736,7 @@ void ABattleObject::LinkCommonParticle(FString Name)
 
 void ABattleObject::LinkCharaParticle(FString Name)
 {
-	if (!GameState) return;
+	if (!GameState || !GameState->Presentation->IsVisible()) return;
 	if (IsPlayer)
 		return;
 	if (Player->CharaParticleData != nullptr)
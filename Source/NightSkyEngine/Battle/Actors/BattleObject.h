@@ -17,6 +17,36 @@ class UState;
 class APlayerObject;
 constexpr int32 CollisionArraySize = 64;
 
+/*
+ * Handle to a battle object, stored in rollback data in place of a pointer so snapshots don't depend on memory addresses.
+ * The value is the object's ObjNumber: battle objects come first, followed by players.
+ */
+using FBattleObjectHandle = uint16;
+constexpr FBattleObjectHandle NullObjectHandle = MAX_uint16;
+
+/*
+ * A field in rollback data that only means something in this process, found by its offset from the start of the data.
+ * State snapshots sent to another machine write these by value instead of copying their bytes.
+ */
+enum class ESnapshotField : uint8
+{
+	// An FName, sent as its string.
+	Name,
+	// A UObject pointer, sent as its object path.
+	Object,
+	// Data that's the same on every machine. The receiver keeps its own copy.
+	Local,
+	// An FStateMachine, sent as the index of its current state.
+	StateMachine,
+};
+
+struct FSnapshotField
+{
+	ESnapshotField Kind;
+	uint32 Offset;
+	uint32 Size;
+};
+
 // Event handler data.
 
 /*
@@ -650,20 +680,12 @@ public:
 	 * Attack data
 	 */
 	
-	UPROPERTY(BlueprintReadWrite)
-	FHitDataCommon HitCommon = {};
-	UPROPERTY(BlueprintReadWrite)
-	FHitData NormalHit = {};
-	UPROPERTY(BlueprintReadWrite)
-	FHitData CounterHit = {};
 	uint32 AttackFlags = 0;
 
 	/*
 	 * Received attack data
 	 */
 
-	FHitDataCommon ReceivedHitCommon = {};
-	FHitData ReceivedHit = {};
 	uint32 StunTime = 0;
 	uint32 StunTimeMax = 0;
 	uint32 Hitstop = 0;
@@ -770,8 +792,6 @@ public:
 	int32 TimeUntilNextCel = 0;
 	// Max time of the cel.
 	int32 MaxCelTime = 0;
-	// Event handlers for every function.
-	FEventHandler EventHandlers[EVT_NUM] = {};
 
 	/*
 	 * Action data for objects only.
@@ -792,8 +812,6 @@ protected:
 	int32 R = 0;
 	int32 T = 0;
 	int32 B = 0;
-	
-	FCollisionBox Boxes[CollisionArraySize];
 
 public:
 	/*
@@ -848,7 +866,57 @@ public:
 	FVector ObjectScale = FVector::One();
 
 	/*
-	 * Object pointers.
+	 * Object handles. These are saved in place of the object pointers, which are resolved from them on load.
+	 */
+	
+	FBattleObjectHandle PlayerHandle = NullObjectHandle;
+	FBattleObjectHandle AttackTargetHandle = NullObjectHandle;
+	FBattleObjectHandle PositionLinkHandle = NullObjectHandle;
+	FBattleObjectHandle StopLinkHandle = NullObjectHandle;
+	FBattleObjectHandle MaterialLinkHandle = NullObjectHandle;
+	
+	int32 ObjectStateIndex = 0;
+	bool bIsCommonState = false;
+
+	/*
+	 * Attack data
+	 */
+	
+	UPROPERTY(BlueprintReadWrite)
+	FHitDataCommon HitCommon = {};
+	UPROPERTY(BlueprintReadWrite)
+	FHitData NormalHit = {};
+	UPROPERTY(BlueprintReadWrite)
+	FHitData CounterHit = {};
+
+	/*
+	 * Received attack data
+	 */
+
+	FHitDataCommon ReceivedHitCommon = {};
+	FHitData ReceivedHit = {};
+
+	//Starting from this until ObjSyncEnd is cold rollback data: large, and rarely changed between frames.
+	//Anything that writes it must call MarkColdDirty, so saves and loads can skip it when it hasn't changed.
+	unsigned char ObjColdSync = 0;
+
+	// Event handlers for every function. Set through InitEventHandler and RemoveEventHandler.
+	FEventHandler EventHandlers[EVT_NUM] = {};
+
+protected:
+	/*
+	 * Collision data
+	 */
+	FCollisionBox Boxes[CollisionArraySize];
+	// The cel Boxes was last built from. Boxes only depend on the cel, so rebuilding them for the same one changes nothing.
+	FName BoxesCelName;
+
+public:
+	// Anything past here isn't saved or loaded for rollback, unless it has the SaveGame tag.
+	unsigned char ObjSyncEnd = 0;
+
+	/*
+	 * Object pointers. These are saved and loaded for rollback through the object handles above.
 	 */
 	
 	// Pointer to player object. If this is not a player, it will point to the owning player.
@@ -862,12 +930,6 @@ public:
 	ABattleObject* StopLinkObj = nullptr;
 	UPROPERTY(BlueprintReadWrite)
 	ABattleObject* MaterialLinkObj = nullptr;
-	
-	int32 ObjectStateIndex = 0;
-	bool bIsCommonState = false;
-	
-	// Anything past here isn't saved or loaded for rollback, unless it has the SaveGame tag.
-	unsigned char ObjSyncEnd = 0;
 
 	UPROPERTY(SaveGame)
 	TArray<ABattleObject*> ObjectsToIgnoreHitsFrom;
@@ -882,6 +944,12 @@ public:
 	TObjectPtr<UNiagaraComponent> LinkedParticle = nullptr;
 	
 	uint32 ObjNumber = 0;
+	// Incremented whenever Boxes is rebuilt or cleared. Lets hit collision notice box changes within a frame.
+	uint32 BoxesGeneration = 0;
+	// Identifies the contents of the cold rollback data. Each write takes a new value from ColdVersionCount, and a
+	// load takes the saved value, so equal versions always mean equal contents. 0 means unknown.
+	uint32 ColdVersion = 0;
+	uint32 ColdVersionCount = 0;
 
 	UPROPERTY(BlueprintReadOnly)
 	float ScreenSpaceDepthOffset = 0;
@@ -913,10 +981,22 @@ public:
 	void HandlePushCollision(ABattleObject* OtherObj);
 	//handles hitting objects
 	void HandleHitCollision(APlayerObject* OtherChar);
+	//checks attack and invulnerability state for a hit. read-only
+	bool CanHitPlayer(const APlayerObject* OtherChar) const;
+	//finds the first overlapping hitbox/hurtbox pair. read-only, safe to call from worker threads
+	bool FindHitOverlap(const APlayerObject* OtherChar, FCollisionBox& OutHitbox) const;
+	//applies a hit found by FindHitOverlap
+	void ResolveHit(APlayerObject* OtherChar, const FCollisionBox& Hitbox);
 	//initializes hit data by attack level
 	FHitData InitHitDataByAttackLevel(bool IsCounter);
 	//handles object clashes
 	void HandleClashCollision(ABattleObject* OtherObj);
+	//checks attack state for a clash. read-only
+	bool CanClash(const ABattleObject* OtherObj) const;
+	//finds the first overlapping hitbox pair. read-only, safe to call from worker threads
+	bool FindClashOverlap(const ABattleObject* OtherObj, FCollisionBox& OutHitbox, FCollisionBox& OutOtherHitbox) const;
+	//applies a clash found by FindClashOverlap
+	void ResolveClash(ABattleObject* OtherObj, const FCollisionBox& Hitbox, const FCollisionBox& OtherHitbox);
 	//handles flip
 	void HandleFlip();
 	//gets position from pos type
@@ -926,8 +1006,16 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void CollisionView();
 	
-	void SaveForRollback(unsigned char* Buffer) const;
+	//gets the rollback handle of an object
+	static FBattleObjectHandle GetObjectHandle(const ABattleObject* InObject);
+	void SaveForRollback(unsigned char* Buffer);
 	void LoadForRollback(const unsigned char* Buffer);
+	//copies the cold rollback data unless Buffer already holds it. returns whether it was copied
+	bool SaveColdForRollback(unsigned char* Buffer, uint32& SavedVersion);
+	void LoadColdForRollback(const unsigned char* Buffer, uint32& SavedVersion);
+	void MarkColdDirty() { ColdVersion = ++ColdVersionCount; } //call after writing cold rollback data
+	//fields of the hot and cold rollback data, from ObjSync, that snapshots can't copy as bytes
+	static const TArray<FSnapshotField>& GetSnapshotFields();
 	virtual void LogForSyncTestFile(std::ofstream& file);
 	
 protected:
@@ -1123,4 +1211,6 @@ public:
 	void DeactivateObject();
 };
 
-constexpr size_t SizeOfBattleObject = offsetof(ABattleObject, ObjSyncEnd) - offsetof(ABattleObject, ObjSync);
\ No newline at end of file
+constexpr size_t SizeOfBattleObject = offsetof(ABattleObject, ObjSyncEnd) - offsetof(ABattleObject, ObjSync);
+constexpr size_t SizeOfBattleObjectHot = offsetof(ABattleObject, ObjColdSync) - offsetof(ABattleObject, ObjSync);
+constexpr size_t SizeOfBattleObjectCold = offsetof(ABattleObject, ObjSyncEnd) - offsetof(ABattleObject, ObjColdSync);
\ No newline at end of file
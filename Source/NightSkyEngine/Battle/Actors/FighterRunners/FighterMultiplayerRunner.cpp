@@ -11,7 +11,106 @@
 #include "NightSkyEngine/Miscellaneous/RpcConnectionManager.h"
 #include <iostream>
 
-#include "Serialization/BufferArchive.h"
+#include "include/simulated_connection_manager.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<int32> CVarNetInputDelay(
+	TEXT("ns.Net.InputDelay"),
+	-1,
+	TEXT("Local input delay in frames for netplay. -1 picks it from ping, jitter and rollback cost at the start of each round."));
+
+static TAutoConsoleVariable<int32> CVarNetMaxInputDelay(
+	TEXT("ns.Net.MaxInputDelay"),
+	4,
+	TEXT("Most input delay the adaptive controller will pick."));
+
+static TAutoConsoleVariable<int32> CVarNetMaxRollbackFrames(
+	TEXT("ns.Net.MaxRollbackFrames"),
+	3,
+	TEXT("Deepest rollback the adaptive controller expects players to tolerate. Latency beyond this becomes input delay."));
+
+static TAutoConsoleVariable<int32> CVarNetPredictionFrames(
+	TEXT("ns.Net.PredictionFrames"),
+	GGPO_DEFAULT_PREDICTION_FRAMES,
+	TEXT("Frames a client may run ahead of the last confirmed remote input before it waits, and so the deepest rollback. Wider windows ride out more latency but keep a saved state per frame. Read when a battle starts."));
+
+static TAutoConsoleVariable<int32> CVarNetInputQueueLength(
+	TEXT("ns.Net.InputQueueLength"),
+	GGPO_DEFAULT_INPUT_QUEUE_LENGTH,
+	TEXT("Inputs GGPO keeps per player. Raised to twice ns.Net.PredictionFrames plus the save interval and input delay if it's shorter. Read when a battle starts."));
+
+static TAutoConsoleVariable<int32> CVarNetSaveInterval(
+	TEXT("ns.Net.SaveInterval"),
+	1,
+	TEXT("Save the game state every N frames instead of every frame. Rollbacks resimulate from the last save, so each one runs up to N-1 extra frames. NetBenchmark -SaveIntervals measures the best N. Read when a battle starts."));
+
+static TAutoConsoleVariable<float> CVarNetRollbackBudget(
+	TEXT("ns.Net.RollbackBudget"),
+	0.5f,
+	TEXT("Share of a frame a rollback may spend resimulating. Slower machines get fewer rollback frames and more input delay."));
+
+static TAutoConsoleVariable<FString> CVarNetConditions(
+	TEXT("ns.Net.Conditions"),
+	TEXT(""),
+	TEXT("Profile from Config/NetworkConditions.ini to simulate on the packets this client sends, such as WiFi. Read when a battle starts."));
+
+static TAutoConsoleVariable<bool> CVarNetWriteTelemetry(
+	TEXT("ns.Net.WriteTelemetry"),
+	true,
+	TEXT("Write network telemetry histograms to Saved/Profiling/Network at the end of each netplay match."));
+
+static FAutoConsoleCommandWithWorld CmdNetTelemetry(
+	TEXT("ns.Net.Telemetry"),
+	TEXT("Prints network telemetry histograms for the current netplay match."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		const AFighterMultiplayerRunner* Runner = Cast<AFighterMultiplayerRunner>(
+			UGameplayStatics::GetActorOfClass(World, AFighterMultiplayerRunner::StaticClass()));
+		if (Runner)
+			Runner->GetTelemetry().Dump();
+		else
+			UE_LOG(LogTemp, Display, TEXT("Network telemetry: not in a netplay match"));
+	}));
+
+static FAutoConsoleCommand CmdNetDumpTrace(
+	TEXT("ns.Net.DumpTrace"),
+	TEXT("Writes GGPO's trace of recent inputs, predictions, saves and rollbacks to Saved/Profiling/Network. Needs GGPOUE4 built with GGPO_TRACE=1."),
+	FConsoleCommandDelegate::CreateLambda([]
+	{
+		AFighterMultiplayerRunner::DumpTrace();
+	}));
+
+static TAutoConsoleVariable<bool> CVarNetTimeSyncPacing(
+	TEXT("ns.Net.TimeSyncPacing"),
+	true,
+	TEXT("Slow down by a fraction of a frame while ahead of the remote, instead of skipping whole frames."));
+
+static TAutoConsoleVariable<float> CVarNetTimeSyncMaxStretch(
+	TEXT("ns.Net.TimeSyncMaxStretch"),
+	0.02f,
+	TEXT("Most the frame interval is stretched by time sync pacing, as a fraction of a frame. Reached at one frame ahead."));
+
+static TAutoConsoleVariable<int32> CVarNetTimeSyncSkipFrames(
+	TEXT("ns.Net.TimeSyncSkipFrames"),
+	5,
+	TEXT("With time sync pacing, frames ahead of the remote before whole frames are skipped as well."));
+
+namespace
+{
+	// Frames ahead of the remote below which pacing leaves the frame interval alone.
+	constexpr float PacingDeadZone = 0.5f;
+
+	// Weight of each new sample in the frame cost averages.
+	constexpr double CostSmoothing = 1.0 / 32;
+
+	void AddCostSample(double& Average, uint64 Cycles)
+	{
+		const double Microseconds = FPlatformTime::ToMilliseconds64(Cycles) * 1000.0;
+		Average = Average == 0 ? Microseconds : Average + (Microseconds - Average) * CostSmoothing;
+	}
+}
 
 // Sets default values
 AFighterMultiplayerRunner::AFighterMultiplayerRunner()
@@ -28,7 +127,20 @@ void AFighterMultiplayerRunner::BeginPlay()
 	Super::BeginPlay();
 	GGPOSessionCallbacks cb = CreateCallbacks();
 	connectionManager = new RpcConnectionManager();
-	GGPONet::ggpo_start_session(&ggpo, &cb, connectionManager,"", 2, sizeof(int));
+	ConnectionManager* SessionConnection = connectionManager;
+	const FString ConditionsProfile = CVarNetConditions.GetValueOnGameThread();
+	NetworkConditions Conditions;
+	if (!ConditionsProfile.IsEmpty() && LoadNetworkConditions(FPaths::ProjectConfigDir() / TEXT("NetworkConditions.ini"),
+		ConditionsProfile, GameState->GameInstance->PlayerIndex, Conditions))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Simulating network conditions %s"), *ConditionsProfile);
+		SimulatedConnection = new SimulatedConnectionManager(connectionManager, Conditions);
+		SessionConnection = SimulatedConnection;
+	}
+	const GGPOSessionLimits Limits = GetSessionLimits();
+	UE_LOG(LogTemp, Display, TEXT("Prediction window %d frames, input queue %d frames, saving every %d frames"),
+		Limits.prediction_frames, Limits.input_queue_length, Limits.save_interval);
+	GGPONet::ggpo_start_session(&ggpo, &cb, SessionConnection,"", 2, sizeof(int), &Limits);
 	GGPONet::ggpo_set_disconnect_timeout(ggpo, 45000);
 	GGPONet::ggpo_set_disconnect_notify_start(ggpo, 15000);
 	for (int i = 0; i < 2; i++)
@@ -45,7 +157,13 @@ void AFighterMultiplayerRunner::BeginPlay()
 		player->connection_id = i;
 		GGPONet::ggpo_add_player(ggpo, player, &handle);
 		if(player->type == GGPO_PLAYERTYPE_LOCAL)
-			GGPONet::ggpo_set_frame_delay(ggpo,handle,2);// TODO: Logic for framedelay (based on ping? or make user choose?)
+		{
+			// Nothing is measured yet, so start at the fixed delay or a safe default until the first round starts.
+			const int32 FixedDelay = CVarNetInputDelay.GetValueOnGameThread();
+			if (FixedDelay >= 0)
+				InputDelay = FixedDelay;
+			GGPONet::ggpo_set_frame_delay(ggpo,handle,InputDelay);
+		}
 		Players.Add(player);
 		PlayerInputIndex.Add(-1);
 		PlayerHandles.Add(handle);
@@ -56,7 +174,10 @@ void AFighterMultiplayerRunner::BeginPlay()
 void AFighterMultiplayerRunner::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
-	
+
+	if (Telemetry.Frames > 0 && CVarNetWriteTelemetry.GetValueOnGameThread())
+		Telemetry.WriteCSV();
+	delete SimulatedConnection;
 	delete connectionManager;
 }
 
@@ -76,6 +197,11 @@ GGPOSessionCallbacks AFighterMultiplayerRunner::CreateCallbacks()
 	cb.free_buffer = std::bind(&AFighterMultiplayerRunner::FreeBuffer, this, std::placeholders::_1);
 	cb.advance_frame = std::bind(&AFighterMultiplayerRunner::AdvanceFrameCallback, this, std::placeholders::_1);
 	cb.on_event = std::bind(&AFighterMultiplayerRunner::OnEventCallback, this, std::placeholders::_1);
+	cb.make_snapshot = std::bind(&AFighterMultiplayerRunner::MakeSnapshotCallback, this,
+	                             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+	                             std::placeholders::_4);
+	cb.load_snapshot = std::bind(&AFighterMultiplayerRunner::LoadSnapshotCallback, this,
+	                             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
 
 	return cb;
 }
@@ -85,42 +211,35 @@ bool AFighterMultiplayerRunner::BeginGameCallback(const char*)
 	return true;
 }
 
-bool AFighterMultiplayerRunner::SaveGameStateCallback(unsigned char** buffer, int32* len, int32* checksum, int32)
+bool AFighterMultiplayerRunner::SaveGameStateCallback(unsigned char** buffer, int32* len, int32* checksum, int32 frame)
 {
 	GameState->SaveGameState(checksum);
+	FRoundSample& RoundSample = RoundSamples[frame % UE_ARRAY_COUNT(RoundSamples)];
+	RoundSample.Frame = frame;
+	RoundSample.RoundCount = GameState->BattleState.RoundCount;
+	RoundSample.bIntroDone = GameState->BattleState.CurrentIntroSide == INT_None;
+	if (bChecksumFullState)
+		*checksum = static_cast<int32>(GameState->HashSavedGameState());
+	const uint32 BufferStartCycles = FPlatformTime::Cycles();
 	int BackupFrame = GameState->LocalFrame % MaxRollbackFrames;
-	FRollbackData rollbackdata = GameState->MainRollbackData[BackupFrame];
-	FBPRollbackData bprollbackdata = GameState->BPRollbackData[BackupFrame];
-	FBufferArchive Ar(false);
-	Ar.SetWantBinaryPropertySerialization(true);
-	bprollbackdata.Serialize(Ar);
-	rollbackdata.SizeOfBPRollbackData = Ar.Num();
-
-	*len = sizeof(FRollbackData) + Ar.Num();
-	*buffer = new unsigned char[*len];
-	
-	FMemory::Memcpy(*buffer, &rollbackdata, sizeof(FRollbackData));
-	FMemory::Memcpy(*buffer + sizeof(FRollbackData), Ar.GetData(), Ar.Num());
+	uint32 CopiedBytes = 0;
+	*buffer = BufferStore.SaveBuffer(GameState->MainRollbackData[BackupFrame], GameState->BPRollbackData[BackupFrame], *len, CopiedBytes);
+	GameState->SnapshotStats.AddGGPOBuffer(*len, CopiedBytes, FRollbackBufferStore::GetUnsharedCopiedBytes(*buffer),
+		FPlatformTime::Cycles() - BufferStartCycles);
 	return true;
 }
 
 bool AFighterMultiplayerRunner::LoadGameStateCallback(unsigned char* buffer, int32 len)
 {
 	int BackupFrame = GameState->LocalFrame % MaxRollbackFrames;
-	FRollbackData* rollbackdata = &GameState->MainRollbackData[BackupFrame];
-	FBPRollbackData* bprollbackdata = &GameState->BPRollbackData[BackupFrame];
 	
-	FMemory::Memcpy(rollbackdata, buffer, sizeof(FRollbackData));
-
-	uint8* BPBuffer = new uint8[len - sizeof(FRollbackData)];
-	FMemory::Memcpy(BPBuffer, buffer + sizeof(FRollbackData), len - sizeof(FRollbackData));
-
-	const TArray BPArray(BPBuffer, rollbackdata->SizeOfBPRollbackData);
-	FMemoryReader Ar(BPArray);
-	Ar.SetWantBinaryPropertySerialization(true);
-	bprollbackdata->Serialize(Ar);
+	Telemetry.AddRollback();
+	const uint64 LoadStartCycles = FPlatformTime::Cycles64();
+	// GGPO only loads buffers it still holds, so their cold blocks are always there.
+	verify(BufferStore.LoadBuffer(buffer, len, GameState->MainRollbackData[BackupFrame], GameState->BPRollbackData[BackupFrame]));
 	
 	GameState->LoadGameState();
+	AddCostSample(LoadMicroseconds, FPlatformTime::Cycles64() - LoadStartCycles);
 	return true;
 }
 
@@ -133,8 +252,12 @@ bool AFighterMultiplayerRunner::LogGameState(const char* filename, unsigned char
 	file.open(TCHAR_TO_ANSI(*savedDir));
 	if (file.is_open())
 	{
-		FRollbackData* rollbackdata = (FRollbackData*)malloc(sizeof(FRollbackData));
-		memcpy(rollbackdata, buffer, sizeof(FRollbackData));
+		// The sync test logs copies of buffers it no longer holds, whose cold blocks may have been reused. Those objects
+		// log zeroed cold data.
+		const TUniquePtr<FRollbackData> rollbackdata = MakeUnique<FRollbackData>();
+		FBPRollbackData bprollbackdata;
+		if (!BufferStore.LoadBuffer(buffer, len, *rollbackdata, bprollbackdata))
+			file << "Some cold object data was no longer stored.\n";
 		file << "GameState:\n";
 		FBattleState BattleState;
 		FMemory::Memcpy(&BattleState, rollbackdata->BattleStateBuffer, SizeOfBattleState);
@@ -208,11 +331,11 @@ bool AFighterMultiplayerRunner::LogGameState(const char* filename, unsigned char
 		}
 		file << "\n";
 
-		int checksum = fletcher32_checksum((short*)buffer, sizeof(FRollbackData) / 2);
+		int checksum = fletcher32_checksum((short*)buffer, len / 2);
 		file << "RawBuffer:\n";
 		file << "\tFletcher32Checksum: " << checksum << "\n";
 		file << "\tBuffer:\n\t0: ";
-		for (int i = 0; i < sizeof(FRollbackData); i++)
+		for (int i = 0; i < len; i++)
 		{
 			file << std::hex << std::uppercase << static_cast<int>(buffer[i]) << " ";
 			if(i % 16 == 0)
@@ -221,7 +344,6 @@ bool AFighterMultiplayerRunner::LogGameState(const char* filename, unsigned char
 			}
 		}
 		
-		delete[] buffer;
 		file.close();
 	}
 	return true;
@@ -229,7 +351,29 @@ bool AFighterMultiplayerRunner::LogGameState(const char* filename, unsigned char
 
 void AFighterMultiplayerRunner::FreeBuffer(void* buffer)
 {
-	delete[] static_cast<char*>(buffer);
+	BufferStore.FreeBuffer(static_cast<unsigned char*>(buffer));
+}
+
+bool AFighterMultiplayerRunner::MakeSnapshotCallback(unsigned char* buffer, int32 len, unsigned char** snapshot, int32* snapshot_len)
+{
+	// GGPO still holds the buffer, so its cold blocks are there.
+	const TUniquePtr<FRollbackData> rollbackdata = MakeUnique<FRollbackData>();
+	FBPRollbackData bprollbackdata;
+	if (!BufferStore.LoadBuffer(buffer, len, *rollbackdata, bprollbackdata))
+		return false;
+	const TArray<uint8> Snapshot = GameState->MakeSnapshot(*rollbackdata, bprollbackdata);
+	if (Snapshot.Num() == 0)
+		return false;
+	*snapshot_len = Snapshot.Num();
+	*snapshot = new unsigned char[*snapshot_len];
+	FMemory::Memcpy(*snapshot, Snapshot.GetData(), *snapshot_len);
+	UE_LOG(LogTemp, Display, TEXT("Made a %d byte state snapshot for a spectator (saved state %d bytes)"), *snapshot_len, len);
+	return true;
+}
+
+bool AFighterMultiplayerRunner::LoadSnapshotCallback(unsigned char* snapshot, int32 len, int32 frame)
+{
+	return GameState->LoadSnapshot(TArray<uint8>(snapshot, len), frame);
 }
 
 bool AFighterMultiplayerRunner::AdvanceFrameCallback(int flag)
@@ -237,7 +381,10 @@ bool AFighterMultiplayerRunner::AdvanceFrameCallback(int flag)
 	int inputs[2] = {0};
 	int disconnect_flags;
 	GGPONet::ggpo_synchronize_input(ggpo, (void*)inputs, sizeof(int) * 2, &disconnect_flags);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
 	GameState->UpdateGameState(inputs[0], inputs[1], true);
+	AddCostSample(ResimMicroseconds, FPlatformTime::Cycles64() - StartCycles);
+	Telemetry.AddResimulatedFrame();
 	GGPONet::ggpo_advance_frame(ggpo);
 	return true;
 }
@@ -270,6 +417,7 @@ bool AFighterMultiplayerRunner::OnEventCallback(GGPOEvent* info)
 		break;
 	case GGPO_EVENTCODE_CONNECTION_INTERRUPTED:
 		UE_LOG(LogTemp, Warning, TEXT("GGPO_EVENTCODE_CONNECTION_INTERRUPTED"));
+		Telemetry.AddInterruption();
 	// connectionLost = true;
 	// FightGameInstance->ErrorMessage = FString("Connection interrupted");
 	// EndOnline(true);
@@ -288,7 +436,7 @@ bool AFighterMultiplayerRunner::OnEventCallback(GGPOEvent* info)
 		break;
 	case GGPO_EVENTCODE_TIMESYNC:
 		UE_LOG(LogTemp, Warning, TEXT("GGPO_EVENTCODE_TIMESYNC"));
-		//if(MultipliedFramesAhead>3)
+		if (ShouldSkipFrames(info->u.timesync.frames_ahead))
 		{
 			MultipliedFramesAhead=info->u.timesync.frames_ahead*TimesyncMultiplier;
 		}
@@ -332,17 +480,176 @@ void AFighterMultiplayerRunner::GgpoUpdate()
 		result = GGPONet::ggpo_synchronize_input(ggpo, (void*)inputs, sizeof(int) * 2, &disconnect_flags);
 		if (GGPO_SUCCEEDED(result))
 		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
 			GameState->UpdateGameState(inputs[0], inputs[1], false);
+			AddCostSample(FrameMicroseconds, FPlatformTime::Cycles64() - StartCycles);
 			GGPONet::ggpo_advance_frame(ggpo);
+			const FGGPONetworkStats Stats = GetRemoteNetworkStats();
+			Telemetry.AddFrame(Stats, FrameInterval > OneFrame);
+			CheckConfirmedRound(Stats.timesync.confirmed_frame);
+		}
+	}
+}
+
+void AFighterMultiplayerRunner::CheckConfirmedRound(int32 ConfirmedFrame)
+{
+	// A state saved at frame N is the result of the inputs up to frame N - 1. Later ones are still predicted,
+	// and a predicted round change could be rolled back.
+	const FRoundSample* Confirmed = nullptr;
+	for (const FRoundSample& Sample : RoundSamples)
+	{
+		if (Sample.Frame >= 0 && Sample.Frame <= ConfirmedFrame + 1 && (Confirmed == nullptr || Sample.Frame > Confirmed->Frame))
+			Confirmed = &Sample;
+	}
+
+	// Delay only changes between rounds. Round one waits for the intros, which gives GGPO time to measure ping.
+	if (Confirmed != nullptr && Confirmed->RoundCount > InputDelayRound && Confirmed->bIntroDone)
+	{
+		InputDelayRound = Confirmed->RoundCount;
+		UpdateInputDelay();
+	}
+}
+
+void AFighterMultiplayerRunner::UpdateInputDelay()
+{
+	int32 NewDelay = CVarNetInputDelay.GetValueOnGameThread();
+	const FGGPONetworkStats Stats = GetRemoteNetworkStats();
+	if (NewDelay < 0)
+	{
+		if (Stats.network.ping_jitter < 0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("Round %d: no ping measured yet, keeping input delay %d"),
+				InputDelayRound, InputDelay);
+			return;
 		}
+		// Before the first rollback, a full frame's cost is an upper bound for a resimulated one.
+		const double FrameCost = ResimMicroseconds > 0 ? ResimMicroseconds : FrameMicroseconds;
+		NewDelay = ChooseInputDelay(Stats.network.ping, Stats.network.ping_jitter, FrameCost, LoadMicroseconds);
 	}
+
+	UE_LOG(LogTemp, Display, TEXT("Round %d: input delay %d -> %d (ping %d ms, jitter %d ms, frame %.0f us, resim %.0f us, load %.0f us)"),
+		InputDelayRound, InputDelay, NewDelay, Stats.network.ping, Stats.network.ping_jitter,
+		FrameMicroseconds, ResimMicroseconds, LoadMicroseconds);
+	if (NewDelay == InputDelay)
+		return;
+	InputDelay = NewDelay;
+	for (int i = 0; i < 2; i++)
+	{
+		if (Players[i]->type == GGPO_PLAYERTYPE_LOCAL)
+			GGPONet::ggpo_set_frame_delay(ggpo, PlayerHandles[i], InputDelay);
+	}
+}
+
+int32 AFighterMultiplayerRunner::ChooseInputDelay(int32 Ping, int32 PingJitter, double FrameCost, double LoadCost)
+{
+	// Rollbacks can't go deeper than the prediction window.
+	const GGPOSessionLimits Limits = GetSessionLimits();
+	const int32 MaxRollback = FMath::Clamp(CVarNetMaxRollbackFrames.GetValueOnGameThread(), 0, Limits.prediction_frames);
+	const int32 MaxDelay = FMath::Max(0, CVarNetMaxInputDelay.GetValueOnGameThread());
+
+	// Frames a remote input is late by on arrival. Jitter is counted twice to cover most late packets.
+	const double FrameMs = OneFrame * 1000.0;
+	const int32 LateFrames = FMath::CeilToInt32((Ping * 0.5 + PingJitter * 2) / FrameMs);
+
+	// Rollback depth this machine can resimulate within its share of a frame.
+	int32 Rollback = MaxRollback;
+	if (FrameCost > 0)
+	{
+		const double Budget = CVarNetRollbackBudget.GetValueOnGameThread() * FrameMs * 1000.0 - LoadCost;
+		// Resimulating from the last save can add up to SaveInterval-1 frames to a rollback.
+		Rollback = FMath::Clamp(FMath::FloorToInt32(Budget / FrameCost) - (Limits.save_interval - 1), 0, MaxRollback);
+	}
+
+	// Whatever latency rollback can't hide is covered by delay instead.
+	return FMath::Clamp(LateFrames - Rollback, 0, MaxDelay);
+}
+
+GGPOSessionLimits AFighterMultiplayerRunner::GetSessionLimits()
+{
+	GGPOSessionLimits Limits = {};
+	Limits.prediction_frames = FMath::Clamp(CVarNetPredictionFrames.GetValueOnGameThread(), 1, GGPO_MAX_PREDICTION_FRAMES);
+	Limits.save_interval = FMath::Clamp(CVarNetSaveInterval.GetValueOnGameThread(), 1, GGPO_MAX_PREDICTION_FRAMES);
+	// Room for both clients' prediction windows, the frames since the last save and the largest delay either input
+	// delay CVar can ask for.
+	const int32 MaxDelay = FMath::Max3(0, CVarNetMaxInputDelay.GetValueOnGameThread(), CVarNetInputDelay.GetValueOnGameThread());
+	Limits.input_queue_length = FMath::Max(CVarNetInputQueueLength.GetValueOnGameThread(),
+		2 * Limits.prediction_frames + Limits.save_interval - 1 + MaxDelay + 1);
+	return Limits;
+}
+
+FString AFighterMultiplayerRunner::DumpTrace()
+{
+	const FString Directory = FPaths::ConvertRelativePathToFull(FPaths::ProfilingDir() / TEXT("Network"));
+	IFileManager::Get().MakeDirectory(*Directory, true);
+	const FString FileName = Directory / FString::Printf(TEXT("Trace_%s.ggpotrace"), *FDateTime::Now().ToString());
+	const GGPOErrorCode Result = GGPONet::ggpo_dump_trace(TCHAR_TO_UTF8(*FileName));
+	if (Result == GGPO_ERRORCODE_UNSUPPORTED)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("GGPO trace: nothing recorded, build GGPOUE4 with GGPO_TRACE=1"));
+		return FString();
+	}
+	if (!GGPO_SUCCEEDED(Result))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("GGPO trace: could not write %s"), *FileName);
+		return FString();
+	}
+	// The text is only rendered here, never while recording.
+	const FString TextFileName = FPaths::ChangeExtension(FileName, TEXT("txt"));
+	GGPONet::ggpo_render_trace(TCHAR_TO_UTF8(*FileName), TCHAR_TO_UTF8(*TextFileName));
+	UE_LOG(LogTemp, Display, TEXT("GGPO trace: wrote %s and %s"), *FileName, *TextFileName);
+	return FileName;
+}
+
+void AFighterMultiplayerRunner::UpdateFramePacing()
+{
+	FrameInterval = GetPacedFrameInterval(GetRemoteNetworkStats().timesync.frames_ahead);
+}
+
+FGGPONetworkStats AFighterMultiplayerRunner::GetRemoteNetworkStats() const
+{
+	FGGPONetworkStats Stats = {};
+	for (int i = 0; i < 2; i++)
+	{
+		if (Players[i]->type == GGPO_PLAYERTYPE_REMOTE)
+			GGPONet::ggpo_get_network_stats(ggpo, PlayerHandles[i], &Stats);
+	}
+	return Stats;
+}
+
+float AFighterMultiplayerRunner::GetPacedFrameInterval(float FramesAhead)
+{
+	// Only the client that is ahead slows down, as with frame skipping. Both clients tend to measure themselves slightly
+	// behind, and speeding up on that would run both games fast.
+	if (!CVarNetTimeSyncPacing.GetValueOnGameThread() || FramesAhead < PacingDeadZone)
+		return OneFrame;
+	const float MaxStretch = FMath::Clamp(CVarNetTimeSyncMaxStretch.GetValueOnGameThread(), 0.f, 0.1f);
+	return OneFrame * (1 + FMath::Min(FramesAhead, 1.f) * MaxStretch);
+}
+
+bool AFighterMultiplayerRunner::ShouldSkipFrames(int32 FramesAhead)
+{
+	return !CVarNetTimeSyncPacing.GetValueOnGameThread() || FramesAhead >= CVarNetTimeSyncSkipFrames.GetValueOnGameThread();
+}
+
+bool AFighterMultiplayerRunner::LoadNetworkConditions(const FString& FileName, const FString& Profile, int32 PlayerIndex, NetworkConditions& OutConditions)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *FileName) || !OutConditions.Load(TCHAR_TO_UTF8(*Text), TCHAR_TO_UTF8(*Profile)))
+	{
+		UE_LOG(LogTemp, Error, TEXT("No network condition profile %s in %s"), *Profile, *FileName);
+		return false;
+	}
+	// The two sides shouldn't lose and delay the same packets.
+	OutConditions.seed += PlayerIndex;
+	return true;
 }
 
 void AFighterMultiplayerRunner::Update(float DeltaTime)
 {
 	ElapsedTime += DeltaTime;
+	UpdateFramePacing();
 	
-	while (ElapsedTime >= OneFrame)
+	while (ElapsedTime >= FrameInterval)
 	{
 		if(MultipliedFramesAhead>0)
 		{
@@ -350,12 +657,13 @@ void AFighterMultiplayerRunner::Update(float DeltaTime)
 			MultipliedFramesAhead--;
 			if(ahead%TimesyncMultiplier==0)
 			{
+				Telemetry.AddSkippedFrame();
 				ElapsedTime=0;
 				break;
 			}
 		}
 		GgpoUpdate();
-		ElapsedTime -= OneFrame;
+		ElapsedTime -= FrameInterval;
 		// if(MultipliedFramesBehind>0)
 		// {
 		// 	MultipliedFramesBehind--;
@@ -5,10 +5,14 @@
 #include "CoreMinimal.h"
 #include "FighterLocalRunner.h"
 #include "include/ggponet.h"
+#include "NightSkyEngine/Battle/NetworkTelemetry.h"
+#include "RollbackBufferStore.h"
 #include "FighterMultiplayerRunner.generated.h"
 
 constexpr int TimesyncMultiplier =4;
 
+struct NetworkConditions;
+
 UCLASS()
 class NIGHTSKYENGINE_API AFighterMultiplayerRunner : public AFighterLocalRunner
 {
@@ -31,6 +35,8 @@ protected:
 	void __cdecl FreeBuffer(void* buffer);
 	bool __cdecl AdvanceFrameCallback(int32);
 	bool __cdecl OnEventCallback(GGPOEvent* info);
+	bool __cdecl MakeSnapshotCallback(unsigned char* buffer, int32 len, unsigned char** snapshot, int32* snapshot_len);
+	bool __cdecl LoadSnapshotCallback(unsigned char* snapshot, int32 len, int32 frame);
 
 public:
 	GGPOSession* ggpo = nullptr;
@@ -41,12 +47,60 @@ protected:
 	TArray<int> PlayerInputIndex;
 	void GgpoUpdate();
 
+	//Picks the local input delay at round boundaries
+	void UpdateInputDelay();
+	//Calls UpdateInputDelay once a confirmed frame is in a new round past its intros
+	void CheckConfirmedRound(int32 ConfirmedFrame);
+	//Stretches the frame interval while this client is ahead of the remote
+	void UpdateFramePacing();
+	//Gets GGPO's stats for the remote player
+	FGGPONetworkStats GetRemoteNetworkStats() const;
+
 	int MultipliedFramesAhead=0;
 	int MultipliedFramesBehind=0;
+	// Time between frames, stretched by time sync pacing.
+	float FrameInterval = OneFrame;
+	// Local input delay in frames, and the last round it was picked for.
+	int32 InputDelay = 2;
+	int32 InputDelayRound = 0;
+	// Round state of each saved frame. Rollbacks save the frames they resimulate again, so entries up to the confirmed frame are final.
+	struct FRoundSample
+	{
+		int32 Frame = -1;
+		int32 RoundCount = 0;
+		bool bIntroDone = false;
+	};
+	FRoundSample RoundSamples[2 * GGPO_MAX_PREDICTION_FRAMES + 4];
+	// Moving averages of the time to simulate a frame, resimulate one during a rollback and load a saved state.
+	double FrameMicroseconds = 0;
+	double ResimMicroseconds = 0;
+	double LoadMicroseconds = 0;
+	// Report a hash of the whole saved state to GGPO instead of the game state's lightweight checksum.
+	bool bChecksumFullState = false;
+	FNetworkTelemetry Telemetry;
+	// Packs the buffers GGPO keeps for each saved frame, sharing cold object data between them.
+	FRollbackBufferStore BufferStore;
 	
 public:	
 	virtual void Update(float DeltaTime) override;
 	class RpcConnectionManager* connectionManager;
+	// Wraps connectionManager when ns.Net.Conditions simulates a network. GGPO talks to this one when set.
+	class SimulatedConnectionManager* SimulatedConnection = nullptr;
+
+	//Input delay that keeps rollbacks within the configured depth and this machine's frame budget
+	static int32 ChooseInputDelay(int32 Ping, int32 PingJitter, double FrameCost, double LoadCost);
+	//Prediction window, input queue length and save interval from the ns.Net CVars
+	static GGPOSessionLimits GetSessionLimits();
+	//Writes GGPO's trace ring to Saved/Profiling/Network, raw and as text, and returns the raw file's name
+	static FString DumpTrace();
+	int32 GetInputDelay() const { return InputDelay; }
+	const FNetworkTelemetry& GetTelemetry() const { return Telemetry; }
+	//Frame interval for a client the given number of frames ahead of the remote
+	static float GetPacedFrameInterval(float FramesAhead);
+	//Whether a GGPO_EVENTCODE_TIMESYNC recommendation is large enough to skip whole frames
+	static bool ShouldSkipFrames(int32 FramesAhead);
+	//Reads a network condition profile, seeded for the given player
+	static bool LoadNetworkConditions(const FString& FileName, const FString& Profile, int32 PlayerIndex, NetworkConditions& OutConditions);
 
 	static int	fletcher32_checksum(short* data, size_t len);
 };
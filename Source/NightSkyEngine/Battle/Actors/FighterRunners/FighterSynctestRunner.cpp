@@ -2,8 +2,39 @@
 
 
 #include "FighterSynctestRunner.h"
+#include "EngineUtils.h"
 #include "NightSkyEngine/Battle/Actors/NightSkyGameState.h"
 
+static TAutoConsoleVariable<int32> CVarSyncTestCheckDistance(
+	TEXT("ns.SyncTest.CheckDistance"),
+	6,
+	TEXT("Frames the synctest runner simulates before rolling back and verifying them. Read when a battle starts."));
+
+static TAutoConsoleVariable<int32> CVarSyncTestRandomRollbacks(
+	TEXT("ns.SyncTest.RandomRollbacks"),
+	0,
+	TEXT("Stress mode: roll back a random 1 to N frames each check, up to the prediction window, and verify a hash of the whole state. 0 uses ns.SyncTest.CheckDistance."));
+
+static TAutoConsoleVariable<int32> CVarSyncTestSeed(
+	TEXT("ns.SyncTest.Seed"),
+	1,
+	TEXT("Seed for the rollback depths injected by ns.SyncTest.RandomRollbacks."));
+
+static FAutoConsoleCommandWithWorld CmdSyncTestStats(
+	TEXT("ns.SyncTest.Stats"),
+	TEXT("Prints rollbacks verified by the synctest runner, with a histogram of rollback time per depth."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (!World)
+			return;
+		for (TActorIterator<AFighterSynctestRunner> It(World); It; ++It)
+		{
+			It->LogSyncTestStats();
+			return;
+		}
+		UE_LOG(LogTemp, Display, TEXT("No synctest runner in this battle."));
+	}));
+
 // Sets default values
 AFighterSynctestRunner::AFighterSynctestRunner()
 {
@@ -18,7 +49,17 @@ void AFighterSynctestRunner::BeginPlay()
 {
 	AFighterLocalRunner::BeginPlay();
 	GGPOSessionCallbacks cb = CreateCallbacks();
-	GGPONet::ggpo_start_synctest(&ggpo, &cb, "", 2, sizeof(int), 6);
+	const int32 CheckDistance = FMath::Clamp(CVarSyncTestCheckDistance.GetValueOnGameThread(), 1, GGPO_DEFAULT_PREDICTION_FRAMES);
+	GGPONet::ggpo_start_synctest(&ggpo, &cb, "", 2, sizeof(int), CheckDistance);
+	const int32 RandomRollbacks = CVarSyncTestRandomRollbacks.GetValueOnGameThread();
+	if (RandomRollbacks > 0)
+	{
+		const int32 Seed = CVarSyncTestSeed.GetValueOnGameThread();
+		GGPONet::ggpo_set_synctest_random_rollbacks(ggpo, RandomRollbacks, Seed);
+		bChecksumFullState = true;
+		UE_LOG(LogTemp, Display, TEXT("Synctest stress mode: rollbacks of 1 to %d frames, seed %d"),
+			FMath::Min(RandomRollbacks, GGPO_DEFAULT_PREDICTION_FRAMES), Seed);
+	}
 	GGPONet::ggpo_set_disconnect_timeout(ggpo, 45000);
 	GGPONet::ggpo_set_disconnect_notify_start(ggpo, 15000);
 	for (int i = 0; i < 2; i++)
@@ -35,6 +76,12 @@ void AFighterSynctestRunner::BeginPlay()
 	GGPONet::ggpo_try_synchronize_local(ggpo);
 }
 
+void AFighterSynctestRunner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	LogSyncTestStats();
+	Super::EndPlay(EndPlayReason);
+}
+
 void AFighterSynctestRunner::Update(float DeltaTime)
 {
 	ElapsedTime += DeltaTime;
@@ -46,3 +93,34 @@ void AFighterSynctestRunner::Update(float DeltaTime)
 	GGPONet::ggpo_idle(ggpo,1);
 }
 
+void AFighterSynctestRunner::LogSyncTestStats() const
+{
+	GGPOSyncTestStats Stats;
+	if (!ggpo || GGPONet::ggpo_get_synctest_stats(ggpo, &Stats) != GGPO_OK || Stats.checks == 0)
+		return;
+
+	UE_LOG(LogTemp, Display, TEXT("Synctest: %d rollbacks verified, %d mismatched frames"), Stats.checks, Stats.failures);
+	for (int Depth = 1; Depth <= GGPO_MAX_PREDICTION_FRAMES; Depth++)
+	{
+		const auto& Entry = Stats.depth[Depth];
+		if (Entry.rollbacks == 0)
+			continue;
+		// One column per power of two microseconds, from the first to the last non-empty bucket.
+		int32 First = 0;
+		int32 Last = GGPO_SYNCTEST_HISTOGRAM_BUCKETS - 1;
+		while (Entry.buckets[First] == 0)
+			First++;
+		while (Entry.buckets[Last] == 0)
+			Last--;
+		FString Histogram;
+		for (int32 Bucket = First; Bucket <= Last; Bucket++)
+		{
+			if (Bucket == GGPO_SYNCTEST_HISTOGRAM_BUCKETS - 1)
+				Histogram += FString::Printf(TEXT(" >=%dus:%d"), 1 << Bucket, Entry.buckets[Bucket]);
+			else
+				Histogram += FString::Printf(TEXT(" <%dus:%d"), 2 << Bucket, Entry.buckets[Bucket]);
+		}
+		UE_LOG(LogTemp, Display, TEXT("  depth %d: %5d rollbacks, avg %8.1f us, max %6d us |%s"),
+			Depth, Entry.rollbacks, static_cast<double>(Entry.total_us) / Entry.rollbacks, Entry.max_us, *Histogram);
+	}
+}
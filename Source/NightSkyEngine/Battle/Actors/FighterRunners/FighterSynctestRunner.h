@@ -18,9 +18,12 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 
 	virtual void Update(float DeltaTime) override;
+	//logs verified rollbacks and a histogram of rollback time per depth
+	void LogSyncTestStats() const;
 
 };
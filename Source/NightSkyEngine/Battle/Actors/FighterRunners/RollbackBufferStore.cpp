@@ -0,0 +1,160 @@
+﻿#include "RollbackBufferStore.h"
+
+#include "Serialization/BufferArchive.h"
+#include "Serialization/MemoryReader.h"
+
+namespace
+{
+	/**
+	 * Start of every buffer. The hot data of each active object and of each player follows, then the blueprint data.
+	 */
+	struct FRollbackBufferHeader
+	{
+		uint32 ObjColdVersion[MaxBattleObjects + MaxPlayerObjects];
+		bool ObjActive[MaxBattleObjects];
+		uint8 CharBuffer[MaxPlayerObjects][SizeOfPlayerObject];
+		uint8 BattleStateBuffer[SizeOfBattleState];
+		int32 ObjCount;
+		int32 BPBytes;
+	};
+
+	bool IsSaved(const bool (&ObjActive)[MaxBattleObjects], int32 Index)
+	{
+		return Index >= MaxBattleObjects || ObjActive[Index];
+	}
+}
+
+unsigned char* FRollbackBufferStore::SaveBuffer(const FRollbackData& RollbackData, FBPRollbackData& BPRollbackData,
+	int32& OutLen, uint32& OutCopiedBytes)
+{
+	FBufferArchive Ar(false);
+	Ar.SetWantBinaryPropertySerialization(true);
+	BPRollbackData.Serialize(Ar);
+
+	int32 ObjCount = MaxPlayerObjects;
+	for (const bool bActive : RollbackData.ObjActive)
+	{
+		ObjCount += bActive;
+	}
+	OutLen = sizeof(FRollbackBufferHeader) + ObjCount * SizeOfBattleObjectHot + Ar.Num();
+	unsigned char* Buffer = new unsigned char[OutLen];
+	OutCopiedBytes = OutLen;
+
+	FRollbackBufferHeader* Header = reinterpret_cast<FRollbackBufferHeader*>(Buffer);
+	FMemory::Memcpy(Header->ObjColdVersion, RollbackData.ObjColdVersion, sizeof(Header->ObjColdVersion));
+	FMemory::Memcpy(Header->ObjActive, RollbackData.ObjActive, sizeof(Header->ObjActive));
+	FMemory::Memcpy(Header->CharBuffer, RollbackData.CharBuffer, sizeof(Header->CharBuffer));
+	FMemory::Memcpy(Header->BattleStateBuffer, RollbackData.BattleStateBuffer, sizeof(Header->BattleStateBuffer));
+	Header->ObjCount = ObjCount;
+	Header->BPBytes = Ar.Num();
+
+	unsigned char* Hot = Buffer + sizeof(FRollbackBufferHeader);
+	for (int32 i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	{
+		if (!IsSaved(RollbackData.ObjActive, i))
+			continue;
+		FMemory::Memcpy(Hot, RollbackData.ObjBuffer[i], SizeOfBattleObjectHot);
+		Hot += SizeOfBattleObjectHot;
+
+		FColdBlock* Block = FindColdBlock(i, RollbackData.ObjColdVersion[i]);
+		if (!Block)
+		{
+			Block = &AddColdBlock(i, RollbackData.ObjColdVersion[i]);
+			FMemory::Memcpy(Block->Data, RollbackData.ObjBuffer[i] + SizeOfBattleObjectHot, SizeOfBattleObjectCold);
+			OutCopiedBytes += SizeOfBattleObjectCold;
+		}
+		Block->Refs++;
+	}
+	FMemory::Memcpy(Hot, Ar.GetData(), Ar.Num());
+	return Buffer;
+}
+
+bool FRollbackBufferStore::LoadBuffer(const unsigned char* Buffer, int32 Len, FRollbackData& OutRollbackData,
+	FBPRollbackData& OutBPRollbackData) const
+{
+	const FRollbackBufferHeader* Header = reinterpret_cast<const FRollbackBufferHeader*>(Buffer);
+	check(Len == sizeof(FRollbackBufferHeader) + Header->ObjCount * SizeOfBattleObjectHot + Header->BPBytes);
+	FMemory::Memcpy(OutRollbackData.ObjActive, Header->ObjActive, sizeof(Header->ObjActive));
+	FMemory::Memcpy(OutRollbackData.CharBuffer, Header->CharBuffer, sizeof(Header->CharBuffer));
+	FMemory::Memcpy(OutRollbackData.BattleStateBuffer, Header->BattleStateBuffer, sizeof(Header->BattleStateBuffer));
+
+	bool bFound = true;
+	const unsigned char* Hot = Buffer + sizeof(FRollbackBufferHeader);
+	for (int32 i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	{
+		if (!IsSaved(Header->ObjActive, i))
+			continue;
+		FMemory::Memcpy(OutRollbackData.ObjBuffer[i], Hot, SizeOfBattleObjectHot);
+		Hot += SizeOfBattleObjectHot;
+
+		// Versions label an object's cold data, so a matching one means it's already there.
+		const uint32 Version = Header->ObjColdVersion[i];
+		if (OutRollbackData.ObjColdVersion[i] == Version)
+			continue;
+		if (const FColdBlock* Block = FindColdBlock(i, Version))
+		{
+			FMemory::Memcpy(OutRollbackData.ObjBuffer[i] + SizeOfBattleObjectHot, Block->Data, SizeOfBattleObjectCold);
+			OutRollbackData.ObjColdVersion[i] = Version;
+		}
+		else
+		{
+			bFound = false;
+		}
+	}
+
+	const TArray<uint8> BPArray(Hot, Header->BPBytes);
+	FMemoryReader Ar(BPArray);
+	Ar.SetWantBinaryPropertySerialization(true);
+	OutBPRollbackData.Serialize(Ar);
+	OutRollbackData.SizeOfBPRollbackData = Header->BPBytes;
+	return bFound;
+}
+
+void FRollbackBufferStore::FreeBuffer(unsigned char* Buffer)
+{
+	const FRollbackBufferHeader* Header = reinterpret_cast<const FRollbackBufferHeader*>(Buffer);
+	for (int32 i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	{
+		if (!IsSaved(Header->ObjActive, i))
+			continue;
+		FColdBlock* Block = FindColdBlock(i, Header->ObjColdVersion[i]);
+		check(Block && Block->Refs > 0);
+		// A free block keeps its data, in case a rollback brings the object back to this version.
+		Block->Refs--;
+	}
+	delete[] Buffer;
+}
+
+uint32 FRollbackBufferStore::GetUnsharedCopiedBytes(const unsigned char* Buffer)
+{
+	// The whole FRollbackData was copied out of the game state, then into the buffer after the blueprint data.
+	const FRollbackBufferHeader* Header = reinterpret_cast<const FRollbackBufferHeader*>(Buffer);
+	return 2 * sizeof(FRollbackData) + Header->BPBytes;
+}
+
+FRollbackBufferStore::FColdBlock* FRollbackBufferStore::FindColdBlock(int32 Index, uint32 Version) const
+{
+	for (const TUniquePtr<FColdBlock>& Block : ColdBlocks[Index])
+	{
+		if (Block->Version == Version)
+			return Block.Get();
+	}
+	return nullptr;
+}
+
+FRollbackBufferStore::FColdBlock& FRollbackBufferStore::AddColdBlock(int32 Index, uint32 Version)
+{
+	FColdBlock* Free = nullptr;
+	for (const TUniquePtr<FColdBlock>& Block : ColdBlocks[Index])
+	{
+		if (Block->Refs == 0)
+		{
+			Free = Block.Get();
+			break;
+		}
+	}
+	if (!Free)
+		Free = ColdBlocks[Index].Add_GetRef(MakeUnique<FColdBlock>()).Get();
+	Free->Version = Version;
+	return *Free;
+}
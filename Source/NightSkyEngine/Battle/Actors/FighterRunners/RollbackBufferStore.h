@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "NightSkyEngine/Battle/Actors/NightSkyGameState.h"
+
+/**
+ * @brief Packs saved rollback data into the buffers GGPO keeps, and unpacks them on a rollback.
+ *
+ * A buffer holds the battle state, player data, the hot data of each active object and the blueprint data. Cold object
+ * data is kept here, one block per object and ABattleObject::ColdVersion, and shared by every buffer saved while it
+ * stayed the same. It's only copied when it was written since the last save, and on a rollback only for objects whose
+ * cold data differs from the buffer's.
+ *
+ * Buffers only mean something to the store that saved them. Free them with FreeBuffer.
+ */
+class NIGHTSKYENGINE_API FRollbackBufferStore
+{
+public:
+	/**
+	 * Packs saved rollback data into a new buffer.
+	 *
+	 * @param RollbackData The game state's save to pack.
+	 * @param BPRollbackData The blueprint data saved with it.
+	 * @param OutLen The length of the buffer.
+	 * @param OutCopiedBytes Bytes copied to make the buffer, including cold blocks that were copied.
+	 * @return The buffer.
+	 */
+	unsigned char* SaveBuffer(const FRollbackData& RollbackData, FBPRollbackData& BPRollbackData, int32& OutLen, uint32& OutCopiedBytes);
+
+	/**
+	 * Unpacks a buffer into rollback data. Cold data is copied only for objects whose saved version differs.
+	 *
+	 * @return Whether every cold block the buffer refers to was found.
+	 */
+	bool LoadBuffer(const unsigned char* Buffer, int32 Len, FRollbackData& OutRollbackData, FBPRollbackData& OutBPRollbackData) const;
+
+	void FreeBuffer(unsigned char* Buffer);
+
+	// Bytes copied to make a buffer that held a whole FRollbackData, the way buffers were made before cold blocks were shared.
+	static uint32 GetUnsharedCopiedBytes(const unsigned char* Buffer);
+
+private:
+	/** Cold rollback data of one object at one version. */
+	struct FColdBlock
+	{
+		uint32 Version = 0;
+		// Buffers holding this block. A block no buffer holds is reused for the next version saved.
+		int32 Refs = 0;
+		uint8 Data[SizeOfBattleObjectCold];
+	};
+
+	FColdBlock* FindColdBlock(int32 Index, uint32 Version) const;
+	FColdBlock& AddColdBlock(int32 Index, uint32 Version); //reuses a block no buffer holds if there is one
+
+	TArray<TUniquePtr<FColdBlock>> ColdBlocks[MaxBattleObjects + MaxPlayerObjects];
+};
@@ -4,6 +4,8 @@
 #include "NightSkyGameState.h"
 #include "LevelSequenceActor.h"
 #include "LevelSequencePlayer.h"
+#include "MovieScene.h"
+#include "MovieSceneTimeHelpers.h"
 #include "NightSkyPlayerController.h"
 #include "ParticleManager.h"
 #include "Camera/CameraActor.h"
@@ -11,9 +13,20 @@
 #include "Camera/CameraComponent.h"
 #include "Components/AudioComponent.h"
 #include "Components/SlateWrapperTypes.h"
+#include "DisplayDebugHelpers.h"
+#include "Engine/Canvas.h"
 #include "FighterRunners/FighterReplayRunner.h"
 #include "FighterRunners/FighterSynctestRunner.h"
+#include "GameFramework/HUD.h"
 #include "Kismet/GameplayStatics.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/SoftObjectPath.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+#include "NightSkyEngine/Battle/BattleProfiler.h"
 #include "NightSkyEngine/Battle/Globals.h"
 #include "NightSkyEngine/Data/BattleExtensionData.h"
 #include "NightSkyEngine/Miscellaneous/FighterRunners.h"
@@ -21,6 +34,111 @@
 #include "NightSkyEngine/UI/NightSkyBattleHudActor.h"
 #include "NightSkyEngine/UI/NightSkyBattleWidget.h"
 
+static TAutoConsoleVariable<int32> CVarParallelCollision(
+	TEXT("ns.Collision.Parallel"),
+	1,
+	TEXT("1: detect hit and clash overlaps in parallel, then resolve serially. 0: use the original serial loop."));
+
+// Below this many active objects, spreading detection across threads costs more than it saves.
+static constexpr int32 MinObjectsForParallelCollision = 32;
+
+DECLARE_STATS_GROUP(TEXT("NightSky Rollback"), STATGROUP_NightSkyRollback, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Snapshots Saved"), STAT_SnapshotSaves, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Battle State Bytes"), STAT_SnapshotBattleStateBytes, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Player Bytes"), STAT_SnapshotPlayerBytes, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Object Bytes"), STAT_SnapshotObjectBytes, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("BP State Bytes"), STAT_SnapshotBPStateBytes, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Extension Bytes"), STAT_SnapshotExtensionBytes, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("GGPO Buffer Bytes"), STAT_SnapshotGGPOBufferBytes, STATGROUP_NightSkyRollback);
+DECLARE_DWORD_COUNTER_STAT(TEXT("GGPO Buffer Copied Bytes"), STAT_SnapshotGGPOCopiedBytes, STATGROUP_NightSkyRollback);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Copy (ms)"), STAT_SnapshotCopyTime, STATGROUP_NightSkyRollback);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Serialize (ms)"), STAT_SnapshotSerializeTime, STATGROUP_NightSkyRollback);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("GGPO Buffer (ms)"), STAT_SnapshotGGPOBufferTime, STATGROUP_NightSkyRollback);
+
+static FAutoConsoleCommandWithWorld CmdRollbackSnapshotStats(
+	TEXT("ns.Rollback.SnapshotStats"),
+	TEXT("Prints the bytes and time spent per saved rollback snapshot by category, with and without the hot/cold object split."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](const UWorld* World)
+	{
+		const ANightSkyGameState* GameState = World ? World->GetGameState<ANightSkyGameState>() : nullptr;
+		if (!GameState || GameState->SnapshotStats.Frames == 0)
+		{
+			UE_LOG(LogTemp, Display, TEXT("No rollback snapshots saved yet."));
+			return;
+		}
+		GameState->LogSnapshotStats();
+	}));
+
+uint32 FRollbackSnapshotFrame::GetTotalBytes() const
+{
+	uint32 Total = 0;
+	for (const uint32 CategoryBytes : Bytes)
+	{
+		Total += CategoryBytes;
+	}
+	return Total;
+}
+
+void FRollbackSnapshotStats::AddSave()
+{
+	Frames++;
+	for (int32 i = 0; i < RollbackSnapshotCategoryCount; i++)
+	{
+		TotalBytes[i] += Current.Bytes[i];
+		Max.Bytes[i] = FMath::Max(Max.Bytes[i], Current.Bytes[i]);
+	}
+	TotalCopyCycles += Current.CopyCycles;
+	TotalSerializeCycles += Current.SerializeCycles;
+	Max.CopyCycles = FMath::Max(Max.CopyCycles, Current.CopyCycles);
+	Max.SerializeCycles = FMath::Max(Max.SerializeCycles, Current.SerializeCycles);
+
+	INC_DWORD_STAT(STAT_SnapshotSaves);
+	INC_DWORD_STAT_BY(STAT_SnapshotBattleStateBytes, Current.Bytes[static_cast<int32>(ERollbackSnapshotCategory::BattleState)]);
+	INC_DWORD_STAT_BY(STAT_SnapshotPlayerBytes, Current.Bytes[static_cast<int32>(ERollbackSnapshotCategory::Players)]);
+	INC_DWORD_STAT_BY(STAT_SnapshotObjectBytes, Current.Bytes[static_cast<int32>(ERollbackSnapshotCategory::Objects)]);
+	INC_DWORD_STAT_BY(STAT_SnapshotBPStateBytes, Current.Bytes[static_cast<int32>(ERollbackSnapshotCategory::BPState)]);
+	INC_DWORD_STAT_BY(STAT_SnapshotExtensionBytes, Current.Bytes[static_cast<int32>(ERollbackSnapshotCategory::Extensions)]);
+	INC_FLOAT_STAT_BY(STAT_SnapshotCopyTime, FPlatformTime::ToMilliseconds(Current.CopyCycles));
+	INC_FLOAT_STAT_BY(STAT_SnapshotSerializeTime, FPlatformTime::ToMilliseconds(Current.SerializeCycles));
+}
+
+void FRollbackSnapshotStats::AddGGPOBuffer(uint32 InBytes, uint32 InCopiedBytes, uint32 InUnsharedCopiedBytes, uint32 InCycles)
+{
+	Current.GGPOBufferBytes = InBytes;
+	Current.GGPOCopiedBytes = InCopiedBytes;
+	Current.GGPOBufferCycles = InCycles;
+	TotalGGPOBufferBytes += InBytes;
+	TotalGGPOCopiedBytes += InCopiedBytes;
+	TotalGGPOUnsharedCopiedBytes += InUnsharedCopiedBytes;
+	TotalGGPOBufferCycles += InCycles;
+	Max.GGPOBufferBytes = FMath::Max(Max.GGPOBufferBytes, InBytes);
+	Max.GGPOCopiedBytes = FMath::Max(Max.GGPOCopiedBytes, InCopiedBytes);
+	Max.GGPOBufferCycles = FMath::Max(Max.GGPOBufferCycles, InCycles);
+
+	INC_DWORD_STAT_BY(STAT_SnapshotGGPOBufferBytes, InBytes);
+	INC_DWORD_STAT_BY(STAT_SnapshotGGPOCopiedBytes, InCopiedBytes);
+	INC_FLOAT_STAT_BY(STAT_SnapshotGGPOBufferTime, FPlatformTime::ToMilliseconds(InCycles));
+}
+
+const TCHAR* FRollbackSnapshotStats::GetCategoryName(ERollbackSnapshotCategory Category)
+{
+	switch (Category)
+	{
+	case ERollbackSnapshotCategory::BattleState:
+		return TEXT("BattleState");
+	case ERollbackSnapshotCategory::Players:
+		return TEXT("Players");
+	case ERollbackSnapshotCategory::Objects:
+		return TEXT("Objects");
+	case ERollbackSnapshotCategory::BPState:
+		return TEXT("BPState");
+	case ERollbackSnapshotCategory::Extensions:
+		return TEXT("Extensions");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
 void FBPRollbackData::Serialize(FArchive& Ar)
 {
 	Ar << PlayerData;
@@ -33,6 +151,7 @@ ANightSkyGameState::ANightSkyGameState()
 {
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+	Presentation = MakeUnique<FBattleScenePresentation>(this);
 }
 
 // Called when the game starts or when spawned
@@ -59,11 +178,21 @@ void ANightSkyGameState::BeginPlay()
 	SequenceCameraActor->SetActorLocation(NewCameraLocation);
 	SequenceCameraActor->SetActorRotation(CameraRotation);
 	
+	ShowDebugHandle = AHUD::OnShowDebugInfo.AddUObject(this, &ANightSkyGameState::ShowNetworkDebug);
 	Init();
 }
 
+void ANightSkyGameState::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	AHUD::OnShowDebugInfo.Remove(ShowDebugHandle);
+	Super::EndPlay(EndPlayReason);
+}
+
 void ANightSkyGameState::Init()
 {
+#if NS_BATTLE_PROFILER
+	FBattleProfiler::Get().BeginMatch();
+#endif
 	BattleState.RandomManager = GameInstance->BattleData.Random;
 	
 	for (int i = 0; i < MaxRollbackFrames; i++)
@@ -150,7 +279,7 @@ void ANightSkyGameState::Init()
 		Players[i]->ObjNumber = i + MaxBattleObjects;
 		SortedObjects[i] = Players[i];
 
-		if (i >= MaxPlayerObjects / 2 && GameInstance->IsCPUBattle)
+		if (i >= MaxPlayerObjects / 2 && GameInstance->IsCPUBattle && !bHeadless)
 		{
 			Players[i]->SpawnDefaultController();
 		}
@@ -174,23 +303,27 @@ void ANightSkyGameState::Init()
 	FActorSpawnParameters SpawnParameters;
 	SpawnParameters.Owner = GetOwner();
 
-	switch (GameInstance->FighterRunner)
+	// Headless battles have no runner; UHeadlessSimulation steps them directly.
+	if (!bHeadless)
 	{
-	case LocalPlay:
-		FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterLocalRunner::StaticClass(),SpawnParameters);
-		break;
-	case Multiplayer:
-		if (GameInstance->IsReplay)
-			FighterRunner = GetWorld()->SpawnActor<AFighterReplayRunner>(AFighterReplayRunner::StaticClass(),SpawnParameters);
-		else
-			FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterMultiplayerRunner::StaticClass(),SpawnParameters);
-		break;
-	case SyncTest:
-		FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterSynctestRunner::StaticClass(),SpawnParameters);
-		break;
-	default:
-		FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterLocalRunner::StaticClass(),SpawnParameters);
-		break;
+		switch (GameInstance->FighterRunner)
+		{
+		case LocalPlay:
+			FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterLocalRunner::StaticClass(),SpawnParameters);
+			break;
+		case Multiplayer:
+			if (GameInstance->IsReplay)
+				FighterRunner = GetWorld()->SpawnActor<AFighterReplayRunner>(AFighterReplayRunner::StaticClass(),SpawnParameters);
+			else
+				FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterMultiplayerRunner::StaticClass(),SpawnParameters);
+			break;
+		case SyncTest:
+			FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterSynctestRunner::StaticClass(),SpawnParameters);
+			break;
+		default:
+			FighterRunner = GetWorld()->SpawnActor<AFighterLocalRunner>(AFighterLocalRunner::StaticClass(),SpawnParameters);
+			break;
+		}
 	}
 	
 	BattleState.RoundFormat = GameInstance->BattleData.RoundFormat;
@@ -200,6 +333,20 @@ void ANightSkyGameState::Init()
 	PlayIntros();
 }
 
+void ANightSkyGameState::InitHeadless(UNightSkyGameInstance* InGameInstance)
+{
+	bHeadless = true;
+	Presentation = MakeUnique<FBattlePresentation>();
+	GameInstance = InGameInstance;
+	Init();
+}
+
+int32 ANightSkyGameState::StepHeadless(int32 Input1, int32 Input2)
+{
+	UpdateGameState(Input1, Input2, false);
+	return CreateChecksum();
+}
+
 void ANightSkyGameState::PlayIntros()
 {
 	if (GameInstance->IsTraining) {
@@ -252,8 +399,7 @@ void ANightSkyGameState::RoundInit()
 		CameraRotation.Yaw -= 90;
 
 		BattleState.PrevCameraPosition = NewCameraLocation;
-		CameraActor->SetActorLocation(NewCameraLocation);
-		CameraActor->SetActorRotation(CameraRotation);
+		Presentation->RoundInit(NewCameraLocation, CameraRotation);
 
 		CallBattleExtension("RoundInit");
 	}
@@ -307,8 +453,7 @@ void ANightSkyGameState::RoundInit()
 		CameraRotation.Yaw -= 90;
 
 		BattleState.PrevCameraPosition = NewCameraLocation;
-		CameraActor->SetActorLocation(NewCameraLocation);
-		CameraActor->SetActorRotation(CameraRotation);
+		Presentation->RoundInit(NewCameraLocation, CameraRotation);
 
 		CallBattleExtension("RoundInit");
 	}
@@ -345,10 +490,12 @@ void ANightSkyGameState::Tick(float DeltaTime)
 
 void ANightSkyGameState::UpdateGameState(int32 Input1, int32 Input2, bool bShouldResimulate)
 {
-	if (bShouldResimulate == false && bIsResimulating == true) RollbackStartAudio(BattleState.FrameNumber);
+	NS_BATTLE_PROFILE_FRAME(BattleState.FrameNumber + 1, bShouldResimulate);
+	
+	const bool bResimulationEnded = bShouldResimulate == false && bIsResimulating == true;
 	bIsResimulating = bShouldResimulate;
 	LocalFrame++;
-	ParticleManager->UpdateParticles();
+	Presentation->FrameStarted(bResimulationEnded);
 
 	if (BattleState.CurrentIntroSide != INT_None)
 	{
@@ -381,7 +528,10 @@ void ANightSkyGameState::UpdateGameState(int32 Input1, int32 Input2, bool bShoul
 	if (BattleState.CurrentSequenceTime != -1)
 		BattleState.CurrentSequenceTime++;
 	
-	SortObjects();
+	{
+		NS_BATTLE_PROFILE_PHASE(SortObjects);
+		SortObjects();
+	}
 
 	BattleState.MainPlayer[0]->Inputs = Input1;
 	BattleState.MainPlayer[1]->Inputs = Input2;
@@ -400,28 +550,34 @@ void ANightSkyGameState::UpdateGameState(int32 Input1, int32 Input2, bool bShoul
 		}
 	}
 
-	HandleHitCollision();
+	{
+		NS_BATTLE_PROFILE_PHASE(HitCollision);
+		HandleHitCollision();
+	}
 	
-	for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
 	{
-		if (i == BattleState.ActiveObjectCount)
-			break;
-		if (((BattleState.SuperFreezeSelfDuration && SortedObjects[i] == BattleState.SuperFreezeCaller)
-			|| (BattleState.SuperFreezeDuration && SortedObjects[i] != BattleState.SuperFreezeCaller))
-			&& (SortedObjects[i]->MiscFlags & MISC_IgnoreSuperFreeze) == 0)
+		NS_BATTLE_PROFILE_PHASE(ObjectUpdate);
+		for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
 		{
-			if (SortedObjects[i]->IsPlayer)
+			if (i == BattleState.ActiveObjectCount)
+				break;
+			if (((BattleState.SuperFreezeSelfDuration && SortedObjects[i] == BattleState.SuperFreezeCaller)
+				|| (BattleState.SuperFreezeDuration && SortedObjects[i] != BattleState.SuperFreezeCaller))
+				&& (SortedObjects[i]->MiscFlags & MISC_IgnoreSuperFreeze) == 0)
 			{
-				if (SortedObjects[i]->Player->PlayerFlags & PLF_IsStunned)
-					SortedObjects[i]->Player->HandleBufferedState();
-				SortedObjects[i]->GetBoxes();
-				SortedObjects[i]->Player->StoredInputBuffer.Update(SortedObjects[i]->Player->Inputs);
-				SortedObjects[i]->Player->HandleStateMachine(true); //handle state transitions
+				if (SortedObjects[i]->IsPlayer)
+				{
+					if (SortedObjects[i]->Player->PlayerFlags & PLF_IsStunned)
+						SortedObjects[i]->Player->HandleBufferedState();
+					SortedObjects[i]->GetBoxes();
+					SortedObjects[i]->Player->StoredInputBuffer.Update(SortedObjects[i]->Player->Inputs);
+					SortedObjects[i]->Player->HandleStateMachine(true); //handle state transitions
+				}
+				SortedObjects[i]->UpdateVisuals();
+				continue;
 			}
-			SortedObjects[i]->UpdateVisuals();
-			continue;
+			SortedObjects[i]->Update();
 		}
-		SortedObjects[i]->Update();
 	}
 
 	if (BattleState.SuperFreezeSelfDuration == 1)
@@ -442,15 +598,17 @@ void ANightSkyGameState::UpdateGameState(int32 Input1, int32 Input2, bool bShoul
 	if (BattleState.SuperFreezeSelfDuration) BattleState.SuperFreezeSelfDuration--;
 	if (BattleState.SuperFreezeDuration) BattleState.SuperFreezeDuration--;
 	
-	HandlePushCollision();
-	SetScreenBounds();
-	SetStageBounds();
-	ParticleManager->PauseParticles();
+	{
+		NS_BATTLE_PROFILE_PHASE(PushCollision);
+		HandlePushCollision();
+		SetScreenBounds();
+		SetStageBounds();
+	}
+	Presentation->FrameSimulated();
 	if (GameInstance->FighterRunner == Multiplayer && !GameInstance->IsReplay)
 	{
 		GameInstance->UpdateReplay(Input1, Input2);
 	}
-	CollisionView();
 	
 	const FGGPONetworkStats Network = GetNetworkStats();
 	NetworkStats.Ping = Network.network.ping;
@@ -464,7 +622,10 @@ void ANightSkyGameState::UpdateGameState(int32 Input1, int32 Input2, bool bShoul
 	else
 		NetworkStats.RollbackFrames = abs(LocalFramesBehind) + abs(RemoteFramesBehind);
 	
-	CallBattleExtension("Update");
+	{
+		NS_BATTLE_PROFILE_PHASE(BattleExtensions);
+		CallBattleExtension("Update");
+	}
 	
 	for (int i = 0; i < 2; i++)
 	{
@@ -482,10 +643,12 @@ void ANightSkyGameState::UpdateGameState(int32 Input1, int32 Input2, bool bShoul
 		}
 	}
 	
-	// these aren't strictly game state related, but tying them to game state update makes things better
 	UpdateCamera();
-	UpdateHUD();
 	ManageAudio();
+	{
+		NS_BATTLE_PROFILE_PHASE(Presentation);
+		Presentation->FrameEnded();
+	}
 	
 	HandleRoundWin();
 }
@@ -532,29 +695,237 @@ void ANightSkyGameState::HandlePushCollision() const
 	}
 }
 
-void ANightSkyGameState::HandleHitCollision() const
+void ANightSkyGameState::HandleHitCollision()
 {
-	for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	if (!CVarParallelCollision.GetValueOnGameThread())
 	{
-		if (i == BattleState.ActiveObjectCount)
-			break;
+		for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+		{
+			if (i == BattleState.ActiveObjectCount)
+				break;
+			for (int j = 0; j < MaxPlayerObjects; j++)
+			{
+				if (i != j && SortedObjects[j]->Player->PlayerFlags & PLF_IsOnScreen)
+				{
+					SortedObjects[i]->HandleHitCollision(Cast<APlayerObject>(SortedObjects[j]));
+				}
+			}
+			for (int j = 0; j < MaxBattleObjects + MaxPlayerObjects; j++)
+			{
+				if (i != j)
+				{
+					SortedObjects[i]->HandleClashCollision(SortedObjects[j]);
+				}
+			}
+		}
+		return;
+	}
+
+	// Detection only reads object state, so it runs across worker threads. Resolution mutates
+	// attacker and defender, so it runs serially in the same order as the loop above.
+	DetectCollisionEvents();
+
+	CollisionDirty.Init(false, MaxBattleObjects + MaxPlayerObjects);
+	CollisionDirtyIndices.Reset();
+	for (int i = 0; i < BattleState.ActiveObjectCount; i++)
+	{
+		ResolveCollisionEvents(i);
+	}
+}
+
+void ANightSkyGameState::DetectCollisionEvents()
+{
+	// Objects are sorted just before this, so the inactive ones all come after ActiveObjectCount.
+	for (int i = 0; i < BattleState.ActiveObjectCount; i++)
+	{
+		CollisionSignatures[i] = GetCollisionSignature(i);
+	}
+	CollisionSpawnedObjectCount = SpawnedObjectCount;
+
+	const int32 ActiveObjectCount = BattleState.ActiveObjectCount;
+	ParallelFor(ActiveObjectCount, [this](int32 i)
+	{
+		TArray<FCollisionEvent>& Events = CollisionEvents[i];
+		Events.Reset();
+
+		const ABattleObject* Attacker = SortedObjects[i];
+		if (!(Attacker->AttackFlags & ATK_IsAttacking && Attacker->AttackFlags & ATK_HitActive))
+			return;
+
 		for (int j = 0; j < MaxPlayerObjects; j++)
 		{
 			if (i != j && SortedObjects[j]->Player->PlayerFlags & PLF_IsOnScreen)
 			{
-				SortedObjects[i]->HandleHitCollision(Cast<APlayerObject>(SortedObjects[j]));
+				const APlayerObject* Target = Cast<APlayerObject>(SortedObjects[j]);
+				FCollisionEvent Event;
+				if (Attacker->CanHitPlayer(Target) && Attacker->FindHitOverlap(Target, Event.Hitbox))
+				{
+					Event.Type = FCollisionEvent::Hit;
+					Event.Defender = j;
+					Events.Add(Event);
+				}
 			}
 		}
 		for (int j = 0; j < MaxBattleObjects + MaxPlayerObjects; j++)
 		{
-			if (i != j)
+			FCollisionEvent Event;
+			if (i != j && Attacker->CanClash(SortedObjects[j])
+				&& Attacker->FindClashOverlap(SortedObjects[j], Event.Hitbox, Event.OtherHitbox))
 			{
-				SortedObjects[i]->HandleClashCollision(SortedObjects[j]);
+				Event.Type = FCollisionEvent::Clash;
+				Event.Defender = j;
+				Events.Add(Event);
 			}
 		}
+	}, ActiveObjectCount < MinObjectsForParallelCollision ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+void ANightSkyGameState::ResolveCollisionEvents(int32 Attacker)
+{
+	ABattleObject* AttackerObj = SortedObjects[Attacker];
+	const TArray<FCollisionEvent>& Events = CollisionEvents[Attacker];
+	int32 EventIndex = 0;
+
+	// Detected events are only trusted while neither object has changed since detection.
+	// Pairs with a changed object are checked again against current state, in the same order as the serial loop.
+	for (int j = 0; j < MaxPlayerObjects; j++)
+	{
+		if (CollisionDirty[Attacker])
+		{
+			HandleHitCollisionSerial(Attacker, j, 0);
+			return;
+		}
+		const FCollisionEvent* Event = nullptr;
+		if (EventIndex < Events.Num() && Events[EventIndex].Type == FCollisionEvent::Hit && Events[EventIndex].Defender == j)
+		{
+			Event = &Events[EventIndex++];
+		}
+		if (CollisionDirty[j])
+		{
+			if (Attacker != j && SortedObjects[j]->Player->PlayerFlags & PLF_IsOnScreen)
+			{
+				AttackerObj->HandleHitCollision(Cast<APlayerObject>(SortedObjects[j]));
+				UpdateCollisionDirty();
+			}
+		}
+		else if (Event)
+		{
+			AttackerObj->ResolveHit(Cast<APlayerObject>(SortedObjects[j]), Event->Hitbox);
+			UpdateCollisionDirty();
+		}
+	}
+
+	// Clashes only visit defenders with a detected event or a changed state.
+	int32 j = 0;
+	while (true)
+	{
+		if (CollisionDirty[Attacker])
+		{
+			HandleHitCollisionSerial(Attacker, MaxPlayerObjects, j);
+			return;
+		}
+		const int32 NextEvent = EventIndex < Events.Num() ? Events[EventIndex].Defender : MaxBattleObjects + MaxPlayerObjects;
+		const int32 DirtyIndex = Algo::LowerBound(CollisionDirtyIndices, j);
+		const int32 NextDirty = DirtyIndex < CollisionDirtyIndices.Num() ? CollisionDirtyIndices[DirtyIndex] : MaxBattleObjects + MaxPlayerObjects;
+		j = FMath::Min(NextEvent, NextDirty);
+		if (j >= MaxBattleObjects + MaxPlayerObjects)
+			return;
+
+		const FCollisionEvent* Event = nullptr;
+		if (NextEvent == j)
+		{
+			Event = &Events[EventIndex++];
+		}
+		if (CollisionDirty[j])
+		{
+			if (Attacker != j)
+			{
+				AttackerObj->HandleClashCollision(SortedObjects[j]);
+				UpdateCollisionDirty();
+			}
+		}
+		else
+		{
+			AttackerObj->ResolveClash(SortedObjects[j], Event->Hitbox, Event->OtherHitbox);
+			UpdateCollisionDirty();
+		}
+		j++;
+	}
+}
+
+void ANightSkyGameState::HandleHitCollisionSerial(int32 Attacker, int32 FirstHitDefender, int32 FirstClashDefender)
+{
+	for (int j = FirstHitDefender; j < MaxPlayerObjects; j++)
+	{
+		if (Attacker != j && SortedObjects[j]->Player->PlayerFlags & PLF_IsOnScreen)
+		{
+			SortedObjects[Attacker]->HandleHitCollision(Cast<APlayerObject>(SortedObjects[j]));
+		}
+	}
+	for (int j = FirstClashDefender; j < MaxBattleObjects + MaxPlayerObjects; j++)
+	{
+		if (Attacker != j)
+		{
+			SortedObjects[Attacker]->HandleClashCollision(SortedObjects[j]);
+		}
+	}
+	// Dirty state is relative to detection, so one check afterward catches every change made above.
+	UpdateCollisionDirty();
+}
+
+FCollisionSignature ANightSkyGameState::GetCollisionSignature(int32 Index) const
+{
+	const ABattleObject* Obj = SortedObjects[Index];
+	FCollisionSignature Signature;
+	Signature.PosX = Obj->PosX;
+	Signature.PosY = Obj->PosY;
+	Signature.AttackFlags = Obj->AttackFlags;
+	Signature.BoxesGeneration = Obj->BoxesGeneration;
+	Signature.Direction = Obj->Direction;
+	Signature.IsActive = Obj->IsActive;
+	if (Obj->IsPlayer)
+	{
+		const APlayerObject* PlayerObj = static_cast<const APlayerObject*>(Obj);
+		Signature.InvulnFlags = PlayerObj->InvulnFlags;
+		Signature.PlayerFlags = PlayerObj->PlayerFlags;
+		Signature.StrikeInvulnerableTimer = PlayerObj->StrikeInvulnerableTimer;
+		// Hits can remove entries as well as add them, so the count alone can stay the same while the contents change.
+		uint32 Hash = PlayerObj->ObjectsToIgnoreHitsFrom.Num();
+		for (const ABattleObject* Ignored : PlayerObj->ObjectsToIgnoreHitsFrom)
+		{
+			Hash = HashCombineFast(Hash, PointerHash(Ignored));
+		}
+		Signature.IgnoreHitsFromHash = Hash;
+	}
+	return Signature;
+}
+
+void ANightSkyGameState::UpdateCollisionDirty()
+{
+	// Only objects active at detection are compared. Inactive ones have no attack flags, so they can only start to
+	// matter by being spawned, and spawning one is a change in itself.
+	if (CollisionSpawnedObjectCount != SpawnedObjectCount)
+	{
+		CollisionSpawnedObjectCount = SpawnedObjectCount;
+		for (int i = BattleState.ActiveObjectCount; i < MaxBattleObjects + MaxPlayerObjects; i++)
+		{
+			if (!CollisionDirty[i] && SortedObjects[i]->IsActive)
+				MarkCollisionDirty(i);
+		}
+	}
+	for (int i = 0; i < BattleState.ActiveObjectCount; i++)
+	{
+		if (!CollisionDirty[i] && !(GetCollisionSignature(i) == CollisionSignatures[i]))
+			MarkCollisionDirty(i);
 	}
 }
 
+void ANightSkyGameState::MarkCollisionDirty(int32 Index)
+{
+	CollisionDirty[Index] = true;
+	CollisionDirtyIndices.Insert(Index, Algo::LowerBound(CollisionDirtyIndices, Index));
+}
+
 void ANightSkyGameState::HandleRoundWin()
 {
 	if (GetMainPlayer(true)->CurrentHealth > 0 && GetMainPlayer(false)->CurrentHealth <= 0)
@@ -669,128 +1040,118 @@ void ANightSkyGameState::HandleMatchWin()
 	case ERoundFormat::FirstToOne:
 		if (BattleState.P1RoundsWon > 0 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 0 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 2 && BattleState.P2RoundsWon == 2)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	case ERoundFormat::FirstToTwo:
 		if (BattleState.P1RoundsWon > 1 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 1 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 3 && BattleState.P2RoundsWon == 3)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	case ERoundFormat::FirstToThree:
 		if (BattleState.P1RoundsWon > 2 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 2 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 4 && BattleState.P2RoundsWon == 4)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	case ERoundFormat::FirstToFour:
 		if (BattleState.P1RoundsWon > 3 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 3 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 5 && BattleState.P2RoundsWon == 5)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	case ERoundFormat::FirstToFive:
 		if (BattleState.P1RoundsWon > 4 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 4 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 6 && BattleState.P2RoundsWon == 6)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	case ERoundFormat::TwoVsTwo:
 	case ERoundFormat::TwoVsTwoKOF:
 		if (BattleState.P1RoundsWon > 1 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 1 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 2 && BattleState.P2RoundsWon == 2)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	case ERoundFormat::ThreeVsThree:
 	case ERoundFormat::ThreeVsThreeKOF:
 		if (BattleState.P1RoundsWon > 2 && BattleState.P2RoundsWon < BattleState.P1RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P2RoundsWon > 2 && BattleState.P1RoundsWon < BattleState.P2RoundsWon)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		else if (BattleState.P1RoundsWon == 3 && BattleState.P2RoundsWon == 3)
 		{
-			GameInstance->EndRecordReplay();
-			UGameplayStatics::OpenLevel(GetGameInstance(), FName(TEXT("MainMenu_PL")));
+			EndMatch();
 		}
 		return;
 	default: ;
 	}
 }
 
+void ANightSkyGameState::EndMatch()
+{
+	bMatchEnded = true;
+#if NS_BATTLE_PROFILER
+	FBattleProfiler::Get().EndMatch();
+#endif
+	if (SnapshotStats.Frames > 0)
+		LogSnapshotStats();
+	Presentation->MatchEnded();
+}
+
 void ANightSkyGameState::CollisionView() const
 {
 	if (bViewCollision)
@@ -845,6 +1206,22 @@ FGGPONetworkStats ANightSkyGameState::GetNetworkStats() const
 	return Stats;
 }
 
+FNetworkTelemetry ANightSkyGameState::GetNetworkTelemetry() const
+{
+	const AFighterMultiplayerRunner* Runner = Cast<AFighterMultiplayerRunner>(FighterRunner);
+	if (IsValid(Runner))
+		return Runner->GetTelemetry();
+	return FNetworkTelemetry();
+}
+
+void ANightSkyGameState::ShowNetworkDebug(AHUD* HUD, UCanvas* Canvas, const FDebugDisplayInfo& DisplayInfo, float& YL, float& YPos)
+{
+	static const FName NAME_Netplay(TEXT("Netplay"));
+	if (HUD->GetWorld() != GetWorld() || !DisplayInfo.IsDisplayOn(NAME_Netplay))
+		return;
+	GetNetworkTelemetry().DrawDebug(Canvas->DisplayDebugManager);
+}
+
 void ANightSkyGameState::SetStageBounds()
 {
 	if ((GetMainPlayer(true)->MiscFlags & MISC_WallCollisionActive) == 0) return;
@@ -911,7 +1288,7 @@ ABattleObject* ANightSkyGameState::AddBattleObject(
 	EObjDir Dir,
 	int32 ObjectStateIndex,
 	bool bIsCommonState,
-	APlayerObject* Parent) const
+	APlayerObject* Parent)
 {
 	for (int i = 0; i < MaxBattleObjects; i++)
 	{
@@ -927,6 +1304,7 @@ ABattleObject* ANightSkyGameState::AddBattleObject(
 			Objects[i]->ObjectStateIndex = ObjectStateIndex;
 			Objects[i]->bIsCommonState = bIsCommonState;
 			Objects[i]->InitObject();
+			SpawnedObjectCount++;
 			return Objects[i];
 		}
 	}
@@ -935,159 +1313,63 @@ ABattleObject* ANightSkyGameState::AddBattleObject(
 
 void ANightSkyGameState::UpdateCamera()
 {
-	if (CameraActor != nullptr)
-	{
-		const FVector P1Location = FVector(static_cast<float>(BattleState.MainPlayer[0]->PosX) / COORD_SCALE,
-		                                   static_cast<float>(BattleState.MainPlayer[0]->PosZ) / COORD_SCALE,
-		                                   static_cast<float>(BattleState.MainPlayer[0]->PosY) / COORD_SCALE);
-		const FVector P2Location = FVector(static_cast<float>(BattleState.MainPlayer[1]->PosX) / COORD_SCALE,
-		                                   static_cast<float>(BattleState.MainPlayer[1]->PosZ) / COORD_SCALE,
-		                                   static_cast<float>(BattleState.MainPlayer[1]->PosY) / COORD_SCALE);
-		const FVector Average = (P1Location + P2Location) / 2;
-		float DistanceForX = sqrt(abs((P1Location - P2Location).X));
-		DistanceForX = FMath::Clamp(DistanceForX,16, BattleState.ScreenBounds / 37800);
-		DistanceForX = FMath::GetMappedRangeValueClamped(TRange<float>(16, BattleState.ScreenBounds / 18900), TRange<float>(0, BattleState.ScreenBounds / 1250), DistanceForX);
-		const float NewX = FMath::Clamp(
-			-Average.X, -(BattleState.StageBounds + BattleState.ScreenBounds * 0.5) / COORD_SCALE + DistanceForX,
-			(BattleState.StageBounds + BattleState.ScreenBounds * 0.5) / COORD_SCALE - DistanceForX);
-		float DistanceForYZ = sqrt(FVector::Distance(P1Location, P2Location));
-		DistanceForYZ = FMath::Clamp(DistanceForYZ,16, BattleState.ScreenBounds / 37800);
-		const float NewY = FMath::GetMappedRangeValueClamped(TRange<float>(16, BattleState.ScreenBounds / 37800), TRange<float>(540, BattleState.ScreenBounds / 1000), DistanceForYZ);
-		float NewZ;
-		if (P1Location.Z > P2Location.Z)
-			NewZ = FMath::Lerp(P1Location.Z, P2Location.Z, 0.25);
-		else
-			NewZ = FMath::Lerp(P1Location.Z, P2Location.Z, 0.75);
-		const float BaseZ = FMath::GetMappedRangeValueClamped(TRange<float>(4, BattleState.ScreenBounds / 37800), TRange<float>(25, 175), DistanceForYZ);
-		NewZ += BaseZ;
-		BattleState.PrevCameraPosition = BattleState.CameraPosition;
-		BattleState.CameraPosition = BattleSceneTransform.GetRotation().RotateVector(FVector(-NewX, NewY, NewZ)) + BattleSceneTransform.GetLocation();
-		BattleState.CameraPosition = FMath::Lerp(BattleState.PrevCameraPosition, BattleState.CameraPosition, 0.25);
-		CameraActor->SetActorLocation(BattleState.CameraPosition);
-		if (BattleState.CurrentSequenceTime == -1)
-		{
-			const FVector SequenceCameraLocation = BattleSceneTransform.GetRotation().RotateVector(FVector(0, 1080, 175)) + BattleSceneTransform.GetLocation();
-			SequenceCameraActor->SetActorLocation(SequenceCameraLocation);
-			if (const auto PlayerController = UGameplayStatics::GetPlayerController(GetWorld(), 0); IsValid(PlayerController))
-			{
-				PlayerController->SetViewTargetWithBlend(CameraActor);	
-			}
-		}
-		else
-		{
-			if (BattleState.CurrentSequenceTime >= SequenceActor->GetSequencePlayer()->GetEndTime().Time)
-			{
-				SequenceActor->GetSequencePlayer()->Stop();
-				BattleState.CurrentSequenceTime = -1;
-				BattleState.IsPlayingSequence = false;
-				return;
-			}
-			const FMovieSceneSequencePlaybackParams Params = FMovieSceneSequencePlaybackParams(
-				FFrameTime(BattleState.CurrentSequenceTime),
-				EUpdatePositionMethod::Scrub);
-			SequenceActor->GetSequencePlayer()->SetPlaybackPosition(Params);
-			const FVector SequenceTargetVector = FVector(SequenceTarget->PosX / COORD_SCALE,
-			                                             SequenceTarget->PosY / COORD_SCALE,
-			                                             SequenceTarget->PosZ / COORD_SCALE);
-
-			FVector NewCamLocation = SequenceCameraActor->GetActorLocation();
-			NewCamLocation.Z = NewCamLocation.Z + SequenceTargetVector.Z;
-
-			if (SequenceTarget->Direction == DIR_Left)
-			{
-				NewCamLocation.X = -NewCamLocation.X + SequenceTargetVector.X;
-				auto NewCamRotation = SequenceCameraActor->GetActorRotation();
-				NewCamRotation.Yaw = -NewCamRotation.Yaw - 180;
-				SequenceCameraActor->SetActorRotation(NewCamRotation);
-			}
-			else
-			{
-				NewCamLocation.X = NewCamLocation.X + SequenceTargetVector.X;
-			}
-
-			SequenceCameraActor->SetActorLocation(BattleSceneTransform.GetRotation().RotateVector(NewCamLocation) + BattleSceneTransform.GetLocation());
-
-			const FRotator CameraRotation = BattleSceneTransform.GetRotation().Rotator() + SequenceCameraActor->GetActorRotation();
+	const FVector P1Location = FVector(static_cast<float>(BattleState.MainPlayer[0]->PosX) / COORD_SCALE,
+	                                   static_cast<float>(BattleState.MainPlayer[0]->PosZ) / COORD_SCALE,
+	                                   static_cast<float>(BattleState.MainPlayer[0]->PosY) / COORD_SCALE);
+	const FVector P2Location = FVector(static_cast<float>(BattleState.MainPlayer[1]->PosX) / COORD_SCALE,
+	                                   static_cast<float>(BattleState.MainPlayer[1]->PosZ) / COORD_SCALE,
+	                                   static_cast<float>(BattleState.MainPlayer[1]->PosY) / COORD_SCALE);
+	const FVector Average = (P1Location + P2Location) / 2;
+	float DistanceForX = sqrt(abs((P1Location - P2Location).X));
+	DistanceForX = FMath::Clamp(DistanceForX,16, BattleState.ScreenBounds / 37800);
+	DistanceForX = FMath::GetMappedRangeValueClamped(TRange<float>(16, BattleState.ScreenBounds / 18900), TRange<float>(0, BattleState.ScreenBounds / 1250), DistanceForX);
+	const float NewX = FMath::Clamp(
+		-Average.X, -(BattleState.StageBounds + BattleState.ScreenBounds * 0.5) / COORD_SCALE + DistanceForX,
+		(BattleState.StageBounds + BattleState.ScreenBounds * 0.5) / COORD_SCALE - DistanceForX);
+	float DistanceForYZ = sqrt(FVector::Distance(P1Location, P2Location));
+	DistanceForYZ = FMath::Clamp(DistanceForYZ,16, BattleState.ScreenBounds / 37800);
+	const float NewY = FMath::GetMappedRangeValueClamped(TRange<float>(16, BattleState.ScreenBounds / 37800), TRange<float>(540, BattleState.ScreenBounds / 1000), DistanceForYZ);
+	float NewZ;
+	if (P1Location.Z > P2Location.Z)
+		NewZ = FMath::Lerp(P1Location.Z, P2Location.Z, 0.25);
+	else
+		NewZ = FMath::Lerp(P1Location.Z, P2Location.Z, 0.75);
+	const float BaseZ = FMath::GetMappedRangeValueClamped(TRange<float>(4, BattleState.ScreenBounds / 37800), TRange<float>(25, 175), DistanceForYZ);
+	NewZ += BaseZ;
+	BattleState.PrevCameraPosition = BattleState.CameraPosition;
+	BattleState.CameraPosition = BattleSceneTransform.GetRotation().RotateVector(FVector(-NewX, NewY, NewZ)) + BattleSceneTransform.GetLocation();
+	BattleState.CameraPosition = FMath::Lerp(BattleState.PrevCameraPosition, BattleState.CameraPosition, 0.25);
 
-			SequenceCameraActor->SetActorRotation(CameraRotation);
-		}
+	if (BattleState.CurrentSequenceTime != -1 && BattleState.CurrentSequenceTime >= BattleState.SequenceEndTime)
+	{
+		BattleState.CurrentSequenceTime = -1;
+		BattleState.IsPlayingSequence = false;
+		Presentation->SequenceEnded();
 	}
 	bIsPlayingSequence = BattleState.IsPlayingSequence;
 }
 
 void ANightSkyGameState::PlayLevelSequence(APlayerObject* Target, APlayerObject* Enemy, ULevelSequence* Sequence)
 {
-	if (SequenceActor != nullptr)
-	{
-		SequenceActor->SetSequence(Sequence);
-		TArray<FMovieSceneBinding> Bindings = Sequence->GetMovieScene()->GetBindings();
-		int NumBindings = Bindings.Num();
-		for (int i = 0; i < NumBindings; i++)
-		{
-			FMovieSceneBinding MovieSceneBinding = Bindings[i];
-			if (!MovieSceneBinding.GetName().Equals("Target"))
-			{
-				continue;
-			}
-
-			FMovieSceneObjectBindingID BindingId = FMovieSceneObjectBindingID(MovieSceneBinding.GetObjectGuid());
-			SequenceActor->SetBinding(BindingId, TArray<AActor*>{ Target });
-
-			break;
-		}
-		for (int i = 0; i < NumBindings; i++)
-		{
-			FMovieSceneBinding MovieSceneBinding = Bindings[i];
-			if (!MovieSceneBinding.GetName().Equals("Enemy"))
-			{
-				continue;
-			}
-
-			FMovieSceneObjectBindingID BindingId = FMovieSceneObjectBindingID(MovieSceneBinding.GetObjectGuid());
-			SequenceActor->SetBinding(BindingId, TArray<AActor*>{ Enemy });
-
-			break;
-		}
-		for (int i = 0; i < NumBindings; i++)
-		{
-			FMovieSceneBinding MovieSceneBinding = Bindings[i];
-			if (!MovieSceneBinding.GetName().Equals("CameraActor"))
-			{
-				continue;
-			}
-
-			FMovieSceneObjectBindingID BindingId = FMovieSceneObjectBindingID(MovieSceneBinding.GetObjectGuid());
-			SequenceActor->SetBinding(BindingId, TArray<AActor*>{ CameraActor });
-
-			break;
-		}
-		for (int i = 0; i < NumBindings; i++)
-		{
-			FMovieSceneBinding MovieSceneBinding = Bindings[i];
-			if (!MovieSceneBinding.GetName().Equals("SequenceCameraActor"))
-			{
-				continue;
-			}
-
-			FMovieSceneObjectBindingID BindingId = FMovieSceneObjectBindingID(MovieSceneBinding.GetObjectGuid());
-			SequenceActor->SetBinding(BindingId, TArray<AActor*>{ SequenceCameraActor });
-
-			break;
-		}
-		SequenceTarget = Target;
-		SequenceEnemy = Enemy;
-		BattleState.CurrentSequenceTime = 0;
-		BattleState.IsPlayingSequence = true;
-	}
+	if (Sequence == nullptr)
+		return;
+	
+	Presentation->SequenceStarted(Target, Enemy, Sequence);
+	SequenceTarget = Target;
+	SequenceEnemy = Enemy;
+	const UMovieScene* MovieScene = Sequence->GetMovieScene();
+	const FFrameTime EndTime = ConvertFrameTime(UE::MovieScene::DiscreteExclusiveUpper(MovieScene->GetPlaybackRange()),
+		MovieScene->GetTickResolution(), MovieScene->GetDisplayRate());
+	BattleState.SequenceEndTime = EndTime.CeilToFrame().Value;
+	BattleState.CurrentSequenceTime = 0;
+	BattleState.IsPlayingSequence = true;
 }
 
 void ANightSkyGameState::CameraShake(const TSubclassOf<UCameraShakeBase>& Pattern, float Scale) const
 {
 	if (Pattern)
 	{
-		const auto PlayerCameraManager = UGameplayStatics::GetPlayerCameraManager(this, 0);
-		PlayerCameraManager->StopAllCameraShakes();
-		PlayerCameraManager->StartCameraShake(Pattern, Scale);
+		Presentation->CameraShake(Pattern, Scale);
 	}
 }
 
@@ -1302,6 +1584,15 @@ APlayerObject* ANightSkyGameState::GetMainPlayer(bool IsP1) const
 	return BattleState.MainPlayer[1];
 }
 
+ABattleObject* ANightSkyGameState::GetObjectFromHandle(FBattleObjectHandle Handle) const
+{
+	if (Handle < MaxBattleObjects)
+		return Objects[Handle];
+	if (Handle != NullObjectHandle && Handle < MaxBattleObjects + MaxPlayerObjects)
+		return Players[Handle - MaxBattleObjects];
+	return nullptr;
+}
+
 void ANightSkyGameState::CallBattleExtension(FString Name)
 {
 	if (BattleExtensionNames.Find(FName(Name)) != INDEX_NONE)
@@ -1359,9 +1650,7 @@ void ANightSkyGameState::PlayCommonAudio(USoundBase* InSoundWave, float MaxDurat
 			BattleState.CommonAudioChannels[i].StartingFrame = BattleState.FrameNumber;
 			BattleState.CommonAudioChannels[i].MaxDuration = MaxDuration;
 			BattleState.CommonAudioChannels[i].Finished = false;
-			if (!bIsResimulating)
-			AudioManager->CommonAudioPlayers[i]->SetSound(InSoundWave);
-				AudioManager->CommonAudioPlayers[i]->Play();
+			Presentation->PlayAudio(EBattleAudioChannel::Common, i, InSoundWave);
 			return;
 		}
 	}
@@ -1377,9 +1666,7 @@ void ANightSkyGameState::PlayCharaAudio(USoundBase* InSoundWave, float MaxDurati
 			BattleState.CharaAudioChannels[i].StartingFrame = BattleState.FrameNumber;
 			BattleState.CharaAudioChannels[i].MaxDuration = MaxDuration;
 			BattleState.CharaAudioChannels[i].Finished = false;
-			if (!bIsResimulating)
-			AudioManager->CharaAudioPlayers[i]->SetSound(InSoundWave);
-				AudioManager->CharaAudioPlayers[i]->Play();
+			Presentation->PlayAudio(EBattleAudioChannel::Chara, i, InSoundWave);
 			return;
 		}
 	}
@@ -1391,22 +1678,20 @@ void ANightSkyGameState::PlayVoiceLine(USoundBase* InSoundWave, float MaxDuratio
 	BattleState.CharaVoiceChannels[Player].StartingFrame = BattleState.FrameNumber;
 	BattleState.CharaVoiceChannels[Player].MaxDuration = MaxDuration;
 	BattleState.CharaVoiceChannels[Player].Finished = false;
-	if (!bIsResimulating)
-	AudioManager->CharaVoicePlayers[Player]->SetSound(InSoundWave);
-		AudioManager->CharaVoicePlayers[Player]->Play();
+	Presentation->PlayAudio(EBattleAudioChannel::CharaVoice, Player, InSoundWave);
 }
 
 void ANightSkyGameState::ManageAudio()
 {
-	if (bIsResimulating) return;
+	// Runs while resimulating and headless too: channels are battle state, so they must free up on the same frame
+	// however a frame was reached.
 	for (int i = 0; i < CommonAudioChannelCount; i++)
 	{
 		const int CurrentAudioTime = BattleState.FrameNumber - BattleState.CommonAudioChannels[i].StartingFrame;
 		if (!BattleState.CommonAudioChannels[i].Finished && static_cast<int>(BattleState.CommonAudioChannels[i].MaxDuration * 60) < CurrentAudioTime + 0.2)
 		{
 			BattleState.CommonAudioChannels[i].Finished = true;
-			AudioManager->CommonAudioPlayers[i]->Stop();
-			AudioManager->CommonAudioPlayers[i]->SetSound(nullptr);
+			Presentation->StopAudio(EBattleAudioChannel::Common, i);
 		}
 	}
 	for (int i = 0; i < CharaAudioChannelCount; i++)
@@ -1415,8 +1700,7 @@ void ANightSkyGameState::ManageAudio()
 		if (!BattleState.CharaAudioChannels[i].Finished && static_cast<int>(BattleState.CharaAudioChannels[i].MaxDuration * 60) < CurrentAudioTime + 0.2)
 		{
 			BattleState.CharaAudioChannels[i].Finished = true;
-			AudioManager->CharaAudioPlayers[i]->Stop();
-			AudioManager->CharaAudioPlayers[i]->SetSound(nullptr);
+			Presentation->StopAudio(EBattleAudioChannel::Chara, i);
 		}
 	}
 	for (int i = 0; i < CharaVoiceChannelCount; i++)
@@ -1425,16 +1709,14 @@ void ANightSkyGameState::ManageAudio()
 		if (!BattleState.CharaVoiceChannels[i].Finished && static_cast<int>(BattleState.CharaVoiceChannels[i].MaxDuration * 60) < CurrentAudioTime + 0.2)
 		{
 			BattleState.CharaVoiceChannels[i].Finished = true;
-			AudioManager->CharaVoicePlayers[i]->Stop();
-			AudioManager->CharaVoicePlayers[i]->SetSound(nullptr);
+			Presentation->StopAudio(EBattleAudioChannel::CharaVoice, i);
 		}
 	}
 	const int CurrentAudioTime = BattleState.FrameNumber - BattleState.AnnouncerVoiceChannel.StartingFrame;
 	if (!BattleState.AnnouncerVoiceChannel.Finished && static_cast<int>(BattleState.AnnouncerVoiceChannel.MaxDuration * 60) < CurrentAudioTime + 0.2)
 	{
 		BattleState.AnnouncerVoiceChannel.Finished = true;
-		AudioManager->AnnouncerVoicePlayer->Stop();
-		AudioManager->AnnouncerVoicePlayer->SetSound(nullptr);
+		Presentation->StopAudio(EBattleAudioChannel::AnnouncerVoice, 0);
 	}
 }
 
@@ -1506,12 +1788,29 @@ void ANightSkyGameState::RollbackStopAudio() const
 
 void ANightSkyGameState::SaveGameState(int32* InChecksum)
 {
+	NS_BATTLE_PROFILE_PHASE(SaveGameState);
+	const uint32 SaveStartCycles = FPlatformTime::Cycles();
+	const uint64 PrevObjectBytes = SnapshotStats.HotBytes + SnapshotStats.ColdBytes;
+	FRollbackSnapshotFrame& SnapshotFrame = SnapshotStats.Current;
+	SnapshotFrame = FRollbackSnapshotFrame();
+	// Blueprint data goes through the property serializer, so it's timed apart from the fixed-size copies.
+	auto SerializeBP = [&SnapshotFrame](auto&& Save)
+	{
+		const uint32 StartCycles = FPlatformTime::Cycles();
+		TArray<uint8> Data = Save();
+		SnapshotFrame.SerializeCycles += FPlatformTime::Cycles() - StartCycles;
+		return Data;
+	};
 	const int BackupFrame = LocalFrame % MaxRollbackFrames;
+	FRollbackData& RollbackData = MainRollbackData[BackupFrame];
 	BPRollbackData[BackupFrame] = FBPRollbackData();
-	memcpy(MainRollbackData[BackupFrame].BattleStateBuffer, &BattleState.BattleStateSync, SizeOfBattleState);
+	BattleState.SuperFreezeCallerHandle = ABattleObject::GetObjectHandle(BattleState.SuperFreezeCaller);
+	BattleState.MainPlayerHandle[0] = ABattleObject::GetObjectHandle(BattleState.MainPlayer[0]);
+	BattleState.MainPlayerHandle[1] = ABattleObject::GetObjectHandle(BattleState.MainPlayer[1]);
+	memcpy(RollbackData.BattleStateBuffer, &BattleState.BattleStateSync, SizeOfBattleState);
 	for (int i = 0; i < BattleExtensions.Num(); i++)
 	{
-		BPRollbackData[BackupFrame].ExtensionData.Add(BattleExtensions[i]->SaveForRollback());
+		BPRollbackData[BackupFrame].ExtensionData.Add(SerializeBP([&] { return BattleExtensions[i]->SaveForRollback(); }));
 	}
 	if (BattleExtensions.Num() == 0)
 	{
@@ -1521,48 +1820,89 @@ void ANightSkyGameState::SaveGameState(int32* InChecksum)
 	{
 		if (Objects[i]->IsActive)
 		{
-			Objects[i]->SaveForRollback(MainRollbackData[BackupFrame].ObjBuffer[i]);
-			BPRollbackData[BackupFrame].StateData.Add(Objects[i]->ObjectState->SaveForRollback());
-			MainRollbackData[BackupFrame].ObjActive[i] = true;
+			Objects[i]->SaveForRollback(RollbackData.ObjBuffer[i]);
+			if (Objects[i]->SaveColdForRollback(RollbackData.ObjBuffer[i] + SizeOfBattleObjectHot, RollbackData.ObjColdVersion[i]))
+				SnapshotStats.ColdBytes += SizeOfBattleObjectCold;
+			BPRollbackData[BackupFrame].StateData.Add(SerializeBP([&] { return Objects[i]->ObjectState->SaveForRollback(); }));
+			RollbackData.ObjActive[i] = true;
+			SnapshotStats.HotBytes += SizeOfBattleObjectHot;
+			SnapshotStats.UnsplitBytes += SizeOfBattleObject;
 		}
 		else
 		{
-			MainRollbackData[BackupFrame].ObjActive[i] = false;
+			RollbackData.ObjActive[i] = false;
 			BPRollbackData[BackupFrame].StateData.Add(TArray<uint8> { 1 });
 		}
 	}
 	for (int i = 0; i < MaxPlayerObjects; i++)
 	{
-		Players[i]->SaveForRollback(MainRollbackData[BackupFrame].ObjBuffer[i + MaxBattleObjects]);
+		Players[i]->SaveForRollback(RollbackData.ObjBuffer[i + MaxBattleObjects]);
+		if (Players[i]->SaveColdForRollback(RollbackData.ObjBuffer[i + MaxBattleObjects] + SizeOfBattleObjectHot, RollbackData.ObjColdVersion[i + MaxBattleObjects]))
+			SnapshotStats.ColdBytes += SizeOfBattleObjectCold;
+		SnapshotStats.HotBytes += SizeOfBattleObjectHot;
+		SnapshotStats.UnsplitBytes += SizeOfBattleObject;
 		if (Players[i]->PlayerFlags & PLF_IsOnScreen)
 		{
-			BPRollbackData[BackupFrame].StateData.Add(Players[i]->StoredStateMachine.CurrentState->SaveForRollback());
+			BPRollbackData[BackupFrame].StateData.Add(SerializeBP([&] { return Players[i]->StoredStateMachine.CurrentState->SaveForRollback(); }));
 		}
 		else
 		{
 			BPRollbackData[BackupFrame].StateData.Add(TArray<uint8> { 1 });
 		}
-		Players[i]->SaveForRollbackPlayer(MainRollbackData[BackupFrame].CharBuffer[i]);
-		BPRollbackData[BackupFrame].PlayerData.Add(Players[i]->SaveForRollbackBP());
+		Players[i]->SaveForRollbackPlayer(RollbackData.CharBuffer[i]);
+		BPRollbackData[BackupFrame].PlayerData.Add(SerializeBP([&] { return Players[i]->SaveForRollbackBP(); }));
 	}
 
+	SnapshotFrame.CopyCycles = FPlatformTime::Cycles() - SaveStartCycles - SnapshotFrame.SerializeCycles;
+	const auto SumBytes = [](const TArray<TArray<uint8>>& Data)
+	{
+		uint32 Bytes = 0;
+		for (const TArray<uint8>& Entry : Data)
+		{
+			Bytes += Entry.Num();
+		}
+		return Bytes;
+	};
+	SnapshotFrame.Bytes[static_cast<int32>(ERollbackSnapshotCategory::BattleState)] = static_cast<uint32>(SizeOfBattleState);
+	SnapshotFrame.Bytes[static_cast<int32>(ERollbackSnapshotCategory::Players)] = static_cast<uint32>(SizeOfPlayerObject * MaxPlayerObjects)
+		+ SumBytes(BPRollbackData[BackupFrame].PlayerData);
+	SnapshotFrame.Bytes[static_cast<int32>(ERollbackSnapshotCategory::Objects)] = static_cast<uint32>(SnapshotStats.HotBytes + SnapshotStats.ColdBytes - PrevObjectBytes);
+	SnapshotFrame.Bytes[static_cast<int32>(ERollbackSnapshotCategory::BPState)] = SumBytes(BPRollbackData[BackupFrame].StateData);
+	SnapshotFrame.Bytes[static_cast<int32>(ERollbackSnapshotCategory::Extensions)] = SumBytes(BPRollbackData[BackupFrame].ExtensionData);
+	SnapshotStats.AddSave();
+
 	*InChecksum = CreateChecksum();
 }
 
 void ANightSkyGameState::LoadGameState()
 {
-	const int CurrentRollbackFrame = LocalFrame % MaxRollbackFrames;
+	NS_BATTLE_PROFILE_PHASE(LoadGameState);
+	NS_BATTLE_PROFILE_ROLLBACK();
 	const int CurrentFrame = BattleState.FrameNumber;
-	memcpy(&BattleState.BattleStateSync, MainRollbackData[CurrentRollbackFrame].BattleStateBuffer, SizeOfBattleState);
+	LoadSavedState();
+	Presentation->RolledBack(CurrentFrame - BattleState.FrameNumber);
+
+	//RollbackStopAudio();
+}
+
+void ANightSkyGameState::LoadSavedState()
+{
+	const int CurrentRollbackFrame = LocalFrame % MaxRollbackFrames;
+	FRollbackData& RollbackData = MainRollbackData[CurrentRollbackFrame];
+	memcpy(&BattleState.BattleStateSync, RollbackData.BattleStateBuffer, SizeOfBattleState);
+	BattleState.SuperFreezeCaller = GetObjectFromHandle(BattleState.SuperFreezeCallerHandle);
+	BattleState.MainPlayer[0] = Cast<APlayerObject>(GetObjectFromHandle(BattleState.MainPlayerHandle[0]));
+	BattleState.MainPlayer[1] = Cast<APlayerObject>(GetObjectFromHandle(BattleState.MainPlayerHandle[1]));
 	for (int i = 0; i < BattleExtensions.Num(); i++)
 	{
 		BattleExtensions[i]->LoadForRollback(BPRollbackData[CurrentRollbackFrame].ExtensionData[i]);
 	}
 	for (int i = 0; i < MaxBattleObjects; i++)
 	{
-		if (MainRollbackData[CurrentRollbackFrame].ObjActive[i])
+		if (RollbackData.ObjActive[i])
 		{
-			Objects[i]->LoadForRollback(MainRollbackData[CurrentRollbackFrame].ObjBuffer[i]);
+			Objects[i]->LoadForRollback(RollbackData.ObjBuffer[i]);
+			Objects[i]->LoadColdForRollback(RollbackData.ObjBuffer[i] + SizeOfBattleObjectHot, RollbackData.ObjColdVersion[i]);
 			Objects[i]->ObjectState->LoadForRollback(BPRollbackData[CurrentRollbackFrame].StateData[i]);
 		}
 		else
@@ -1573,18 +1913,292 @@ void ANightSkyGameState::LoadGameState()
 	}
 	for (int i = 0; i < MaxPlayerObjects; i++)
 	{
-		Players[i]->LoadForRollback(MainRollbackData[CurrentRollbackFrame].ObjBuffer[i + MaxBattleObjects]);
+		Players[i]->LoadForRollback(RollbackData.ObjBuffer[i + MaxBattleObjects]);
+		Players[i]->LoadColdForRollback(RollbackData.ObjBuffer[i + MaxBattleObjects] + SizeOfBattleObjectHot, RollbackData.ObjColdVersion[i + MaxBattleObjects]);
 		if (Players[i]->PlayerFlags & PLF_IsOnScreen)
 		{
 			Players[i]->StoredStateMachine.CurrentState->LoadForRollback(BPRollbackData[CurrentRollbackFrame].StateData[i + MaxBattleObjects]);
 		}
-		Players[i]->LoadForRollbackPlayer(MainRollbackData[CurrentRollbackFrame].CharBuffer[i]);
+		Players[i]->LoadForRollbackPlayer(RollbackData.CharBuffer[i]);
 		Players[i]->LoadForRollbackBP(BPRollbackData[CurrentRollbackFrame].PlayerData[i]);
 	}
 	SortObjects();
-	ParticleManager->RollbackParticles(CurrentFrame - BattleState.FrameNumber);
-	if (!FighterRunner->IsA(AFighterSynctestRunner::StaticClass()))
-		GameInstance->RollbackReplay(CurrentFrame - BattleState.FrameNumber);
+}
 
-	//RollbackStopAudio();
+uint32 ANightSkyGameState::HashSavedGameState() const
+{
+	const int CurrentRollbackFrame = LocalFrame % MaxRollbackFrames;
+	const FRollbackData& RollbackData = MainRollbackData[CurrentRollbackFrame];
+	const FBPRollbackData& BPData = BPRollbackData[CurrentRollbackFrame];
+	uint32 Hash = FCrc::MemCrc32(RollbackData.BattleStateBuffer, SizeOfBattleState);
+	for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	{
+		if (i < MaxBattleObjects && !RollbackData.ObjActive[i])
+			continue;
+		Hash = FCrc::MemCrc32(RollbackData.ObjBuffer[i], SizeOfBattleObject, Hash);
+	}
+	for (int i = 0; i < MaxPlayerObjects; i++)
+	{
+		Hash = FCrc::MemCrc32(RollbackData.CharBuffer[i], SizeOfPlayerObject, Hash);
+	}
+	for (const TArray<TArray<uint8>>* Data : { &BPData.PlayerData, &BPData.StateData, &BPData.ExtensionData })
+	{
+		for (const TArray<uint8>& Bytes : *Data)
+		{
+			Hash = FCrc::MemCrc32(Bytes.GetData(), Bytes.Num(), Hash);
+		}
+	}
+	return Hash;
+}
+
+// Bump when the snapshot layout changes. Snapshots also carry the rollback data sizes, so a different build is rejected either way.
+static constexpr uint32 StateSnapshotVersion = 1;
+
+static const TArray<FSnapshotField>& GetBattleStateSnapshotFields()
+{
+	static const TArray<FSnapshotField> Fields = []
+	{
+		TArray<FSnapshotField> Result;
+		const auto AddChannel = [&Result](size_t Offset)
+		{
+			Result.Add({ ESnapshotField::Object, static_cast<uint32>(Offset + offsetof(FAudioChannel, SoundWave) - offsetof(FBattleState, BattleStateSync)),
+				static_cast<uint32>(sizeof(TObjectPtr<UObject>)) });
+		};
+		for (int i = 0; i < CommonAudioChannelCount; i++)
+			AddChannel(offsetof(FBattleState, CommonAudioChannels) + i * sizeof(FAudioChannel));
+		for (int i = 0; i < CharaAudioChannelCount; i++)
+			AddChannel(offsetof(FBattleState, CharaAudioChannels) + i * sizeof(FAudioChannel));
+		for (int i = 0; i < CharaVoiceChannelCount; i++)
+			AddChannel(offsetof(FBattleState, CharaVoiceChannels) + i * sizeof(FAudioChannel));
+		AddChannel(offsetof(FBattleState, AnnouncerVoiceChannel));
+		return Result;
+	}();
+	return Fields;
+}
+
+// Writes rollback data with its process-local fields replaced by values another machine can resolve.
+// LocalData is the live data the rollback data was saved from, which state machines are looked up in.
+static void WriteSnapshotData(FArchive& Ar, const uint8* Data, int32 Size, const TArray<FSnapshotField>& Fields, const uint8* LocalData)
+{
+	TArray<uint8> Bytes(Data, Size);
+	for (const FSnapshotField& Field : Fields)
+	{
+		FMemory::Memzero(Bytes.GetData() + Field.Offset, Field.Size);
+	}
+	Ar.Serialize(Bytes.GetData(), Size);
+	for (const FSnapshotField& Field : Fields)
+	{
+		const uint8* Value = Data + Field.Offset;
+		switch (Field.Kind)
+		{
+		case ESnapshotField::Name:
+			{
+				FString Name = reinterpret_cast<const FName*>(Value)->ToString();
+				Ar << Name;
+				break;
+			}
+		case ESnapshotField::Object:
+			{
+				FString Path = FSoftObjectPath(reinterpret_cast<const TObjectPtr<UObject>*>(Value)->Get()).ToString();
+				Ar << Path;
+				break;
+			}
+		case ESnapshotField::StateMachine:
+			{
+				const FStateMachine* StateMachine = reinterpret_cast<const FStateMachine*>(LocalData + Field.Offset);
+				int32 StateIndex = StateMachine->States.Find(reinterpret_cast<const FStateMachine*>(Value)->CurrentState);
+				Ar << StateIndex;
+				break;
+			}
+		case ESnapshotField::Local:
+			break;
+		}
+	}
+}
+
+// Reads rollback data written by WriteSnapshotData. Local fields are copied from LocalData, the live data it will be loaded into.
+static bool ReadSnapshotData(FArchive& Ar, uint8* Data, int32 Size, const TArray<FSnapshotField>& Fields, const uint8* LocalData)
+{
+	Ar.Serialize(Data, Size);
+	for (const FSnapshotField& Field : Fields)
+	{
+		uint8* Value = Data + Field.Offset;
+		switch (Field.Kind)
+		{
+		case ESnapshotField::Name:
+			{
+				FString Name;
+				Ar << Name;
+				*reinterpret_cast<FName*>(Value) = FName(*Name);
+				break;
+			}
+		case ESnapshotField::Object:
+			{
+				FString Path;
+				Ar << Path;
+				UObject* Object = Path.IsEmpty() ? nullptr : FSoftObjectPath(Path).TryLoad();
+				if (!Path.IsEmpty() && !Object)
+				{
+					UE_LOG(LogTemp, Warning, TEXT("State snapshot references %s, which couldn't be loaded"), *Path);
+				}
+				*reinterpret_cast<TObjectPtr<UObject>*>(Value) = Object;
+				break;
+			}
+		case ESnapshotField::StateMachine:
+			{
+				int32 StateIndex = INDEX_NONE;
+				Ar << StateIndex;
+				FMemory::Memcpy(Value, LocalData + Field.Offset, Field.Size);
+				FStateMachine* StateMachine = reinterpret_cast<FStateMachine*>(Value);
+				if (!StateMachine->States.IsValidIndex(StateIndex))
+					return false;
+				StateMachine->CurrentState = StateMachine->States[StateIndex];
+				break;
+			}
+		case ESnapshotField::Local:
+			FMemory::Memcpy(Value, LocalData + Field.Offset, Field.Size);
+			break;
+		}
+	}
+	return !Ar.IsError();
+}
+
+TArray<uint8> ANightSkyGameState::MakeSnapshot(const FRollbackData& RollbackData, const FBPRollbackData& BPData) const
+{
+	TArray<uint8> Data;
+	FMemoryWriter Ar(Data);
+	uint32 Header[] = { StateSnapshotVersion, SizeOfBattleState, SizeOfBattleObject, SizeOfPlayerObject, MaxBattleObjects, MaxPlayerObjects };
+	Ar.Serialize(Header, sizeof(Header));
+	WriteSnapshotData(Ar, RollbackData.BattleStateBuffer, SizeOfBattleState, GetBattleStateSnapshotFields(),
+		reinterpret_cast<const uint8*>(&BattleState.BattleStateSync));
+
+	for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	{
+		if (i < MaxBattleObjects)
+		{
+			bool bActive = RollbackData.ObjActive[i];
+			Ar << bActive;
+			if (!bActive)
+				continue;
+		}
+		const ABattleObject* Object = i < MaxBattleObjects ? Objects[i] : Players[i - MaxBattleObjects];
+		WriteSnapshotData(Ar, RollbackData.ObjBuffer[i], SizeOfBattleObject, ABattleObject::GetSnapshotFields(), reinterpret_cast<const uint8*>(&Object->ObjSync));
+	}
+	for (int i = 0; i < MaxPlayerObjects; i++)
+	{
+		WriteSnapshotData(Ar, RollbackData.CharBuffer[i], SizeOfPlayerObject, APlayerObject::GetSnapshotFields(),
+			reinterpret_cast<const uint8*>(&Players[i]->PlayerSync));
+	}
+	FBPRollbackData BPCopy = BPData;
+	BPCopy.Serialize(Ar);
+
+	const int32 UncompressedSize = Data.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+	TArray<uint8> Snapshot;
+	Snapshot.SetNumUninitialized(sizeof(int32) + CompressedSize);
+	FMemory::Memcpy(Snapshot.GetData(), &UncompressedSize, sizeof(int32));
+	if (!FCompression::CompressMemory(NAME_Zlib, Snapshot.GetData() + sizeof(int32), CompressedSize, Data.GetData(), UncompressedSize))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't compress a %d byte state snapshot"), UncompressedSize);
+		return TArray<uint8>();
+	}
+	Snapshot.SetNum(sizeof(int32) + CompressedSize);
+	return Snapshot;
+}
+
+bool ANightSkyGameState::LoadSnapshot(const TArray<uint8>& Snapshot, int32 Frame)
+{
+	int32 UncompressedSize = 0;
+	if (Snapshot.Num() > static_cast<int32>(sizeof(int32)))
+		FMemory::Memcpy(&UncompressedSize, Snapshot.GetData(), sizeof(int32));
+	TArray<uint8> Data;
+	Data.SetNumUninitialized(FMath::Max(UncompressedSize, 0));
+	if (UncompressedSize <= 0 || !FCompression::UncompressMemory(NAME_Zlib, Data.GetData(), UncompressedSize,
+		Snapshot.GetData() + sizeof(int32), Snapshot.Num() - static_cast<int32>(sizeof(int32))))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Couldn't decompress the state snapshot of frame %d"), Frame);
+		return false;
+	}
+
+	FMemoryReader Ar(Data);
+	const uint32 ExpectedHeader[] = { StateSnapshotVersion, SizeOfBattleState, SizeOfBattleObject, SizeOfPlayerObject, MaxBattleObjects, MaxPlayerObjects };
+	uint32 Header[UE_ARRAY_COUNT(ExpectedHeader)] = { 0 };
+	Ar.Serialize(Header, sizeof(Header));
+	if (FMemory::Memcmp(Header, ExpectedHeader, sizeof(Header)) != 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The state snapshot of frame %d is from a different build"), Frame);
+		return false;
+	}
+
+	LocalFrame = Frame;
+	const int CurrentRollbackFrame = LocalFrame % MaxRollbackFrames;
+	FRollbackData& RollbackData = MainRollbackData[CurrentRollbackFrame];
+	bool bLoaded = ReadSnapshotData(Ar, RollbackData.BattleStateBuffer, SizeOfBattleState, GetBattleStateSnapshotFields(),
+		reinterpret_cast<const uint8*>(&BattleState.BattleStateSync));
+
+	for (int i = 0; i < MaxBattleObjects + MaxPlayerObjects; i++)
+	{
+		// Another machine's cold data, so nothing here is known to match it yet.
+		RollbackData.ObjColdVersion[i] = 0;
+		if (i < MaxBattleObjects)
+		{
+			Ar << RollbackData.ObjActive[i];
+			if (!RollbackData.ObjActive[i])
+				continue;
+		}
+		const ABattleObject* Object = i < MaxBattleObjects ? Objects[i] : Players[i - MaxBattleObjects];
+		bLoaded &= ReadSnapshotData(Ar, RollbackData.ObjBuffer[i], SizeOfBattleObject, ABattleObject::GetSnapshotFields(), reinterpret_cast<const uint8*>(&Object->ObjSync));
+	}
+	for (int i = 0; i < MaxPlayerObjects; i++)
+	{
+		bLoaded &= ReadSnapshotData(Ar, RollbackData.CharBuffer[i], SizeOfPlayerObject, APlayerObject::GetSnapshotFields(),
+			reinterpret_cast<const uint8*>(&Players[i]->PlayerSync));
+	}
+	BPRollbackData[CurrentRollbackFrame] = FBPRollbackData();
+	BPRollbackData[CurrentRollbackFrame].Serialize(Ar);
+	if (!bLoaded || Ar.IsError() || BPRollbackData[CurrentRollbackFrame].ExtensionData.Num() < BattleExtensions.Num()
+		|| BPRollbackData[CurrentRollbackFrame].StateData.Num() != MaxBattleObjects + MaxPlayerObjects
+		|| BPRollbackData[CurrentRollbackFrame].PlayerData.Num() != MaxPlayerObjects)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The state snapshot of frame %d doesn't match this battle"), Frame);
+		return false;
+	}
+
+	// Nothing was presented for the frames before the snapshot, so there's nothing to roll back.
+	LoadSavedState();
+	return true;
+}
+
+void ANightSkyGameState::LogSnapshotStats() const
+{
+	const FRollbackSnapshotStats& Stats = SnapshotStats;
+	const uint64 Frames = FMath::Max<uint64>(Stats.Frames, 1);
+	uint64 TotalBytes = 0;
+	for (const uint64 CategoryBytes : Stats.TotalBytes)
+	{
+		TotalBytes += CategoryBytes;
+	}
+	UE_LOG(LogTemp, Display, TEXT("Rollback snapshots: %llu frames, avg %llu bytes (max %u) saved per frame"),
+		Stats.Frames, TotalBytes / Frames, Stats.Max.GetTotalBytes());
+	for (int32 i = 0; i < RollbackSnapshotCategoryCount; i++)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  %-12s avg %8llu bytes  max %8u bytes  %5.1f%%"),
+			FRollbackSnapshotStats::GetCategoryName(static_cast<ERollbackSnapshotCategory>(i)),
+			Stats.TotalBytes[i] / Frames, Stats.Max.Bytes[i], TotalBytes > 0 ? Stats.TotalBytes[i] * 100.0 / TotalBytes : 0.0);
+	}
+	UE_LOG(LogTemp, Display, TEXT("  copy avg %.2f us (max %.2f), serialize avg %.2f us (max %.2f)"),
+		FPlatformTime::ToMilliseconds64(Stats.TotalCopyCycles) * 1000 / Frames, FPlatformTime::ToMilliseconds(Stats.Max.CopyCycles) * 1000,
+		FPlatformTime::ToMilliseconds64(Stats.TotalSerializeCycles) * 1000 / Frames, FPlatformTime::ToMilliseconds(Stats.Max.SerializeCycles) * 1000);
+	if (Stats.TotalGGPOBufferBytes > 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  GGPO buffer avg %llu bytes (max %u), built in avg %.2f us (max %.2f)"),
+			Stats.TotalGGPOBufferBytes / Frames, Stats.Max.GGPOBufferBytes,
+			FPlatformTime::ToMilliseconds64(Stats.TotalGGPOBufferCycles) * 1000 / Frames, FPlatformTime::ToMilliseconds(Stats.Max.GGPOBufferCycles) * 1000);
+		UE_LOG(LogTemp, Display, TEXT("  GGPO buffer bytes copied per frame avg %llu (max %u), unshared %llu"),
+			Stats.TotalGGPOCopiedBytes / Frames, Stats.Max.GGPOCopiedBytes, Stats.TotalGGPOUnsharedCopiedBytes / Frames);
+	}
+	UE_LOG(LogTemp, Display, TEXT("  object size %llu bytes (hot %llu, cold %llu), object bytes per frame: unsplit %llu, hot %llu + cold %llu"),
+		static_cast<uint64>(SizeOfBattleObject), static_cast<uint64>(SizeOfBattleObjectHot), static_cast<uint64>(SizeOfBattleObjectCold),
+		Stats.UnsplitBytes / Frames, Stats.HotBytes / Frames, Stats.ColdBytes / Frames);
+	UE_LOG(LogTemp, Display, TEXT("  FRollbackData size: %llu bytes"), static_cast<uint64>(sizeof(FRollbackData)));
 }
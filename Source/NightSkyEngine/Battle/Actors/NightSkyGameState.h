@@ -7,6 +7,8 @@
 #include "PlayerObject.h"
 #include "GameFramework/GameStateBase.h"
 #include "include/ggponet.h"
+#include "NightSkyEngine/Battle/BattlePresentation.h"
+#include "NightSkyEngine/Battle/NetworkTelemetry.h"
 #include "NightSkyEngine/Miscellaneous/RandomManager.h"
 #include "NightSkyGameState.generated.h"
 
@@ -20,6 +22,9 @@ constexpr int32 GaugeCount = 5;
 
 class UGGPONetwork;
 class ANightSkyBattleHudActor;
+class AHUD;
+class UCanvas;
+class FDebugDisplayInfo;
 
 // Battle data
 
@@ -98,10 +103,9 @@ struct FBattleState
 	int32 SuperFreezeDuration = 0;
 	int32 SuperFreezeSelfDuration = 0;
 	
-	UPROPERTY()
-	ABattleObject* SuperFreezeCaller = nullptr;
-	UPROPERTY()
-	APlayerObject* MainPlayer[2];
+	// Saved in place of SuperFreezeCaller and MainPlayer, which are resolved from these on load.
+	FBattleObjectHandle SuperFreezeCallerHandle = NullObjectHandle;
+	FBattleObjectHandle MainPlayerHandle[2] = { NullObjectHandle, NullObjectHandle };
 	
 	int32 P1RoundsWon = 0;
 	int32 P2RoundsWon = 0;
@@ -111,6 +115,8 @@ struct FBattleState
 	
 	int32 ActiveObjectCount = MaxPlayerObjects;
 	int32 CurrentSequenceTime = -1;
+	// Frame the current level sequence ends on, read from the sequence asset so it ends the same way headless.
+	int32 SequenceEndTime = 0;
 	
 	FAudioChannel CommonAudioChannels[CommonAudioChannelCount];
 	FAudioChannel CharaAudioChannels[CharaAudioChannelCount];
@@ -119,6 +125,11 @@ struct FBattleState
 
 	char BattleStateSyncEnd;
 
+	UPROPERTY()
+	ABattleObject* SuperFreezeCaller = nullptr;
+	UPROPERTY()
+	APlayerObject* MainPlayer[2];
+
 	UPROPERTY(BlueprintReadOnly)
 	ERoundFormat RoundFormat = ERoundFormat::FirstToTwo;
 };
@@ -128,13 +139,82 @@ constexpr size_t SizeOfBattleState = offsetof(FBattleState, BattleStateSyncEnd)
 
 struct FRollbackData
 {
+	// Hot rollback data of each object, followed by its cold rollback data.
 	uint8 ObjBuffer[MaxBattleObjects + MaxPlayerObjects][SizeOfBattleObject] = { { 0 } };
+	// ABattleObject::ColdVersion of each object's saved cold data, or 0 if unknown.
+	uint32 ObjColdVersion[MaxBattleObjects + MaxPlayerObjects] = { 0 };
 	bool ObjActive[MaxBattleObjects] = { false };
 	uint8 CharBuffer[MaxPlayerObjects][SizeOfPlayerObject] = { { 0 } };
 	uint8 BattleStateBuffer[SizeOfBattleState] = { 0 };
 	uint64 SizeOfBPRollbackData;
 };
 
+/**
+ * Parts of a rollback snapshot, for measuring where its size comes from.
+ */
+enum class ERollbackSnapshotCategory : uint8
+{
+	BattleState,
+	// Player sync data and blueprint player data.
+	Players,
+	// Hot object data, plus cold data that changed since the last save.
+	Objects,
+	// Blueprint state data of objects and players.
+	BPState,
+	Extensions,
+	Num,
+};
+
+constexpr int32 RollbackSnapshotCategoryCount = static_cast<int32>(ERollbackSnapshotCategory::Num);
+
+/**
+ * Bytes and time spent on one rollback snapshot.
+ */
+struct FRollbackSnapshotFrame
+{
+	uint32 Bytes[RollbackSnapshotCategoryCount] = { 0 };
+	// Size of the buffer handed to GGPO.
+	uint32 GGPOBufferBytes = 0;
+	// Bytes copied to build the GGPO buffer, counting cold blocks that weren't shared with an earlier buffer.
+	uint32 GGPOCopiedBytes = 0;
+	// Copying fixed-size data into the snapshot.
+	uint32 CopyCycles = 0;
+	// Serializing blueprint data into the snapshot.
+	uint32 SerializeCycles = 0;
+	// Copying the snapshot into a GGPO buffer, serializing blueprint data again.
+	uint32 GGPOBufferCycles = 0;
+
+	uint32 GetTotalBytes() const;
+};
+
+/**
+ * Bytes copied into rollback snapshots since the battle started.
+ */
+struct FRollbackSnapshotStats
+{
+	uint64 Frames = 0;
+	uint64 HotBytes = 0;
+	uint64 ColdBytes = 0;
+	// What the same saves would have copied before cold data was split out.
+	uint64 UnsplitBytes = 0;
+
+	// The most recent snapshot, and the largest value of each field over every snapshot.
+	FRollbackSnapshotFrame Current;
+	FRollbackSnapshotFrame Max;
+	uint64 TotalBytes[RollbackSnapshotCategoryCount] = { 0 };
+	uint64 TotalGGPOBufferBytes = 0;
+	uint64 TotalGGPOCopiedBytes = 0;
+	// What building the GGPO buffers would have copied when each held a whole FRollbackData.
+	uint64 TotalGGPOUnsharedCopiedBytes = 0;
+	uint64 TotalCopyCycles = 0;
+	uint64 TotalSerializeCycles = 0;
+	uint64 TotalGGPOBufferCycles = 0;
+
+	void AddSave(); //adds the current snapshot to the totals
+	void AddGGPOBuffer(uint32 InBytes, uint32 InCopiedBytes, uint32 InUnsharedCopiedBytes, uint32 InCycles); //adds the GGPO buffer built from the current snapshot
+	static const TCHAR* GetCategoryName(ERollbackSnapshotCategory Category);
+};
+
 struct FBPRollbackData
 {
 	TArray<TArray<uint8>> PlayerData;
@@ -144,6 +224,53 @@ struct FBPRollbackData
 	void Serialize(FArchive& Ar);
 };
 
+// Collision
+
+/**
+ * A hit or clash found by the detection phase of hit collision.
+ * Events are kept per attacker, in the order the serial loop visits defenders: hits first, then clashes.
+ */
+struct FCollisionEvent
+{
+	enum EType : uint8
+	{
+		Hit,
+		Clash,
+	};
+	
+	EType Type = Hit;
+	int32 Defender = 0;
+	FCollisionBox Hitbox;
+	FCollisionBox OtherHitbox;
+};
+
+/**
+ * The object state that decides whether a pair can hit or clash.
+ * If resolving a collision changes an object's signature, later pairs involving it are re-checked serially.
+ */
+struct FCollisionSignature
+{
+	int32 PosX = 0;
+	int32 PosY = 0;
+	uint32 AttackFlags = 0;
+	uint32 InvulnFlags = 0;
+	uint32 PlayerFlags = 0;
+	uint32 StrikeInvulnerableTimer = 0;
+	uint32 BoxesGeneration = 0;
+	uint32 IgnoreHitsFromHash = 0;
+	uint8 Direction = 0;
+	bool IsActive = false;
+
+	bool operator==(const FCollisionSignature& Other) const
+	{
+		return PosX == Other.PosX && PosY == Other.PosY && AttackFlags == Other.AttackFlags
+			&& InvulnFlags == Other.InvulnFlags && PlayerFlags == Other.PlayerFlags
+			&& StrikeInvulnerableTimer == Other.StrikeInvulnerableTimer && BoxesGeneration == Other.BoxesGeneration
+			&& IgnoreHitsFromHash == Other.IgnoreHitsFromHash && Direction == Other.Direction
+			&& IsActive == Other.IsActive;
+	}
+};
+
 // Network
 
 USTRUCT(BlueprintType)
@@ -164,6 +291,8 @@ class NIGHTSKYENGINE_API ANightSkyGameState : public AGameStateBase
 {
 	GENERATED_BODY()
 
+	friend class FBattleScenePresentation;
+
 protected:
 	UPROPERTY()
 	ABattleObject* Objects[MaxBattleObjects] {};
@@ -205,14 +334,23 @@ public:
 
 	UPROPERTY(BlueprintReadOnly)
 	bool bIsPlayingSequence = false;
+	// Set by InitHeadless, which swaps Presentation for one that shows nothing; only the simulation runs.
+	UPROPERTY(BlueprintReadOnly)
+	bool bHeadless = false;
+	UPROPERTY(BlueprintReadOnly)
+	bool bMatchEnded = false;
 
 	UPROPERTY()
 	class AFighterLocalRunner* FighterRunner = nullptr;;
 	UPROPERTY(BlueprintReadWrite)
 	ANightSkyBattleHudActor* BattleHudActor = nullptr;;
 
+	// Cameras, level sequences, particles, audio and the HUD. Never null.
+	TUniquePtr<FBattlePresentation> Presentation;
+
 	TArray<FRollbackData> MainRollbackData = {};
 	TArray<FBPRollbackData> BPRollbackData = {};
+	FRollbackSnapshotStats SnapshotStats = FRollbackSnapshotStats();
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
 	FBattleState BattleState = FBattleState();
@@ -236,22 +374,42 @@ private:
 	int32 PrevOtherChecksumFrame = 0;
 	FNetworkStats NetworkStats = FNetworkStats();
 	bool bIsResimulating = false;
+
+	TArray<FCollisionEvent> CollisionEvents[MaxBattleObjects + MaxPlayerObjects];
+	FCollisionSignature CollisionSignatures[MaxBattleObjects + MaxPlayerObjects];
+	TBitArray<> CollisionDirty;
+	TArray<int32> CollisionDirtyIndices;
+	// Battle objects spawned so far, and the count when hit collision last looked for spawns.
+	uint32 SpawnedObjectCount = 0;
+	uint32 CollisionSpawnedObjectCount = 0;
+	// When set, every hit and clash resolved is added to ResolvedCollisions as (attacker, defender, 0 for hits or 1 for clashes) ObjNumbers.
+	bool bRecordCollisions = false;
+	TArray<FIntVector> ResolvedCollisions;
 	
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	void Init();
 	void PlayIntros();
 	void RoundInit();
 	void UpdateLocalInput(); //updates local input
 	void SortObjects();
 	void HandlePushCollision() const; //for each active object, handle push collision
-	void HandleHitCollision() const;
+	void HandleHitCollision();
+	void DetectCollisionEvents();
+	void ResolveCollisionEvents(int32 Attacker);
+	void HandleHitCollisionSerial(int32 Attacker, int32 FirstHitDefender, int32 FirstClashDefender);
+	FCollisionSignature GetCollisionSignature(int32 Index) const;
+	void UpdateCollisionDirty();
+	void MarkCollisionDirty(int32 Index);
 	void HandleRoundWin();
 	virtual void HandleMatchWin();
+	void EndMatch();
 	void CollisionView() const;
 	int32 CreateChecksum();
 	FGGPONetworkStats GetNetworkStats() const;
+	void LoadSavedState(); //loads the saved state of the current frame, without rolling back presentation
 	
 public:
 	// Called every frame
@@ -259,20 +417,27 @@ public:
 
 	void UpdateGameState();
 	void UpdateGameState(int32 Input1, int32 Input2, bool bShouldResimulate);
+	void InitHeadless(UNightSkyGameInstance* InGameInstance); //initializes the battle without presentation
+	int32 StepHeadless(int32 Input1, int32 Input2); //advances one frame and returns the checksum
 
 	void SetStageBounds(); //sets screen bounds
 	void SetScreenBounds() const; //forces wall collision
 	void StartSuperFreeze(int32 Duration, int32 SelfDuration, ABattleObject* CallingObject);
 	void ScreenPosToWorldPos(int32 X, int32 Y, int32* OutX, int32* OutY) const;
-	ABattleObject* AddBattleObject(const UState* InState, int PosX, int PosY, EObjDir Dir, int32 ObjectStateIndex, bool bIsCommonState, APlayerObject* Parent) const;
+	ABattleObject* AddBattleObject(const UState* InState, int PosX, int PosY, EObjDir Dir, int32 ObjectStateIndex, bool bIsCommonState, APlayerObject* Parent);
 	void SetDrawPriorityFront(ABattleObject* InObject) const;
 	APlayerObject* SwitchMainPlayer(APlayerObject* InPlayer, int TeamIndex);
 	bool CanTag(const APlayerObject* InPlayer, int TeamIndex) const;
+	ABattleObject* GetObjectFromHandle(FBattleObjectHandle Handle) const; //resolves a rollback handle to an object
 	
 	void SaveGameState(int32* InChecksum); //saves game state
 	void LoadGameState(); //loads game state
+	uint32 HashSavedGameState() const; //hashes every byte of the last saved game state
+	void LogSnapshotStats() const; //logs snapshot size and save time by category
+	TArray<uint8> MakeSnapshot(const FRollbackData& RollbackData, const FBPRollbackData& BPData) const; //compresses a saved state into a snapshot another machine can load
+	bool LoadSnapshot(const TArray<uint8>& Snapshot, int32 Frame); //loads another machine's snapshot of the given frame, for joining a match in progress
 
-	void UpdateCamera();
+	void UpdateCamera(); //updates the camera position and ends the level sequence once it's over
 	void PlayLevelSequence(APlayerObject* Target, APlayerObject* Enemy, ULevelSequence* Sequence);
 	void CameraShake(const TSubclassOf<UCameraShakeBase>& Pattern, float Scale) const;
 
@@ -282,7 +447,7 @@ public:
 	void PlayCommonAudio(USoundBase* InSoundWave, float MaxDuration);
 	void PlayCharaAudio(USoundBase* InSoundWave, float MaxDuration);
 	void PlayVoiceLine(USoundBase* InSoundWave, float MaxDuration, int Player);
-	void ManageAudio();
+	void ManageAudio(); //frees audio channels whose sound has finished
 	void RollbackStartAudio(int32 InFrame) const;
 	void RollbackStopAudio() const;
 
@@ -302,4 +467,13 @@ public:
 	void SetGauge(bool IsP1, int32 GaugeIndex, int32 Value);
 	UFUNCTION(BlueprintCallable)
 	void UseGauge(bool IsP1, int32 GaugeIndex, int32 Value);
+	//network histograms for the match so far, for debug widgets. empty outside of netplay
+	UFUNCTION(BlueprintPure)
+	FNetworkTelemetry GetNetworkTelemetry() const;
+
+private:
+	//draws GetNetworkTelemetry for "ShowDebug Netplay"
+	void ShowNetworkDebug(AHUD* HUD, UCanvas* Canvas, const FDebugDisplayInfo& DisplayInfo, float& YL, float& YPos);
+
+	FDelegateHandle ShowDebugHandle;
 };
@@ -11,7 +11,6 @@
 #include "NightSkyGameState.h"
 #include "FighterRunners/FighterMultiplayerRunner.h"
 #include "GameFramework/InputSettings.h"
-#include "Kismet/GameplayStatics.h"
 #include "NightSkyEngine/Miscellaneous/NetworkPawn.h"
 #include "NightSkyEngine/Miscellaneous/NightSkyGameInstance.h"
 #include "NightSkyEngine/Miscellaneous/RpcConnectionManager.h"
@@ -39,29 +38,63 @@ void ANightSkyPlayerController::BeginPlay()
 void ANightSkyPlayerController::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	if (NetworkPawn != nullptr)
+	// On a listen server, the server's copy of the remote client's controller ticks too. Only the local one sends.
+	if (IsLocalController() && NetworkPawn != nullptr && ResolveGgpoTarget())
 	{
 		const int PlayerIndex = Cast<UNightSkyGameInstance>(GetGameInstance())->PlayerIndex;
-		TArray<ANetworkPawn*> NetworkPawns;
-		for (TActorIterator<ANetworkPawn> It(GetWorld()); It; ++It)
+		SendGgpo(GgpoTargetPawn, PlayerIndex == 0);
+	}
+}
+
+void ANightSkyPlayerController::SetPawn(APawn* InPawn)
+{
+	Super::SetPawn(InPawn);
+
+	// Runs on possession on the server and when the pawn replicates on the client.
+	NetworkPawn = Cast<ANetworkPawn>(InPawn);
+	GgpoTargetPawn = nullptr;
+}
+
+bool ANightSkyPlayerController::ResolveGgpoTarget()
+{
+	// A remote player's controller would pick the host's pawn and take over its runner and send ring.
+	if (!IsLocalController())
+		return false;
+	if (!IsValid(GgpoTargetPawn))
+	{
+		GgpoTargetPawn = nullptr;
+		if (Cast<UNightSkyGameInstance>(GetGameInstance())->PlayerIndex != 0)
 		{
-			NetworkPawns.Add(*It);
+			// Server RPCs must go through a pawn this client owns.
+			GgpoTargetPawn = NetworkPawn;
 		}
-		if (NetworkPawns.Num() > 1)
+		else
 		{
-			if (PlayerIndex == 0)
+			for (TActorIterator<ANetworkPawn> It(GetWorld()); It; ++It)
 			{
-				SendGgpo(NetworkPawns[1], true);
-			}
-			else
-			{
-				SendGgpo(NetworkPawns[0], false);
+				if (*It != NetworkPawn)
+				{
+					GgpoTargetPawn = *It;
+					break;
+				}
 			}
 		}
+		if (GgpoTargetPawn == nullptr)
+			return false;
 	}
+	if (!IsValid(FighterMultiplayerRunner))
+	{
+		FighterMultiplayerRunner = nullptr;
+		if (const ANightSkyGameState* GameState = GetWorld()->GetGameState<ANightSkyGameState>())
+			FighterMultiplayerRunner = Cast<AFighterMultiplayerRunner>(GameState->FighterRunner);
+		if (FighterMultiplayerRunner == nullptr)
+			return false;
+	}
+	// RPCs arrive on the same pawn they're sent through, which hands them to the runner.
+	GgpoTargetPawn->FighterMultiplayerRunner = FighterMultiplayerRunner;
+	return true;
 }
 
-
 void ANightSkyPlayerController::SetupInputComponent()
 {
 	if (GetLocalPlayer())
@@ -323,31 +356,21 @@ void ANightSkyPlayerController::PauseGame()
 
 void ANightSkyPlayerController::SendGgpo(ANetworkPawn* InNetworkPawn, bool Client)
 {
-	if(InNetworkPawn->FighterMultiplayerRunner==nullptr)//TODO: CHECK IF MULTIPLAYERRUNNER IS SPAWNED BEFORE THIS, IF SO DO THIS IN BEGINPLAY
-	{
-		TArray<AActor*> FoundFighterGameStates;
-		UGameplayStatics::GetAllActorsOfClass(GetWorld(), AFighterMultiplayerRunner::StaticClass(), FoundFighterGameStates);
-		if(FoundFighterGameStates.Num()>0)
-		{
-			InNetworkPawn->FighterMultiplayerRunner = Cast<AFighterMultiplayerRunner>(FoundFighterGameStates[0]);
-		}
-	}
-
 	if (InNetworkPawn->FighterMultiplayerRunner && InNetworkPawn->FighterMultiplayerRunner->connectionManager)
 	{
-		while(InNetworkPawn->FighterMultiplayerRunner->connectionManager->sendSchedule.Num()>0)
+		// Send every queued message in order. Dropping any makes GGPO resend and roll back further.
+		// Messages are packed into one RPC per tick unless they overflow a payload.
+		RpcConnectionManager* ConnectionManager = InNetworkPawn->FighterMultiplayerRunner->connectionManager;
+		while (ConnectionManager->PackSendSchedule(GgpoPayload))
 		{
-			const auto SendVal = InNetworkPawn->FighterMultiplayerRunner->connectionManager->sendSchedule.GetTail();
 			if(Client)
 			{
-				InNetworkPawn->SendGgpoToClient(SendVal->GetValue());
+				InNetworkPawn->SendGgpoToClient(GgpoPayload);
 			}
 			else
 			{
-				InNetworkPawn->SendGgpoToServer(SendVal->GetValue());
+				InNetworkPawn->SendGgpoToServer(GgpoPayload);
 			}
-			InNetworkPawn->FighterMultiplayerRunner->connectionManager->sendSchedule.Empty();
-			//InNetworkPawn->FighterMultiplayerRunner->connectionManager->sendSchedule.RemoveNode(SendVal);
 		}
 	}
 }
@@ -8,6 +8,7 @@
 
 class UInputMappingContext;
 class ANetworkPawn;
+class AFighterMultiplayerRunner;
 
 UCLASS()
 class NIGHTSKYENGINE_API ANightSkyPlayerController : public APlayerController
@@ -27,6 +28,7 @@ public:
 	virtual void Tick(float DeltaTime) override;
 
 	virtual void SetupInputComponent() override;
+	virtual void SetPawn(APawn* InPawn) override;
 	
 	int Inputs;
 	int Frame;
@@ -61,7 +63,7 @@ public:
 
 	void PauseGame();
 	
-	void SendGgpo(ANetworkPawn* InNetworkPawn, bool Client);
+	void SendGgpo(ANetworkPawn* InNetworkPawn, bool Client); //sends every queued GGPO message to the other player, coalesced into as few RPCs as possible
 	
 	UFUNCTION(BlueprintCallable)
 	void SendBattleData();
@@ -74,4 +76,15 @@ public:
 
 	UFUNCTION(BlueprintImplementableEvent)
 	void ClosePauseMenu();
+
+private:
+	bool ResolveGgpoTarget(); //finds the pawn GGPO RPCs go through and the multiplayer runner. only searches until both are found, and only for a local controller
+
+	// The network pawn GGPO RPCs are called on: the other player's pawn on the server, or our own on the client.
+	UPROPERTY()
+	ANetworkPawn* GgpoTargetPawn = nullptr;
+	UPROPERTY()
+	AFighterMultiplayerRunner* FighterMultiplayerRunner = nullptr;
+	// Reused each tick to pack queued GGPO messages.
+	TArray<int8> GgpoPayload;
 };
@@ -2076,6 +2076,8 @@ void APlayerObject::SetComponentVisibility() const
 void APlayerObject::UpdateVisuals()
 {
 	Super::UpdateVisuals();
+	if (IsValid(GameState) && !GameState->Presentation->IsVisible())
+		return;
 	
 	for (const auto& LinkActor : StoredLinkActors)
 	{
@@ -2324,6 +2326,7 @@ void APlayerObject::OnStateChange()
 	for (auto& Handler : EventHandlers)
 		Handler = FEventHandler();
 	EventHandlers[EVT_Enter].FunctionName = FName("Init");	
+	MarkColdDirty();
 
 	// Reset action registers
 	ActionReg1 = 0;
@@ -2479,6 +2482,9 @@ void APlayerObject::RoundInit(bool ResetHealth)
 	{
 		Box = FCollisionBox();
 	}
+	BoxesCelName = FName();
+	BoxesGeneration++;
+	MarkColdDirty();
 	PlayerReg1 = 0;
 	PlayerReg2 = 0;
 	PlayerReg3 = 0;
@@ -2570,8 +2576,18 @@ void APlayerObject::DisableLastInput()
 	StoredInputBuffer.InputDisabled[InputBufferSize - 1] = StoredInputBuffer.InputBufferInternal[InputBufferSize - 1];
 }
 
-void APlayerObject::SaveForRollbackPlayer(unsigned char* Buffer) const
+void APlayerObject::SaveForRollbackPlayer(unsigned char* Buffer)
 {
+	EnemyHandle = GetObjectHandle(Enemy);
+	AttackOwnerHandle = GetObjectHandle(AttackOwner);
+	for (int i = 0; i < 64; i++)
+	{
+		ChildBattleObjectHandles[i] = GetObjectHandle(ChildBattleObjects[i]);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		StoredBattleObjectHandles[i] = GetObjectHandle(StoredBattleObjects[i]);
+	}
 	FMemory::Memcpy(Buffer, &PlayerSync, SizeOfPlayerObject);
 }
 
@@ -2587,6 +2603,36 @@ TArray<uint8> APlayerObject::SaveForRollbackBP()
 void APlayerObject::LoadForRollbackPlayer(const unsigned char* Buffer)
 {
 	FMemory::Memcpy(&PlayerSync, Buffer, SizeOfPlayerObject);
+	Enemy = Cast<APlayerObject>(GameState->GetObjectFromHandle(EnemyHandle));
+	AttackOwner = GameState->GetObjectFromHandle(AttackOwnerHandle);
+	for (int i = 0; i < 64; i++)
+	{
+		ChildBattleObjects[i] = GameState->GetObjectFromHandle(ChildBattleObjectHandles[i]);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		StoredBattleObjects[i] = GameState->GetObjectFromHandle(StoredBattleObjectHandles[i]);
+	}
+}
+
+const TArray<FSnapshotField>& APlayerObject::GetSnapshotFields()
+{
+	static const TArray<FSnapshotField> Fields = []
+	{
+		TArray<FSnapshotField> Result;
+		const auto Add = [&Result](ESnapshotField Kind, size_t Offset, size_t Size)
+		{
+			Result.Add({ Kind, static_cast<uint32>(Offset - offsetof(APlayerObject, PlayerSync)), static_cast<uint32>(Size) });
+		};
+		// Input conditions and the state machine's arrays are set up when the match starts, and never change.
+		Add(ESnapshotField::Local, offsetof(APlayerObject, ProximityThrowInput), sizeof(FInputCondition));
+		Add(ESnapshotField::StateMachine, offsetof(APlayerObject, StoredStateMachine), sizeof(FStateMachine));
+		Add(ESnapshotField::Name, offsetof(APlayerObject, LastStateName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(APlayerObject, ExeStateName), sizeof(FName));
+		Add(ESnapshotField::Name, offsetof(APlayerObject, BufferedStateName), sizeof(FName));
+		return Result;
+	}();
+	return Fields;
 }
 
 void APlayerObject::LoadForRollbackBP(TArray<uint8> InBytes)
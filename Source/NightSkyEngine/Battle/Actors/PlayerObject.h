@@ -259,17 +259,13 @@ public:
 	int32 WallTouchTimer;
 	
 	/*
-	 * Object pointers.
+	 * Object handles. These are saved in place of the object pointers, which are resolved from them on load.
 	 */
 	
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
-	APlayerObject* Enemy;
-	UPROPERTY(BlueprintReadOnly)
-	ABattleObject* AttackOwner;
-	UPROPERTY()
-	ABattleObject* ChildBattleObjects[64];
-	UPROPERTY()
-	ABattleObject* StoredBattleObjects[16];
+	FBattleObjectHandle EnemyHandle = NullObjectHandle;
+	FBattleObjectHandle AttackOwnerHandle = NullObjectHandle;
+	FBattleObjectHandle ChildBattleObjectHandles[64];
+	FBattleObjectHandle StoredBattleObjectHandles[16];
 
 	bool ComponentVisible[MaxComponentCount];
 
@@ -300,6 +296,19 @@ public:
 	// Anything past here isn't saved or loaded for rollback, unless it has the SaveGame tag.
 	unsigned char PlayerSyncEnd; 
 
+	/*
+	 * Object pointers. These are saved and loaded for rollback through the object handles above.
+	 */
+	
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	APlayerObject* Enemy;
+	UPROPERTY(BlueprintReadOnly)
+	ABattleObject* AttackOwner;
+	UPROPERTY()
+	ABattleObject* ChildBattleObjects[64];
+	UPROPERTY()
+	ABattleObject* StoredBattleObjects[16];
+
 	/*
 	 * These properties are saved and loaded for rollback, as they have the SaveGame tag.
 	 */
@@ -484,10 +493,12 @@ public:
 	
 	static uint32 FlipInput(uint32 Input);
 	
-	void SaveForRollbackPlayer(unsigned char* Buffer) const;
+	void SaveForRollbackPlayer(unsigned char* Buffer);
 	TArray<uint8> SaveForRollbackBP();
 	void LoadForRollbackPlayer(const unsigned char* Buffer);
 	void LoadForRollbackBP(TArray<uint8> InBytes);
+	//fields of the player rollback data, from PlayerSync, that snapshots can't copy as bytes
+	static const TArray<FSnapshotField>& GetSnapshotFields();
 	virtual void LogForSyncTestFile(std::ofstream& file) override;
 
 	//ONLY CALL WHEN INITIALIZING MATCH! OTHERWISE THE GAME WILL CRASH
@@ -0,0 +1,261 @@
+﻿#include "BattleBenchmarkCommandlet.h"
+
+#include "BattleProfiler.h"
+#include "HeadlessSimulation.h"
+#include "Actors/NightSkyGameState.h"
+#include "Dom/JsonObject.h"
+#include "Misc/FileHelper.h"
+#include "Misc/ScopeExit.h"
+#include "Misc/Paths.h"
+#include "NightSkyEngine/Miscellaneous/ReplayInfo.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/StrongObjectPtr.h"
+
+namespace
+{
+	constexpr int32 PhaseCount = static_cast<int32>(EBattleProfilePhase::Num);
+
+	struct FReplayBenchmarkResult
+	{
+		FString Name;
+		int32 Frames = 0;
+		double FramesPerSecond = 0;
+		// CRC of every frame's checksum, in order.
+		uint32 Hash = 0;
+		int32 FinalChecksum = 0;
+		double PhaseMicroseconds[PhaseCount] = {};
+		bool bProfiled = false;
+	};
+
+	/** Plays a replay once. Returns false if the battle could not be created. */
+	bool PlayReplay(const UReplaySaveInfo* Replay, TSubclassOf<ANightSkyGameState> GameStateClass, bool bProfile, FReplayBenchmarkResult& OutResult)
+	{
+		const TStrongObjectPtr<UHeadlessSimulation> Simulation(NewObject<UHeadlessSimulation>());
+#if NS_BATTLE_PROFILER
+		FBattleProfiler::Get().SetEnabled(bProfile);
+#endif
+		if (!Simulation->Start(Replay->BattleData, GameStateClass))
+			return false;
+
+		const int32 Length = FMath::Min3(Replay->LengthInFrames, Replay->InputsP1.Num(), Replay->InputsP2.Num());
+		uint32 Hash = 0;
+		int32 Checksum = 0;
+		int32 Frame = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (; Frame < Length && !Simulation->IsMatchOver(); Frame++)
+		{
+			Checksum = Simulation->Step(Replay->InputsP1[Frame], Replay->InputsP2[Frame]);
+			Hash = FCrc::MemCrc32(&Checksum, sizeof(Checksum), Hash);
+		}
+		const double Elapsed = FPlatformTime::Seconds() - StartTime;
+
+		OutResult.Frames = Frame;
+		OutResult.FramesPerSecond = Elapsed > 0 ? Frame / Elapsed : 0;
+		OutResult.Hash = Hash;
+		OutResult.FinalChecksum = Checksum;
+
+#if NS_BATTLE_PROFILER
+		if (bProfile)
+		{
+			const TArray<FBattleFrameRecord> Records = FBattleProfiler::Get().GetMatchRecords();
+			for (const FBattleFrameRecord& Record : Records)
+			{
+				for (int32 Phase = 0; Phase < PhaseCount; Phase++)
+				{
+					OutResult.PhaseMicroseconds[Phase] += FPlatformTime::ToMilliseconds64(Record.PhaseCycles[Phase]) * 1000.0;
+				}
+			}
+			for (double& Phase : OutResult.PhaseMicroseconds)
+			{
+				Phase /= FMath::Max(1, Records.Num());
+			}
+			OutResult.bProfiled = Records.Num() > 0;
+			FBattleProfiler::Get().SetEnabled(false);
+		}
+#endif
+		Simulation->Stop();
+		return true;
+	}
+
+	bool WriteBaseline(const FString& FileName, const TArray<FReplayBenchmarkResult>& Results)
+	{
+		TArray<TSharedPtr<FJsonValue>> Replays;
+		for (const FReplayBenchmarkResult& Result : Results)
+		{
+			const TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+			Entry->SetStringField(TEXT("Name"), Result.Name);
+			Entry->SetNumberField(TEXT("Frames"), Result.Frames);
+			Entry->SetNumberField(TEXT("FramesPerSecond"), Result.FramesPerSecond);
+			Entry->SetNumberField(TEXT("Hash"), Result.Hash);
+			Replays.Add(MakeShared<FJsonValueObject>(Entry));
+		}
+		const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+		Root->SetStringField(TEXT("Version"), BattleVersion);
+		Root->SetArrayField(TEXT("Replays"), Replays);
+
+		FString Output;
+		const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+		return FJsonSerializer::Serialize(Root, Writer) && FFileHelper::SaveStringToFile(Output, *FileName);
+	}
+
+	/** Compares results with a baseline file. Returns the number of regressions. */
+	int32 CompareBaseline(const FString& FileName, const TArray<FReplayBenchmarkResult>& Results, double TolerancePercent)
+	{
+		FString Input;
+		TSharedPtr<FJsonObject> Root;
+		if (!FFileHelper::LoadFileToString(Input, *FileName)
+			|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Input), Root) || !Root.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: could not read baseline %s"), *FileName);
+			return 1;
+		}
+
+		TMap<FString, TSharedPtr<FJsonObject>> BaselineEntries;
+		const TArray<TSharedPtr<FJsonValue>>* Replays = nullptr;
+		if (Root->TryGetArrayField(TEXT("Replays"), Replays))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *Replays)
+			{
+				const TSharedPtr<FJsonObject> Entry = Value->AsObject();
+				if (Entry.IsValid())
+					BaselineEntries.Add(Entry->GetStringField(TEXT("Name")), Entry);
+			}
+		}
+
+		int32 Regressions = 0;
+		for (const FReplayBenchmarkResult& Result : Results)
+		{
+			const TSharedPtr<FJsonObject>* Entry = BaselineEntries.Find(Result.Name);
+			if (!Entry)
+			{
+				UE_LOG(LogTemp, Warning, TEXT("BattleBenchmark: %s is not in the baseline"), *Result.Name);
+				continue;
+			}
+			const int32 BaselineFrames = (*Entry)->GetIntegerField(TEXT("Frames"));
+			const uint32 BaselineHash = static_cast<uint32>((*Entry)->GetNumberField(TEXT("Hash")));
+			const double BaselineSpeed = (*Entry)->GetNumberField(TEXT("FramesPerSecond"));
+			if (BaselineFrames != Result.Frames || BaselineHash != Result.Hash)
+			{
+				UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: %s desynced from the baseline: %d frames, hash %08x (baseline %d frames, hash %08x)"),
+					*Result.Name, Result.Frames, Result.Hash, BaselineFrames, BaselineHash);
+				Regressions++;
+			}
+			if (Result.FramesPerSecond < BaselineSpeed * (1 - TolerancePercent / 100))
+			{
+				UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: %s is slower than the baseline: %.0f fps (baseline %.0f fps, tolerance %.1f%%)"),
+					*Result.Name, Result.FramesPerSecond, BaselineSpeed, TolerancePercent);
+				Regressions++;
+			}
+		}
+		return Regressions;
+	}
+}
+
+UBattleBenchmarkCommandlet::UBattleBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBattleBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ReplayDir = FPaths::ProjectSavedDir() / TEXT("SaveGames");
+	FParse::Value(*Params, TEXT("Replays="), ReplayDir);
+	FString BaselineFile;
+	FParse::Value(*Params, TEXT("Baseline="), BaselineFile);
+	const bool bWriteBaseline = FParse::Param(*Params, TEXT("WriteBaseline"));
+	int32 Iterations = 3;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	Iterations = FMath::Max(1, Iterations);
+	double TolerancePercent = 10;
+	FParse::Value(*Params, TEXT("Tolerance="), TolerancePercent);
+
+	TSubclassOf<ANightSkyGameState> GameStateClass = ANightSkyGameState::StaticClass();
+	FString GameStateClassPath;
+	if (FParse::Value(*Params, TEXT("GameState="), GameStateClassPath))
+	{
+		GameStateClass = LoadClass<ANightSkyGameState>(nullptr, *GameStateClassPath);
+		if (!GameStateClass)
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: could not load game state class %s"), *GameStateClassPath);
+			return 1;
+		}
+	}
+
+#if NS_BATTLE_PROFILER
+	// Profiled runs read their records directly. Without this, every replay that ends its match would write a CSV.
+	FBattleProfiler::Get().SetWriteMatchCSV(false);
+	ON_SCOPE_EXIT
+	{
+		FBattleProfiler::Get().SetWriteMatchCSV(true);
+	};
+#endif
+
+	TArray<FReplayBenchmarkResult> Results;
+	for (const TPair<FString, UReplaySaveInfo*>& Entry : UHeadlessSimulation::LoadReplays(ReplayDir))
+	{
+		const UReplaySaveInfo* Replay = Entry.Value;
+
+		// The first run is profiled, and doubles as a warm-up. Later runs measure speed without profiling overhead.
+		FReplayBenchmarkResult Result;
+		Result.Name = Entry.Key;
+		if (!PlayReplay(Replay, GameStateClass, true, Result))
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: could not start a battle for %s"), *Result.Name);
+			return 1;
+		}
+		if (Iterations > 1)
+			Result.FramesPerSecond = 0;
+		for (int32 i = 1; i < Iterations; i++)
+		{
+			FReplayBenchmarkResult Run;
+			PlayReplay(Replay, GameStateClass, false, Run);
+			if (Run.Hash != Result.Hash || Run.Frames != Result.Frames)
+			{
+				UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: %s is nondeterministic: hash %08x, then %08x"), *Result.Name, Result.Hash, Run.Hash);
+				return 1;
+			}
+			Result.FramesPerSecond = FMath::Max(Result.FramesPerSecond, Run.FramesPerSecond);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("%s: %d frames, %.0f fps, hash %08x, final checksum %d"),
+			*Result.Name, Result.Frames, Result.FramesPerSecond, Result.Hash, Result.FinalChecksum);
+#if NS_BATTLE_PROFILER
+		if (Result.bProfiled)
+		{
+			for (int32 Phase = 0; Phase < PhaseCount; Phase++)
+			{
+				UE_LOG(LogTemp, Display, TEXT("  %-18s %9.2f us/frame"),
+					FBattleProfiler::GetPhaseName(static_cast<EBattleProfilePhase>(Phase)), Result.PhaseMicroseconds[Phase]);
+			}
+		}
+#endif
+		Results.Add(Result);
+	}
+
+	if (Results.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: no replays for version %s found in %s"), *BattleVersion, *ReplayDir);
+		return 1;
+	}
+
+	if (BaselineFile.IsEmpty())
+		return 0;
+	if (bWriteBaseline)
+	{
+		if (!WriteBaseline(BaselineFile, Results))
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleBenchmark: could not write baseline %s"), *BaselineFile);
+			return 1;
+		}
+		UE_LOG(LogTemp, Display, TEXT("BattleBenchmark: wrote baseline %s"), *BaselineFile);
+		return 0;
+	}
+	const int32 Regressions = CompareBaseline(BaselineFile, Results, TolerancePercent);
+	UE_LOG(LogTemp, Display, TEXT("BattleBenchmark: %d regressions against %s"), Regressions, *BaselineFile);
+	return Regressions > 0 ? 1 : 0;
+}
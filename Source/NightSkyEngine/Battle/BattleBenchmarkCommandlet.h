@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BattleBenchmarkCommandlet.generated.h"
+
+/**
+ * @brief Plays replays through a headless battle and reports simulation speed and state hashes.
+ *
+ * Every replay in a directory is stepped frame by frame with its recorded inputs and no rendering.
+ * For each replay this reports frames per second, average per-phase cost (when the battle profiler is compiled in),
+ * and a hash of every frame's checksum. Results can be saved as a baseline, and later runs fail when a hash differs
+ * from the baseline or speed drops below it by more than the tolerance.
+ *
+ * Usage: UnrealEditor-Cmd NightSkyEngine.uproject -run=BattleBenchmark -nullrhi
+ *   -Replays=<dir>        Directory of replay .sav files. Defaults to Saved/SaveGames.
+ *   -GameState=<class>    Game state class path to battle with. Defaults to ANightSkyGameState.
+ *   -Iterations=<n>       Times to play each replay. The fastest run is reported. Defaults to 3.
+ *   -Baseline=<file>      Baseline JSON to compare against or write.
+ *   -WriteBaseline        Writes the results to the baseline file instead of comparing.
+ *   -Tolerance=<percent>  Allowed slowdown against the baseline. Defaults to 10.
+ */
+UCLASS()
+class NIGHTSKYENGINE_API UBattleBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBattleBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,181 @@
+﻿#include "BattlePresentation.h"
+
+#include "LevelSequenceActor.h"
+#include "LevelSequencePlayer.h"
+#include "Actors/AudioManager.h"
+#include "Actors/NightSkyGameState.h"
+#include "Actors/ParticleManager.h"
+#include "Actors/FighterRunners/FighterSynctestRunner.h"
+#include "Camera/CameraActor.h"
+#include "Components/AudioComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "NightSkyEngine/Miscellaneous/NightSkyGameInstance.h"
+
+void FBattleScenePresentation::RoundInit(const FVector& CameraLocation, const FRotator& CameraRotation)
+{
+	if (GameState->CameraActor == nullptr)
+		return;
+	GameState->CameraActor->SetActorLocation(CameraLocation);
+	GameState->CameraActor->SetActorRotation(CameraRotation);
+}
+
+void FBattleScenePresentation::FrameStarted(bool bResimulationEnded)
+{
+	if (bResimulationEnded)
+		GameState->RollbackStartAudio(GameState->BattleState.FrameNumber);
+	GameState->ParticleManager->UpdateParticles();
+}
+
+void FBattleScenePresentation::FrameSimulated()
+{
+	GameState->ParticleManager->PauseParticles();
+	GameState->CollisionView();
+}
+
+void FBattleScenePresentation::FrameEnded()
+{
+	UpdateCameraActors();
+	GameState->UpdateHUD();
+}
+
+void FBattleScenePresentation::RolledBack(int32 Frames)
+{
+	GameState->ParticleManager->RollbackParticles(Frames);
+	if (!GameState->FighterRunner->IsA(AFighterSynctestRunner::StaticClass()))
+		GameState->GameInstance->RollbackReplay(Frames);
+}
+
+void FBattleScenePresentation::MatchEnded()
+{
+	GameState->GameInstance->EndRecordReplay();
+	UGameplayStatics::OpenLevel(GameState->GetGameInstance(), FName(TEXT("MainMenu_PL")));
+}
+
+void FBattleScenePresentation::SequenceStarted(APlayerObject* Target, APlayerObject* Enemy, ULevelSequence* Sequence)
+{
+	ALevelSequenceActor* SequenceActor = GameState->SequenceActor;
+	if (SequenceActor == nullptr)
+		return;
+	
+	SequenceActor->SetSequence(Sequence);
+	const TPair<FString, AActor*> BoundActors[] = {
+		{ TEXT("Target"), Target },
+		{ TEXT("Enemy"), Enemy },
+		{ TEXT("CameraActor"), GameState->CameraActor },
+		{ TEXT("SequenceCameraActor"), GameState->SequenceCameraActor },
+	};
+	const TArray<FMovieSceneBinding>& Bindings = Sequence->GetMovieScene()->GetBindings();
+	for (const auto& [Name, Actor] : BoundActors)
+	{
+		for (const FMovieSceneBinding& MovieSceneBinding : Bindings)
+		{
+			if (!MovieSceneBinding.GetName().Equals(Name))
+			{
+				continue;
+			}
+
+			FMovieSceneObjectBindingID BindingId = FMovieSceneObjectBindingID(MovieSceneBinding.GetObjectGuid());
+			SequenceActor->SetBinding(BindingId, TArray<AActor*>{ Actor });
+
+			break;
+		}
+	}
+}
+
+void FBattleScenePresentation::SequenceEnded()
+{
+	if (GameState->SequenceActor != nullptr)
+		GameState->SequenceActor->GetSequencePlayer()->Stop();
+}
+
+void FBattleScenePresentation::CameraShake(const TSubclassOf<UCameraShakeBase>& Pattern, float Scale)
+{
+	const auto PlayerCameraManager = UGameplayStatics::GetPlayerCameraManager(GameState, 0);
+	PlayerCameraManager->StopAllCameraShakes();
+	PlayerCameraManager->StartCameraShake(Pattern, Scale);
+}
+
+void FBattleScenePresentation::PlayAudio(EBattleAudioChannel Channel, int32 Index, USoundBase* Sound)
+{
+	// Sounds started while resimulating are picked up by RollbackStartAudio once the rollback ends.
+	if (GameState->bIsResimulating)
+		return;
+	UAudioComponent* AudioPlayer = GetAudioPlayer(Channel, Index);
+	AudioPlayer->SetSound(Sound);
+	AudioPlayer->Play();
+}
+
+void FBattleScenePresentation::StopAudio(EBattleAudioChannel Channel, int32 Index)
+{
+	UAudioComponent* AudioPlayer = GetAudioPlayer(Channel, Index);
+	AudioPlayer->Stop();
+	AudioPlayer->SetSound(nullptr);
+}
+
+void FBattleScenePresentation::UpdateCameraActors() const
+{
+	ACameraActor* CameraActor = GameState->CameraActor;
+	ACameraActor* SequenceCameraActor = GameState->SequenceCameraActor;
+	if (CameraActor == nullptr)
+		return;
+	
+	const FBattleState& BattleState = GameState->BattleState;
+	const FTransform& BattleSceneTransform = GameState->BattleSceneTransform;
+	CameraActor->SetActorLocation(BattleState.CameraPosition);
+	if (BattleState.CurrentSequenceTime == -1 || GameState->SequenceActor == nullptr)
+	{
+		const FVector SequenceCameraLocation = BattleSceneTransform.GetRotation().RotateVector(FVector(0, 1080, 175)) + BattleSceneTransform.GetLocation();
+		SequenceCameraActor->SetActorLocation(SequenceCameraLocation);
+		if (const auto PlayerController = UGameplayStatics::GetPlayerController(GameState->GetWorld(), 0); IsValid(PlayerController))
+		{
+			PlayerController->SetViewTargetWithBlend(CameraActor);	
+		}
+		return;
+	}
+	
+	const FMovieSceneSequencePlaybackParams Params = FMovieSceneSequencePlaybackParams(
+		FFrameTime(BattleState.CurrentSequenceTime),
+		EUpdatePositionMethod::Scrub);
+	GameState->SequenceActor->GetSequencePlayer()->SetPlaybackPosition(Params);
+	const APlayerObject* SequenceTarget = GameState->SequenceTarget;
+	const FVector SequenceTargetVector = FVector(SequenceTarget->PosX / COORD_SCALE,
+	                                             SequenceTarget->PosY / COORD_SCALE,
+	                                             SequenceTarget->PosZ / COORD_SCALE);
+
+	FVector NewCamLocation = SequenceCameraActor->GetActorLocation();
+	NewCamLocation.Z = NewCamLocation.Z + SequenceTargetVector.Z;
+
+	if (SequenceTarget->Direction == DIR_Left)
+	{
+		NewCamLocation.X = -NewCamLocation.X + SequenceTargetVector.X;
+		auto NewCamRotation = SequenceCameraActor->GetActorRotation();
+		NewCamRotation.Yaw = -NewCamRotation.Yaw - 180;
+		SequenceCameraActor->SetActorRotation(NewCamRotation);
+	}
+	else
+	{
+		NewCamLocation.X = NewCamLocation.X + SequenceTargetVector.X;
+	}
+
+	SequenceCameraActor->SetActorLocation(BattleSceneTransform.GetRotation().RotateVector(NewCamLocation) + BattleSceneTransform.GetLocation());
+
+	const FRotator CameraRotation = BattleSceneTransform.GetRotation().Rotator() + SequenceCameraActor->GetActorRotation();
+
+	SequenceCameraActor->SetActorRotation(CameraRotation);
+}
+
+UAudioComponent* FBattleScenePresentation::GetAudioPlayer(EBattleAudioChannel Channel, int32 Index) const
+{
+	const AAudioManager* AudioManager = GameState->AudioManager;
+	switch (Channel)
+	{
+	case EBattleAudioChannel::Common:
+		return AudioManager->CommonAudioPlayers[Index];
+	case EBattleAudioChannel::Chara:
+		return AudioManager->CharaAudioPlayers[Index];
+	case EBattleAudioChannel::CharaVoice:
+		return AudioManager->CharaVoicePlayers[Index];
+	default:
+		return AudioManager->AnnouncerVoicePlayer;
+	}
+}
@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class ANightSkyGameState;
+class APlayerObject;
+class ULevelSequence;
+class UCameraShakeBase;
+class USoundBase;
+class UAudioComponent;
+
+enum class EBattleAudioChannel : uint8
+{
+	Common,
+	Chara,
+	CharaVoice,
+	AnnouncerVoice,
+};
+
+/**
+ * @brief Everything a battle shows or plays, kept apart from the simulation.
+ *
+ * The game state and battle objects report to this instead of driving cameras, particles, audio, the HUD and actor
+ * visuals themselves, so the simulation runs the same whether or not anyone is watching. This base class ignores
+ * everything, and is what headless battles use. FBattleScenePresentation shows the battle in the game state's world.
+ */
+class NIGHTSKYENGINE_API FBattlePresentation
+{
+public:
+	virtual ~FBattlePresentation() = default;
+
+	// Whether anything is shown. Battle objects skip particles and visuals when it isn't.
+	virtual bool IsVisible() const { return false; }
+
+	virtual void RoundInit(const FVector& CameraLocation, const FRotator& CameraRotation) {}
+	//before a frame is simulated. bResimulationEnded is set on the first frame after a rollback has caught up
+	virtual void FrameStarted(bool bResimulationEnded) {}
+	//after objects have moved, before the frame's battle extensions and round checks
+	virtual void FrameSimulated() {}
+	//after the frame's camera and sequence state is updated
+	virtual void FrameEnded() {}
+	//after the saved state of an earlier frame has been loaded
+	virtual void RolledBack(int32 Frames) {}
+	virtual void MatchEnded() {}
+
+	virtual void SequenceStarted(APlayerObject* Target, APlayerObject* Enemy, ULevelSequence* Sequence) {}
+	virtual void SequenceEnded() {}
+	virtual void CameraShake(const TSubclassOf<UCameraShakeBase>& Pattern, float Scale) {}
+	virtual void PlayAudio(EBattleAudioChannel Channel, int32 Index, USoundBase* Sound) {}
+	virtual void StopAudio(EBattleAudioChannel Channel, int32 Index) {}
+};
+
+/**
+ * @brief Shows a battle in its world: cameras, level sequences, particles, audio, the HUD and the collision view.
+ */
+class NIGHTSKYENGINE_API FBattleScenePresentation : public FBattlePresentation
+{
+public:
+	explicit FBattleScenePresentation(ANightSkyGameState* InGameState) : GameState(InGameState) {}
+
+	virtual bool IsVisible() const override { return true; }
+
+	virtual void RoundInit(const FVector& CameraLocation, const FRotator& CameraRotation) override;
+	virtual void FrameStarted(bool bResimulationEnded) override;
+	virtual void FrameSimulated() override;
+	virtual void FrameEnded() override;
+	virtual void RolledBack(int32 Frames) override;
+	virtual void MatchEnded() override;
+
+	virtual void SequenceStarted(APlayerObject* Target, APlayerObject* Enemy, ULevelSequence* Sequence) override;
+	virtual void SequenceEnded() override;
+	virtual void CameraShake(const TSubclassOf<UCameraShakeBase>& Pattern, float Scale) override;
+	virtual void PlayAudio(EBattleAudioChannel Channel, int32 Index, USoundBase* Sound) override;
+	virtual void StopAudio(EBattleAudioChannel Channel, int32 Index) override;
+
+private:
+	void UpdateCameraActors() const; //moves the battle camera, and scrubs and places the sequence camera
+	UAudioComponent* GetAudioPlayer(EBattleAudioChannel Channel, int32 Index) const;
+
+	ANightSkyGameState* GameState;
+};
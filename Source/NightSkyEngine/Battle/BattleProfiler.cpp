@@ -0,0 +1,286 @@
+﻿#include "BattleProfiler.h"
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#if NS_BATTLE_PROFILER
+
+bool FBattleProfiler::bEnabled = false;
+
+namespace
+{
+	constexpr int32 PhaseCount = static_cast<int32>(EBattleProfilePhase::Num);
+
+	double CyclesToMicroseconds(uint32 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds64(Cycles) * 1000.0;
+	}
+
+	// Prints p50/p99/max of one column of values, given in cycles.
+	void LogPercentiles(const TCHAR* Name, TArray<uint32>& Values)
+	{
+		Values.Sort();
+		const int32 Last = Values.Num() - 1;
+		UE_LOG(LogTemp, Display, TEXT("  %-18s p50 %9.2f  p99 %9.2f  max %9.2f"), Name,
+			CyclesToMicroseconds(Values[Last / 2]),
+			CyclesToMicroseconds(Values[Last * 99 / 100]),
+			CyclesToMicroseconds(Values[Last]));
+	}
+}
+
+static FAutoConsoleCommand CmdProfilerStart(
+	TEXT("ns.Profiler.Start"),
+	TEXT("Starts recording per-phase battle frame timings. Same as launching with -BattleProfile."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FBattleProfiler::Get().SetEnabled(true);
+	}));
+
+static FAutoConsoleCommand CmdProfilerStop(
+	TEXT("ns.Profiler.Stop"),
+	TEXT("Stops recording battle frame timings. Recorded frames are kept."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FBattleProfiler::Get().SetEnabled(false);
+	}));
+
+static FAutoConsoleCommand CmdProfilerDump(
+	TEXT("ns.Profiler.Dump"),
+	TEXT("Prints p50/p99/max per battle frame phase, in microseconds, and writes the current match to a CSV file."),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FBattleProfiler::Get().Dump();
+		FBattleProfiler::Get().WriteCSV();
+	}));
+
+FBattleProfiler& FBattleProfiler::Get()
+{
+	static FBattleProfiler Profiler;
+	return Profiler;
+}
+
+FBattleProfiler::FBattleProfiler()
+{
+	SetEnabled(FParse::Param(FCommandLine::Get(), TEXT("BattleProfile")));
+}
+
+void FBattleProfiler::SetEnabled(bool bInEnabled)
+{
+	if (bInEnabled && !Records.IsValid())
+	{
+		Records = MakeUnique<FBattleFrameRecord[]>(Capacity);
+	}
+	bEnabled = bInEnabled;
+}
+
+void FBattleProfiler::BeginFrame(int32 FrameNumber, bool bResimulated)
+{
+	PublishOpenRecord();
+	OpenRecord = FBattleFrameRecord();
+	OpenRecord.FrameNumber = FrameNumber;
+	OpenRecord.bResimulated = bResimulated;
+	bRecordOpen = true;
+	bInFrame = true;
+}
+
+void FBattleProfiler::EndFrame(uint32 Cycles)
+{
+	OpenRecord.FrameCycles = Cycles;
+	bInFrame = false;
+	if (bMatchEndPending)
+	{
+		bMatchEndPending = false;
+		EndMatch();
+	}
+}
+
+void FBattleProfiler::AddPhase(EBattleProfilePhase Phase, uint32 Cycles)
+{
+	if (bRecordOpen)
+		OpenRecord.PhaseCycles[static_cast<int32>(Phase)] += Cycles;
+}
+
+void FBattleProfiler::AddRollback()
+{
+	if (bRecordOpen && OpenRecord.Rollbacks < MAX_uint8)
+		OpenRecord.Rollbacks++;
+}
+
+void FBattleProfiler::BeginMatch()
+{
+	if (bMatchOpen)
+	{
+		PublishOpenRecord();
+		if (bWriteMatchCSV && WriteIndex.load(std::memory_order_relaxed) > MatchStartIndex)
+			WriteCSV();
+	}
+	PublishOpenRecord();
+	MatchStartIndex = WriteIndex.load(std::memory_order_relaxed);
+	bMatchOpen = true;
+	bMatchEndPending = false;
+}
+
+void FBattleProfiler::EndMatch()
+{
+	if (!bMatchOpen)
+		return;
+	if (bInFrame)
+	{
+		bMatchEndPending = true;
+		return;
+	}
+	PublishOpenRecord();
+	if (bWriteMatchCSV && WriteIndex.load(std::memory_order_relaxed) > MatchStartIndex)
+		WriteCSV();
+	bMatchOpen = false;
+}
+
+void FBattleProfiler::PublishOpenRecord()
+{
+	if (!bRecordOpen || !Records.IsValid())
+		return;
+	const uint64 Index = WriteIndex.load(std::memory_order_relaxed);
+	Records[Index % Capacity] = OpenRecord;
+	WriteIndex.store(Index + 1, std::memory_order_release);
+	bRecordOpen = false;
+}
+
+void FBattleProfiler::CopyRecords(uint64 FirstIndex, TArray<FBattleFrameRecord>& OutRecords) const
+{
+	OutRecords.Reset();
+	if (!Records.IsValid())
+		return;
+
+	// The oldest slot is skipped, as the game thread may be overwriting it with the next record.
+	const uint64 End = WriteIndex.load(std::memory_order_acquire);
+	const uint64 Start = FMath::Max(FirstIndex, End >= Capacity ? End - Capacity + 1 : 0);
+	for (uint64 i = Start; i < End; i++)
+	{
+		OutRecords.Add(Records[i % Capacity]);
+	}
+
+	// Drop anything that was overwritten while copying.
+	const uint64 NewEnd = WriteIndex.load(std::memory_order_acquire);
+	const uint64 NewStart = NewEnd >= Capacity ? NewEnd - Capacity + 1 : 0;
+	if (NewStart > Start)
+	{
+		OutRecords.RemoveAt(0, FMath::Min<int32>(NewStart - Start, OutRecords.Num()));
+	}
+}
+
+void FBattleProfiler::Dump() const
+{
+	TArray<FBattleFrameRecord> Frames;
+	CopyRecords(0, Frames);
+	if (Frames.Num() == 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("No battle frames recorded. Use ns.Profiler.Start or launch with -BattleProfile."));
+		return;
+	}
+
+	int32 ResimulatedFrames = 0;
+	int32 Rollbacks = 0;
+	int32 MaxDepth = 0;
+	int32 Depth = 0;
+	TArray<uint32> Values;
+	Values.Reserve(Frames.Num());
+	for (const FBattleFrameRecord& Frame : Frames)
+	{
+		Rollbacks += Frame.Rollbacks;
+		Depth = Frame.bResimulated ? Depth + 1 : 0;
+		ResimulatedFrames += Frame.bResimulated;
+		MaxDepth = FMath::Max(MaxDepth, Depth);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Battle profile: %d frames (%d resimulated), %d rollbacks, max resimulation depth %d. Times in microseconds."),
+		Frames.Num(), ResimulatedFrames, Rollbacks, MaxDepth);
+	for (const FBattleFrameRecord& Frame : Frames)
+	{
+		Values.Add(Frame.FrameCycles);
+	}
+	LogPercentiles(TEXT("Frame"), Values);
+	for (int32 Phase = 0; Phase < PhaseCount; Phase++)
+	{
+		Values.Reset();
+		for (const FBattleFrameRecord& Frame : Frames)
+		{
+			Values.Add(Frame.PhaseCycles[Phase]);
+		}
+		LogPercentiles(GetPhaseName(static_cast<EBattleProfilePhase>(Phase)), Values);
+	}
+}
+
+FString FBattleProfiler::WriteCSV() const
+{
+	TArray<FBattleFrameRecord> Frames;
+	CopyRecords(MatchStartIndex, Frames);
+	if (Frames.Num() == 0)
+		return FString();
+
+	const uint64 Recorded = WriteIndex.load(std::memory_order_acquire) - MatchStartIndex;
+	if (Recorded > static_cast<uint64>(Frames.Num()))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Battle profile: match has %llu frames, only the last %d fit in the buffer."), Recorded, Frames.Num());
+	}
+
+	FString CSV = TEXT("Frame,Resimulated,Rollbacks,Total_us");
+	for (int32 Phase = 0; Phase < PhaseCount; Phase++)
+	{
+		CSV += FString::Printf(TEXT(",%s_us"), GetPhaseName(static_cast<EBattleProfilePhase>(Phase)));
+	}
+	CSV += LINE_TERMINATOR;
+	for (const FBattleFrameRecord& Frame : Frames)
+	{
+		CSV += FString::Printf(TEXT("%d,%d,%d,%.2f"), Frame.FrameNumber, Frame.bResimulated, Frame.Rollbacks, CyclesToMicroseconds(Frame.FrameCycles));
+		for (int32 Phase = 0; Phase < PhaseCount; Phase++)
+		{
+			CSV += FString::Printf(TEXT(",%.2f"), CyclesToMicroseconds(Frame.PhaseCycles[Phase]));
+		}
+		CSV += LINE_TERMINATOR;
+	}
+
+	const FString FileName = FPaths::ProfilingDir() / TEXT("Battle") / FString::Printf(TEXT("Match_%s.csv"), *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(CSV, *FileName))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Battle profile: could not write %s"), *FileName);
+		return FString();
+	}
+	UE_LOG(LogTemp, Display, TEXT("Battle profile: wrote %d frames to %s"), Frames.Num(), *FileName);
+	return FileName;
+}
+
+TArray<FBattleFrameRecord> FBattleProfiler::GetMatchRecords() const
+{
+	TArray<FBattleFrameRecord> Frames;
+	CopyRecords(MatchStartIndex, Frames);
+	return Frames;
+}
+
+const TCHAR* FBattleProfiler::GetPhaseName(EBattleProfilePhase Phase)
+{
+	switch (Phase)
+	{
+	case EBattleProfilePhase::SortObjects:
+		return TEXT("SortObjects");
+	case EBattleProfilePhase::HitCollision:
+		return TEXT("HitCollision");
+	case EBattleProfilePhase::ObjectUpdate:
+		return TEXT("ObjectUpdate");
+	case EBattleProfilePhase::PushCollision:
+		return TEXT("PushCollision");
+	case EBattleProfilePhase::BattleExtensions:
+		return TEXT("BattleExtensions");
+	case EBattleProfilePhase::Presentation:
+		return TEXT("Presentation");
+	case EBattleProfilePhase::SaveGameState:
+		return TEXT("SaveGameState");
+	case EBattleProfilePhase::LoadGameState:
+		return TEXT("LoadGameState");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+#endif
@@ -0,0 +1,163 @@
+﻿#pragma once
+
+#include <atomic>
+
+#include "CoreMinimal.h"
+
+// The battle profiler is compiled out of shipping builds.
+#ifndef NS_BATTLE_PROFILER
+#define NS_BATTLE_PROFILER !UE_BUILD_SHIPPING
+#endif
+
+/**
+ * Parts of a battle frame that are timed separately.
+ */
+enum class EBattleProfilePhase : uint8
+{
+	SortObjects,
+	HitCollision,
+	ObjectUpdate,
+	PushCollision,
+	BattleExtensions,
+	Presentation,
+	SaveGameState,
+	LoadGameState,
+	Num,
+};
+
+/**
+ * Timings of one call to ANightSkyGameState::UpdateGameState.
+ * Saving and loading happen outside of it, and are added to the most recent frame.
+ */
+struct FBattleFrameRecord
+{
+	int32 FrameNumber = 0;
+	// Whether this frame was resimulated after a rollback.
+	bool bResimulated = false;
+	// Number of game state loads (rollbacks) recorded against this frame.
+	uint8 Rollbacks = 0;
+	// Cycles spent in all of UpdateGameState.
+	uint32 FrameCycles = 0;
+	uint32 PhaseCycles[static_cast<int32>(EBattleProfilePhase::Num)] = {};
+};
+
+/**
+ * Collects per-phase timings of battle frames.
+ *
+ * Frames are written by the game thread into a fixed-size ring, which can be read from any thread without locking.
+ * Enable it with the -BattleProfile command-line switch or ns.Profiler.Start.
+ * ns.Profiler.Dump prints p50/p99/max per phase, and a CSV is written to Saved/Profiling/Battle at the end of each match
+ * unless SetWriteMatchCSV turned it off.
+ */
+class NIGHTSKYENGINE_API FBattleProfiler
+{
+public:
+	static constexpr int32 Capacity = 1 << 15;
+
+	static FBattleProfiler& Get();
+
+	static bool IsEnabled() { return bEnabled; }
+	void SetEnabled(bool bInEnabled);
+	//whether a csv is written when each match ends. benchmarks that read the records themselves turn it off
+	void SetWriteMatchCSV(bool bInWriteMatchCSV) { bWriteMatchCSV = bInWriteMatchCSV; }
+
+	//starts a frame record, and publishes the previous one
+	void BeginFrame(int32 FrameNumber, bool bResimulated);
+	//adds the total frame time to the open record. the record stays open for saving and loading
+	void EndFrame(uint32 Cycles);
+	void AddPhase(EBattleProfilePhase Phase, uint32 Cycles);
+	void AddRollback();
+
+	//marks the start of a match. writes the previous match's csv if it never ended
+	void BeginMatch();
+	//writes the csv for the match. if called during a frame, waits until the frame ends
+	void EndMatch();
+
+	//prints p50/p99/max per phase of the recorded frames
+	void Dump() const;
+	//writes recorded frames since the match began to a csv file. returns the file name, or an empty string on failure
+	FString WriteCSV() const;
+	//gets recorded frames since the match began, oldest first
+	TArray<FBattleFrameRecord> GetMatchRecords() const;
+
+	static const TCHAR* GetPhaseName(EBattleProfilePhase Phase);
+
+private:
+	FBattleProfiler();
+
+	// Publishes the open record to the ring.
+	void PublishOpenRecord();
+	// Copies published records from FirstIndex onward, oldest first.
+	void CopyRecords(uint64 FirstIndex, TArray<FBattleFrameRecord>& OutRecords) const;
+
+	static bool bEnabled;
+
+	TUniquePtr<FBattleFrameRecord[]> Records;
+	// Number of records published so far. Only the game thread writes it.
+	std::atomic<uint64> WriteIndex = 0;
+	// Value of WriteIndex when the current match began.
+	uint64 MatchStartIndex = 0;
+	bool bMatchOpen = false;
+	bool bWriteMatchCSV = true;
+
+	FBattleFrameRecord OpenRecord;
+	bool bRecordOpen = false;
+	bool bInFrame = false;
+	bool bMatchEndPending = false;
+};
+
+/**
+ * Adds the time from construction to destruction to a phase of the open frame.
+ */
+class FBattleProfileScope
+{
+public:
+	explicit FBattleProfileScope(EBattleProfilePhase InPhase)
+		: Phase(InPhase)
+		, StartCycles(FBattleProfiler::IsEnabled() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FBattleProfileScope()
+	{
+		if (StartCycles != 0)
+			FBattleProfiler::Get().AddPhase(Phase, static_cast<uint32>(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+private:
+	EBattleProfilePhase Phase;
+	uint64 StartCycles;
+};
+
+/**
+ * Records one battle frame from construction to destruction.
+ */
+class FBattleProfileFrameScope
+{
+public:
+	FBattleProfileFrameScope(int32 FrameNumber, bool bResimulated)
+		: StartCycles(FBattleProfiler::IsEnabled() ? FPlatformTime::Cycles64() : 0)
+	{
+		if (StartCycles != 0)
+			FBattleProfiler::Get().BeginFrame(FrameNumber, bResimulated);
+	}
+
+	~FBattleProfileFrameScope()
+	{
+		if (StartCycles != 0)
+			FBattleProfiler::Get().EndFrame(static_cast<uint32>(FPlatformTime::Cycles64() - StartCycles));
+	}
+
+private:
+	uint64 StartCycles;
+};
+
+#if NS_BATTLE_PROFILER
+#define NS_BATTLE_PROFILE_FRAME(FrameNumber, bResimulated) FBattleProfileFrameScope ANONYMOUS_VARIABLE(BattleProfileFrame)(FrameNumber, bResimulated)
+#define NS_BATTLE_PROFILE_PHASE(Phase) FBattleProfileScope ANONYMOUS_VARIABLE(BattleProfileScope)(EBattleProfilePhase::Phase)
+#define NS_BATTLE_PROFILE_ROLLBACK() if (FBattleProfiler::IsEnabled()) FBattleProfiler::Get().AddRollback()
+#else
+#define NS_BATTLE_PROFILE_FRAME(FrameNumber, bResimulated)
+#define NS_BATTLE_PROFILE_PHASE(Phase)
+#define NS_BATTLE_PROFILE_ROLLBACK()
+#endif
@@ -0,0 +1,63 @@
+﻿#include "BattleSelfTestCommandlet.h"
+
+#include "BattleSelfTests.h"
+#include "Actors/NightSkyGameState.h"
+#include "Misc/Paths.h"
+#include "NightSkyEngine/Miscellaneous/ReplayInfo.h"
+
+UBattleSelfTestCommandlet::UBattleSelfTestCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBattleSelfTestCommandlet::Main(const FString& Params)
+{
+#if WITH_DEV_AUTOMATION_TESTS
+	FString ReplayDir = FPaths::ProjectSavedDir() / TEXT("SaveGames");
+	FParse::Value(*Params, TEXT("Replays="), ReplayDir);
+	int32 SyncTestDepth = 8;
+	FParse::Value(*Params, TEXT("SyncTestDepth="), SyncTestDepth);
+	SyncTestDepth = FMath::Max(1, SyncTestDepth);
+	int32 JoinFrame = 3000;
+	FParse::Value(*Params, TEXT("JoinFrame="), JoinFrame);
+
+	TSubclassOf<ANightSkyGameState> GameStateClass = ANightSkyGameState::StaticClass();
+	FString GameStateClassPath;
+	if (FParse::Value(*Params, TEXT("GameState="), GameStateClassPath))
+	{
+		GameStateClass = LoadClass<ANightSkyGameState>(nullptr, *GameStateClassPath);
+		if (!GameStateClass)
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleSelfTest: could not load game state class %s"), *GameStateClassPath);
+			return 1;
+		}
+	}
+
+	BattleSelfTest::FSelfTestResults Results;
+	BattleSelfTest::TestFixedMath(Results);
+	BattleSelfTest::TestInputBuffer(Results);
+	BattleSelfTest::TestRandomManager(Results);
+	BattleSelfTest::TestRpcMessageRing(Results);
+	BattleSelfTest::TestSnapshotFields(Results);
+
+	const TMap<FString, UReplaySaveInfo*> Replays = BattleSelfTest::LoadReplays(ReplayDir);
+	Results.Check(Replays.Num() > 0, FString::Printf(TEXT("no replay fixtures found in %s and no replays for version %s in %s"),
+		*BattleSelfTest::GetReplayFixtureDir(), *BattleVersion, *ReplayDir));
+	for (const TPair<FString, UReplaySaveInfo*>& Entry : Replays)
+	{
+		BattleSelfTest::TestReplay(Results, Entry.Key, Entry.Value, GameStateClass, SyncTestDepth);
+		BattleSelfTest::TestCollisionPaths(Results, Entry.Key, Entry.Value, GameStateClass);
+		if (JoinFrame > 0)
+			BattleSelfTest::TestJoin(Results, Entry.Key, Entry.Value, GameStateClass, JoinFrame);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("BattleSelfTest: %d checks, %d failed"), Results.Checks, Results.Failures);
+	return Results.Failures > 0 ? 1 : 0;
+#else
+	UE_LOG(LogTemp, Error, TEXT("BattleSelfTest: the checks aren't built in this configuration"));
+	return 1;
+#endif
+}
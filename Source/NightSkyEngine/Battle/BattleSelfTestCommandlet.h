@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BattleSelfTestCommandlet.generated.h"
+
+/**
+ * @brief Checks that the battle simulation is deterministic and rolls back correctly.
+ *
+ * Runs without rendering, and covers:
+ * - FixedMath against reference integer and float math.
+ * - FInputBuffer sequence matching, lenience and disabled inputs.
+ * - FRandomManager sequences, which replays and netplay depend on.
+ * - RpcConnectionManager delivering every message in order under burst load, and its ring across threads.
+ * - Snapshot fields covering every reflected name and object pointer in battle and player rollback data.
+ * - For every replay, SaveGameState/LoadGameState round trips and a synctest: each chunk of frames is
+ *   simulated, rolled back and simulated again, and both passes must produce the same checksums.
+ * - For every replay, hit collision resolved from the cached detection pass against the original serial loop:
+ *   both must resolve the same hits and clashes every frame.
+ * - For every replay, joining a match in progress: a state snapshot is made partway through and loaded into a second
+ *   battle, and both must produce the same checksums for the rest of the replay.
+ *
+ * Usage: UnrealEditor-Cmd NightSkyEngine.uproject -run=BattleSelfTest -nullrhi
+ *   -Replays=<dir>        Directory of replay .sav files. Defaults to Saved/SaveGames. The JSON replay fixtures in
+ *                         Tests/Replays always run as well, and finding no replays at all fails the run.
+ *   -GameState=<class>    Game state class path to battle with. Defaults to ANightSkyGameState.
+ *   -SyncTestDepth=<n>    Frames simulated between each save and rollback. Defaults to 8.
+ *   -JoinFrame=<n>        Frame to join each replay at, or halfway if it's shorter. Defaults to 3000, 0 skips it.
+ *
+ * Returns 0 if every check passed, or 1 otherwise.
+ *
+ * The same checks, found in BattleSelfTests.h, also run as automation tests under NightSkyEngine.Battle, from the
+ * Session Frontend or with -ExecCmds="Automation RunTests NightSkyEngine.Battle". Those use the default replay
+ * directory and settings. The commandlet only runs the checks in builds with automation tests.
+ */
+UCLASS()
+class NIGHTSKYENGINE_API UBattleSelfTestCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBattleSelfTestCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
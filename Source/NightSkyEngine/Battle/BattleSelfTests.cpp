@@ -0,0 +1,640 @@
+﻿#include "BattleSelfTests.h"
+
+#include "Bitflags.h"
+#include "FixedPoint.h"
+#include "HeadlessSimulation.h"
+#include "InputBuffer.h"
+#include "Actors/NightSkyGameState.h"
+#include "Actors/PlayerObject.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "NightSkyEngine/Miscellaneous/RandomManager.h"
+#include "NightSkyEngine/Miscellaneous/ReplayInfo.h"
+#include "NightSkyEngine/Miscellaneous/RpcConnectionManager.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/StrongObjectPtr.h"
+#include "UObject/UnrealType.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	bool ReadInputs(const FJsonObject& Root, const TCHAR* Field, TArray<int32>& OutInputs)
+	{
+		const TArray<TSharedPtr<FJsonValue>>* Values;
+		if (!Root.TryGetArrayField(Field, Values))
+			return false;
+		for (const TSharedPtr<FJsonValue>& Value : *Values)
+		{
+			OutInputs.Add(static_cast<int32>(Value->AsNumber()));
+		}
+		return true;
+	}
+
+	/**
+	 * Loads a replay fixture. Fixtures are replays written as JSON, so they can be kept in the repository and don't
+	 * depend on the save game format. They don't record a version: inputs stay valid when the battle code changes.
+	 */
+	UReplaySaveInfo* LoadReplayFixture(const FString& FileName)
+	{
+		FString Input;
+		TSharedPtr<FJsonObject> Root;
+		if (!FFileHelper::LoadFileToString(Input, *FileName)
+			|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Input), Root) || !Root.IsValid())
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleSelfTest: could not read replay fixture %s"), *FileName);
+			return nullptr;
+		}
+
+		UReplaySaveInfo* Replay = NewObject<UReplaySaveInfo>();
+		FBattleData& BattleData = Replay->BattleData;
+		const TArray<TSharedPtr<FJsonValue>>* PlayerList;
+		if (Root->TryGetArrayField(TEXT("PlayerList"), PlayerList))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *PlayerList)
+			{
+				// An empty entry leaves that slot to the default player object, as character select does.
+				const FString ClassPath = Value->AsString();
+				BattleData.PlayerList.Add(ClassPath.IsEmpty() ? nullptr : LoadClass<APlayerObject>(nullptr, *ClassPath));
+				if (!ClassPath.IsEmpty() && !BattleData.PlayerList.Last())
+				{
+					UE_LOG(LogTemp, Error, TEXT("BattleSelfTest: replay fixture %s uses missing character %s"), *FileName, *ClassPath);
+					return nullptr;
+				}
+			}
+		}
+		const TArray<TSharedPtr<FJsonValue>>* ColorIndices;
+		if (Root->TryGetArrayField(TEXT("ColorIndices"), ColorIndices))
+		{
+			for (const TSharedPtr<FJsonValue>& Value : *ColorIndices)
+			{
+				BattleData.ColorIndices.Add(static_cast<int32>(Value->AsNumber()));
+			}
+		}
+		const int64 RoundFormat = StaticEnum<ERoundFormat>()->GetValueByNameString(Root->GetStringField(TEXT("RoundFormat")));
+		int32 Seed = 1;
+		Root->TryGetNumberField(TEXT("Seed"), Seed);
+		if (RoundFormat == INDEX_NONE || !Root->TryGetNumberField(TEXT("StartRoundTimer"), BattleData.StartRoundTimer)
+			|| !ReadInputs(*Root, TEXT("InputsP1"), Replay->InputsP1) || !ReadInputs(*Root, TEXT("InputsP2"), Replay->InputsP2))
+		{
+			UE_LOG(LogTemp, Error, TEXT("BattleSelfTest: replay fixture %s is missing fields"), *FileName);
+			return nullptr;
+		}
+		BattleData.RoundFormat = static_cast<ERoundFormat>(RoundFormat);
+		BattleData.Random.Reseed(Seed);
+		Replay->LengthInFrames = FMath::Min(Replay->InputsP1.Num(), Replay->InputsP2.Num());
+		return Replay;
+	}
+}
+
+namespace BattleSelfTest
+{
+	FString GetReplayFixtureDir()
+	{
+		return FPaths::ProjectDir() / TEXT("Tests/Replays");
+	}
+
+	TMap<FString, UReplaySaveInfo*> LoadReplays(const FString& ReplayDir)
+	{
+		TMap<FString, UReplaySaveInfo*> Replays;
+		const FString FixtureDir = GetReplayFixtureDir();
+		TArray<FString> Files;
+		IFileManager::Get().FindFiles(Files, *(FixtureDir / TEXT("*.json")), true, false);
+		Files.Sort();
+		for (const FString& File : Files)
+		{
+			if (UReplaySaveInfo* Replay = LoadReplayFixture(FixtureDir / File))
+				Replays.Add(FPaths::GetBaseFilename(File), Replay);
+		}
+		Replays.Append(UHeadlessSimulation::LoadReplays(ReplayDir));
+		return Replays;
+	}
+
+	bool FSelfTestResults::Check(bool bPassed, const FString& What)
+	{
+		Checks++;
+		if (!bPassed)
+		{
+			Failures++;
+			if (AutomationTest)
+				AutomationTest->AddError(What);
+			else
+				UE_LOG(LogTemp, Error, TEXT("BattleSelfTest: FAILED %s"), *What);
+		}
+		return bPassed;
+	}
+
+	void TestFixedMath(FSelfTestResults& Results)
+	{
+		// Sqrt must return floor(sqrt(n)).
+		FString SqrtFailure;
+		uint64 Value = 0;
+		for (int32 i = 0; i < 200000; i++)
+		{
+			Value = i < 100000 ? i : Value * 6364136223846793005ULL + 1442695040888963407ULL;
+			const uint64 Root = FixedMath::Sqrt(Value);
+			if (Root * Root > Value || (Root != MAX_uint32 && (Root + 1) * (Root + 1) <= Value))
+			{
+				SqrtFailure = FString::Printf(TEXT("FixedMath::Sqrt(%llu) returned %llu"), Value, Root);
+				break;
+			}
+		}
+		Results.Check(SqrtFailure.IsEmpty(), SqrtFailure);
+
+		// The sine table is truncated, so allow a small error against float math.
+		FString SinFailure;
+		for (int32 Deg = -3600; Deg <= 7200; Deg++)
+		{
+			const double Rad = Deg * (PI / 1800);
+			if (FMath::Abs(FixedMath::Sin_x1000(Deg) - FMath::Sin(Rad) * 1000) > 2
+				|| FMath::Abs(FixedMath::Cos_x1000(Deg) - FMath::Cos(Rad) * 1000) > 2)
+			{
+				SinFailure = FString::Printf(TEXT("FixedMath::Sin_x1000/Cos_x1000(%d) differ from float math"), Deg);
+				break;
+			}
+		}
+		Results.Check(SinFailure.IsEmpty(), SinFailure);
+
+		double MaxAtanDiff = 0;
+		for (int32 Y = -1000; Y <= 1000; Y += 37)
+		{
+			for (int32 X = -1000; X <= 1000; X += 41)
+			{
+				const double Expected = FMath::Fmod(FMath::Atan2(static_cast<double>(Y), static_cast<double>(X)) * 57295.77951308232 + 360000, 360000);
+				const double Diff = FMath::Abs(FixedMath::Atan2_x1000(Y, X) - Expected);
+				MaxAtanDiff = FMath::Max(MaxAtanDiff, FMath::Min(Diff, 360000 - Diff));
+			}
+		}
+		Results.Check(MaxAtanDiff <= 50, FString::Printf(TEXT("FixedMath::Atan2_x1000 is off by up to %.0f"), MaxAtanDiff));
+
+		Results.Check((FFixed::FromInt(7) * FFixed::FromRatio(1, 2)).ToInt() == 3, TEXT("FFixed multiply"));
+		Results.Check((FFixed::FromInt(-7) / FFixed::FromInt(2)).ToIntTrunc() == -3, TEXT("FFixed divide"));
+		Results.Check((FFixedSat::FromInt(-30000) * FFixedSat::FromInt(30000)).Raw == MIN_int32, TEXT("FFixedSat multiply saturates"));
+		Results.Check(FixedMath::Sqrt(FFixed::FromInt(16)).ToInt() == 4, TEXT("FixedMath::Sqrt(FFixed)"));
+	}
+
+	FInputBuffer MakeInputBuffer(std::initializer_list<int32> Inputs)
+	{
+		FInputBuffer Buffer;
+		for (int32 i = 0; i < InputBufferSize; i++)
+		{
+			Buffer.Update(INP_Neutral);
+		}
+		for (const int32 Input : Inputs)
+		{
+			Buffer.Update(Input);
+		}
+		return Buffer;
+	}
+
+	FInputCondition MakeInputCondition(std::initializer_list<EInputFlags> Sequence, EInputMethod Method = EInputMethod::Normal)
+	{
+		FInputCondition Condition;
+		for (const EInputFlags Input : Sequence)
+		{
+			Condition.Sequence.Add(FInputBitmask(Input));
+		}
+		Condition.Method = Method;
+		return Condition;
+	}
+
+	void TestInputBuffer(FSelfTestResults& Results)
+	{
+		const FInputCondition QuarterCircle = MakeInputCondition({ INP_Down, INP_DownRight, INP_Right, INP_A });
+		const int32 DownRight = INP_Down | INP_Right;
+
+		FInputBuffer Buffer = MakeInputBuffer({ INP_Down, INP_Down, DownRight, DownRight, INP_Right, INP_Right, INP_Right | INP_A });
+		Results.Check(Buffer.CheckInputCondition(QuarterCircle), TEXT("input buffer matches a quarter circle"));
+
+		Buffer = MakeInputBuffer({ INP_Down, INP_Down, DownRight, DownRight });
+		for (int32 i = 0; i < 20; i++)
+		{
+			Buffer.Update(INP_Neutral);
+		}
+		Buffer.Update(INP_Right);
+		Buffer.Update(INP_Right);
+		Buffer.Update(INP_Right | INP_A);
+		Results.Check(!Buffer.CheckInputCondition(QuarterCircle), TEXT("input buffer rejects a quarter circle past its lenience"));
+
+		Buffer = MakeInputBuffer({ INP_Down, INP_Down, DownRight, DownRight, INP_Right, INP_Right, INP_Right | INP_A });
+		Buffer.InputDisabled[InputBufferSize - 1] = Buffer.InputBufferInternal[InputBufferSize - 1];
+		Results.Check(!Buffer.CheckInputCondition(QuarterCircle), TEXT("input buffer rejects a disabled input"));
+		Results.Check(Buffer.CheckInputCondition(QuarterCircle, true), TEXT("input buffer ignores disabled inputs for kara cancels"));
+
+		const FInputCondition StrictRight = MakeInputCondition({ INP_Right }, EInputMethod::Strict);
+		Buffer = MakeInputBuffer({ DownRight });
+		Results.Check(!Buffer.CheckInputCondition(StrictRight), TEXT("strict input rejects a diagonal"));
+		Buffer = MakeInputBuffer({ INP_Right });
+		Results.Check(Buffer.CheckInputCondition(StrictRight), TEXT("strict input matches an exact direction"));
+	}
+
+	void TestRandomManager(FSelfTestResults& Results)
+	{
+		// Replays and netplay only stay in sync if these sequences never change.
+		FRandomManager Random;
+		for (const int32 Expected : { 16838, 5758, 10113, 17515, 31051 })
+		{
+			const int32 Actual = Random.Rand();
+			Results.Check(Actual == Expected, FString::Printf(TEXT("FRandomManager seed 1 returned %d, expected %d"), Actual, Expected));
+		}
+
+		Random.Reseed(12345);
+		for (const int32 Expected : { 21468, 9988, 22117, 3498, 16927 })
+		{
+			const int32 Actual = Random.Rand();
+			Results.Check(Actual == Expected, FString::Printf(TEXT("FRandomManager seed 12345 returned %d, expected %d"), Actual, Expected));
+		}
+
+		FRandomManager Copy = Random;
+		Results.Check(Copy.Rand() == Random.Rand() && Copy.GetSeed() == Random.GetSeed(), TEXT("copied FRandomManager continues the same sequence"));
+	}
+
+	// Fills a message whose size and contents depend on its sequence number. Returns the size.
+	int32 MakeRpcMessage(int32 Sequence, int8* OutData)
+	{
+		const int32 Size = sizeof(int32) + Sequence * 37 % 1000;
+		FMemory::Memcpy(OutData, &Sequence, sizeof(int32));
+		for (int32 i = sizeof(int32); i < Size; i++)
+		{
+			OutData[i] = static_cast<int8>((Sequence + i) & 0x7F);
+		}
+		return Size;
+	}
+
+	bool RpcMessageMatches(int32 Sequence, const int8* Data, int32 Size)
+	{
+		int8 Expected[FRpcMessage::MaxSize];
+		return Size == MakeRpcMessage(Sequence, Expected) && FMemory::Memcmp(Data, Expected, Size) == 0;
+	}
+
+	void TestRpcMessageRing(FSelfTestResults& Results)
+	{
+		// Loopback: bursts GGPO sends through one manager are packed and carried to another, like the player controller and network pawn do.
+		const TUniquePtr<RpcConnectionManager> Sender = MakeUnique<RpcConnectionManager>();
+		const TUniquePtr<RpcConnectionManager> Receiver = MakeUnique<RpcConnectionManager>();
+		Receiver->playerIndex = 1;
+		constexpr int32 MessageCount = 10000;
+		FRandomStream BurstSizes(1234);
+		int8 Buffer[FRpcMessage::MaxSize];
+		int32 Sent = 0;
+		int32 Received = 0;
+		FString Failure;
+		while (Received < MessageCount && Failure.IsEmpty())
+		{
+			const int32 Burst = FMath::Min<int32>(BurstSizes.RandRange(1, FRpcMessageRing::Capacity), MessageCount - Sent);
+			for (int32 i = 0; i < Burst; i++, Sent++)
+			{
+				Sender->SendTo(reinterpret_cast<const char*>(Buffer), MakeRpcMessage(Sent, Buffer), 0, 0);
+			}
+			TArray<int8> Payload;
+			while (Sender->PackSendSchedule(Payload))
+			{
+				Receiver->UnpackToReceiveSchedule(Payload);
+			}
+			int ConnectionId = -1;
+			int Size;
+			while ((Size = Receiver->RecvFrom(reinterpret_cast<char*>(Buffer), sizeof(Buffer), 0, &ConnectionId)) > 0)
+			{
+				if (!RpcMessageMatches(Received, Buffer, Size) || ConnectionId != 1)
+				{
+					Failure = FString::Printf(TEXT("RpcConnectionManager delivered the wrong message in place of message %d"), Received);
+					break;
+				}
+				Received++;
+			}
+			if (Burst == 0 && Received < MessageCount && Failure.IsEmpty())
+				Failure = FString::Printf(TEXT("RpcConnectionManager lost %d of %d messages"), MessageCount - Received, MessageCount);
+		}
+		Results.Check(Failure.IsEmpty(), Failure);
+		Results.Check(Sender->sendSchedule.GetDropped() == 0 && Receiver->receiveSchedule.GetDropped() == 0,
+			TEXT("RpcConnectionManager dropped messages under burst load"));
+
+		// The ring must also stay ordered with the producer on another thread.
+		const TUniquePtr<FRpcMessageRing> Ring = MakeUnique<FRpcMessageRing>();
+		constexpr int32 ThreadedCount = 200000;
+		TFuture<void> Producer = Async(EAsyncExecution::Thread, [&Ring]()
+		{
+			int8 Data[FRpcMessage::MaxSize];
+			for (int32 i = 0; i < ThreadedCount; i++)
+			{
+				const int32 Size = MakeRpcMessage(i, Data);
+				// Only this thread adds messages, so there's room once Num drops below capacity.
+				while (Ring->Num() == FRpcMessageRing::Capacity)
+				{
+					FPlatformProcess::Yield();
+				}
+				Ring->Push(Data, Size);
+			}
+		});
+		int32 Consumed = 0;
+		bool bOrdered = true;
+		const double StartTime = FPlatformTime::Seconds();
+		while (Consumed < ThreadedCount && bOrdered && FPlatformTime::Seconds() - StartTime < 30)
+		{
+			if (const FRpcMessage* Message = Ring->Peek())
+			{
+				bOrdered = RpcMessageMatches(Consumed, Message->Data, Message->Size);
+				Ring->Pop();
+				Consumed++;
+			}
+		}
+		// If the check stopped early, keep making room so the producer can finish before the ring goes away.
+		while (!Producer.WaitFor(FTimespan::FromMilliseconds(1)))
+		{
+			while (Ring->Peek())
+			{
+				Ring->Pop();
+			}
+		}
+		Results.Check(bOrdered && Consumed == ThreadedCount,
+			FString::Printf(TEXT("FRpcMessageRing delivered %d of %d messages in order across threads"), Consumed, ThreadedCount));
+	}
+
+	/**
+	 * Walks the reflected properties of Struct, found at BaseOffset in the object, that lie in the rollback data from Begin
+	 * to End. Adds every name or object pointer, including soft and weak ones, that no snapshot field covers.
+	 */
+	void FindUncoveredSnapshotProperties(const UStruct* Struct, size_t BaseOffset, size_t Begin, size_t End,
+		const TArray<FSnapshotField>& Fields, const FString& Path, TArray<FString>& OutUncovered)
+	{
+		for (TFieldIterator<FProperty> It(Struct); It; ++It)
+		{
+			const FProperty* Property = *It;
+			for (int32 i = 0; i < Property->ArrayDim; i++)
+			{
+				const size_t Offset = BaseOffset + Property->GetOffset_ForInternal() + i * Property->ElementSize;
+				if (Offset < Begin || Offset >= End)
+					continue;
+				const size_t FieldOffset = Offset - Begin;
+				if (Fields.ContainsByPredicate([FieldOffset](const FSnapshotField& Field)
+				{
+					return FieldOffset >= Field.Offset && FieldOffset < Field.Offset + Field.Size;
+				}))
+					continue;
+				FString PropertyPath = Path + TEXT(".") + Property->GetName();
+				if (Property->ArrayDim > 1)
+					PropertyPath += FString::Printf(TEXT("[%d]"), i);
+				// Structs such as FSoftObjectPath hold their names further down.
+				if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+					FindUncoveredSnapshotProperties(StructProperty->Struct, Offset, Begin, End, Fields, PropertyPath, OutUncovered);
+				else if (Property->IsA<FNameProperty>() || Property->IsA<FObjectPropertyBase>())
+					OutUncovered.Add(PropertyPath);
+			}
+		}
+	}
+
+	void TestSnapshotFields(FSelfTestResults& Results)
+	{
+		TArray<FString> Uncovered;
+		FindUncoveredSnapshotProperties(APlayerObject::StaticClass(), 0, offsetof(ABattleObject, ObjSync),
+			offsetof(ABattleObject, ObjSyncEnd), ABattleObject::GetSnapshotFields(), TEXT("BattleObject"), Uncovered);
+		FindUncoveredSnapshotProperties(APlayerObject::StaticClass(), 0, offsetof(APlayerObject, PlayerSync),
+			offsetof(APlayerObject, PlayerSyncEnd), APlayerObject::GetSnapshotFields(), TEXT("PlayerObject"), Uncovered);
+		Results.Check(Uncovered.Num() == 0,
+			FString::Printf(TEXT("snapshot fields don't cover %s"), *FString::Join(Uncovered, TEXT(", "))));
+	}
+
+	void TestReplay(FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, int32 SyncTestDepth)
+	{
+		const TStrongObjectPtr<UHeadlessSimulation> Simulation(NewObject<UHeadlessSimulation>());
+		if (!Results.Check(Simulation->Start(Replay->BattleData, GameStateClass), FString::Printf(TEXT("%s: could not start a battle"), *Name)))
+			return;
+
+		ANightSkyGameState* GameState = Simulation->GetGameState();
+		const int32 Length = FMath::Min3(Replay->LengthInFrames, Replay->InputsP1.Num(), Replay->InputsP2.Num());
+		TArray<int32> Checksums;
+		int32 Frame = 0;
+		while (Frame < Length && !Simulation->IsMatchOver())
+		{
+			int32 SavedChecksum = 0;
+			GameState->SaveGameState(&SavedChecksum);
+			const uint32 SavedHash = GameState->HashSavedGameState();
+
+			const int32 Depth = FMath::Min(SyncTestDepth, Length - Frame);
+			Checksums.Reset();
+			for (int32 i = 0; i < Depth && !Simulation->IsMatchOver(); i++)
+			{
+				Checksums.Add(Simulation->Step(Replay->InputsP1[Frame + i], Replay->InputsP2[Frame + i]));
+			}
+			// A headless match that has ended can't be resumed, so the last chunk isn't rolled back.
+			if (Simulation->IsMatchOver())
+				break;
+
+			GameState->LoadGameState();
+			int32 LoadedChecksum = 0;
+			GameState->SaveGameState(&LoadedChecksum);
+			if (!Results.Check(LoadedChecksum == SavedChecksum && GameState->HashSavedGameState() == SavedHash,
+				FString::Printf(TEXT("%s: state saved after loading frame %d differs from the original"), *Name, Frame)))
+				return;
+
+			for (int32 i = 0; i < Depth; i++)
+			{
+				const int32 Checksum = Simulation->Step(Replay->InputsP1[Frame + i], Replay->InputsP2[Frame + i]);
+				if (!Results.Check(Checksum == Checksums[i],
+					FString::Printf(TEXT("%s: desync at frame %d after rolling back to frame %d"), *Name, Frame + i + 1, Frame)))
+					return;
+			}
+			Frame += Depth;
+		}
+		UE_LOG(LogTemp, Display, TEXT("BattleSelfTest: %s passed synctest over %d frames"), *Name, Frame);
+		Simulation->Stop();
+	}
+
+	void TestCollisionPaths(FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass)
+	{
+		IConsoleVariable* ParallelCollision = IConsoleManager::Get().FindConsoleVariable(TEXT("ns.Collision.Parallel"));
+		const TStrongObjectPtr<UHeadlessSimulation> Cached(NewObject<UHeadlessSimulation>());
+		const TStrongObjectPtr<UHeadlessSimulation> Serial(NewObject<UHeadlessSimulation>());
+		if (!Results.Check(ParallelCollision && Cached->Start(Replay->BattleData, GameStateClass) && Serial->Start(Replay->BattleData, GameStateClass),
+			FString::Printf(TEXT("%s: could not start battles to compare collision paths"), *Name)))
+			return;
+
+		const int32 PreviousValue = ParallelCollision->GetInt();
+		ANightSkyGameState* CachedState = Cached->GetGameState();
+		ANightSkyGameState* SerialState = Serial->GetGameState();
+		CachedState->bRecordCollisions = true;
+		SerialState->bRecordCollisions = true;
+		const int32 Length = FMath::Min3(Replay->LengthInFrames, Replay->InputsP1.Num(), Replay->InputsP2.Num());
+		int32 Collisions = 0;
+		int32 Frame = 0;
+		for (; Frame < Length && !Cached->IsMatchOver(); Frame++)
+		{
+			CachedState->ResolvedCollisions.Reset();
+			SerialState->ResolvedCollisions.Reset();
+			ParallelCollision->Set(1, ECVF_SetByCode);
+			const int32 CachedChecksum = Cached->Step(Replay->InputsP1[Frame], Replay->InputsP2[Frame]);
+			ParallelCollision->Set(0, ECVF_SetByCode);
+			const int32 SerialChecksum = Serial->Step(Replay->InputsP1[Frame], Replay->InputsP2[Frame]);
+			if (!Results.Check(CachedState->ResolvedCollisions == SerialState->ResolvedCollisions && CachedChecksum == SerialChecksum,
+				FString::Printf(TEXT("%s: cached hit collision resolved %d collisions at frame %d, the serial loop %d"),
+					*Name, CachedState->ResolvedCollisions.Num(), Frame + 1, SerialState->ResolvedCollisions.Num())))
+				break;
+			Collisions += CachedState->ResolvedCollisions.Num();
+		}
+		ParallelCollision->Set(PreviousValue, ECVF_SetByCode);
+		UE_LOG(LogTemp, Display, TEXT("BattleSelfTest: %s resolved the same %d hits and clashes on both collision paths over %d frames"),
+			*Name, Collisions, Frame);
+		Cached->Stop();
+		Serial->Stop();
+	}
+
+	void TestJoin(FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, int32 JoinFrame)
+	{
+		const TStrongObjectPtr<UHeadlessSimulation> Host(NewObject<UHeadlessSimulation>());
+		const TStrongObjectPtr<UHeadlessSimulation> Joiner(NewObject<UHeadlessSimulation>());
+		if (!Results.Check(Host->Start(Replay->BattleData, GameStateClass) && Joiner->Start(Replay->BattleData, GameStateClass),
+			FString::Printf(TEXT("%s: could not start a battle to join"), *Name)))
+			return;
+
+		const int32 Length = FMath::Min3(Replay->LengthInFrames, Replay->InputsP1.Num(), Replay->InputsP2.Num());
+		JoinFrame = FMath::Min(JoinFrame, Length / 2);
+		int32 Frame = 0;
+		for (; Frame < JoinFrame && !Host->IsMatchOver(); Frame++)
+		{
+			Host->Step(Replay->InputsP1[Frame], Replay->InputsP2[Frame]);
+		}
+
+		ANightSkyGameState* HostState = Host->GetGameState();
+		int32 HostChecksum = 0;
+		HostState->SaveGameState(&HostChecksum);
+		const int32 SavedFrame = HostState->LocalFrame % MaxRollbackFrames;
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const TArray<uint8> Snapshot = HostState->MakeSnapshot(HostState->MainRollbackData[SavedFrame], HostState->BPRollbackData[SavedFrame]);
+		const uint64 MadeCycles = FPlatformTime::Cycles64();
+		ANightSkyGameState* JoinerState = Joiner->GetGameState();
+		const bool bLoaded = JoinerState->LoadSnapshot(Snapshot, HostState->LocalFrame);
+		const uint64 LoadedCycles = FPlatformTime::Cycles64();
+		int32 JoinerChecksum = 0;
+		JoinerState->SaveGameState(&JoinerChecksum);
+		if (!Results.Check(bLoaded && JoinerChecksum == HostChecksum,
+			FString::Printf(TEXT("%s: state loaded from a snapshot of frame %d differs from the original"), *Name, Frame)))
+			return;
+
+		for (int32 i = Frame; i < Length && !Host->IsMatchOver(); i++)
+		{
+			const int32 Checksum = Host->Step(Replay->InputsP1[i], Replay->InputsP2[i]);
+			if (!Results.Check(Joiner->Step(Replay->InputsP1[i], Replay->InputsP2[i]) == Checksum,
+				FString::Printf(TEXT("%s: desync at frame %d after joining at frame %d"), *Name, i + 1, Frame)))
+				return;
+		}
+		UE_LOG(LogTemp, Display, TEXT("BattleSelfTest: %s joined at frame %d from a %d byte snapshot, made in %.2f ms and loaded in %.2f ms"),
+			*Name, Frame, Snapshot.Num(), FPlatformTime::ToMilliseconds64(MadeCycles - StartCycles), FPlatformTime::ToMilliseconds64(LoadedCycles - MadeCycles));
+		Host->Stop();
+		Joiner->Stop();
+	}
+}
+
+namespace
+{
+	bool RunSelfTest(FAutomationTestBase& Test, void (*RunCheck)(BattleSelfTest::FSelfTestResults&))
+	{
+		BattleSelfTest::FSelfTestResults Results;
+		Results.AutomationTest = &Test;
+		RunCheck(Results);
+		return Results.Failures == 0;
+	}
+
+	// Runs a check on every replay fixture and every replay in Saved/SaveGames, where the commandlet looks by default.
+	bool RunReplaySelfTest(FAutomationTestBase& Test,
+		TFunctionRef<void(BattleSelfTest::FSelfTestResults&, const FString&, const UReplaySaveInfo*)> RunCheck)
+	{
+		const FString ReplayDir = FPaths::ProjectSavedDir() / TEXT("SaveGames");
+		const TMap<FString, UReplaySaveInfo*> Replays = BattleSelfTest::LoadReplays(ReplayDir);
+		if (Replays.Num() == 0)
+		{
+			Test.AddError(FString::Printf(TEXT("No replay fixtures found in %s and no replays for version %s in %s"),
+				*BattleSelfTest::GetReplayFixtureDir(), *BattleVersion, *ReplayDir));
+			return false;
+		}
+		BattleSelfTest::FSelfTestResults Results;
+		Results.AutomationTest = &Test;
+		for (const TPair<FString, UReplaySaveInfo*>& Entry : Replays)
+		{
+			RunCheck(Results, Entry.Key, Entry.Value);
+		}
+		return Results.Failures == 0;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleFixedMathTest, "NightSkyEngine.Battle.FixedMath",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleFixedMathTest::RunTest(const FString& Parameters)
+{
+	return RunSelfTest(*this, &BattleSelfTest::TestFixedMath);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleInputBufferTest, "NightSkyEngine.Battle.InputBuffer",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleInputBufferTest::RunTest(const FString& Parameters)
+{
+	return RunSelfTest(*this, &BattleSelfTest::TestInputBuffer);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleRandomManagerTest, "NightSkyEngine.Battle.RandomManager",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleRandomManagerTest::RunTest(const FString& Parameters)
+{
+	return RunSelfTest(*this, &BattleSelfTest::TestRandomManager);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleRpcMessageRingTest, "NightSkyEngine.Battle.RpcMessageRing",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleRpcMessageRingTest::RunTest(const FString& Parameters)
+{
+	return RunSelfTest(*this, &BattleSelfTest::TestRpcMessageRing);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleSnapshotFieldsTest, "NightSkyEngine.Battle.SnapshotFields",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleSnapshotFieldsTest::RunTest(const FString& Parameters)
+{
+	return RunSelfTest(*this, &BattleSelfTest::TestSnapshotFields);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleReplaySynctestTest, "NightSkyEngine.Battle.Replays.Synctest",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleReplaySynctestTest::RunTest(const FString& Parameters)
+{
+	return RunReplaySelfTest(*this, [](BattleSelfTest::FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay)
+	{
+		BattleSelfTest::TestReplay(Results, Name, Replay, ANightSkyGameState::StaticClass(), 8);
+	});
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleReplayCollisionPathsTest, "NightSkyEngine.Battle.Replays.CollisionPaths",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleReplayCollisionPathsTest::RunTest(const FString& Parameters)
+{
+	return RunReplaySelfTest(*this, [](BattleSelfTest::FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay)
+	{
+		BattleSelfTest::TestCollisionPaths(Results, Name, Replay, ANightSkyGameState::StaticClass());
+	});
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBattleReplayJoinTest, "NightSkyEngine.Battle.Replays.Join",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBattleReplayJoinTest::RunTest(const FString& Parameters)
+{
+	return RunReplaySelfTest(*this, [](BattleSelfTest::FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay)
+	{
+		BattleSelfTest::TestJoin(Results, Name, Replay, ANightSkyGameState::StaticClass(), 3000);
+	});
+}
+
+#endif
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class ANightSkyGameState;
+class FAutomationTestBase;
+class UReplaySaveInfo;
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Battle simulation checks, run by the BattleSelfTest commandlet and by the NightSkyEngine.Battle automation tests.
+ * They're only built where automation tests are, so shipping builds leave them out.
+ */
+namespace BattleSelfTest
+{
+	struct FSelfTestResults
+	{
+		int32 Checks = 0;
+		int32 Failures = 0;
+		// If set, failures are reported to this automation test instead of the log.
+		FAutomationTestBase* AutomationTest = nullptr;
+
+		bool Check(bool bPassed, const FString& What);
+	};
+
+	// Checks FixedMath against reference integer and float math.
+	void TestFixedMath(FSelfTestResults& Results);
+	// Checks FInputBuffer sequence matching, lenience and disabled inputs.
+	void TestInputBuffer(FSelfTestResults& Results);
+	// Checks FRandomManager sequences, which replays and netplay depend on.
+	void TestRandomManager(FSelfTestResults& Results);
+	// Checks RpcConnectionManager delivers every message in order under burst load, and its ring across threads.
+	void TestRpcMessageRing(FSelfTestResults& Results);
+
+	/**
+	 * Snapshots copy rollback data as bytes except for the snapshot fields. A name or object pointer left out of them
+	 * would reach the other machine as an index or address that means nothing there. Fields without UPROPERTY can't
+	 * be found this way.
+	 */
+	void TestSnapshotFields(FSelfTestResults& Results);
+
+	/**
+	 * Plays a replay in chunks of SyncTestDepth frames. Each chunk is simulated, rolled back and simulated again, and
+	 * both passes must produce the same checksums. Saving again after each load must match the original save.
+	 */
+	void TestReplay(FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, int32 SyncTestDepth);
+
+	/**
+	 * Plays a replay in two battles, one resolving hit collision from the cached detection pass and one with the original
+	 * serial loop. Every frame must resolve the same hits and clashes, between the same objects, in the same order.
+	 */
+	void TestCollisionPaths(FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass);
+
+	/**
+	 * Plays a replay to JoinFrame, or halfway if it's shorter, and loads a snapshot of that frame into a second battle,
+	 * the way a spectator joins a match in progress. Both battles must then play the rest of the replay identically.
+	 */
+	void TestJoin(FSelfTestResults& Results, const FString& Name, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, int32 JoinFrame);
+
+	// Directory of the replay fixtures kept in the repository, Tests/Replays in the project.
+	FString GetReplayFixtureDir();
+	// Loads every replay fixture, then every replay of the current version in ReplayDir.
+	TMap<FString, UReplaySaveInfo*> LoadReplays(const FString& ReplayDir);
+}
+
+#endif
@@ -0,0 +1,104 @@
+﻿#include "FixedPoint.h"
+
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	/** The float-based Vec2Angle_x1000 that predates FixedMath::Atan2_x1000. Kept for comparison only. */
+	int32 LegacyVec2Angle_x1000(int32 x, int32 y)
+	{
+		int32 Angle = static_cast<int>(atan2(y, x) * 57295.77791868204) % 360000;
+		if (Angle < 0)
+			Angle += 360000;
+		return Angle;
+	}
+
+	template <typename FuncType>
+	double TimeLoop(int32 Iterations, FuncType&& Func)
+	{
+		const double Start = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Iterations; i++)
+		{
+			Func(i);
+		}
+		return (FPlatformTime::Seconds() - Start) * 1e9 / Iterations;
+	}
+
+	void RunFixedMathBenchmark(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(1, FCString::Atoi(*Args[0])) : 1000000;
+
+		// Pseudo-random but fixed inputs, so runs are comparable between machines.
+		TArray<int32> Inputs;
+		Inputs.SetNumUninitialized(4096);
+		uint32 Seed = 12345;
+		for (int32& Input : Inputs)
+		{
+			Seed = Seed * 1103515245 + 12345;
+			Input = static_cast<int32>(Seed >> 8) % 2000000 - 1000000;
+		}
+		const int32 Mask = Inputs.Num() - 1;
+
+		volatile int64 Sink = 0;
+
+		const double LegacySqrt = TimeLoop(Iterations, [&](int32 i)
+		{
+			const int64 V = Inputs[i & Mask];
+			Sink += V == 0 ? 0 : isqrt_impl(V * V + i, V * V + i);
+		});
+		const double FixedSqrt = TimeLoop(Iterations, [&](int32 i)
+		{
+			const int64 V = Inputs[i & Mask];
+			Sink += FixedMath::Sqrt(V * V + i);
+		});
+		const double LegacyAtan = TimeLoop(Iterations, [&](int32 i)
+		{
+			Sink += LegacyVec2Angle_x1000(Inputs[i & Mask], Inputs[(i + 1) & Mask]);
+		});
+		const double FixedAtan = TimeLoop(Iterations, [&](int32 i)
+		{
+			Sink += FixedMath::Atan2_x1000(Inputs[(i + 1) & Mask], Inputs[i & Mask]);
+		});
+		const double FloatSinCos = TimeLoop(Iterations, [&](int32 i)
+		{
+			const double Rad = Inputs[i & Mask] % 3600 * (PI / 1800);
+			Sink += static_cast<int32>(FMath::Sin(Rad) * 1000) + static_cast<int32>(FMath::Cos(Rad) * 1000);
+		});
+		const double FixedSinCos = TimeLoop(Iterations, [&](int32 i)
+		{
+			const int32 Deg = Inputs[i & Mask] % 3600;
+			Sink += FixedMath::Sin_x1000(Deg) + FixedMath::Cos_x1000(Deg);
+		});
+		const double FloatMul = TimeLoop(Iterations, [&](int32 i)
+		{
+			Sink += static_cast<int32>(Inputs[i & Mask] % 10 * COORD_SCALE);
+		});
+		const FFixed FixedCoordScale = FFixed::FromRatio(100000, 43);
+		const double FixedMul = TimeLoop(Iterations, [&](int32 i)
+		{
+			Sink += (FixedCoordScale * (Inputs[i & Mask] % 10)).ToIntTrunc();
+		});
+
+		// Agreement between the legacy float path and the integer path.
+		int32 MaxAtanDiff = 0;
+		for (int32 i = 0; i < Inputs.Num(); i++)
+		{
+			const int32 X = Inputs[i] / 1000;
+			const int32 Y = Inputs[(i + 1) & Mask] / 1000;
+			int32 Diff = FMath::Abs(LegacyVec2Angle_x1000(X, Y) - FixedMath::Atan2_x1000(Y, X));
+			Diff = FMath::Min(Diff, 360000 - Diff);
+			MaxAtanDiff = FMath::Max(MaxAtanDiff, Diff);
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("FixedMath benchmark (%d iterations, ns per call)"), Iterations);
+		UE_LOG(LogTemp, Display, TEXT("  sqrt:        isqrt_impl %7.2f  FixedMath::Sqrt %7.2f"), LegacySqrt, FixedSqrt);
+		UE_LOG(LogTemp, Display, TEXT("  atan2:       float      %7.2f  FixedMath::Atan2 %7.2f  (max diff %d x1000 deg)"), LegacyAtan, FixedAtan, MaxAtanDiff);
+		UE_LOG(LogTemp, Display, TEXT("  sin+cos:     float      %7.2f  FixedMath        %7.2f"), FloatSinCos, FixedSinCos);
+		UE_LOG(LogTemp, Display, TEXT("  coord scale: double     %7.2f  FFixed           %7.2f"), FloatMul, FixedMul);
+	}
+}
+
+static FAutoConsoleCommand CmdFixedMathBenchmark(
+	TEXT("ns.FixedMath.Benchmark"),
+	TEXT("Compares FixedMath against the float and recursive helpers it replaces. Usage: ns.FixedMath.Benchmark [Iterations]"),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunFixedMathBenchmark));
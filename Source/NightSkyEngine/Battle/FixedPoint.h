@@ -0,0 +1,269 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Globals.h"
+
+/**
+ * How a fixed-point value behaves when a result leaves its representable range.
+ */
+enum class EFixedOverflow : uint8
+{
+	/** Results wrap around like plain int32 math. Matches existing battle code. */
+	Wrap,
+	/** Results clamp to the minimum or maximum representable value. */
+	Saturate,
+};
+
+/**
+ * Deterministic Q-format fixed-point number backed by an int32.
+ *
+ * All operations are integer only, so results are identical on every platform and compiler.
+ * Intermediate products and quotients are computed in 64 bits.
+ *
+ * @tparam FracBits Number of fractional bits.
+ * @tparam Overflow Overflow behavior of arithmetic operators.
+ */
+template <int32 FracBits, EFixedOverflow Overflow = EFixedOverflow::Wrap>
+struct TFixedPoint
+{
+	static_assert(FracBits >= 0 && FracBits < 31, "FracBits must be in [0, 30].");
+
+	static constexpr int32 One = 1 << FracBits;
+
+	int32 Raw = 0;
+
+	constexpr TFixedPoint() = default;
+
+	/** Creates a value from its raw representation. */
+	static constexpr TFixedPoint FromRaw(int32 InRaw)
+	{
+		TFixedPoint Result;
+		Result.Raw = InRaw;
+		return Result;
+	}
+
+	/** Creates a value from an integer. */
+	static constexpr TFixedPoint FromInt(int32 Value)
+	{
+		return FromRaw(Narrow(static_cast<int64>(Value) * One));
+	}
+
+	/** Creates a value from a ratio of two integers, e.g. FromRatio(43, 100) for 0.43. */
+	static constexpr TFixedPoint FromRatio(int32 Numerator, int32 Denominator)
+	{
+		return FromRaw(Narrow(static_cast<int64>(Numerator) * One / Denominator));
+	}
+
+	/** Integer part, rounded toward negative infinity. */
+	constexpr int32 ToInt() const { return Raw >> FracBits; }
+	/** Integer part, rounded toward zero like an int cast. */
+	constexpr int32 ToIntTrunc() const { return Raw / One; }
+	/** Scales the value to an integer with the given multiplier, e.g. ToScaled(1000) for _x1000 values. */
+	constexpr int32 ToScaled(int32 Scale) const { return Narrow(static_cast<int64>(Raw) * Scale / One); }
+
+	/** Only for display and debugging. Never feed the result back into the simulation. */
+	float ToFloatForDisplay() const { return static_cast<float>(Raw) / One; }
+
+	constexpr TFixedPoint operator+(TFixedPoint Other) const { return FromRaw(Narrow(static_cast<int64>(Raw) + Other.Raw)); }
+	constexpr TFixedPoint operator-(TFixedPoint Other) const { return FromRaw(Narrow(static_cast<int64>(Raw) - Other.Raw)); }
+	constexpr TFixedPoint operator-() const { return FromRaw(Narrow(-static_cast<int64>(Raw))); }
+	constexpr TFixedPoint operator*(TFixedPoint Other) const
+	{
+		return FromRaw(Narrow(static_cast<int64>(Raw) * Other.Raw >> FracBits));
+	}
+	constexpr TFixedPoint operator/(TFixedPoint Other) const
+	{
+		return FromRaw(Narrow((static_cast<int64>(Raw) << FracBits) / Other.Raw));
+	}
+	constexpr TFixedPoint operator*(int32 Value) const { return FromRaw(Narrow(static_cast<int64>(Raw) * Value)); }
+	constexpr TFixedPoint operator/(int32 Value) const { return FromRaw(Raw / Value); }
+
+	constexpr TFixedPoint& operator+=(TFixedPoint Other) { return *this = *this + Other; }
+	constexpr TFixedPoint& operator-=(TFixedPoint Other) { return *this = *this - Other; }
+	constexpr TFixedPoint& operator*=(TFixedPoint Other) { return *this = *this * Other; }
+	constexpr TFixedPoint& operator/=(TFixedPoint Other) { return *this = *this / Other; }
+
+	constexpr bool operator==(TFixedPoint Other) const { return Raw == Other.Raw; }
+	constexpr bool operator!=(TFixedPoint Other) const { return Raw != Other.Raw; }
+	constexpr bool operator<(TFixedPoint Other) const { return Raw < Other.Raw; }
+	constexpr bool operator<=(TFixedPoint Other) const { return Raw <= Other.Raw; }
+	constexpr bool operator>(TFixedPoint Other) const { return Raw > Other.Raw; }
+	constexpr bool operator>=(TFixedPoint Other) const { return Raw >= Other.Raw; }
+
+private:
+	static constexpr int32 Narrow(int64 Value)
+	{
+		if constexpr (Overflow == EFixedOverflow::Saturate)
+		{
+			if (Value > MAX_int32)
+				return MAX_int32;
+			if (Value < MIN_int32)
+				return MIN_int32;
+		}
+		return static_cast<int32>(static_cast<uint32>(Value));
+	}
+};
+
+/** Q16.16 value with wrapping overflow. */
+using FFixed = TFixedPoint<16, EFixedOverflow::Wrap>;
+/** Q16.16 value with saturating overflow. */
+using FFixedSat = TFixedPoint<16, EFixedOverflow::Saturate>;
+
+namespace FixedMath
+{
+	/**
+	 * Takes the square root of an integer without floats.
+	 * Returns the same value as isqrt(), but runs a fixed number of iterations without recursion.
+	 */
+	constexpr uint32 Sqrt(uint64 N)
+	{
+		uint64 Result = 0;
+		uint64 Bit = 1ULL << 62;
+		while (Bit > N)
+			Bit >>= 2;
+		while (Bit != 0)
+		{
+			if (N >= Result + Bit)
+			{
+				N -= Result + Bit;
+				Result = (Result >> 1) + Bit;
+			}
+			else
+			{
+				Result >>= 1;
+			}
+			Bit >>= 2;
+		}
+		return static_cast<uint32>(Result);
+	}
+
+	/** Square root of a fixed-point value. Negative inputs return zero. */
+	template <int32 FracBits, EFixedOverflow Overflow>
+	constexpr TFixedPoint<FracBits, Overflow> Sqrt(TFixedPoint<FracBits, Overflow> Value)
+	{
+		if (Value.Raw <= 0)
+			return TFixedPoint<FracBits, Overflow>();
+		return TFixedPoint<FracBits, Overflow>::FromRaw(static_cast<int32>(Sqrt(static_cast<uint64>(Value.Raw) << FracBits)));
+	}
+
+	/** Sine of an angle in tenths of a degree, scaled by 1000. Uses gSinTable. */
+	constexpr int32 Sin_x1000(int32 Deg_x10)
+	{
+		int32 Tmp1 = Deg_x10 % 3600;
+		int32 Tmp2 = Deg_x10 + 3600;
+		if (Tmp1 >= 0)
+			Tmp2 = Tmp1;
+		if (Tmp2 < 900)
+			return gSinTable[Tmp2];
+		if (Tmp2 < 1800)
+			return gSinTable[1799 - Tmp2];
+		if (Tmp2 >= 2700)
+			return -gSinTable[3599 - Tmp2];
+		return -gSinTable[Tmp2 - 1800];
+	}
+
+	/** Cosine of an angle in tenths of a degree, scaled by 1000. Uses gSinTable. */
+	constexpr int32 Cos_x1000(int32 Deg_x10)
+	{
+		return Sin_x1000((Deg_x10 + 900) % 3600);
+	}
+
+	/** Sine of an angle in tenths of a degree as a fixed-point value. */
+	template <typename FixedType = FFixed>
+	constexpr FixedType Sin(int32 Deg_x10)
+	{
+		return FixedType::FromRatio(Sin_x1000(Deg_x10), 1000);
+	}
+
+	/** Cosine of an angle in tenths of a degree as a fixed-point value. */
+	template <typename FixedType = FFixed>
+	constexpr FixedType Cos(int32 Deg_x10)
+	{
+		return FixedType::FromRatio(Cos_x1000(Deg_x10), 1000);
+	}
+
+	namespace Private
+	{
+		/** Number of arctangent table steps between a ratio of 0 and 1. */
+		constexpr int32 AtanTableSteps = 1024;
+		/** Fractional bits kept in arctangent table entries and interpolation. */
+		constexpr int32 AtanFracBits = 8;
+
+		/** Compile-time arctangent in degrees for 0 <= X <= 1 using Euler's series. Never called at runtime. */
+		constexpr double ConstexprAtanDeg(double X)
+		{
+			const double X2 = X * X;
+			const double Ratio = X2 / (1 + X2);
+			double Term = X / (1 + X2);
+			double Sum = Term;
+			for (int32 n = 1; n < 48; n++)
+			{
+				Term *= Ratio * (2.0 * n) / (2.0 * n + 1);
+				Sum += Term;
+			}
+			return Sum * (180.0 / 3.14159265358979323846);
+		}
+
+		/** Arctangent of (i / AtanTableSteps) in thousandths of a degree, with AtanFracBits extra precision. */
+		struct FAtanTable
+		{
+			int32 Values[AtanTableSteps + 1] = {};
+
+			constexpr FAtanTable()
+			{
+				for (int32 i = 0; i <= AtanTableSteps; i++)
+				{
+					Values[i] = static_cast<int32>(ConstexprAtanDeg(static_cast<double>(i) / AtanTableSteps) * 1000 * (1 << AtanFracBits) + 0.5);
+				}
+			}
+		};
+
+		inline constexpr FAtanTable gAtanTable;
+
+		/** Arctangent of Num / Den for 0 <= Num <= Den, Den > 0, in thousandths of a degree with AtanFracBits precision. */
+		constexpr int64 AtanOctant(int64 Num, int64 Den)
+		{
+			const int64 Scaled = (Num * AtanTableSteps << AtanFracBits) / Den;
+			const int64 Index = Scaled >> AtanFracBits;
+			const int64 Frac = Scaled & ((1 << AtanFracBits) - 1);
+			if (Index >= AtanTableSteps)
+				return gAtanTable.Values[AtanTableSteps];
+			const int64 Low = gAtanTable.Values[Index];
+			const int64 High = gAtanTable.Values[Index + 1];
+			return Low + ((High - Low) * Frac >> AtanFracBits);
+		}
+	}
+
+	/**
+	 * Angle of the vector (X, Y) in thousandths of a degree, in the range [0, 360000).
+	 * Integer replacement for atan2, so the result does not depend on the platform's float math.
+	 */
+	constexpr int32 Atan2_x1000(int32 Y, int32 X)
+	{
+		using namespace Private;
+		if (X == 0 && Y == 0)
+			return 0;
+
+		const int64 AbsX = X < 0 ? -static_cast<int64>(X) : X;
+		const int64 AbsY = Y < 0 ? -static_cast<int64>(Y) : Y;
+
+		int64 Angle = AbsY <= AbsX
+			              ? AtanOctant(AbsY, AbsX)
+			              : (90000LL << AtanFracBits) - AtanOctant(AbsX, AbsY);
+		if (X < 0)
+			Angle = (180000LL << AtanFracBits) - Angle;
+
+		const int32 Truncated = static_cast<int32>(Angle >> AtanFracBits);
+		if (Y < 0 && Truncated != 0)
+			return 360000 - Truncated;
+		return Truncated;
+	}
+
+	static_assert(Sqrt(0) == 0 && Sqrt(1) == 1 && Sqrt(99) == 9 && Sqrt(100) == 10, "Sqrt must floor.");
+	static_assert(Sqrt(18446744073709551615ULL) == 4294967295U, "Sqrt must handle the full uint64 range.");
+	static_assert(Sin_x1000(900) == 999 && Sin_x1000(-900) == -999 && Cos_x1000(0) == 999, "Sin/Cos table folding.");
+	static_assert(Atan2_x1000(0, 1) == 0 && Atan2_x1000(1, 0) == 90000 && Atan2_x1000(0, -1) == 180000, "Atan2 axes.");
+	static_assert(Atan2_x1000(1, 1) == 45000 && Atan2_x1000(-1, 0) == 270000, "Atan2 diagonals.");
+	static_assert((FFixed::FromInt(3) * FFixed::FromRatio(1, 2)).Raw == FFixed::FromRatio(3, 2).Raw, "Fixed multiply.");
+	static_assert((FFixedSat::FromInt(30000) * FFixedSat::FromInt(30000)).Raw == MAX_int32, "Saturating multiply.");
+}
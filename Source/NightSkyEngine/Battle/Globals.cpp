@@ -1,5 +1,7 @@
 ﻿#include "Globals.h"
 
+#include "FixedPoint.h"
+
 uint32 isqrt_impl(
 	uint64 const n,
 	uint64 const xk)
@@ -10,7 +12,5 @@ uint32 isqrt_impl(
 
 uint32 isqrt(uint64 const n)
 {
-	if (n == 0) return 0;
-	if (n == 18446744073709551615ULL) return 4294967295U;
-	return isqrt_impl(n, n);
+	return FixedMath::Sqrt(n);
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+﻿#include "HeadlessSimulation.h"
+
+#include "Actors/NightSkyGameState.h"
+#include "Engine/Engine.h"
+#include "HAL/FileManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "NightSkyEngine/Miscellaneous/ReplayInfo.h"
+
+bool UHeadlessSimulation::Start(const FBattleData& BattleData, TSubclassOf<ANightSkyGameState> GameStateClass)
+{
+	Stop();
+	if (!GameStateClass)
+		GameStateClass = ANightSkyGameState::StaticClass();
+
+	// The game instance only supplies battle settings here; it is never initialized as a running game.
+	GameInstance = NewObject<UNightSkyGameInstance>(this);
+	GameInstance->BattleData = BattleData;
+	GameInstance->FighterRunner = LocalPlay;
+	GameInstance->IsTraining = false;
+	GameInstance->IsCPUBattle = false;
+	GameInstance->IsReplay = false;
+
+	World = UWorld::CreateWorld(EWorldType::GamePreview, false, MakeUniqueObjectName(GetTransientPackage(), UWorld::StaticClass(), TEXT("HeadlessBattle")));
+	if (!World)
+		return false;
+	GEngine->CreateNewWorldContext(EWorldType::GamePreview).SetCurrentWorld(World);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.ObjectFlags = RF_Transient;
+	GameState = World->SpawnActor<ANightSkyGameState>(GameStateClass, SpawnParameters);
+	if (!GameState)
+	{
+		Stop();
+		return false;
+	}
+	GameState->InitHeadless(GameInstance);
+	return true;
+}
+
+int32 UHeadlessSimulation::Step(int32 Input1, int32 Input2)
+{
+	if (!GameState)
+		return 0;
+	return GameState->StepHeadless(Input1, Input2);
+}
+
+void UHeadlessSimulation::Stop()
+{
+	if (World)
+	{
+		if (GEngine)
+			GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+	World = nullptr;
+	GameState = nullptr;
+	GameInstance = nullptr;
+}
+
+int32 UHeadlessSimulation::GetFrameNumber() const
+{
+	if (!GameState)
+		return 0;
+	return GameState->BattleState.FrameNumber;
+}
+
+bool UHeadlessSimulation::IsMatchOver() const
+{
+	return !GameState || GameState->bMatchEnded;
+}
+
+TMap<FString, UReplaySaveInfo*> UHeadlessSimulation::LoadReplays(const FString& Directory)
+{
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(Directory / TEXT("*.sav")), true, false);
+	Files.Sort();
+
+	TMap<FString, UReplaySaveInfo*> Replays;
+	for (const FString& File : Files)
+	{
+		TArray<uint8> Bytes;
+		if (!FFileHelper::LoadFileToArray(Bytes, *(Directory / File)))
+			continue;
+		UReplaySaveInfo* Replay = Cast<UReplaySaveInfo>(UGameplayStatics::LoadGameFromMemory(Bytes));
+		if (!Replay || Replay->Version != BattleVersion)
+			continue;
+		Replays.Add(FPaths::GetBaseFilename(File), Replay);
+	}
+	return Replays;
+}
+
+void UHeadlessSimulation::BeginDestroy()
+{
+	Stop();
+	Super::BeginDestroy();
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "NightSkyEngine/Miscellaneous/NightSkyGameInstance.h"
+#include "HeadlessSimulation.generated.h"
+
+class ANightSkyGameState;
+class UReplaySaveInfo;
+
+/**
+ * @brief Runs a battle without a viewport, player controllers or presentation.
+ *
+ * The battle is spawned into a private world that is never ticked or rendered.
+ * Each call to Step advances exactly one frame with the given inputs, so matches can be run as fast as the
+ * simulation allows. Cameras, HUD, audio, particles and actor visuals are skipped.
+ */
+UCLASS(BlueprintType)
+class NIGHTSKYENGINE_API UHeadlessSimulation : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Creates the world and initializes a battle.
+	 *
+	 * @param BattleData The characters, colors, round format and random seed to use.
+	 * @param GameStateClass The game state class, for its battle scene and extension defaults.
+	 * @return Whether the battle was created.
+	 */
+	UFUNCTION(BlueprintCallable)
+	bool Start(const FBattleData& BattleData, TSubclassOf<ANightSkyGameState> GameStateClass);
+
+	/**
+	 * Advances the battle by one frame.
+	 *
+	 * @param Input1 Player 1 input bitmask.
+	 * @param Input2 Player 2 input bitmask.
+	 * @return The checksum of the battle state after the frame.
+	 */
+	UFUNCTION(BlueprintCallable)
+	int32 Step(int32 Input1, int32 Input2);
+
+	/**
+	 * Destroys the world and everything in it.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void Stop();
+
+	UFUNCTION(BlueprintPure)
+	int32 GetFrameNumber() const;
+	UFUNCTION(BlueprintPure)
+	bool IsMatchOver() const;
+	UFUNCTION(BlueprintPure)
+	ANightSkyGameState* GetGameState() const { return GameState; }
+
+	/**
+	 * Loads every replay saved with the current battle version from a directory.
+	 *
+	 * @param Directory The directory to search for .sav files.
+	 * @return The replays keyed by file name without extension, sorted by name.
+	 */
+	static TMap<FString, UReplaySaveInfo*> LoadReplays(const FString& Directory);
+
+	virtual void BeginDestroy() override;
+
+private:
+	UPROPERTY()
+	UWorld* World = nullptr;
+	UPROPERTY()
+	ANightSkyGameState* GameState = nullptr;
+	UPROPERTY()
+	UNightSkyGameInstance* GameInstance = nullptr;
+};
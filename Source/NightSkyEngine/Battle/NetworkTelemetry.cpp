@@ -0,0 +1,186 @@
+﻿#include "NetworkTelemetry.h"
+
+#include "DisplayDebugHelpers.h"
+#include "include/ggponet.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	struct FNamedHistogram
+	{
+		const TCHAR* Name;
+		const FNetworkHistogram* Histogram;
+	};
+
+	TArray<FNamedHistogram, TInlineAllocator<8>> GetHistograms(const FNetworkTelemetry& Telemetry)
+	{
+		return {
+			{ TEXT("Ping_ms"), &Telemetry.PingMs },
+			{ TEXT("PingJitter_ms"), &Telemetry.PingJitterMs },
+			{ TEXT("RollbackDepth"), &Telemetry.RollbackDepth },
+			{ TEXT("ResimulatedPerFrame"), &Telemetry.ResimulatedPerFrame },
+			{ TEXT("SendQueueLength"), &Telemetry.SendQueueLength },
+			{ TEXT("KbpsSent"), &Telemetry.KbpsSent },
+			{ TEXT("FramesAhead_quarters"), &Telemetry.FramesAheadQuarters },
+		};
+	}
+}
+
+FNetworkHistogram::FNetworkHistogram(std::initializer_list<int32> InUpperBounds)
+	: UpperBounds(InUpperBounds)
+{
+	Counts.SetNumZeroed(UpperBounds.Num() + 1);
+}
+
+void FNetworkHistogram::Add(int32 Value)
+{
+	int32 Bucket = 0;
+	while (Bucket < UpperBounds.Num() && Value > UpperBounds[Bucket])
+		Bucket++;
+	Counts[Bucket]++;
+	Max = Samples > 0 ? FMath::Max(Max, Value) : Value;
+	Samples++;
+	Sum += Value;
+}
+
+int32 FNetworkHistogram::GetPercentile(float Share) const
+{
+	const int64 Target = FMath::CeilToInt64(Samples * Share);
+	int64 Seen = 0;
+	for (int32 Bucket = 0; Bucket < UpperBounds.Num(); Bucket++)
+	{
+		Seen += Counts[Bucket];
+		if (Seen >= Target)
+			return UpperBounds[Bucket];
+	}
+	return Max;
+}
+
+FNetworkTelemetry::FNetworkTelemetry()
+	: PingMs({ 10, 20, 30, 40, 50, 60, 80, 100, 125, 150, 200, 250, 300 })
+	, PingJitterMs({ 0, 1, 2, 3, 5, 8, 12, 16, 24, 32, 48 })
+	, RollbackDepth({ 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 15 })
+	, ResimulatedPerFrame({ 0, 1, 2, 3, 4, 5, 6, 8, 10, 15 })
+	, SendQueueLength({ 0, 1, 2, 4, 8, 16, 32, 64 })
+	, KbpsSent({ 2, 4, 8, 12, 16, 24, 32, 48, 64, 96, 128 })
+	, FramesAheadQuarters({ -8, -4, -2, -1, 0, 1, 2, 4, 8, 16 })
+{
+}
+
+void FNetworkTelemetry::AddFrame(const FGGPONetworkStats& Stats, bool bPaced)
+{
+	EndRollback();
+	Frames++;
+	PacedFrames += bPaced;
+	MispredictedFrames += ResimulatedThisFrame > 0;
+	ResimulatedPerFrame.Add(ResimulatedThisFrame);
+	ResimulatedThisFrame = 0;
+
+	PingMs.Add(Stats.network.ping);
+	// Jitter is unknown until the first quality report comes back.
+	if (Stats.network.ping_jitter >= 0)
+		PingJitterMs.Add(Stats.network.ping_jitter);
+	SendQueueLength.Add(Stats.network.send_queue_len);
+	KbpsSent.Add(Stats.network.kbps_sent);
+	FramesAheadQuarters.Add(FMath::RoundToInt32(Stats.timesync.frames_ahead * 4));
+}
+
+void FNetworkTelemetry::AddRollback()
+{
+	EndRollback();
+	Rollbacks++;
+	bRollingBack = true;
+}
+
+void FNetworkTelemetry::EndRollback()
+{
+	if (bRollingBack)
+		RollbackDepth.Add(CurrentRollbackDepth);
+	bRollingBack = false;
+	CurrentRollbackDepth = 0;
+}
+
+void FNetworkTelemetry::Dump() const
+{
+	UE_LOG(LogTemp, Display, TEXT("Network telemetry: %d frames, %d rollbacks, %d frames resimulated, %.1f%% mispredicted, %d skipped, %d paced, %d interruptions"),
+		Frames, Rollbacks, ResimulatedFrames, GetPredictionErrorRate() * 100, SkippedFrames, PacedFrames, Interruptions);
+	for (const FNamedHistogram& Named : GetHistograms(*this))
+	{
+		const FNetworkHistogram& Histogram = *Named.Histogram;
+		FString Buckets;
+		for (int32 Bucket = 0; Bucket < Histogram.Counts.Num(); Bucket++)
+		{
+			if (Bucket < Histogram.UpperBounds.Num())
+				Buckets += FString::Printf(TEXT(" <=%d:%d"), Histogram.UpperBounds[Bucket], Histogram.Counts[Bucket]);
+			else
+				Buckets += FString::Printf(TEXT(" more:%d"), Histogram.Counts[Bucket]);
+		}
+		UE_LOG(LogTemp, Display, TEXT("  %-22s mean %7.2f  p50 %4d  p99 %4d  max %4d |%s"), Named.Name,
+			Histogram.GetMean(), Histogram.GetPercentile(0.5f), Histogram.GetPercentile(0.99f), Histogram.Max, *Buckets);
+	}
+}
+
+void FNetworkTelemetry::DrawDebug(FDisplayDebugManager& DisplayDebugManager) const
+{
+	DisplayDebugManager.SetDrawColor(FColor::Yellow);
+	DisplayDebugManager.DrawString(TEXT("NETPLAY"));
+	DisplayDebugManager.SetDrawColor(FColor::White);
+	if (Frames == 0)
+	{
+		DisplayDebugManager.DrawString(TEXT("No netplay frames recorded"));
+		return;
+	}
+	DisplayDebugManager.DrawString(FString::Printf(TEXT("%d frames, %d rollbacks, %d resimulated, %.1f%% mispredicted"),
+		Frames, Rollbacks, ResimulatedFrames, GetPredictionErrorRate() * 100));
+	DisplayDebugManager.DrawString(FString::Printf(TEXT("%d skipped, %d paced, %d interruptions"),
+		SkippedFrames, PacedFrames, Interruptions));
+	for (const FNamedHistogram& Named : GetHistograms(*this))
+	{
+		const FNetworkHistogram& Histogram = *Named.Histogram;
+		DisplayDebugManager.DrawString(FString::Printf(TEXT("%s: mean %.2f, p50 %d, p99 %d, max %d"), Named.Name,
+			Histogram.GetMean(), Histogram.GetPercentile(0.5f), Histogram.GetPercentile(0.99f), Histogram.Max));
+	}
+}
+
+FString FNetworkTelemetry::WriteCSV() const
+{
+	// One row per counter and per bucket, so matches can be concatenated and compared in a spreadsheet.
+	FString CSV = TEXT("Metric,UpperBound,Count");
+	CSV += LINE_TERMINATOR;
+	const TPair<const TCHAR*, int32> Counters[] = {
+		{ TEXT("Frames"), Frames },
+		{ TEXT("Rollbacks"), Rollbacks },
+		{ TEXT("ResimulatedFrames"), ResimulatedFrames },
+		{ TEXT("MispredictedFrames"), MispredictedFrames },
+		{ TEXT("SkippedFrames"), SkippedFrames },
+		{ TEXT("PacedFrames"), PacedFrames },
+		{ TEXT("Interruptions"), Interruptions },
+	};
+	for (const TPair<const TCHAR*, int32>& Counter : Counters)
+	{
+		CSV += FString::Printf(TEXT("%s,,%d"), Counter.Key, Counter.Value);
+		CSV += LINE_TERMINATOR;
+	}
+	for (const FNamedHistogram& Named : GetHistograms(*this))
+	{
+		const FNetworkHistogram& Histogram = *Named.Histogram;
+		for (int32 Bucket = 0; Bucket < Histogram.Counts.Num(); Bucket++)
+		{
+			if (Bucket < Histogram.UpperBounds.Num())
+				CSV += FString::Printf(TEXT("%s,%d,%d"), Named.Name, Histogram.UpperBounds[Bucket], Histogram.Counts[Bucket]);
+			else
+				CSV += FString::Printf(TEXT("%s,>%d,%d"), Named.Name, Histogram.UpperBounds.Last(), Histogram.Counts[Bucket]);
+			CSV += LINE_TERMINATOR;
+		}
+	}
+
+	const FString FileName = FPaths::ProfilingDir() / TEXT("Network") / FString::Printf(TEXT("Match_%s.csv"), *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(CSV, *FileName))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Network telemetry: could not write %s"), *FileName);
+		return FString();
+	}
+	UE_LOG(LogTemp, Display, TEXT("Network telemetry: wrote %d frames to %s"), Frames, *FileName);
+	return FileName;
+}
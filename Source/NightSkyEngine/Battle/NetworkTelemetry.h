@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "NetworkTelemetry.generated.h"
+
+class FDisplayDebugManager;
+struct FGGPONetworkStats;
+
+/**
+ * Counts samples in fixed buckets.
+ */
+USTRUCT(BlueprintType)
+struct NIGHTSKYENGINE_API FNetworkHistogram
+{
+	GENERATED_BODY()
+
+	// Inclusive upper bound of each bucket. Counts has one more bucket at the end for anything above the last bound.
+	UPROPERTY(BlueprintReadOnly)
+	TArray<int32> UpperBounds;
+	UPROPERTY(BlueprintReadOnly)
+	TArray<int32> Counts;
+	UPROPERTY(BlueprintReadOnly)
+	int32 Samples = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 Max = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int64 Sum = 0;
+
+	FNetworkHistogram() = default;
+	FNetworkHistogram(std::initializer_list<int32> InUpperBounds);
+
+	void Add(int32 Value);
+	//upper bound of the bucket holding the given share of samples. the overflow bucket reports Max
+	int32 GetPercentile(float Share) const;
+	float GetMean() const { return Samples > 0 ? static_cast<float>(Sum) / Samples : 0; }
+};
+
+/**
+ * Network and rollback behaviour over one netplay match.
+ *
+ * The multiplayer runner fills it in every frame. It is written to a CSV file in Saved/Profiling/Network when the
+ * match ends, ns.Net.Telemetry prints it, and ANightSkyGameState::GetNetworkTelemetry exposes it to debug widgets.
+ * "ShowDebug Netplay" draws it over the game.
+ */
+USTRUCT(BlueprintType)
+struct NIGHTSKYENGINE_API FNetworkTelemetry
+{
+	GENERATED_BODY()
+
+	FNetworkTelemetry();
+
+	// Round trip time and its jitter as GGPO reports them, sampled every frame.
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram PingMs;
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram PingJitterMs;
+	// Frames resimulated by each rollback.
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram RollbackDepth;
+	// Frames resimulated during each frame, across all of its rollbacks.
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram ResimulatedPerFrame;
+	// Packets waiting for the remote to acknowledge them.
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram SendQueueLength;
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram KbpsSent;
+	// How far ahead of the remote time sync measures this client, in quarters of a frame.
+	UPROPERTY(BlueprintReadOnly)
+	FNetworkHistogram FramesAheadQuarters;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Frames = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 Rollbacks = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 ResimulatedFrames = 0;
+	// Frames that had to roll back because a remote input was predicted wrong.
+	UPROPERTY(BlueprintReadOnly)
+	int32 MispredictedFrames = 0;
+	// Frames skipped whole and frames stretched by pacing, so the remote could catch up.
+	UPROPERTY(BlueprintReadOnly)
+	int32 SkippedFrames = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 PacedFrames = 0;
+	UPROPERTY(BlueprintReadOnly)
+	int32 Interruptions = 0;
+
+	//records a frame and the network stats at the time
+	void AddFrame(const FGGPONetworkStats& Stats, bool bPaced);
+	//records the start of a rollback
+	void AddRollback();
+	void AddResimulatedFrame() { ResimulatedFrames++; CurrentRollbackDepth++; ResimulatedThisFrame++; }
+	void AddSkippedFrame() { SkippedFrames++; }
+	void AddInterruption() { Interruptions++; }
+	float GetPredictionErrorRate() const { return Frames > 0 ? static_cast<float>(MispredictedFrames) / Frames : 0; }
+
+	//prints the counters and the histograms
+	void Dump() const;
+	//draws the counters and a summary of each histogram, for ShowDebug
+	void DrawDebug(FDisplayDebugManager& DisplayDebugManager) const;
+	//writes the match to a csv file. returns the file name, or an empty string on failure
+	FString WriteCSV() const;
+
+private:
+	void EndRollback();
+
+	int32 CurrentRollbackDepth = 0;
+	int32 ResimulatedThisFrame = 0;
+	bool bRollingBack = false;
+};
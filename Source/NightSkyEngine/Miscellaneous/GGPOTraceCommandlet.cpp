@@ -0,0 +1,35 @@
+﻿#include "GGPOTraceCommandlet.h"
+
+#include "Misc/Paths.h"
+#include "include/ggponet.h"
+
+UGGPOTraceCommandlet::UGGPOTraceCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UGGPOTraceCommandlet::Main(const FString& Params)
+{
+	FString TraceFile;
+	if (!FParse::Value(*Params, TEXT("Trace="), TraceFile))
+	{
+		UE_LOG(LogTemp, Error, TEXT("GGPOTrace: pass the trace to render with -Trace=<file>"));
+		return 1;
+	}
+	TraceFile = FPaths::ConvertRelativePathToFull(TraceFile);
+	FString TextFile = FPaths::ChangeExtension(TraceFile, TEXT("txt"));
+	FParse::Value(*Params, TEXT("Out="), TextFile);
+	TextFile = FPaths::ConvertRelativePathToFull(TextFile);
+
+	if (!GGPO_SUCCEEDED(GGPONet::ggpo_render_trace(TCHAR_TO_UTF8(*TraceFile), TCHAR_TO_UTF8(*TextFile))))
+	{
+		UE_LOG(LogTemp, Error, TEXT("GGPOTrace: could not render %s to %s, it may not be a trace from this version of GGPOUE4"),
+			*TraceFile, *TextFile);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("GGPOTrace: rendered %s to %s"), *TraceFile, *TextFile);
+	return 0;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GGPOTraceCommandlet.generated.h"
+
+/**
+ * @brief Renders a GGPO trace as text.
+ *
+ * GGPOUE4 built with GGPO_TRACE=1 records the inputs, predictions, saves and rollbacks of its sessions into a ring of
+ * binary records, without formatting anything. ns.Net.DumpTrace and a failed sync test write the ring to a .ggpotrace
+ * file. This turns one into text, one line per record, so a trace sent from another machine can be read after a desync.
+ *
+ * Usage: UnrealEditor-Cmd NightSkyEngine.uproject -run=GGPOTrace -nullrhi -Trace=<file>
+ *   -Trace=<file>  The .ggpotrace file to render.
+ *   -Out=<file>    The text file to write. Defaults to the trace with a .txt extension.
+ *
+ * Returns 0 if the trace was rendered, or 1 otherwise.
+ */
+UCLASS()
+class NIGHTSKYENGINE_API UGGPOTraceCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGGPOTraceCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
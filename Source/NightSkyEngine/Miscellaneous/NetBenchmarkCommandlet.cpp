@@ -0,0 +1,188 @@
+﻿#include "NetBenchmarkCommandlet.h"
+
+#include "NetBenchmarkTests.h"
+#include "ReplayInfo.h"
+#include "RpcConnectionManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "NightSkyEngine/Battle/BattleProfiler.h"
+#include "NightSkyEngine/Battle/HeadlessSimulation.h"
+#include "NightSkyEngine/Battle/Actors/NightSkyGameState.h"
+#include "NightSkyEngine/Battle/Actors/FighterRunners/FighterMultiplayerRunner.h"
+#include "include/connection_manager.h"
+#include "include/simulated_connection_manager.h"
+
+UNetBenchmarkCommandlet::UNetBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UNetBenchmarkCommandlet::Main(const FString& Params)
+{
+	// Benchmark matches would each write a telemetry and profile CSV when they end. The results are logged instead.
+	IConsoleVariable* WriteTelemetry = IConsoleManager::Get().FindConsoleVariable(TEXT("ns.Net.WriteTelemetry"));
+	const bool bWroteTelemetry = WriteTelemetry && WriteTelemetry->GetBool();
+	if (WriteTelemetry)
+		WriteTelemetry->Set(false, ECVF_SetByCode);
+#if NS_BATTLE_PROFILER
+	FBattleProfiler::Get().SetWriteMatchCSV(false);
+#endif
+	ON_SCOPE_EXIT
+	{
+		if (WriteTelemetry)
+			WriteTelemetry->Set(bWroteTelemetry, ECVF_SetByCode);
+#if NS_BATTLE_PROFILER
+		FBattleProfiler::Get().SetWriteMatchCSV(true);
+#endif
+	};
+
+	int32 PacketSize = 64;
+	FParse::Value(*Params, TEXT("PacketSize="), PacketSize);
+	int32 MessagesPerTick = 4;
+	FParse::Value(*Params, TEXT("MessagesPerTick="), MessagesPerTick);
+
+	int32 Frames = 3600;
+	FParse::Value(*Params, TEXT("Frames="), Frames);
+	TArray<int32> Inputs[2];
+	FString ReplayDir = FPaths::ProjectSavedDir() / TEXT("SaveGames");
+	FParse::Value(*Params, TEXT("Replays="), ReplayDir);
+	FString ReplayName;
+	const bool bReplay = FParse::Value(*Params, TEXT("Replay="), ReplayName);
+	FString SaveIntervalList;
+	FParse::Value(*Params, TEXT("SaveIntervals="), SaveIntervalList);
+	TMap<FString, UReplaySaveInfo*> Replays;
+	if (bReplay || !SaveIntervalList.IsEmpty())
+		Replays = UHeadlessSimulation::LoadReplays(ReplayDir);
+	if (bReplay)
+	{
+		UReplaySaveInfo* const* Replay = Replays.Find(ReplayName);
+		if (!Replay)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: no replay %s for version %s found in %s"), *ReplayName, *BattleVersion, *ReplayDir);
+			return 1;
+		}
+		Inputs[0] = (*Replay)->InputsP1;
+		Inputs[1] = (*Replay)->InputsP2;
+		Frames = FMath::Min3((*Replay)->LengthInFrames, Inputs[0].Num(), Inputs[1].Num());
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: playing the inputs of %s, %d frames"), *ReplayName, Frames);
+	}
+
+	bool bPassed = NetBenchmark::TestRpcPath(FMath::Clamp(MessagesPerTick, 1, static_cast<int32>(FRpcMessageRing::Capacity)),
+		FMath::Clamp(PacketSize, 1, FRpcMessage::MaxSize));
+
+	FString ProfileList;
+	FParse::Value(*Params, TEXT("NetProfile="), ProfileList);
+	FString ProfileFile = FPaths::ProjectConfigDir() / TEXT("NetworkConditions.ini");
+	FParse::Value(*Params, TEXT("NetProfiles="), ProfileFile);
+	int32 ConditionFrames = 1200;
+	FParse::Value(*Params, TEXT("ConditionFrames="), ConditionFrames);
+	FString WindowList;
+	FParse::Value(*Params, TEXT("PredictionFrames="), WindowList);
+	int32 InputQueueLength = 0;
+	FParse::Value(*Params, TEXT("InputQueueLength="), InputQueueLength);
+	int32 Spectators = GGPO_MAX_SPECTATORS;
+	FParse::Value(*Params, TEXT("Spectators="), Spectators);
+	int32 SpectatorFrames = 600;
+	FParse::Value(*Params, TEXT("SpectatorFrames="), SpectatorFrames);
+	int32 JoinFrame = 3000;
+	FParse::Value(*Params, TEXT("JoinFrame="), JoinFrame);
+	int32 SnapshotBytes = 128 * 1024;
+	FParse::Value(*Params, TEXT("SnapshotBytes="), SnapshotBytes);
+	TArray<FString> Profiles;
+	ProfileList.ParseIntoArray(Profiles, TEXT(","));
+	TArray<FString> Windows;
+	WindowList.ParseIntoArray(Windows, TEXT(","));
+	if (Windows.IsEmpty())
+		Windows.Add(FString::FromInt(GGPO_DEFAULT_PREDICTION_FRAMES));
+	TArray<FString> SaveIntervalStrings;
+	SaveIntervalList.ParseIntoArray(SaveIntervalStrings, TEXT(","));
+	TArray<int32> SaveIntervals;
+	for (const FString& SaveInterval : SaveIntervalStrings)
+	{
+		SaveIntervals.Add(FMath::Clamp(FCString::Atoi(*SaveInterval), 1, GGPO_MAX_PREDICTION_FRAMES));
+	}
+	TMap<FString, TArray<int32>> RollbackDepths;
+	for (const FString& Profile : Profiles)
+	{
+		NetworkConditions Conditions;
+		if (!AFighterMultiplayerRunner::LoadNetworkConditions(ProfileFile, Profile, 0, Conditions))
+		{
+			bPassed = false;
+			continue;
+		}
+		for (int32 i = 0; i < Windows.Num(); i++)
+		{
+			GGPOSessionLimits Limits = {};
+			Limits.prediction_frames = FCString::Atoi(*Windows[i]);
+			Limits.input_queue_length = InputQueueLength;
+			// The first window's rollbacks are the ones replayed for the save intervals.
+			TArray<int32>* ProfileRollbackDepths = i == 0 && !SaveIntervals.IsEmpty() ? &RollbackDepths.Add(Profile) : nullptr;
+			bPassed &= NetBenchmark::TestConditions(Profile, Conditions, Limits, FMath::Max(1, ConditionFrames), Inputs, ProfileRollbackDepths);
+		}
+	}
+	if (!SaveIntervals.IsEmpty())
+	{
+		TSubclassOf<ANightSkyGameState> GameStateClass = ANightSkyGameState::StaticClass();
+		FString GameStateClassPath;
+		if (FParse::Value(*Params, TEXT("GameState="), GameStateClassPath))
+			GameStateClass = LoadClass<ANightSkyGameState>(nullptr, *GameStateClassPath);
+		if (!GameStateClass)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not load game state class %s"), *GameStateClassPath);
+			bPassed = false;
+		}
+		else if (RollbackDepths.IsEmpty() || Replays.IsEmpty())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("NetBenchmark: comparing save intervals needs a -NetProfile and replays for version %s in %s, skipping it"),
+				*BattleVersion, *ReplayDir);
+		}
+		for (const TPair<FString, UReplaySaveInfo*>& Replay : Replays)
+		{
+			if (!GameStateClass || (bReplay && Replay.Key != ReplayName))
+				continue;
+			for (const TPair<FString, TArray<int32>>& Profile : RollbackDepths)
+			{
+				bPassed &= NetBenchmark::TestSaveIntervals(Replay.Key, Profile.Key, Replay.Value, GameStateClass, Profile.Value, SaveIntervals);
+			}
+		}
+	}
+	if (SpectatorFrames > 0)
+		bPassed &= NetBenchmark::TestSpectators(FMath::Clamp(Spectators, 1, GGPO_MAX_SPECTATORS), SpectatorFrames, Inputs);
+	if (JoinFrame > 0)
+		bPassed &= NetBenchmark::TestJoin(JoinFrame, FMath::Max(0, SnapshotBytes), Inputs);
+
+#if PLATFORM_LINUX
+	int32 RoundTrips = 10000;
+	FParse::Value(*Params, TEXT("RoundTrips="), RoundTrips);
+	double DriftSeconds = 20;
+	FParse::Value(*Params, TEXT("DriftSeconds="), DriftSeconds);
+	double DriftPercent = 1;
+	FParse::Value(*Params, TEXT("Drift="), DriftPercent);
+	double IdleSeconds = 4;
+	FParse::Value(*Params, TEXT("IdleSeconds="), IdleSeconds);
+	PacketSize = FMath::Clamp(PacketSize, static_cast<int32>(sizeof(uint64)), UDPConnectionManager::MAX_PACKET_SIZE);
+
+	bPassed &= NetBenchmark::TestThroughput(PacketSize);
+	bPassed &= NetBenchmark::TestRoundTrip(FMath::Max(1, RoundTrips), PacketSize);
+	bPassed &= NetBenchmark::TestSessions(FMath::Max(1, Frames), Inputs, false);
+	bPassed &= NetBenchmark::TestSessions(FMath::Max(1, Frames), Inputs, true);
+	if (DriftSeconds > 0)
+	{
+		bPassed &= NetBenchmark::TestTimeSync(DriftSeconds, DriftPercent / 100, false);
+		bPassed &= NetBenchmark::TestTimeSync(DriftSeconds, DriftPercent / 100, true);
+	}
+	if (IdleSeconds > 0)
+	{
+		bPassed &= NetBenchmark::TestIdleWake(IdleSeconds, NetBenchmark::EIdleMode::Spin);
+		bPassed &= NetBenchmark::TestIdleWake(IdleSeconds, NetBenchmark::EIdleMode::Sleep);
+		bPassed &= NetBenchmark::TestIdleWake(IdleSeconds, NetBenchmark::EIdleMode::Wait);
+	}
+#else
+	UE_LOG(LogTemp, Display, TEXT("NetBenchmark: skipping UDP tests, the batched UDP connection manager is only available on Linux"));
+#endif
+	return bPassed ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "NetBenchmarkCommandlet.generated.h"
+
+/**
+ * @brief Measures the GGPO transports over loopback.
+ *
+ * Runs these tests in one process:
+ * - RPC path: messages go through two RpcConnectionManagers for about a second, packed into one payload per tick
+ *   and then sent one per payload, reporting messages per second for both. Then, on a listen server, the server's copy
+ *   of the remote player's controller ticks, and must not send any of the host's queued messages.
+ * - Throughput: one UDP manager streams small packets to another, in batches, for about a second.
+ * - Round trip: the UDP managers bounce a packet back and forth, timing each round trip.
+ * - Sessions: two GGPO sessions with a trivial game state play against each other, reporting frames per second, ping,
+ *   the cost of adding local input and bytes per input packet. They play once with the regular input encoding and once
+ *   with compact input. Build GGPOUE4 with GGPO_UDP_MSG_POOL=0 to compare against heap-allocated messages.
+ * - Time sync: two sessions play in real time while one clock runs fast, once skipping whole frames and once with
+ *   ns.Net.TimeSyncPacing, reporting how long the clients stay apart, frames skipped and rollbacks.
+ * - Idle wake: two sessions play in real time, the second on its own thread idling between frames by spinning, by
+ *   sleeping a millisecond and by passing ggpo_idle a timeout, reporting how soon it wakes for each input and its CPU use.
+ *
+ * - Network conditions: for each -NetProfile and -PredictionFrames window, two sessions play in real time over an
+ *   in-process loopback, impaired by SimulatedConnectionManager with that profile, reporting rollbacks, frames
+ *   resimulated, the deepest rollback and frames spent waiting at the edge of the prediction window.
+ * - Spectators: two sessions play in real time while spectators watch player one, first directly and then through one
+ *   relaying spectator, reporting the bytes and packets per second player one and the relay send.
+ * - Joining: two sessions play up to -JoinFrame, then a spectator joins player one from a state snapshot and catches up
+ *   while the players go on in real time, reporting how long the snapshot took to load and the spectator to catch up.
+ * - Save intervals: for each -SaveIntervals interval, a headless battle plays each replay, saving every that many frames
+ *   and rolling back as deep as player one did on each frame under each -NetProfile with the first -PredictionFrames
+ *   window. Rollbacks resimulate from the last save, like a GGPO session with that save_interval, and must match the
+ *   first run. Reports the cost per frame of each interval and the fastest. With a replay of each matchup, this picks
+ *   ns.Net.SaveInterval for each character.
+ *
+ * The UDP tests only run where UDPConnectionManager batches with recvmmsg/sendmmsg (Linux). The other tests run everywhere.
+ * The tests themselves are declared in NetBenchmarkTests.h.
+ *
+ * Usage: UnrealEditor-Cmd NightSkyEngine.uproject -run=NetBenchmark -nullrhi
+ *   -RoundTrips=<n>       Round trips to time. Defaults to 10000.
+ *   -Frames=<n>           Frames for the two GGPO sessions to play. Defaults to 3600.
+ *   -DriftSeconds=<n>     Length of each time sync run. Defaults to 20, 0 skips them.
+ *   -Drift=<percent>      How much faster the second peer's clock runs in the time sync runs. Defaults to 1.
+ *   -IdleSeconds=<n>      Length of each idle wake run. Defaults to 4, 0 skips them.
+ *   -PacketSize=<n>       Bytes per packet. Defaults to 64.
+ *   -MessagesPerTick=<n>  Messages queued each tick for the RPC path. Defaults to 4.
+ *   -Replay=<name>        Replay whose recorded inputs the sessions play, for its whole length. Inputs are generated otherwise.
+ *   -Replays=<dir>        Directory of replay .sav files. Defaults to Saved/SaveGames.
+ *   -SaveIntervals=<a,b>  Save intervals to compare, such as 1,2,4, over every replay or only -Replay. None by default.
+ *   -GameState=<class>    Game state class path for the save interval battles. Defaults to ANightSkyGameState.
+ *   -NetProfile=<a,b>     Network condition profiles to play under, such as WiFi,Congested. None by default.
+ *   -NetProfiles=<file>   File the profiles are read from. Defaults to Config/NetworkConditions.ini.
+ *   -ConditionFrames=<n>  Frames to play under each profile. Defaults to 1200.
+ *   -PredictionFrames=<a,b> Prediction windows to play each profile with, such as 4,8,16. Defaults to GGPO's, 8.
+ *   -InputQueueLength=<n> Inputs GGPO keeps per player in the network condition tests. Defaults to GGPO's, 128.
+ *   -Spectators=<n>       Spectators in the spectator test. Defaults to 32, the most GGPO allows.
+ *   -SpectatorFrames=<n>  Frames to play in each spectator run. Defaults to 600, 0 skips them.
+ *   -JoinFrame=<n>        Frame the spectator joins at in the join test. Defaults to 3000, 0 skips it.
+ *   -SnapshotBytes=<n>    Padding added to each snapshot, standing in for a game state. Defaults to 131072.
+ *
+ * Returns 0 if every test ran, or 1 otherwise.
+ */
+UCLASS()
+class NIGHTSKYENGINE_API UNetBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UNetBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
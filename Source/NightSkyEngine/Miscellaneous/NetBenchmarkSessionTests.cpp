@@ -0,0 +1,533 @@
+﻿#include "NetBenchmarkTests.h"
+
+#include "ReplayInfo.h"
+#include "HAL/IConsoleManager.h"
+#include "NightSkyEngine/Battle/HeadlessSimulation.h"
+#include "NightSkyEngine/Battle/Actors/NightSkyGameState.h"
+#include "NightSkyEngine/Battle/Actors/FighterRunners/FighterMultiplayerRunner.h"
+#include "include/simulated_connection_manager.h"
+#include "UObject/StrongObjectPtr.h"
+
+namespace NetBenchmark
+{
+	GGPOSessionCallbacks FLoopbackPeer::CreateCallbacks()
+	{
+		GGPOSessionCallbacks Callbacks;
+		Callbacks.begin_game = [](const char*) { return true; };
+		Callbacks.save_game_state = [this](unsigned char** Buffer, int* Len, int* Checksum, int)
+		{
+			*Buffer = new unsigned char[sizeof(State) + sizeof(Frames)];
+			FMemory::Memcpy(*Buffer, &State, sizeof(State));
+			FMemory::Memcpy(*Buffer + sizeof(State), &Frames, sizeof(Frames));
+			*Len = sizeof(State) + sizeof(Frames);
+			*Checksum = State;
+			return true;
+		};
+		Callbacks.load_game_state = [this](unsigned char* Buffer, int)
+		{
+			const int32 RollbackFrom = Frames;
+			FMemory::Memcpy(&State, Buffer, sizeof(State));
+			FMemory::Memcpy(&Frames, Buffer + sizeof(State), sizeof(Frames));
+			Rollbacks++;
+			MaxRollbackFrames = FMath::Max(MaxRollbackFrames, RollbackFrom - Frames);
+			if (bRecordRollbacks)
+			{
+				RollbackDepths.SetNum(FMath::Max(RollbackDepths.Num(), RollbackFrom + 1));
+				RollbackDepths[RollbackFrom] = FMath::Max(RollbackDepths[RollbackFrom], RollbackFrom - Frames);
+			}
+			return true;
+		};
+		Callbacks.log_game_state = [](const char*, unsigned char*, int) { return true; };
+		Callbacks.free_buffer = [](void* Buffer) { delete[] static_cast<unsigned char*>(Buffer); };
+		Callbacks.advance_frame = [this](int) { AdvanceFrame(); ResimulatedFrames++; return true; };
+		Callbacks.on_event = [this](GGPOEvent* Event)
+		{
+			if (Event->code == GGPO_EVENTCODE_RUNNING)
+				bRunning = true;
+			else if (Event->code == GGPO_EVENTCODE_TIMESYNC)
+				TimeSyncFramesAhead = FMath::Max(TimeSyncFramesAhead, Event->u.timesync.frames_ahead);
+			return true;
+		};
+		if (bMakeSnapshots)
+		{
+			Callbacks.make_snapshot = [this](unsigned char* Buffer, int Len, unsigned char** Snapshot, int* SnapshotLen)
+			{
+				*SnapshotLen = Len + SnapshotPadding;
+				*Snapshot = new unsigned char[*SnapshotLen];
+				FMemory::Memcpy(*Snapshot, Buffer, Len);
+				int32 SavedState;
+				FMemory::Memcpy(&SavedState, Buffer, sizeof(SavedState));
+				for (int32 i = 0; i < SnapshotPadding; i++)
+				{
+					(*Snapshot)[Len + i] = static_cast<uint8>(i * 31 + SavedState);
+				}
+				return true;
+			};
+		}
+		Callbacks.load_snapshot = [this](unsigned char* Snapshot, int Len, int Frame)
+		{
+			const int32 StateLen = sizeof(State) + sizeof(Frames);
+			if (Len < StateLen)
+				return false;
+			int32 SavedState;
+			int32 SavedFrames;
+			FMemory::Memcpy(&SavedState, Snapshot, sizeof(SavedState));
+			FMemory::Memcpy(&SavedFrames, Snapshot + sizeof(SavedState), sizeof(SavedFrames));
+			for (int32 i = StateLen; i < Len; i++)
+			{
+				if (Snapshot[i] != static_cast<uint8>((i - StateLen) * 31 + SavedState))
+					return false;
+			}
+			if (SavedFrames != Frame)
+				return false;
+			State = SavedState;
+			Frames = SavedFrames;
+			SnapshotFrame = Frame;
+			SnapshotLoadTime = FPlatformTime::Seconds();
+			return true;
+		};
+		return Callbacks;
+	}
+
+	bool FLoopbackPeer::Start(ConnectionManager* Connection, int32 RemoteConnection, int32 PlayerIndex, bool bCompactInput, const GGPOSessionLimits* Limits)
+	{
+		GGPOSessionCallbacks Callbacks = CreateCallbacks();
+		if (GGPONet::ggpo_start_session(&Session, &Callbacks, Connection, "NetBenchmark", 2, sizeof(int32), Limits) != GGPO_OK)
+			return false;
+		GGPONet::ggpo_set_compact_input(Session, bCompactInput);
+		for (int32 i = 0; i < 2; i++)
+		{
+			GGPOPlayer Player;
+			Player.size = sizeof(GGPOPlayer);
+			Player.type = i == PlayerIndex ? GGPO_PLAYERTYPE_LOCAL : GGPO_PLAYERTYPE_REMOTE;
+			Player.player_num = i + 1;
+			Player.connection_id = RemoteConnection;
+			GGPONet::ggpo_add_player(Session, &Player, i == PlayerIndex ? &LocalHandle : &RemoteHandle);
+		}
+		GGPONet::ggpo_set_disconnect_timeout(Session, 0);
+		return true;
+	}
+
+	bool FLoopbackPeer::Spectate(ConnectionManager* Connection, int32 HostConnection)
+	{
+		GGPOSessionCallbacks Callbacks = CreateCallbacks();
+		return GGPONet::ggpo_start_spectating(&Session, &Callbacks, Connection, "NetBenchmark", 2, sizeof(int32), HostConnection) == GGPO_OK;
+	}
+
+	bool FLoopbackPeer::AddSpectator(int32 Connection)
+	{
+		GGPOPlayer Player;
+		Player.size = sizeof(GGPOPlayer);
+		Player.type = GGPO_PLAYERTYPE_SPECTATOR;
+		Player.connection_id = Connection;
+		GGPOPlayerHandle Handle;
+		return GGPONet::ggpo_add_player(Session, &Player, &Handle) == GGPO_OK;
+	}
+
+	void FLoopbackPeer::AdvanceFrame()
+	{
+		int32 Inputs[2];
+		int DisconnectFlags;
+		if (GGPONet::ggpo_synchronize_input(Session, Inputs, sizeof(Inputs), &DisconnectFlags) != GGPO_OK)
+			return;
+		State = State * 31 + Inputs[0] * 7 + Inputs[1];
+		GGPONet::ggpo_advance_frame(Session);
+		Frames++;
+		if (bRecordStates)
+		{
+			States.SetNum(FMath::Max(States.Num(), Frames + 1));
+			States[Frames] = State;
+		}
+	}
+
+	void FLoopbackPeer::Stop()
+	{
+		GGPONet::ggpo_close_session(Session);
+		Session = nullptr;
+	}
+
+	bool WaitForPeers(FLoopbackPeer (&Peers)[2], double& OutSyncTime)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		while (!(Peers[0].bRunning && Peers[1].bRunning) && FPlatformTime::Seconds() - StartTime < 10)
+		{
+			for (FLoopbackPeer& Peer : Peers)
+			{
+				GGPONet::ggpo_idle(Peer.Session, 0);
+			}
+		}
+		OutSyncTime = FPlatformTime::Seconds() - StartTime;
+		if (!(Peers[0].bRunning && Peers[1].bRunning))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: GGPO sessions did not synchronize"));
+			for (FLoopbackPeer& Peer : Peers)
+			{
+				Peer.Stop();
+			}
+			return false;
+		}
+		return true;
+	}
+
+	bool TestConditions(const FString& Profile, const NetworkConditions& Conditions, const GGPOSessionLimits& Limits, int32 Frames,
+		const TArray<int32> (&Inputs)[2], TArray<int32>* OutRollbackDepths)
+	{
+		LoopbackConnectionManager Loopbacks[2];
+		LoopbackConnectionManager::Connect(&Loopbacks[0], &Loopbacks[1]);
+		NetworkConditions SecondConditions = Conditions;
+		SecondConditions.seed++;
+		SimulatedConnectionManager Connections[2] = {
+			SimulatedConnectionManager(&Loopbacks[0], Conditions),
+			SimulatedConnectionManager(&Loopbacks[1], SecondConditions)
+		};
+
+		FLoopbackPeer Peers[2];
+		Peers[0].bRecordRollbacks = OutRollbackDepths != nullptr;
+		double SyncTime;
+		if (!Peers[0].Start(&Connections[0], 0, 0, true, &Limits) || !Peers[1].Start(&Connections[1], 0, 1, true, &Limits))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not start GGPO sessions with a %d frame prediction window and %d frame input queue"),
+				Limits.prediction_frames, Limits.input_queue_length);
+			return false;
+		}
+		if (!WaitForPeers(Peers, SyncTime))
+			return false;
+
+		int32 Stalls[2] = {};
+		double Accumulator = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		double LastTime = StartTime;
+		while (FMath::Min(Peers[0].Frames, Peers[1].Frames) < Frames && LastTime - StartTime < Frames * OneFrame * 2)
+		{
+			FPlatformProcess::Sleep(0.0005f);
+			const double Now = FPlatformTime::Seconds();
+			Accumulator += Now - LastTime;
+			LastTime = Now;
+			for (; Accumulator >= OneFrame; Accumulator -= OneFrame)
+			{
+				for (int32 i = 0; i < 2; i++)
+				{
+					FLoopbackPeer& Peer = Peers[i];
+					int32 Input = Inputs[i].Num() > 0 ? Inputs[i][Peer.Frames % Inputs[i].Num()] : (Peer.Frames / 13 + i) % 7;
+					const GGPOErrorCode Result = GGPONet::ggpo_add_local_input(Peer.Session, Peer.LocalHandle, &Input, sizeof(Input));
+					if (Result == GGPO_OK)
+						Peer.AdvanceFrame();
+					else if (Result == GGPO_ERRORCODE_PREDICTION_THRESHOLD)
+						Stalls[i]++;
+				}
+			}
+			for (FLoopbackPeer& Peer : Peers)
+			{
+				GGPONet::ggpo_idle(Peer.Session, 0);
+			}
+		}
+
+		FGGPONetworkStats Stats;
+		FMemory::Memzero(Stats);
+		GGPONet::ggpo_get_network_stats(Peers[0].Session, Peers[0].RemoteHandle, &Stats);
+		SimulatedConnectionManager::Stats Simulated;
+		Connections[0].GetStats(&Simulated);
+		const int32 Played = FMath::Min(Peers[0].Frames, Peers[1].Frames);
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %s, %d frame window: synchronized in %.0f ms, ping %d ms, jitter %d ms, %d/%d packets lost, %d duplicated, %d reordered"),
+			*Profile, Limits.prediction_frames, SyncTime * 1000, Stats.network.ping, Stats.network.ping_jitter, Simulated.lost, Simulated.sent, Simulated.duplicated, Simulated.reordered);
+		for (int32 i = 0; i < 2; i++)
+		{
+			UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %s, %d frame window: player %d played %d frames, %d rollbacks, %d frames resimulated (%.1f per rollback, deepest %d), %d frames waited at the window"),
+				*Profile, Limits.prediction_frames, i + 1, Peers[i].Frames, Peers[i].Rollbacks, Peers[i].ResimulatedFrames,
+				static_cast<double>(Peers[i].ResimulatedFrames) / FMath::Max(1, Peers[i].Rollbacks), Peers[i].MaxRollbackFrames, Stalls[i]);
+		}
+		if (OutRollbackDepths)
+		{
+			*OutRollbackDepths = MoveTemp(Peers[0].RollbackDepths);
+			OutRollbackDepths->SetNum(FMath::Max(1, Peers[0].Frames));
+		}
+		for (FLoopbackPeer& Peer : Peers)
+		{
+			Peer.Stop();
+		}
+		return Played >= Frames;
+	}
+
+	/** A battle state saved by BenchmarkSaveInterval, one of the ring GGPO would keep. */
+	struct FSavedBattleState
+	{
+		FRollbackData Data;
+		FBPRollbackData BPData;
+		int32 Frame = -1;
+	};
+
+	/**
+	 * Plays a replay on a headless battle, saving every SaveInterval frames, and on each frame rolls back as deep as
+	 * RollbackDepths says, repeating it over the replay. Each rollback loads the last save at or before the frame it
+	 * needs and resimulates from there, the way a GGPO session with that save interval does. Every resimulated frame is
+	 * checked against Checksums, which the first run fills in. Returns the seconds spent per frame, or 0 on a desync.
+	 */
+	double BenchmarkSaveInterval(const FString& Name, const FString& Profile, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, const TArray<int32>& RollbackDepths, int32 SaveInterval, TArray<int32>& Checksums)
+	{
+		const TStrongObjectPtr<UHeadlessSimulation> Simulation(NewObject<UHeadlessSimulation>());
+		if (!Simulation->Start(Replay->BattleData, GameStateClass))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: %s: could not start a battle"), *Name);
+			return 0;
+		}
+		ANightSkyGameState* GameState = Simulation->GetGameState();
+
+		// Like GGPO's ring, enough saves to reach back past the deepest rollback and the frames since the last save.
+		int32 MaxDepth = 0;
+		for (const int32 Depth : RollbackDepths)
+		{
+			MaxDepth = FMath::Max(MaxDepth, Depth);
+		}
+		TArray<FSavedBattleState> Saves;
+		Saves.SetNum(MaxDepth / SaveInterval + 2);
+
+		int32 SaveCount = 0;
+		int32 LoadCount = 0;
+		int32 ResimulatedFrames = 0;
+		double SaveSeconds = 0;
+		double LoadSeconds = 0;
+		auto Save = [&](int32 Frame)
+		{
+			const double SaveStart = FPlatformTime::Seconds();
+			int32 Checksum;
+			GameState->SaveGameState(&Checksum);
+			const int BackupFrame = GameState->LocalFrame % MaxRollbackFrames;
+			FSavedBattleState& Saved = Saves[Frame / SaveInterval % Saves.Num()];
+			Saved.Data = GameState->MainRollbackData[BackupFrame];
+			Saved.BPData = GameState->BPRollbackData[BackupFrame];
+			Saved.Frame = Frame;
+			SaveSeconds += FPlatformTime::Seconds() - SaveStart;
+			SaveCount++;
+		};
+		auto Load = [&](int32 Frame)
+		{
+			const FSavedBattleState& Saved = Saves[Frame / SaveInterval % Saves.Num()];
+			if (Saved.Frame != Frame)
+				return false;
+			const double LoadStart = FPlatformTime::Seconds();
+			const int BackupFrame = GameState->LocalFrame % MaxRollbackFrames;
+			GameState->MainRollbackData[BackupFrame] = Saved.Data;
+			GameState->BPRollbackData[BackupFrame] = Saved.BPData;
+			GameState->LoadGameState();
+			LoadSeconds += FPlatformTime::Seconds() - LoadStart;
+			LoadCount++;
+			return true;
+		};
+
+		const int32 Length = FMath::Min3(Replay->LengthInFrames, Replay->InputsP1.Num(), Replay->InputsP2.Num());
+		const double StartTime = FPlatformTime::Seconds();
+		Save(0);
+		int32 Frame = 0;
+		while (Frame < Length)
+		{
+			const int32 Checksum = Simulation->Step(Replay->InputsP1[Frame], Replay->InputsP2[Frame]);
+			if (Checksums.Num() <= Frame)
+				Checksums.Add(Checksum);
+			Frame++;
+			// A headless match that has ended can't be resumed, so it isn't rolled back.
+			if (Simulation->IsMatchOver())
+				break;
+			if (Frame % SaveInterval == 0)
+				Save(Frame);
+
+			const int32 Depth = FMath::Min(RollbackDepths[Frame % RollbackDepths.Num()], Frame);
+			if (Depth == 0)
+				continue;
+			const int32 SeekTo = Frame - Depth;
+			const int32 LoadFrame = SeekTo - SeekTo % SaveInterval;
+			if (!Load(LoadFrame))
+			{
+				UE_LOG(LogTemp, Error, TEXT("NetBenchmark: %s, save every %d frames: the save of frame %d was overwritten before the rollback at frame %d"),
+					*Name, SaveInterval, LoadFrame, Frame);
+				return 0;
+			}
+			for (int32 i = LoadFrame; i < Frame; i++)
+			{
+				if (Simulation->Step(Replay->InputsP1[i], Replay->InputsP2[i]) != Checksums[i])
+				{
+					UE_LOG(LogTemp, Error, TEXT("NetBenchmark: %s, save every %d frames: desync at frame %d after rolling back to frame %d"),
+						*Name, SaveInterval, i + 1, LoadFrame);
+					return 0;
+				}
+				if ((i + 1) % SaveInterval == 0)
+					Save(i + 1);
+				ResimulatedFrames++;
+			}
+		}
+		const double Seconds = (FPlatformTime::Seconds() - StartTime) / FMath::Max(1, Frame);
+		Simulation->Stop();
+
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %s with %s rollbacks, save every %d frames: %.1f us per frame over %d frames, %d saves (%.1f us each), %d loads (%.1f us each), %d frames resimulated"),
+			*Name, *Profile, SaveInterval, Seconds * 1e6, Frame, SaveCount, SaveSeconds * 1e6 / FMath::Max(1, SaveCount),
+			LoadCount, LoadSeconds * 1e6 / FMath::Max(1, LoadCount), ResimulatedFrames);
+		return Seconds;
+	}
+
+	bool TestSaveIntervals(const FString& Name, const FString& Profile, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, const TArray<int32>& RollbackDepths, const TArray<int32>& SaveIntervals)
+	{
+		TArray<int32> Checksums;
+		int32 BestInterval = 0;
+		double BestSeconds = 0;
+		for (const int32 SaveInterval : SaveIntervals)
+		{
+			const double Seconds = BenchmarkSaveInterval(Name, Profile, Replay, GameStateClass, RollbackDepths, SaveInterval, Checksums);
+			if (Seconds <= 0)
+				return false;
+			if (BestInterval == 0 || Seconds < BestSeconds)
+			{
+				BestInterval = SaveInterval;
+				BestSeconds = Seconds;
+			}
+		}
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %s with %s rollbacks: saving every %d frames is fastest, %.1f us per frame"),
+			*Name, *Profile, BestInterval, BestSeconds * 1e6);
+		return true;
+	}
+}
+
+#if PLATFORM_LINUX
+#include "include/connection_manager.h"
+
+namespace NetBenchmark
+{
+	bool StartPeers(FLoopbackPeer (&Peers)[2], UDPConnectionManager (&Connections)[2], bool bCompactInput, double& OutSyncTime)
+	{
+		int32 AToB, BToA;
+		if (!ConnectPair(Connections[0], Connections[1], AToB, BToA))
+			return false;
+		if (!Peers[0].Start(&Connections[0], AToB, 0, bCompactInput) || !Peers[1].Start(&Connections[1], BToA, 1, bCompactInput))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not start GGPO sessions"));
+			return false;
+		}
+		return WaitForPeers(Peers, OutSyncTime);
+	}
+
+	bool TestSessions(int32 Frames, const TArray<int32> (&Inputs)[2], bool bCompactInput)
+	{
+		UDPConnectionManager Connections[2];
+		FLoopbackPeer Peers[2];
+		double SyncTime;
+		if (!StartPeers(Peers, Connections, bCompactInput, SyncTime))
+			return false;
+
+		// Adding local input sends it to the other peer, so its cost is dominated by UdpProtocol::SendInput.
+		uint64 InputCycles = 0;
+		int32 InputCalls = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		while (FMath::Min(Peers[0].Frames, Peers[1].Frames) < Frames && FPlatformTime::Seconds() - StartTime < 60)
+		{
+			for (int32 i = 0; i < 2; i++)
+			{
+				FLoopbackPeer& Peer = Peers[i];
+				int32 Input = Inputs[i].Num() > 0 ? Inputs[i][Peer.Frames % Inputs[i].Num()] : (Peer.Frames * (i + 3)) & 0xFF;
+				if (Peer.Frames < Frames)
+				{
+					const uint64 InputStart = FPlatformTime::Cycles64();
+					const GGPOErrorCode Result = GGPONet::ggpo_add_local_input(Peer.Session, Peer.LocalHandle, &Input, sizeof(Input));
+					InputCycles += FPlatformTime::Cycles64() - InputStart;
+					InputCalls++;
+					if (Result == GGPO_OK)
+						Peer.AdvanceFrame();
+				}
+				GGPONet::ggpo_idle(Peer.Session, 0);
+			}
+		}
+		const double Elapsed = FPlatformTime::Seconds() - StartTime;
+		FGGPONetworkStats Stats;
+		FMemory::Memzero(Stats);
+		GGPONet::ggpo_get_network_stats(Peers[0].Session, Peers[0].RemoteHandle, &Stats);
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: sessions synchronized in %.0f ms, played %d frames at %.0f frames/s, ping %d ms, %d kbps"),
+			SyncTime * 1000, FMath::Min(Peers[0].Frames, Peers[1].Frames), FMath::Min(Peers[0].Frames, Peers[1].Frames) / Elapsed,
+			Stats.network.ping, Stats.network.kbps_sent);
+		const double InputMicroseconds = FMath::Max(CyclesToMicroseconds(InputCycles) / FMath::Max(1, InputCalls), 0.001);
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: add_local_input averaged %.2f us over %d calls (%.0f calls/s), message pool high water %d, %d heap allocations"),
+			InputMicroseconds, InputCalls, 1e6 / InputMicroseconds, Stats.network.msg_pool_high_water, Stats.network.msg_pool_overflows);
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %s input encoding, %d input packets, %.1f bytes per input packet before UDP/IP headers"),
+			Stats.network.compact_input ? TEXT("compact") : TEXT("regular"), Stats.network.input_packets_sent,
+			static_cast<double>(Stats.network.input_bytes_sent) / FMath::Max(1, Stats.network.input_packets_sent));
+		const bool bPassed = FMath::Min(Peers[0].Frames, Peers[1].Frames) >= Frames;
+		for (FLoopbackPeer& Peer : Peers)
+		{
+			Peer.Stop();
+		}
+		return bPassed;
+	}
+
+	bool TestTimeSync(double Seconds, double Drift, bool bPacing)
+	{
+		IConsoleVariable* PacingVar = IConsoleManager::Get().FindConsoleVariable(TEXT("ns.Net.TimeSyncPacing"));
+		const bool bWasPacing = PacingVar->GetBool();
+		PacingVar->Set(bPacing, ECVF_SetByCode);
+
+		UDPConnectionManager Connections[2];
+		FLoopbackPeer Peers[2];
+		double SyncTime;
+		if (!StartPeers(Peers, Connections, true, SyncTime))
+		{
+			PacingVar->Set(bWasPacing, ECVF_SetByCode);
+			return false;
+		}
+
+		const double ClockRates[2] = { 1, 1 + Drift };
+		double Accumulators[2] = {};
+		int32 MultipliedFramesAhead[2] = {};
+		int32 SkippedFrames[2] = {};
+		int32 MaxGap = 0;
+		double LastApartTime = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		double LastTime = StartTime;
+		while (LastTime - StartTime < Seconds)
+		{
+			FPlatformProcess::Sleep(0.0005f);
+			const double Now = FPlatformTime::Seconds();
+			for (int32 i = 0; i < 2; i++)
+			{
+				FLoopbackPeer& Peer = Peers[i];
+				if (Peer.TimeSyncFramesAhead > 0 && AFighterMultiplayerRunner::ShouldSkipFrames(Peer.TimeSyncFramesAhead))
+					MultipliedFramesAhead[i] = Peer.TimeSyncFramesAhead * TimesyncMultiplier;
+				Peer.TimeSyncFramesAhead = 0;
+
+				FGGPONetworkStats Stats;
+				FMemory::Memzero(Stats);
+				GGPONet::ggpo_get_network_stats(Peer.Session, Peer.RemoteHandle, &Stats);
+				const float Interval = AFighterMultiplayerRunner::GetPacedFrameInterval(Stats.timesync.frames_ahead);
+				Accumulators[i] += (Now - LastTime) * ClockRates[i];
+				while (Accumulators[i] >= Interval)
+				{
+					if (MultipliedFramesAhead[i] > 0 && MultipliedFramesAhead[i]-- % TimesyncMultiplier == 0)
+					{
+						Accumulators[i] = 0;
+						SkippedFrames[i]++;
+						break;
+					}
+					int32 Input = (Peer.Frames / 17 + i) % 5;
+					if (GGPONet::ggpo_add_local_input(Peer.Session, Peer.LocalHandle, &Input, sizeof(Input)) == GGPO_OK)
+						Peer.AdvanceFrame();
+					Accumulators[i] -= Interval;
+				}
+				GGPONet::ggpo_idle(Peer.Session, 0);
+			}
+			LastTime = Now;
+
+			const int32 Gap = FMath::Abs(Peers[0].Frames - Peers[1].Frames);
+			MaxGap = FMath::Max(MaxGap, Gap);
+			if (Gap > 1)
+				LastApartTime = Now - StartTime;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: time sync %s, %.1f%% drift over %.0f s: last more than a frame apart at %.1f s, widest gap %d frames, frames skipped %d/%d, rollbacks %d/%d, frames resimulated %d/%d"),
+			bPacing ? TEXT("pacing") : TEXT("skipping"), Drift * 100, Seconds, LastApartTime, MaxGap,
+			SkippedFrames[0], SkippedFrames[1], Peers[0].Rollbacks, Peers[1].Rollbacks, Peers[0].ResimulatedFrames, Peers[1].ResimulatedFrames);
+		const bool bPassed = FMath::Min(Peers[0].Frames, Peers[1].Frames) > 0;
+		for (FLoopbackPeer& Peer : Peers)
+		{
+			Peer.Stop();
+		}
+		PacingVar->Set(bWasPacing, ECVF_SetByCode);
+		return bPassed;
+	}
+}
+#endif
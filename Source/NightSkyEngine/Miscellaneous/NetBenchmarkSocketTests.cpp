@@ -0,0 +1,344 @@
+﻿#include "NetBenchmarkTests.h"
+
+#include "NetworkPawn.h"
+#include "RpcConnectionManager.h"
+#include "Engine/Engine.h"
+#include "NightSkyEngine/Battle/Actors/NightSkyGameState.h"
+#include "NightSkyEngine/Battle/Actors/NightSkyPlayerController.h"
+#include "NightSkyEngine/Battle/Actors/FighterRunners/FighterMultiplayerRunner.h"
+
+namespace NetBenchmark
+{
+	/**
+	 * Streams messages between two RpcConnectionManagers for about a second, the way the player controller and
+	 * network pawn carry them, and returns messages delivered per second.
+	 * Each tick queues MessagesPerTick messages, then either packs them into payloads or sends one payload per message.
+	 */
+	double BenchmarkRpcPath(int32 MessagesPerTick, int32 PacketSize, bool bCoalesce, double& OutRpcsPerTick)
+	{
+		RpcConnectionManager Sender;
+		RpcConnectionManager Receiver;
+		int8 Packet[FRpcMessage::MaxSize] = {};
+		char Received[FRpcMessage::MaxSize];
+		TArray<int8> Payload;
+		uint64 Delivered = 0;
+		uint64 Rpcs = 0;
+		uint64 Ticks = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		double Elapsed = 0;
+		while (Elapsed < 1.0)
+		{
+			for (int32 i = 0; i < MessagesPerTick; i++)
+			{
+				Sender.SendTo(reinterpret_cast<const char*>(Packet), PacketSize, 0, 0);
+			}
+			if (bCoalesce)
+			{
+				while (Sender.PackSendSchedule(Payload))
+				{
+					// RPC parameters are copied when they're sent.
+					const TArray<int8> Rpc = Payload;
+					Receiver.UnpackToReceiveSchedule(Rpc);
+					Rpcs++;
+				}
+			}
+			else
+			{
+				while (const FRpcMessage* Message = Sender.sendSchedule.Peek())
+				{
+					const TArray<int8> Rpc(Message->Data, Message->Size);
+					Receiver.receiveSchedule.Push(Rpc.GetData(), Rpc.Num());
+					Sender.sendSchedule.Pop();
+					Rpcs++;
+				}
+			}
+			int ConnectionId;
+			while (Receiver.RecvFrom(Received, sizeof(Received), 0, &ConnectionId) > 0)
+			{
+				Delivered++;
+			}
+			Ticks++;
+			Elapsed = FPlatformTime::Seconds() - StartTime;
+		}
+		OutRpcsPerTick = static_cast<double>(Rpcs) / FMath::Max<uint64>(1, Ticks);
+		return Delivered == Ticks * MessagesPerTick ? Delivered / Elapsed : 0;
+	}
+
+	/**
+	 * On a listen server, the server's copy of the remote client's controller ticks alongside the host's own. It must
+	 * leave the host's pawn, runner and send ring alone, or it takes messages meant for the client.
+	 */
+	bool TestRpcPathListenServer(int32 MessagesPerTick, int32 PacketSize)
+	{
+		UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, MakeUniqueObjectName(GetTransientPackage(), UWorld::StaticClass(), TEXT("ListenServer")));
+		World->URL.AddOption(TEXT("Listen"));
+		GEngine->CreateNewWorldContext(EWorldType::Game).SetCurrentWorld(World);
+
+		RpcConnectionManager HostConnection;
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.ObjectFlags = RF_Transient;
+		AFighterMultiplayerRunner* Runner = World->SpawnActor<AFighterMultiplayerRunner>(SpawnParameters);
+		ANetworkPawn* HostPawn = World->SpawnActor<ANetworkPawn>(SpawnParameters);
+		ANetworkPawn* ClientPawn = World->SpawnActor<ANetworkPawn>(SpawnParameters);
+		ANightSkyPlayerController* ClientController = World->SpawnActor<ANightSkyPlayerController>(SpawnParameters);
+		Runner->connectionManager = &HostConnection;
+		HostPawn->FighterMultiplayerRunner = Runner;
+		ClientController->SetPawn(ClientPawn);
+
+		int8 Packet[FRpcMessage::MaxSize] = {};
+		for (int32 i = 0; i < MessagesPerTick; i++)
+		{
+			HostConnection.SendTo(reinterpret_cast<const char*>(Packet), PacketSize, 0, 0);
+		}
+		const bool bRemote = World->GetNetMode() == NM_ListenServer && !ClientController->IsLocalController();
+		for (int32 i = 0; i < 8 && bRemote; i++)
+		{
+			ClientController->Tick(OneFrame);
+		}
+		const int32 Queued = HostConnection.sendSchedule.Num();
+		const bool bUntouched = ClientPawn->FighterMultiplayerRunner == nullptr && HostPawn->FighterMultiplayerRunner == Runner;
+
+		Runner->connectionManager = nullptr;
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+
+		if (!bRemote)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not set up a remote player's controller on a listen server"));
+			return false;
+		}
+		if (Queued != MessagesPerTick || !bUntouched)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: a remote player's controller on a listen server sent %d of the host's %d queued messages"),
+				MessagesPerTick - Queued, MessagesPerTick);
+			return false;
+		}
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: a remote player's controller on a listen server left the host's messages alone"));
+		return true;
+	}
+
+	bool TestRpcPath(int32 MessagesPerTick, int32 PacketSize)
+	{
+		double SingleRpcsPerTick, CoalescedRpcsPerTick;
+		const double Single = BenchmarkRpcPath(MessagesPerTick, PacketSize, false, SingleRpcsPerTick);
+		const double Coalesced = BenchmarkRpcPath(MessagesPerTick, PacketSize, true, CoalescedRpcsPerTick);
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: RPC path with %d messages of %d bytes per tick: %.0f messages/s coalesced (%.2f RPCs per tick), %.0f messages/s one per RPC (%.2f RPCs per tick)"),
+			MessagesPerTick, PacketSize, Coalesced, CoalescedRpcsPerTick, Single, SingleRpcsPerTick);
+		if (Single == 0 || Coalesced == 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: the RPC path lost messages"));
+			return false;
+		}
+		return TestRpcPathListenServer(MessagesPerTick, PacketSize);
+	}
+}
+
+#if PLATFORM_LINUX
+#include <atomic>
+#include <time.h>
+#include "Async/Async.h"
+#include "include/connection_manager.h"
+
+namespace NetBenchmark
+{
+	bool ConnectPair(UDPConnectionManager& A, UDPConnectionManager& B, int32& OutAToB, int32& OutBToA)
+	{
+		A.Init(0);
+		B.Init(0);
+		if (A.GetPort() == 0 || B.GetPort() == 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not bind loopback sockets"));
+			return false;
+		}
+		OutAToB = A.AddConnection("127.0.0.1", B.GetPort());
+		OutBToA = B.AddConnection("127.0.0.1", A.GetPort());
+		return OutAToB >= 0 && OutBToA >= 0;
+	}
+
+	bool TestThroughput(int32 PacketSize)
+	{
+		UDPConnectionManager Sender;
+		UDPConnectionManager Receiver;
+		int32 ToReceiver, ToSender;
+		if (!ConnectPair(Sender, Receiver, ToReceiver, ToSender))
+			return false;
+
+		// Keep a bounded number of packets in flight so the socket buffer doesn't overflow and drop them.
+		constexpr int32 MaxInFlight = 4 * UDPConnectionManager::BATCH_SIZE;
+		char Packet[UDPConnectionManager::MAX_PACKET_SIZE] = {};
+		char Received[UDPConnectionManager::MAX_PACKET_SIZE];
+		uint64 Sent = 0;
+		uint64 Delivered = 0;
+		uint64 Dropped = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		double LastDelivery = StartTime;
+		double Elapsed = 0;
+		while (Elapsed < 1.0)
+		{
+			while (Sent - Delivered - Dropped < MaxInFlight)
+			{
+				Sender.SendTo(Packet, PacketSize, 0, ToReceiver);
+				Sent++;
+			}
+			Sender.Flush();
+			int ConnectionId;
+			while (Receiver.RecvFrom(Received, sizeof(Received), 0, &ConnectionId) > 0)
+			{
+				Delivered++;
+				LastDelivery = FPlatformTime::Seconds();
+			}
+			// Loopback doesn't reorder, so anything outstanding this long after the last delivery was dropped.
+			if (FPlatformTime::Seconds() - LastDelivery > 0.01)
+			{
+				Dropped = Sent - Delivered;
+				LastDelivery = FPlatformTime::Seconds();
+			}
+			Elapsed = FPlatformTime::Seconds() - StartTime;
+		}
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: throughput %.0f packets/s of %d bytes (%.1f MB/s), %llu of %llu packets dropped"),
+			Delivered / Elapsed, PacketSize, Delivered * PacketSize / Elapsed / (1024 * 1024), Dropped, Sent);
+		return Delivered > 0;
+	}
+
+	bool TestRoundTrip(int32 RoundTrips, int32 PacketSize)
+	{
+		UDPConnectionManager A;
+		UDPConnectionManager B;
+		int32 AToB, BToA;
+		if (!ConnectPair(A, B, AToB, BToA))
+			return false;
+
+		char Packet[UDPConnectionManager::MAX_PACKET_SIZE] = {};
+		TArray<uint64> Times;
+		Times.Reserve(RoundTrips);
+		for (int32 i = 0; i < RoundTrips; i++)
+		{
+			const uint64 Start = FPlatformTime::Cycles64();
+			int ConnectionId;
+			A.SendTo(Packet, PacketSize, 0, AToB);
+			A.Flush();
+			while (B.RecvFrom(Packet, sizeof(Packet), 0, &ConnectionId) <= 0)
+			{
+				if (FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - Start) > 1)
+				{
+					UE_LOG(LogTemp, Error, TEXT("NetBenchmark: round trip %d timed out"), i);
+					return false;
+				}
+			}
+			B.SendTo(Packet, PacketSize, 0, BToA);
+			B.Flush();
+			while (A.RecvFrom(Packet, sizeof(Packet), 0, &ConnectionId) <= 0)
+			{
+				if (FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - Start) > 1)
+				{
+					UE_LOG(LogTemp, Error, TEXT("NetBenchmark: round trip %d timed out"), i);
+					return false;
+				}
+			}
+			Times.Add(FPlatformTime::Cycles64() - Start);
+		}
+
+		Times.Sort();
+		const int32 Last = Times.Num() - 1;
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %d round trips, p50 %.2f us, p99 %.2f us, max %.2f us"),
+			Times.Num(), CyclesToMicroseconds(Times[Last / 2]), CyclesToMicroseconds(Times[Last * 99 / 100]), CyclesToMicroseconds(Times[Last]));
+		return true;
+	}
+
+	double ThreadCpuSeconds()
+	{
+		timespec Time;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+		return Time.tv_sec + Time.tv_nsec / 1e9;
+	}
+
+	bool TestIdleWake(double Seconds, EIdleMode Mode)
+	{
+		UDPConnectionManager Connections[2];
+		FLoopbackPeer Peers[2];
+		double SyncTime;
+		if (!StartPeers(Peers, Connections, true, SyncTime))
+			return false;
+
+		constexpr double FrameTime = 1.0 / 60;
+		// When the first peer last sent an input that the second hasn't woken for yet, or 0.
+		std::atomic<double> SendTime(0);
+		std::atomic<bool> bStop(false);
+		TArray<double> Latencies;
+		double CpuSeconds = 0;
+		double WallSeconds = 0;
+		TFuture<void> Waiter = Async(EAsyncExecution::Thread, [&]
+		{
+			FLoopbackPeer& Peer = Peers[1];
+			const double CpuStart = ThreadCpuSeconds();
+			const double StartTime = FPlatformTime::Seconds();
+			double NextFrame = StartTime;
+			while (!bStop)
+			{
+				switch (Mode)
+				{
+				case EIdleMode::Spin:
+					GGPONet::ggpo_idle(Peer.Session, 0);
+					break;
+				case EIdleMode::Sleep:
+					GGPONet::ggpo_idle(Peer.Session, 0);
+					FPlatformProcess::Sleep(0.001f);
+					break;
+				case EIdleMode::Wait:
+					GGPONet::ggpo_idle(Peer.Session, FMath::Max(1, FMath::CeilToInt((NextFrame - FPlatformTime::Seconds()) * 1000)));
+					break;
+				}
+				const double Now = FPlatformTime::Seconds();
+				double Sent = SendTime;
+				if (Sent > 0 && Sent < Now && SendTime.compare_exchange_strong(Sent, 0))
+					Latencies.Add(Now - Sent);
+				if (Now >= NextFrame)
+				{
+					int32 Input = (Peer.Frames / 13 + 1) % 7;
+					if (GGPONet::ggpo_add_local_input(Peer.Session, Peer.LocalHandle, &Input, sizeof(Input)) == GGPO_OK)
+						Peer.AdvanceFrame();
+					NextFrame += FrameTime;
+				}
+			}
+			CpuSeconds = ThreadCpuSeconds() - CpuStart;
+			WallSeconds = FPlatformTime::Seconds() - StartTime;
+		});
+
+		FLoopbackPeer& Sender = Peers[0];
+		const double StartTime = FPlatformTime::Seconds();
+		double NextFrame = StartTime;
+		while (FPlatformTime::Seconds() - StartTime < Seconds)
+		{
+			if (FPlatformTime::Seconds() >= NextFrame)
+			{
+				int32 Input = (Sender.Frames / 13) % 7;
+				const double Now = FPlatformTime::Seconds();
+				if (GGPONet::ggpo_add_local_input(Sender.Session, Sender.LocalHandle, &Input, sizeof(Input)) == GGPO_OK)
+				{
+					SendTime = Now;
+					Sender.AdvanceFrame();
+				}
+				NextFrame += FrameTime;
+			}
+			GGPONet::ggpo_idle(Sender.Session, 0);
+			FPlatformProcess::Sleep(0.0003f);
+		}
+		bStop = true;
+		Waiter.Wait();
+
+		static const TCHAR* ModeNames[] = { TEXT("spinning"), TEXT("sleeping 1 ms"), TEXT("waiting on the socket") };
+		Latencies.Sort();
+		const int32 Last = Latencies.Num() - 1;
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: idle %s, %d frames/%d frames, woke for %d inputs, p50 %.0f us, p99 %.0f us, %.1f%% of a core"),
+			ModeNames[static_cast<int32>(Mode)], Peers[0].Frames, Peers[1].Frames, Latencies.Num(),
+			Last >= 0 ? Latencies[Last / 2] * 1e6 : 0, Last >= 0 ? Latencies[Last * 99 / 100] * 1e6 : 0,
+			WallSeconds > 0 ? CpuSeconds / WallSeconds * 100 : 0);
+		const bool bPassed = Latencies.Num() > 0 && FMath::Min(Peers[0].Frames, Peers[1].Frames) > 0;
+		for (FLoopbackPeer& Peer : Peers)
+		{
+			Peer.Stop();
+		}
+		return bPassed;
+	}
+}
+#endif
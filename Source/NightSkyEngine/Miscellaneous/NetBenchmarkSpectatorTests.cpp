@@ -0,0 +1,285 @@
+﻿#include "NetBenchmarkTests.h"
+
+#include "NightSkyEngine/Battle/Actors/NightSkyGameState.h"
+#include "include/simulated_connection_manager.h"
+
+namespace NetBenchmark
+{
+	struct FSpectatorResult
+	{
+		double PlayerBytesPerSecond = 0;
+		double PlayerPacketsPerSecond = 0;
+		double RelayBytesPerSecond = 0;
+		int32 SlowestSpectatorFrames = 0;
+		bool bStatesMatch = true;
+	};
+
+	/**
+	 * Plays two sessions in real time over in-process loopbacks while Spectators watch player one, either directly or
+	 * through one relaying spectator, and measures what player one and the relay send.
+	 */
+	bool RunSpectators(int32 Spectators, bool bRelay, int32 Frames, const TArray<int32> (&Inputs)[2], FSpectatorResult& OutResult)
+	{
+		// The players are 0 and 1, the relay 2 and the spectators follow.
+		TArray<TUniquePtr<LoopbackConnectionManager>> Connections;
+		for (int32 i = 0; i < Spectators + 3; i++)
+		{
+			Connections.Add(MakeUnique<LoopbackConnectionManager>());
+		}
+		LoopbackConnectionManager::Connect(Connections[0].Get(), Connections[1].Get());
+
+		// Sessions keep pointers to their peers, so the audience is never reallocated.
+		FLoopbackPeer Peers[2];
+		FLoopbackPeer Relay;
+		TArray<FLoopbackPeer> Audience;
+		Audience.SetNum(Spectators);
+		bool bStarted = Peers[0].Start(Connections[0].Get(), 0, 0, true) && Peers[1].Start(Connections[1].Get(), 0, 1, true);
+		FLoopbackPeer* Host = &Peers[0];
+		if (bRelay)
+		{
+			LoopbackConnectionManager::Connect(Connections[0].Get(), Connections[2].Get());
+			bStarted = bStarted && Peers[0].AddSpectator(1) && Relay.Spectate(Connections[2].Get(), 0);
+			Host = &Relay;
+		}
+		const int32 HostConnection = bRelay ? 2 : 0;
+		for (int32 i = 0; i < Spectators; i++)
+		{
+			// Connection 0 of the host is the other player or player one, so spectators start at 1.
+			LoopbackConnectionManager::Connect(Connections[HostConnection].Get(), Connections[i + 3].Get());
+			bStarted = bStarted && Host->AddSpectator(i + 1) && Audience[i].Spectate(Connections[i + 3].Get(), 0);
+		}
+
+		auto StopAll = [&]()
+		{
+			for (FLoopbackPeer& Spectator : Audience)
+			{
+				Spectator.Stop();
+			}
+			Relay.Stop();
+			Peers[0].Stop();
+			Peers[1].Stop();
+		};
+		if (!bStarted)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not start GGPO sessions with %d spectators"), Spectators);
+			StopAll();
+			return false;
+		}
+
+		// Spectators play whatever has arrived, as fast as it arrives.
+		auto Idle = [&]()
+		{
+			for (FLoopbackPeer& Peer : Peers)
+			{
+				GGPONet::ggpo_idle(Peer.Session, 0);
+			}
+			if (bRelay)
+				GGPONet::ggpo_idle(Relay.Session, 0);
+			for (FLoopbackPeer& Spectator : Audience)
+			{
+				GGPONet::ggpo_idle(Spectator.Session, 0);
+				for (int32 Before = -1; Before != Spectator.Frames;)
+				{
+					Before = Spectator.Frames;
+					Spectator.AdvanceFrame();
+				}
+			}
+		};
+
+		// The players wait for their spectators to synchronize before they start.
+		double StartTime = FPlatformTime::Seconds();
+		while (!(Peers[0].bRunning && Peers[1].bRunning) && FPlatformTime::Seconds() - StartTime < 10)
+		{
+			Idle();
+		}
+		if (!(Peers[0].bRunning && Peers[1].bRunning))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: GGPO sessions with %d spectators did not synchronize"), Spectators);
+			StopAll();
+			return false;
+		}
+
+		const uint64 StartBytes = Connections[0]->GetBytesSent();
+		const uint64 StartPackets = Connections[0]->GetPacketsSent();
+		const uint64 StartRelayBytes = Connections[2]->GetBytesSent();
+		double Accumulator = 0;
+		StartTime = FPlatformTime::Seconds();
+		double LastTime = StartTime;
+		while (FMath::Min(Peers[0].Frames, Peers[1].Frames) < Frames && LastTime - StartTime < Frames * OneFrame * 2)
+		{
+			FPlatformProcess::Sleep(0.0005f);
+			const double Now = FPlatformTime::Seconds();
+			Accumulator += Now - LastTime;
+			LastTime = Now;
+			for (; Accumulator >= OneFrame; Accumulator -= OneFrame)
+			{
+				for (int32 i = 0; i < 2; i++)
+				{
+					FLoopbackPeer& Peer = Peers[i];
+					int32 Input = Inputs[i].Num() > 0 ? Inputs[i][Peer.Frames % Inputs[i].Num()] : (Peer.Frames / 13 + i) % 7;
+					if (GGPONet::ggpo_add_local_input(Peer.Session, Peer.LocalHandle, &Input, sizeof(Input)) == GGPO_OK)
+						Peer.AdvanceFrame();
+				}
+			}
+			Idle();
+		}
+		const double Elapsed = FMath::Max(LastTime - StartTime, 1e-3);
+		OutResult.PlayerBytesPerSecond = (Connections[0]->GetBytesSent() - StartBytes) / Elapsed;
+		OutResult.PlayerPacketsPerSecond = (Connections[0]->GetPacketsSent() - StartPackets) / Elapsed;
+		OutResult.RelayBytesPerSecond = (Connections[2]->GetBytesSent() - StartRelayBytes) / Elapsed;
+
+		// Let the last batches reach the spectators.
+		const double DrainTime = FPlatformTime::Seconds();
+		while (FPlatformTime::Seconds() - DrainTime < 0.5)
+		{
+			FPlatformProcess::Sleep(0.0005f);
+			Idle();
+		}
+		const int32 Played = FMath::Min(Peers[0].Frames, Peers[1].Frames);
+		OutResult.SlowestSpectatorFrames = Played;
+		for (const FLoopbackPeer& Spectator : Audience)
+		{
+			OutResult.SlowestSpectatorFrames = FMath::Min(OutResult.SlowestSpectatorFrames, Spectator.Frames);
+			if (Spectator.Frames == Peers[0].Frames && Spectator.State != Peers[0].State)
+				OutResult.bStatesMatch = false;
+		}
+		StopAll();
+		return Played >= Frames;
+	}
+
+	bool TestSpectators(int32 Spectators, int32 Frames, const TArray<int32> (&Inputs)[2])
+	{
+		FSpectatorResult Direct;
+		FSpectatorResult Relayed;
+		if (!RunSpectators(Spectators, false, Frames, Inputs, Direct) || !RunSpectators(Spectators, true, Frames, Inputs, Relayed))
+			return false;
+
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %d spectators watching directly: player one sends %.1f KB/s in %.0f packets/s"),
+			Spectators, Direct.PlayerBytesPerSecond / 1024, Direct.PlayerPacketsPerSecond);
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: %d spectators behind a relay: player one sends %.1f KB/s in %.0f packets/s, the relay %.1f KB/s"),
+			Spectators, Relayed.PlayerBytesPerSecond / 1024, Relayed.PlayerPacketsPerSecond, Relayed.RelayBytesPerSecond / 1024);
+
+		// The players' last few frames may never be confirmed, so spectators can end a little behind.
+		bool bPassed = true;
+		for (const FSpectatorResult* Result : { &Direct, &Relayed })
+		{
+			if (Result->SlowestSpectatorFrames < Frames - GGPO_DEFAULT_PREDICTION_FRAMES || !Result->bStatesMatch)
+			{
+				UE_LOG(LogTemp, Error, TEXT("NetBenchmark: %s spectators fell behind or diverged, the slowest at frame %d of %d"),
+					Result == &Direct ? TEXT("direct") : TEXT("relayed"), Result->SlowestSpectatorFrames, Frames);
+				bPassed = false;
+			}
+		}
+		return bPassed;
+	}
+
+	bool TestJoin(int32 JoinFrame, int32 SnapshotBytes, const TArray<int32> (&Inputs)[2])
+	{
+		// Player one's connection 0 is player two and 1 the spectator.
+		LoopbackConnectionManager Connections[3];
+		LoopbackConnectionManager::Connect(&Connections[0], &Connections[1]);
+		FLoopbackPeer Peers[2];
+		FLoopbackPeer Spectator;
+		Peers[0].bMakeSnapshots = true;
+		Peers[0].SnapshotPadding = SnapshotBytes;
+		Peers[0].bRecordStates = true;
+		double SyncTime;
+		if (!Peers[0].Start(&Connections[0], 0, 0, true) || !Peers[1].Start(&Connections[1], 0, 1, true))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not start GGPO sessions"));
+			return false;
+		}
+		if (!WaitForPeers(Peers, SyncTime))
+			return false;
+
+		auto PlayFrame = [&]()
+		{
+			for (int32 i = 0; i < 2; i++)
+			{
+				FLoopbackPeer& Peer = Peers[i];
+				int32 Input = Inputs[i].Num() > 0 ? Inputs[i][Peer.Frames % Inputs[i].Num()] : (Peer.Frames / 13 + i) % 7;
+				if (GGPONet::ggpo_add_local_input(Peer.Session, Peer.LocalHandle, &Input, sizeof(Input)) == GGPO_OK)
+					Peer.AdvanceFrame();
+			}
+		};
+		auto Idle = [&]()
+		{
+			for (FLoopbackPeer& Peer : Peers)
+			{
+				GGPONet::ggpo_idle(Peer.Session, 0);
+			}
+			if (Spectator.Session)
+			{
+				GGPONet::ggpo_idle(Spectator.Session, 0);
+				for (int32 Before = -1; Before != Spectator.Frames;)
+				{
+					Before = Spectator.Frames;
+					Spectator.AdvanceFrame();
+				}
+			}
+		};
+		auto StopAll = [&]()
+		{
+			Spectator.Stop();
+			Peers[0].Stop();
+			Peers[1].Stop();
+		};
+
+		double StartTime = FPlatformTime::Seconds();
+		while (FMath::Min(Peers[0].Frames, Peers[1].Frames) < JoinFrame && FPlatformTime::Seconds() - StartTime < 60)
+		{
+			PlayFrame();
+			Idle();
+		}
+		LoopbackConnectionManager::Connect(&Connections[0], &Connections[2]);
+		if (FMath::Min(Peers[0].Frames, Peers[1].Frames) < JoinFrame || !Peers[0].AddSpectator(1) || !Spectator.Spectate(&Connections[2], 0))
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: could not add a spectator at frame %d"), JoinFrame);
+			StopAll();
+			return false;
+		}
+
+		// The spectator has caught up once it's as close as spectators watching from the start get.
+		const int32 Behind = GGPO_DEFAULT_PREDICTION_FRAMES + GGPO_SPECTATOR_INPUT_INTERVAL;
+		const double JoinTime = FPlatformTime::Seconds();
+		double CaughtUpTime = 0;
+		double Accumulator = 0;
+		double LastTime = JoinTime;
+		while (LastTime - JoinTime < 10 && (CaughtUpTime == 0 || LastTime - CaughtUpTime < 1))
+		{
+			FPlatformProcess::Sleep(0.0005f);
+			const double Now = FPlatformTime::Seconds();
+			Accumulator += Now - LastTime;
+			LastTime = Now;
+			for (; Accumulator >= OneFrame; Accumulator -= OneFrame)
+			{
+				PlayFrame();
+			}
+			Idle();
+			if (CaughtUpTime == 0 && Spectator.SnapshotFrame >= 0 && Spectator.Frames >= Peers[0].Frames - Behind)
+				CaughtUpTime = FPlatformTime::Seconds();
+		}
+
+		// Let the last inputs reach the spectator.
+		const double DrainTime = FPlatformTime::Seconds();
+		while (FPlatformTime::Seconds() - DrainTime < 0.5)
+		{
+			FPlatformProcess::Sleep(0.0005f);
+			Idle();
+		}
+		const bool bStatesMatch = Spectator.Frames > 0 && Spectator.Frames < Peers[0].States.Num() && Spectator.State == Peers[0].States[Spectator.Frames];
+		if (Spectator.SnapshotFrame < 0 || CaughtUpTime == 0 || !bStatesMatch)
+		{
+			UE_LOG(LogTemp, Error, TEXT("NetBenchmark: a spectator joining at frame %d %s, reaching frame %d of %d"), JoinFrame,
+				Spectator.SnapshotFrame < 0 ? TEXT("never loaded a snapshot") : CaughtUpTime == 0 ? TEXT("never caught up") : TEXT("diverged"),
+				Spectator.Frames, Peers[0].Frames);
+			StopAll();
+			return false;
+		}
+		UE_LOG(LogTemp, Display, TEXT("NetBenchmark: spectator joined at frame %d: %d byte snapshot of frame %d loaded in %.0f ms, caught up %.0f ms later"),
+			JoinFrame, SnapshotBytes + static_cast<int32>(sizeof(int32) * 2), Spectator.SnapshotFrame, (Spectator.SnapshotLoadTime - JoinTime) * 1000,
+			(CaughtUpTime - Spectator.SnapshotLoadTime) * 1000);
+		StopAll();
+		return true;
+	}
+}
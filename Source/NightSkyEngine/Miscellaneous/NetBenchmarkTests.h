@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+#include "include/ggponet.h"
+
+class ANightSkyGameState;
+class ConnectionManager;
+class UDPConnectionManager;
+class UReplaySaveInfo;
+struct NetworkConditions;
+
+/**
+ * Tests run by the NetBenchmark commandlet, one file per group: the RPC path and UDP sockets, GGPO sessions, and
+ * spectators joining and watching.
+ */
+namespace NetBenchmark
+{
+	/** One side of a two player GGPO session whose game state is a single integer. */
+	struct FLoopbackPeer
+	{
+		GGPOSession* Session = nullptr;
+		GGPOPlayerHandle LocalHandle = GGPO_INVALID_HANDLE;
+		GGPOPlayerHandle RemoteHandle = GGPO_INVALID_HANDLE;
+		int32 State = 0;
+		int32 Frames = 0;
+		bool bRunning = false;
+		int32 Rollbacks = 0;
+		int32 MaxRollbackFrames = 0;
+		int32 ResimulatedFrames = 0;
+		// The largest GGPO_EVENTCODE_TIMESYNC recommendation since the last check.
+		int32 TimeSyncFramesAhead = 0;
+		// Lets spectators join mid-match, with snapshots padded by this many bytes to stand in for a real game state.
+		bool bMakeSnapshots = false;
+		int32 SnapshotPadding = 0;
+		// The frame of the snapshot this spectator joined from, and when it was loaded.
+		int32 SnapshotFrame = -1;
+		double SnapshotLoadTime = 0;
+		// The state after every frame played, when bRecordStates is set. Resimulating overwrites the predicted ones.
+		bool bRecordStates = false;
+		TArray<int32> States;
+		// The deepest rollback taken from each frame, when bRecordRollbacks is set.
+		bool bRecordRollbacks = false;
+		TArray<int32> RollbackDepths;
+
+		GGPOSessionCallbacks CreateCallbacks();
+		bool Start(ConnectionManager* Connection, int32 RemoteConnection, int32 PlayerIndex, bool bCompactInput, const GGPOSessionLimits* Limits = nullptr);
+		bool Spectate(ConnectionManager* Connection, int32 HostConnection);
+		bool AddSpectator(int32 Connection);
+		void AdvanceFrame();
+		void Stop();
+	};
+
+	/** Idles both sessions until they synchronize. Stops them if they don't. */
+	bool WaitForPeers(FLoopbackPeer (&Peers)[2], double& OutSyncTime);
+
+	// Socket and ring tests, in NetBenchmarkSocketTests.cpp.
+
+	/**
+	 * Streams messages through the RPC path one per RPC and coalesced, then checks them through a listen server's copy of
+	 * a remote player's controller.
+	 */
+	bool TestRpcPath(int32 MessagesPerTick, int32 PacketSize);
+
+#if PLATFORM_LINUX
+	inline double CyclesToMicroseconds(uint64 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds64(Cycles) * 1000.0;
+	}
+
+	/** Binds two managers to free loopback ports and connects them to each other. */
+	bool ConnectPair(UDPConnectionManager& A, UDPConnectionManager& B, int32& OutAToB, int32& OutBToA);
+
+	/** Streams packets from one UDP manager to another, in batches, and reports the rate they arrive at. */
+	bool TestThroughput(int32 PacketSize);
+
+	/** Bounces a packet between two UDP managers RoundTrips times and reports the round trip times. */
+	bool TestRoundTrip(int32 RoundTrips, int32 PacketSize);
+
+	/** How the waiting peer in TestIdleWake spends the time between its frames. */
+	enum class EIdleMode : uint8
+	{
+		// ggpo_idle(0) in a loop.
+		Spin,
+		// ggpo_idle(0) and a millisecond's sleep, the way ggpo_idle used to wait.
+		Sleep,
+		// ggpo_idle with the time until the next frame, waking when a packet arrives.
+		Wait,
+	};
+
+	/**
+	 * Plays two sessions in real time for Seconds, the second on its own thread idling between frames as Mode says.
+	 * Reports how long after the first peer sends an input the second one's ggpo_idle returns, and the share of a core
+	 * the second thread uses.
+	 */
+	bool TestIdleWake(double Seconds, EIdleMode Mode);
+#endif
+
+	// GGPO session tests, in NetBenchmarkSessionTests.cpp.
+
+	/**
+	 * Plays two sessions in real time, at 60 frames per second, over an in-process loopback whose packets are impaired
+	 * by Conditions in both directions, with the prediction window and input queue in Limits. Reports rollbacks, how
+	 * deep they went and how often a player had to wait at the edge of the prediction window. If OutRollbackDepths is
+	 * given, it gets the deepest rollback player one took from each frame played.
+	 */
+	bool TestConditions(const FString& Profile, const NetworkConditions& Conditions, const GGPOSessionLimits& Limits, int32 Frames,
+		const TArray<int32> (&Inputs)[2], TArray<int32>* OutRollbackDepths = nullptr);
+
+	/**
+	 * Runs BenchmarkSaveInterval on a replay for each save interval, with the rollbacks recorded under a network profile,
+	 * and reports the fastest interval.
+	 */
+	bool TestSaveIntervals(const FString& Name, const FString& Profile, const UReplaySaveInfo* Replay,
+		TSubclassOf<ANightSkyGameState> GameStateClass, const TArray<int32>& RollbackDepths, const TArray<int32>& SaveIntervals);
+
+#if PLATFORM_LINUX
+	/** Binds two UDP managers to loopback ports, starts a session on each and waits for them to synchronize. */
+	bool StartPeers(FLoopbackPeer (&Peers)[2], UDPConnectionManager (&Connections)[2], bool bCompactInput, double& OutSyncTime);
+
+	/**
+	 * Plays two sessions against each other. Each player's inputs come from Inputs, looping if it's shorter than Frames,
+	 * or are generated when it's empty.
+	 */
+	bool TestSessions(int32 Frames, const TArray<int32> (&Inputs)[2], bool bCompactInput);
+
+	/**
+	 * Plays two sessions in real time for Seconds, with the second peer's clock running fast by Drift. Each peer paces
+	 * its frames the way AFighterMultiplayerRunner::Update does, with time sync pacing on or off. Reports when the
+	 * clients last drifted more than a frame apart, frames skipped and rollbacks.
+	 */
+	bool TestTimeSync(double Seconds, double Drift, bool bPacing);
+#endif
+
+	// Spectator and join tests, in NetBenchmarkSpectatorTests.cpp.
+
+	/**
+	 * Compares what player one sends with Spectators watching directly against the same audience behind one relay.
+	 */
+	bool TestSpectators(int32 Spectators, int32 Frames, const TArray<int32> (&Inputs)[2]);
+
+	/**
+	 * Plays two sessions as fast as they can until JoinFrame, then adds a spectator to player one, which joins from a
+	 * snapshot padded to SnapshotBytes while the players go on in real time. Reports how long the snapshot took to
+	 * load and the spectator to catch up, and checks that it plays the same states as player one.
+	 */
+	bool TestJoin(int32 JoinFrame, int32 SnapshotBytes, const TArray<int32> (&Inputs)[2]);
+}
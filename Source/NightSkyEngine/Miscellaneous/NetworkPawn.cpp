@@ -39,14 +39,14 @@ void ANetworkPawn::ServerGetFinishedLoading_Implementation(bool Finished)
 
 void ANetworkPawn::SendGgpoToClient_Implementation(const TArray<int8> &GgpoMessage)
 {
-	 if(FighterMultiplayerRunner)
-	 	FighterMultiplayerRunner->connectionManager->receiveSchedule.AddTail(GgpoMessage);
+	 if(FighterMultiplayerRunner && FighterMultiplayerRunner->connectionManager)
+	 	FighterMultiplayerRunner->connectionManager->UnpackToReceiveSchedule(GgpoMessage);
 }
 
 void ANetworkPawn::SendGgpoToServer_Implementation(const TArray<int8> &GgpoMessage)
 {
-	 if(FighterMultiplayerRunner)
-	 	FighterMultiplayerRunner->connectionManager->receiveSchedule.AddTail(GgpoMessage);
+	 if(FighterMultiplayerRunner && FighterMultiplayerRunner->connectionManager)
+	 	FighterMultiplayerRunner->connectionManager->UnpackToReceiveSchedule(GgpoMessage);
 }
 
 void ANetworkPawn::ClientGetBattleData_Implementation(FBattleData InBattleData)
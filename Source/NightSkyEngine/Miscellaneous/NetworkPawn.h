@@ -42,6 +42,7 @@ public:
 	UPROPERTY()
 	class AFighterMultiplayerRunner* FighterMultiplayerRunner = nullptr;
 	
+	// GGPO messages are sent as one payload per tick, packed by RpcConnectionManager::PackSendSchedule.
 	UFUNCTION( Server, Reliable )
 	void SendGgpoToServer(const TArray<int8> &GgpoMessage);
 	UFUNCTION( Client, Reliable )
@@ -3,6 +3,47 @@
 
 #include "RpcConnectionManager.h"
 
+FRpcMessageRing::FRpcMessageRing()
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+	Slots = MakeUnique<FRpcMessage[]>(Capacity);
+}
+
+bool FRpcMessageRing::Push(const int8* Data, int32 Size)
+{
+	const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+	if (Size < 0 || Size > FRpcMessage::MaxSize || CurrentHead - Tail.load(std::memory_order_acquire) == Capacity)
+	{
+		const uint32 TotalDropped = Dropped.fetch_add(1, std::memory_order_relaxed) + 1;
+		UE_LOG(LogTemp, Warning, TEXT("RpcConnectionManager: dropped a %d byte message, %u dropped in total"), Size, TotalDropped);
+		return false;
+	}
+	FRpcMessage& Slot = Slots[CurrentHead & (Capacity - 1)];
+	FMemory::Memcpy(Slot.Data, Data, Size);
+	Slot.Size = Size;
+	Head.store(CurrentHead + 1, std::memory_order_release);
+	return true;
+}
+
+const FRpcMessage* FRpcMessageRing::Peek() const
+{
+	const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+	if (CurrentTail == Head.load(std::memory_order_acquire))
+		return nullptr;
+	return &Slots[CurrentTail & (Capacity - 1)];
+}
+
+void FRpcMessageRing::Pop()
+{
+	const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+	check(CurrentTail != Head.load(std::memory_order_acquire));
+	Tail.store(CurrentTail + 1, std::memory_order_release);
+}
+
+int32 FRpcMessageRing::Num() const
+{
+	return Head.load(std::memory_order_acquire) - Tail.load(std::memory_order_acquire);
+}
 
 RpcConnectionManager::RpcConnectionManager()
 {
@@ -15,25 +56,62 @@ RpcConnectionManager::~RpcConnectionManager()
 
 int RpcConnectionManager::SendTo(const char* buffer, int len, int flags, int connection_id)
 {
-	const TArray scheduledMessage((int8*)buffer,len);
-	sendSchedule.AddTail(scheduledMessage);
-
-	return 0;
+	return sendSchedule.Push((const int8*)buffer, len) ? 0 : -1;
 }
 
 int RpcConnectionManager::RecvFrom(char* buffer, int len, int flags, int* connection_id)
 {
-	if (receiveSchedule.Num() == 0)
-		return -1;
-	auto msg = receiveSchedule.GetTail();
-	
-	auto msgVal = msg->GetValue();
-	auto rec = (char*)msgVal.GetData();
-	auto leng = msgVal.Num(); // int* to char* size
-	if (leng == 0)
-		return -1;
-	memcpy(buffer, rec, leng);
-	receiveSchedule.Empty();
-	*connection_id = playerIndex;
-	return leng;
+	// Messages are returned one per call, oldest first, until the ring is empty.
+	for (const FRpcMessage* msg = receiveSchedule.Peek(); msg != nullptr; msg = receiveSchedule.Peek())
+	{
+		const int leng = FMath::Min(msg->Size, len);
+		memcpy(buffer, msg->Data, leng);
+		receiveSchedule.Pop();
+		if (leng > 0)
+		{
+			*connection_id = playerIndex;
+			return leng;
+		}
+	}
+	return -1;
+}
+
+bool RpcConnectionManager::PackSendSchedule(TArray<int8>& OutPayload)
+{
+	static_assert(FRpcMessage::MaxSize <= MAX_uint16, "Message sizes must fit the uint16 length prefix");
+	OutPayload.Reset();
+	while (const FRpcMessage* msg = sendSchedule.Peek())
+	{
+		const int32 PrefixedSize = sizeof(uint16) + msg->Size;
+		if (OutPayload.Num() > 0 && OutPayload.Num() + PrefixedSize > MaxPayloadSize)
+			break;
+		const int32 Offset = OutPayload.AddUninitialized(PrefixedSize);
+		const uint16 Size = static_cast<uint16>(msg->Size);
+		FMemory::Memcpy(OutPayload.GetData() + Offset, &Size, sizeof(uint16));
+		FMemory::Memcpy(OutPayload.GetData() + Offset + sizeof(uint16), msg->Data, msg->Size);
+		sendSchedule.Pop();
+	}
+	return OutPayload.Num() > 0;
+}
+
+int32 RpcConnectionManager::UnpackToReceiveSchedule(const TArray<int8>& Payload)
+{
+	int32 Count = 0;
+	int32 Offset = 0;
+	while (Offset + static_cast<int32>(sizeof(uint16)) <= Payload.Num())
+	{
+		uint16 Size;
+		FMemory::Memcpy(&Size, Payload.GetData() + Offset, sizeof(uint16));
+		Offset += sizeof(uint16);
+		if (Offset + Size > Payload.Num())
+			break;
+		receiveSchedule.Push(Payload.GetData() + Offset, Size);
+		Offset += Size;
+		Count++;
+	}
+	if (Offset != Payload.Num())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("RpcConnectionManager: discarded %d bytes of a truncated %d byte payload"), Payload.Num() - Offset, Payload.Num());
+	}
+	return Count;
 }
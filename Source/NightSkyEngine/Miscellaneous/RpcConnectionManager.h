@@ -2,9 +2,47 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "CoreMinimal.h"
 #include "include/connection_manager.h"
 
+/**
+ * A GGPO message copied into a ring slot.
+ */
+struct FRpcMessage
+{
+	static constexpr int32 MaxSize = 4096;
+
+	int32 Size = 0;
+	int8 Data[MaxSize];
+};
+
+/**
+ * Bounded single-producer single-consumer ring of GGPO messages.
+ * Messages are copied into fixed-size slots and read back in the order they were pushed.
+ */
+class NIGHTSKYENGINE_API FRpcMessageRing
+{
+public:
+	static constexpr uint32 Capacity = 64;
+
+	FRpcMessageRing();
+
+	bool Push(const int8* Data, int32 Size); //copies a message into the next slot. fails if the ring is full or the message too large
+	const FRpcMessage* Peek() const; //returns the oldest message, or nullptr if the ring is empty
+	void Pop(); //releases the message returned by Peek
+	int32 Num() const;
+	uint32 GetDropped() const { return Dropped.load(std::memory_order_relaxed); }
+
+private:
+	TUniquePtr<FRpcMessage[]> Slots;
+	// Only the producer writes Head and only the consumer writes Tail.
+	std::atomic<uint32> Head = 0;
+	std::atomic<uint32> Tail = 0;
+	std::atomic<uint32> Dropped = 0;
+};
+
 /**
  * 
  */
@@ -16,9 +54,18 @@ public:
 	
 	virtual int SendTo(const char* buffer, int len, int flags, int connection_id);
 	virtual int RecvFrom(char* buffer, int len, int flags, int* connection_id);
+
+	// Queued messages are coalesced into payloads of this many bytes at most, the default net.MaxRepArraySize.
+	// A single message larger than this is sent on its own.
+	static constexpr int32 MaxPayloadSize = 2048;
+
+	bool PackSendSchedule(TArray<int8>& OutPayload); //moves queued messages into one payload, each prefixed with its uint16 length. returns false if nothing was queued
+	int32 UnpackToReceiveSchedule(const TArray<int8>& Payload); //queues every message in a payload for GGPO. returns the number of messages queued
 	
 	int playerIndex;
-	TDoubleLinkedList<TArray<int8>> sendSchedule;
-	TDoubleLinkedList<TArray<int8>> receiveSchedule;
+	// Messages from GGPO waiting to be sent over RPC.
+	FRpcMessageRing sendSchedule;
+	// Messages received over RPC waiting for GGPO.
+	FRpcMessageRing receiveSchedule;
 };
 